@@ -331,5 +331,64 @@ class RESTTest (BitcoinTestFramework):
         json_obj = json.loads(json_string)
         assert_equal(json_obj['bestblockhash'], bb_hash)
 
+        #################
+        # /rest/blocks/ #
+        #################
+
+        height = self.nodes[0].getblockcount()
+        hashes = [self.nodes[0].getblockhash(h) for h in range(height - 2, height + 1)]
+
+        # json returns the blocks with tx details in height order
+        json_string = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height - 2)+'/3'+self.FORMAT_SEPARATOR+'json')
+        json_obj = json.loads(json_string)
+        assert_equal([b['hash'] for b in json_obj], hashes)
+        assert_equal(json_obj[2]['tx'][0]['txid'], self.nodes[0].getblock(hashes[2])['tx'][0])
+
+        # hex returns one serialized block per line, bin the same blocks concatenated
+        response_hex = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height - 2)+'/3'+self.FORMAT_SEPARATOR+'hex', True)
+        assert_equal(response_hex.status, 200)
+        hex_blocks = response_hex.read().decode('utf-8').split()
+        assert_equal(hex_blocks, [self.nodes[0].getblock(h, False) for h in hashes])
+        response_bin = http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height - 2)+'/3'+self.FORMAT_SEPARATOR+'bin', True)
+        assert_equal(response_bin.status, 200)
+        assert_equal(encode(response_bin.read(), "hex_codec").decode('ascii'), ''.join(hex_blocks))
+
+        # the range is cut at the tip, also when start + count doesn't fit a 32 bit int
+        json_obj = json.loads(http_get_call(url.hostname, url.port, '/rest/blocks/'+str(height)+'/100'+self.FORMAT_SEPARATOR+'json'))
+        assert_equal([b['hash'] for b in json_obj], hashes[2:])
+        response = http_get_call(url.hostname, url.port, '/rest/blocks/2147483647/100'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 200)
+        assert_equal(json.loads(response.read().decode('utf-8')), [])
+
+        # invalid ranges
+        for path in ['0/0', '0/101', '-1/1', '0', 'a/1']:
+            response = http_get_call(url.hostname, url.port, '/rest/blocks/'+path+self.FORMAT_SEPARATOR+'json', True)
+            assert_equal(response.status, 400)
+
+        ################
+        # /rest/sigma/ #
+        ################
+
+        json_obj = json.loads(http_get_call(url.hostname, url.port, '/rest/sigma/'+str(height - 2)+'/10'+self.FORMAT_SEPARATOR+'json'))
+        assert_equal([b['hash'] for b in json_obj], hashes)
+        assert_equal([b['height'] for b in json_obj], list(range(height - 2, height + 1)))
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/2147483647/2000'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 200)
+        response = http_get_call(url.hostname, url.port, '/rest/sigma/0/2001'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
+        ##################
+        # /rest/address/ #
+        ##################
+
+        # the nodes run without -addressindex
+        address = self.nodes[0].getnewaddress()
+        response = http_get_call(url.hostname, url.port, '/rest/address/utxos/'+address+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+        response = http_get_call(url.hostname, url.port, '/rest/address/deltas/'+address+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 404)
+        response = http_get_call(url.hostname, url.port, '/rest/address/deltas/invalid'+self.FORMAT_SEPARATOR+'json', True)
+        assert_equal(response.status, 400)
+
 if __name__ == '__main__':
     RESTTest ().main ()
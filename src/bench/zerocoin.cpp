@@ -0,0 +1,92 @@
+// Copyright (c) 2013 Ian Miers, Christina Garman and Matthew Green
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// Benchmarks from libzerocoin/Benchmark.cpp ported to bench_bitcoin
+
+#include "bench.h"
+
+#include "zerocoin.h"
+#include "streams.h"
+#include "libzerocoin/Zerocoin.h"
+
+#include <memory>
+#include <vector>
+
+using namespace libzerocoin;
+
+// Number of coins in the accumulator used by the spend benchmarks
+static const int ZEROCOIN_BENCH_COINS = 10;
+
+static void ZerocoinPowMod(benchmark::State& state)
+{
+    const IntegerGroupParams &group = ZCParamsV2->coinCommitmentGroup;
+    CBigNum exponent = CBigNum::randBignum(group.groupOrder);
+    CBigNum modulus = ZCParamsV2->accumulatorParams.accumulatorModulus;
+    CBigNum base = ZCParamsV2->accumulatorParams.accumulatorBase;
+
+    while (state.KeepRunning()) {
+        base = base.pow_mod(exponent, modulus);
+    }
+}
+
+static void ZerocoinPowModPublic(benchmark::State& state)
+{
+    const IntegerGroupParams &group = ZCParamsV2->coinCommitmentGroup;
+    CBigNum exponent = CBigNum::randBignum(group.groupOrder);
+    CBigNum modulus = ZCParamsV2->accumulatorParams.accumulatorModulus;
+    CBigNum base = ZCParamsV2->accumulatorParams.accumulatorBase;
+
+    while (state.KeepRunning()) {
+        base = base.pow_mod_public(exponent, modulus);
+    }
+}
+
+static void ZerocoinMint(benchmark::State& state)
+{
+    while (state.KeepRunning()) {
+        PrivateCoin coin(ZCParamsV2);
+    }
+}
+
+static void ZerocoinAccumulate(benchmark::State& state)
+{
+    PrivateCoin coin(ZCParamsV2);
+    Accumulator accumulator(&ZCParamsV2->accumulatorParams);
+
+    while (state.KeepRunning()) {
+        accumulator += coin.getPublicCoin();
+    }
+}
+
+static void ZerocoinSpendVerify(benchmark::State& state)
+{
+    std::vector<std::unique_ptr<PrivateCoin>> coins;
+    for (int i = 0; i < ZEROCOIN_BENCH_COINS; i++)
+        coins.emplace_back(new PrivateCoin(ZCParamsV2));
+
+    Accumulator accumulator(&ZCParamsV2->accumulatorParams);
+    AccumulatorWitness witness(ZCParamsV2, accumulator, coins[0]->getPublicCoin());
+    for (const auto &coin: coins) {
+        accumulator += coin->getPublicCoin();
+        witness += coin->getPublicCoin();
+    }
+
+    SpendMetaData metaData(0, uint256());
+    CoinSpend spend(ZCParamsV2, *coins[0], accumulator, witness, metaData);
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << spend;
+    CoinSpend newSpend(ZCParamsV2, stream);
+
+    while (state.KeepRunning()) {
+        if (!newSpend.Verify(accumulator, metaData))
+            throw std::runtime_error("ZerocoinSpendVerify: spend didn't verify");
+    }
+}
+
+BENCHMARK(ZerocoinPowMod);
+BENCHMARK(ZerocoinPowModPublic);
+BENCHMARK(ZerocoinMint);
+BENCHMARK(ZerocoinAccumulate);
+BENCHMARK(ZerocoinSpendVerify);
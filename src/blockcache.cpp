@@ -0,0 +1,240 @@
+// Copyright (c) 2020 The Zcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockcache.h"
+
+#include "chain.h"
+#include "clientversion.h"
+#include "compat.h"
+#include "core_memusage.h"
+#include "crypto/common.h"
+#include "main.h"
+#include "streams.h"
+#include "util.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CBlockFileReader blockFileReader;
+CBlockCache blockCache;
+
+CMappedBlockFile::CMappedBlockFile() : pdata(NULL), nSize(0) {}
+
+CMappedBlockFile::~CMappedBlockFile()
+{
+#ifndef WIN32
+    if (pdata)
+        munmap((void*)pdata, nSize);
+#endif
+}
+
+bool CMappedBlockFile::Map(int nFile)
+{
+#ifndef WIN32
+    boost::filesystem::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the descriptor is closed
+    close(fd);
+    if (p == MAP_FAILED)
+        return false;
+
+    pdata = (const unsigned char*)p;
+    nSize = (size_t)st.st_size;
+    return true;
+#else
+    return false;
+#endif
+}
+
+CBlockFileReader::CBlockFileReader() : nUseCounter(0), fEnabled(DEFAULT_MMAP_BLOCKS) {}
+
+void CBlockFileReader::SetEnabled(bool fEnabledIn)
+{
+    LOCK(cs);
+    fEnabled = fEnabledIn;
+    if (!fEnabled)
+        mapFiles.clear();
+}
+
+std::shared_ptr<CMappedBlockFile> CBlockFileReader::GetFile(int nFile, size_t nMinSize)
+{
+    LOCK(cs);
+    if (!fEnabled)
+        return std::shared_ptr<CMappedBlockFile>();
+
+    std::map<int, MappedFile>::iterator it = mapFiles.find(nFile);
+    if (it != mapFiles.end() && it->second.file->size() >= nMinSize) {
+        it->second.nLastUsed = ++nUseCounter;
+        return it->second.file;
+    }
+
+    // Either not mapped yet or the file has been appended to since it was mapped.
+    // Readers still holding the old mapping keep it alive until they are done
+    std::shared_ptr<CMappedBlockFile> file = std::make_shared<CMappedBlockFile>();
+    if (!file->Map(nFile) || file->size() < nMinSize) {
+        if (it != mapFiles.end())
+            mapFiles.erase(it);
+        return std::shared_ptr<CMappedBlockFile>();
+    }
+
+    if (it == mapFiles.end() && mapFiles.size() >= MAX_MAPPED_BLOCK_FILES) {
+        std::map<int, MappedFile>::iterator itOldest = mapFiles.begin();
+        for (std::map<int, MappedFile>::iterator itFile = mapFiles.begin(); itFile != mapFiles.end(); ++itFile) {
+            if (itFile->second.nLastUsed < itOldest->second.nLastUsed)
+                itOldest = itFile;
+        }
+        mapFiles.erase(itOldest);
+    }
+
+    MappedFile &mapped = mapFiles[nFile];
+    mapped.file = file;
+    mapped.nLastUsed = ++nUseCounter;
+    return file;
+}
+
+bool CBlockFileReader::ReadBlock(CBlock &block, const CDiskBlockPos &pos)
+{
+    // Blocks are stored as message start, size and the block itself, pos points to the block
+    if (pos.IsNull() || pos.nPos < 8)
+        return false;
+
+    std::shared_ptr<CMappedBlockFile> file = GetFile(pos.nFile, pos.nPos);
+    if (!file)
+        return false;
+
+    const unsigned char *pdata = file->data();
+    uint32_t nBlockSize = ReadLE32(pdata + pos.nPos - 4);
+    if (file->size() - pos.nPos < nBlockSize) {
+        file = GetFile(pos.nFile, (size_t)pos.nPos + nBlockSize);
+        if (!file)
+            return false;
+        pdata = file->data();
+    }
+
+    try {
+        CMemoryReader reader(pdata + pos.nPos, nBlockSize, SER_DISK, CLIENT_VERSION);
+        reader >> block;
+    } catch (const std::exception &e) {
+        LogPrint("blockcache", "%s: failed to read block at %s from the mapped file: %s\n", __func__, pos.ToString(), e.what());
+        block.SetNull();
+        return false;
+    }
+    return true;
+}
+
+void CBlockFileReader::Invalidate(int nFile)
+{
+    LOCK(cs);
+    mapFiles.erase(nFile);
+}
+
+void CBlockFileReader::Clear()
+{
+    LOCK(cs);
+    mapFiles.clear();
+}
+
+CBlockCache::CBlockCache() : nUsage(0), nMaxUsage((size_t)DEFAULT_BLOCK_CACHE_SIZE << 20), nHits(0), nMisses(0) {}
+
+void CBlockCache::SetMaxUsage(size_t nMaxUsageIn)
+{
+    LOCK(cs);
+    nMaxUsage = nMaxUsageIn;
+    Evict(nMaxUsage);
+}
+
+void CBlockCache::Evict(size_t nTargetUsage)
+{
+    AssertLockHeld(cs);
+    while (nUsage > nTargetUsage && !lruBlocks.empty()) {
+        const CacheEntry &entry = lruBlocks.back();
+        nUsage -= entry.nUsage;
+        mapBlocks.erase(entry.hash);
+        lruBlocks.pop_back();
+    }
+}
+
+bool CBlockCache::Get(const uint256 &hash, CBlock &block)
+{
+    std::shared_ptr<const CBlock> cached;
+    {
+        LOCK(cs);
+        std::map<uint256, std::list<CacheEntry>::iterator>::iterator it = mapBlocks.find(hash);
+        if (it == mapBlocks.end()) {
+            nMisses++;
+            return false;
+        }
+        nHits++;
+        lruBlocks.splice(lruBlocks.begin(), lruBlocks, it->second);
+        cached = it->second->block;
+    }
+
+    // Copy outside of the lock, only the transaction references are duplicated
+    block.SetNull();
+    *((CBlockHeader*)&block) = *cached;
+    block.vtx = cached->vtx;
+    block.vchBlockSig = cached->vchBlockSig;
+    return true;
+}
+
+void CBlockCache::Insert(const uint256 &hash, const CBlock &block)
+{
+    // Keep only the data read from disk, memory only validation state stays with the caller
+    std::shared_ptr<CBlock> copy = std::make_shared<CBlock>(block.GetBlockHeader());
+    copy->vtx = block.vtx;
+    copy->vchBlockSig = block.vchBlockSig;
+    size_t nBlockUsage = RecursiveDynamicUsage(*copy) + sizeof(CacheEntry);
+
+    LOCK(cs);
+    if (nBlockUsage > nMaxUsage || mapBlocks.count(hash))
+        return;
+
+    Evict(nMaxUsage - nBlockUsage);
+    CacheEntry entry;
+    entry.hash = hash;
+    entry.block = copy;
+    entry.nUsage = nBlockUsage;
+    lruBlocks.push_front(entry);
+    mapBlocks[hash] = lruBlocks.begin();
+    nUsage += nBlockUsage;
+}
+
+void CBlockCache::Clear()
+{
+    LOCK(cs);
+    lruBlocks.clear();
+    mapBlocks.clear();
+    nUsage = 0;
+}
+
+size_t CBlockCache::GetUsage() const
+{
+    LOCK(cs);
+    return nUsage;
+}
+
+uint64_t CBlockCache::GetHits() const
+{
+    LOCK(cs);
+    return nHits;
+}
+
+uint64_t CBlockCache::GetMisses() const
+{
+    LOCK(cs);
+    return nMisses;
+}
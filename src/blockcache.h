@@ -0,0 +1,120 @@
+// Copyright (c) 2020 The Zcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BLOCKCACHE_H
+#define BITCOIN_BLOCKCACHE_H
+
+#include "primitives/block.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <stdint.h>
+
+#include <list>
+#include <map>
+#include <memory>
+
+struct CDiskBlockPos;
+
+/** Default for -blockcache, memory used by recently read blocks in megabytes */
+static const unsigned int DEFAULT_BLOCK_CACHE_SIZE = 32;
+/** Default for -mmapblocks */
+static const bool DEFAULT_MMAP_BLOCKS = true;
+/** Maximum number of block files kept mapped at the same time */
+static const unsigned int MAX_MAPPED_BLOCK_FILES = sizeof(void*) > 4 ? 64 : 8;
+
+/** Read-only memory mapping of a whole blk?????.dat file */
+class CMappedBlockFile
+{
+private:
+    const unsigned char *pdata;
+    size_t nSize;
+
+    CMappedBlockFile(const CMappedBlockFile&);
+    CMappedBlockFile& operator=(const CMappedBlockFile&);
+
+public:
+    CMappedBlockFile();
+    ~CMappedBlockFile();
+
+    bool Map(int nFile);
+
+    const unsigned char *data() const { return pdata; }
+    size_t size() const { return nSize; }
+};
+
+/**
+ * Deserializes blocks directly from memory mapped block files. Mappings are shared
+ * between all the readers, and are refreshed when the file has grown past the mapped size.
+ */
+class CBlockFileReader
+{
+private:
+    struct MappedFile {
+        std::shared_ptr<CMappedBlockFile> file;
+        uint64_t nLastUsed;
+    };
+
+    mutable CCriticalSection cs;
+    std::map<int, MappedFile> mapFiles;
+    uint64_t nUseCounter;
+    bool fEnabled;
+
+    std::shared_ptr<CMappedBlockFile> GetFile(int nFile, size_t nMinSize);
+
+public:
+    CBlockFileReader();
+
+    void SetEnabled(bool fEnabledIn);
+
+    //! Read the block at pos. Returns false if the block couldn't be read this way, the caller should then use file I/O
+    bool ReadBlock(CBlock &block, const CDiskBlockPos &pos);
+
+    //! Drop the mapping of a block file, e.g. because it was pruned
+    void Invalidate(int nFile);
+
+    void Clear();
+};
+
+/** Bounded LRU cache of recently read blocks, shared by all callers of ReadBlockFromDisk */
+class CBlockCache
+{
+private:
+    struct CacheEntry {
+        uint256 hash;
+        std::shared_ptr<const CBlock> block;
+        size_t nUsage;
+    };
+
+    mutable CCriticalSection cs;
+    std::list<CacheEntry> lruBlocks;                                    // most recently used first
+    std::map<uint256, std::list<CacheEntry>::iterator> mapBlocks;
+    size_t nUsage;
+    size_t nMaxUsage;
+    uint64_t nHits;
+    uint64_t nMisses;
+
+    void Evict(size_t nTargetUsage);
+
+public:
+    CBlockCache();
+
+    void SetMaxUsage(size_t nMaxUsageIn);
+
+    //! Copy the cached block to block. Transactions are shared, not copied
+    bool Get(const uint256 &hash, CBlock &block);
+
+    void Insert(const uint256 &hash, const CBlock &block);
+
+    void Clear();
+
+    size_t GetUsage() const;
+    uint64_t GetHits() const;
+    uint64_t GetMisses() const;
+};
+
+extern CBlockFileReader blockFileReader;
+extern CBlockCache blockCache;
+
+#endif // BITCOIN_BLOCKCACHE_H
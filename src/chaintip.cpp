@@ -0,0 +1,56 @@
+// Copyright (c) 2020 The Zcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chaintip.h"
+
+#include "chain.h"
+#include "main.h"
+#include "sigma.h"
+#include "zerocoin.h"
+
+static CChainTipSnapshotRef chainTipSnapshot = std::make_shared<CChainTipSnapshot>();
+
+CChainTipSnapshot::CChainTipSnapshot() :
+    pindexTip(NULL), nHeight(-1), nTime(0), nMedianTime(0), nBits(0),
+    nSigmaMints(0), nSigmaSpends(0), nZerocoinMints(0), nZerocoinSpends(0)
+{
+}
+
+const CBlockIndex* CChainTipSnapshot::GetBlockAt(int nHeightIn) const
+{
+    if (!pindexTip || nHeightIn < 0 || nHeightIn > nHeight)
+        return NULL;
+    return pindexTip->GetAncestor(nHeightIn);
+}
+
+CChainTipSnapshotRef GetChainTipSnapshot()
+{
+    return std::atomic_load(&chainTipSnapshot);
+}
+
+void PublishChainTipSnapshot(const CBlockIndex* pindexTip)
+{
+    AssertLockHeld(cs_main);
+
+    std::shared_ptr<CChainTipSnapshot> snapshot = std::make_shared<CChainTipSnapshot>();
+    if (pindexTip) {
+        snapshot->pindexTip = pindexTip;
+        snapshot->nHeight = pindexTip->nHeight;
+        snapshot->hashBlock = pindexTip->GetBlockHash();
+        snapshot->nTime = pindexTip->GetBlockTime();
+        snapshot->nMedianTime = pindexTip->GetMedianTimePast();
+        snapshot->nBits = pindexTip->nBits;
+        snapshot->nChainWork = pindexTip->nChainWork;
+
+        sigma::CSigmaState* sigmaState = sigma::CSigmaState::GetState();
+        snapshot->nSigmaMints = sigmaState->GetTotalCoins();
+        snapshot->nSigmaSpends = sigmaState->GetSpends().size();
+
+        CZerocoinState* zerocoinState = CZerocoinState::GetZerocoinState();
+        snapshot->nZerocoinMints = zerocoinState->GetTotalCoins();
+        snapshot->nZerocoinSpends = zerocoinState->usedCoinSerials.size();
+    }
+
+    std::atomic_store(&chainTipSnapshot, CChainTipSnapshotRef(snapshot));
+}
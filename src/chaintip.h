@@ -0,0 +1,54 @@
+// Copyright (c) 2020 The Zcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CHAINTIP_H
+#define BITCOIN_CHAINTIP_H
+
+#include "arith_uint256.h"
+#include "uint256.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+
+class CBlockIndex;
+
+/**
+ * Immutable summary of the active chain tip. A new one is published whenever the tip changes, so
+ * readers get a consistent view of the chain without taking cs_main.
+ */
+struct CChainTipSnapshot
+{
+    //! Tip of the active chain, NULL before the genesis block is connected. Block index entries are
+    //! never freed while the node runs and the fields used here don't change, so the ancestors of
+    //! pindexTip (see CBlockIndex::GetAncestor) can be read without locks as well
+    const CBlockIndex* pindexTip;
+    int nHeight;
+    uint256 hashBlock;
+    int64_t nTime;
+    int64_t nMedianTime;
+    uint32_t nBits;
+    arith_uint256 nChainWork;
+
+    size_t nSigmaMints;
+    size_t nSigmaSpends;
+    size_t nZerocoinMints;
+    size_t nZerocoinSpends;
+
+    CChainTipSnapshot();
+
+    //! Block of the active chain at nHeightIn, or NULL
+    const CBlockIndex* GetBlockAt(int nHeightIn) const;
+};
+
+typedef std::shared_ptr<const CChainTipSnapshot> CChainTipSnapshotRef;
+
+/** The latest published snapshot, never NULL */
+CChainTipSnapshotRef GetChainTipSnapshot();
+
+/** Publish a snapshot of pindexTip, which must be the tip of chainActive. Requires cs_main */
+void PublishChainTipSnapshot(const CBlockIndex* pindexTip);
+
+#endif // BITCOIN_CHAINTIP_H
@@ -46,6 +46,14 @@ bool CCoinsView::GetCoins(const uint256 &txid, CCoins &coins) const { return fal
 bool CCoinsView::HaveCoins(const uint256 &txid) const { return false; }
 uint256 CCoinsView::GetBestBlock() const { return uint256(); }
 bool CCoinsView::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return false; }
+bool CCoinsView::BatchWriteEntries(const std::vector<CCoinsMap::const_iterator> &entries, const uint256 &hashBlock, bool fFinal) {
+    // Views without their own implementation take a copy of the batch and keep their best block until the last one
+    CCoinsMap mapCoins;
+    BOOST_FOREACH(const CCoinsMap::const_iterator &it, entries)
+        mapCoins.insert(*it);
+    return BatchWrite(mapCoins, fFinal ? hashBlock : GetBestBlock());
+}
+std::vector<uint256> CCoinsView::GetHeadBlocks() const { return std::vector<uint256>(); }
 CCoinsViewCursor *CCoinsView::Cursor() const { return 0; }
 
 
@@ -55,11 +63,13 @@ bool CCoinsViewBacked::HaveCoins(const uint256 &txid) const { return base->HaveC
 uint256 CCoinsViewBacked::GetBestBlock() const { return base->GetBestBlock(); }
 void CCoinsViewBacked::SetBackend(CCoinsView &viewIn) { base = &viewIn; }
 bool CCoinsViewBacked::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) { return base->BatchWrite(mapCoins, hashBlock); }
+bool CCoinsViewBacked::BatchWriteEntries(const std::vector<CCoinsMap::const_iterator> &entries, const uint256 &hashBlock, bool fFinal) { return base->BatchWriteEntries(entries, hashBlock, fFinal); }
+std::vector<uint256> CCoinsViewBacked::GetHeadBlocks() const { return base->GetHeadBlocks(); }
 CCoinsViewCursor *CCoinsViewBacked::Cursor() const { return base->Cursor(); }
 
 SaltedTxidHasher::SaltedTxidHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
 
-CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), cachedCoinsUsage(0) { }
+CCoinsViewCache::CCoinsViewCache(CCoinsView *baseIn) : CCoinsViewBacked(baseIn), hasModifier(false), cachedCoinsUsage(0), nCacheHits(0), nCacheMisses(0) { }
 
 CCoinsViewCache::~CCoinsViewCache()
 {
@@ -72,8 +82,11 @@ size_t CCoinsViewCache::DynamicMemoryUsage() const {
 
 CCoinsMap::const_iterator CCoinsViewCache::FetchCoins(const uint256 &txid) const {
     CCoinsMap::iterator it = cacheCoins.find(txid);
-    if (it != cacheCoins.end())
+    if (it != cacheCoins.end()) {
+        nCacheHits++;
         return it;
+    }
+    nCacheMisses++;
     CCoins tmp;
     if (!base->GetCoins(txid, tmp))
         return cacheCoins.end();
@@ -102,6 +115,7 @@ CCoinsModifier CCoinsViewCache::ModifyCoins(const uint256 &txid) {
     std::pair<CCoinsMap::iterator, bool> ret = cacheCoins.insert(std::make_pair(txid, CCoinsCacheEntry()));
     size_t cachedCoinUsage = 0;
     if (ret.second) {
+        nCacheMisses++;
         if (!base->GetCoins(txid, ret.first->second.coins)) {
             // The parent view does not have this entry; mark it as fresh.
             ret.first->second.coins.Clear();
@@ -111,6 +125,7 @@ CCoinsModifier CCoinsViewCache::ModifyCoins(const uint256 &txid) {
             ret.first->second.flags = CCoinsCacheEntry::FRESH;
         }
     } else {
+        nCacheHits++;
         cachedCoinUsage = ret.first->second.coins.DynamicMemoryUsage();
     }
     // Assume that whenever ModifyCoins is called, the entry will be modified.
@@ -211,6 +226,11 @@ bool CCoinsViewCache::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlockIn
     return true;
 }
 
+bool CCoinsViewCache::BatchWriteEntries(const std::vector<CCoinsMap::const_iterator> &entries, const uint256 &hashBlockIn, bool fFinal) {
+    // Cached entries are merged through BatchWrite, a child cache must not bypass this one
+    return CCoinsView::BatchWriteEntries(entries, hashBlockIn, fFinal);
+}
+
 bool CCoinsViewCache::Flush() {
     bool fOk = base->BatchWrite(cacheCoins, hashBlock);
     cacheCoins.clear();
@@ -218,6 +238,74 @@ bool CCoinsViewCache::Flush() {
     return fOk;
 }
 
+bool CCoinsViewCache::Sync(size_t nBatchUsage) {
+    size_t nWritten = 0;
+    return WriteDirty(std::numeric_limits<size_t>::max(), nBatchUsage, true, nWritten);
+}
+
+bool CCoinsViewCache::SyncPartial(size_t nMaxUsage, size_t &nWritten, size_t nBatchUsage) {
+    return WriteDirty(nMaxUsage, nBatchUsage, false, nWritten);
+}
+
+bool CCoinsViewCache::WriteDirty(size_t nMaxUsage, size_t nBatchUsage, bool fFinal, size_t &nWritten) {
+    assert(!hasModifier);
+    // Hand the modified entries to the base in place, one batch at a time, so that no
+    // copy of the dirty part of the cache is ever made
+    std::vector<CCoinsMap::const_iterator> batch;
+    size_t nBatch = 0;
+    nWritten = 0;
+    for (CCoinsMap::const_iterator it = cacheCoins.begin(); it != cacheCoins.end() && nWritten < nMaxUsage;) {
+        // Advance first, pruned entries of the batch are erased once it is written
+        CCoinsMap::const_iterator cur = it++;
+        if (!(cur->second.flags & CCoinsCacheEntry::DIRTY))
+            continue;
+        batch.push_back(cur);
+        size_t nUsage = cur->second.coins.DynamicMemoryUsage() + sizeof(CCoinsMap::value_type);
+        nBatch += nUsage;
+        nWritten += nUsage;
+        if (nBatch >= nBatchUsage) {
+            if (!base->BatchWriteEntries(batch, hashBlock, false))
+                return false;
+            MarkWritten(batch);
+            batch.clear();
+            nBatch = 0;
+        }
+    }
+    if (fFinal || !batch.empty()) {
+        if (!base->BatchWriteEntries(batch, hashBlock, fFinal))
+            return false;
+        MarkWritten(batch);
+    }
+    return true;
+}
+
+void CCoinsViewCache::MarkWritten(const std::vector<CCoinsMap::const_iterator> &entries) {
+    BOOST_FOREACH(const CCoinsMap::const_iterator &it, entries) {
+        if (it->second.coins.IsPruned()) {
+            cachedCoinsUsage -= it->second.coins.DynamicMemoryUsage();
+            cacheCoins.erase(it);
+        } else {
+            // The base view has the entry now, so it is neither dirty nor fresh anymore
+            cacheCoins.find(it->first)->second.flags = 0;
+        }
+    }
+}
+
+size_t CCoinsViewCache::Trim(size_t nTargetUsage) {
+    assert(!hasModifier);
+    size_t nEvicted = 0;
+    for (CCoinsMap::iterator it = cacheCoins.begin(); it != cacheCoins.end() && DynamicMemoryUsage() > nTargetUsage;) {
+        if (it->second.flags == 0) {
+            cachedCoinsUsage -= it->second.coins.DynamicMemoryUsage();
+            it = cacheCoins.erase(it);
+            nEvicted++;
+        } else {
+            it++;
+        }
+    }
+    return nEvicted;
+}
+
 void CCoinsViewCache::Uncache(const uint256& hash)
 {
     CCoinsMap::iterator it = cacheCoins.find(hash);
@@ -231,6 +319,15 @@ unsigned int CCoinsViewCache::GetCacheSize() const {
     return cacheCoins.size();
 }
 
+unsigned int CCoinsViewCache::GetDirtyCacheSize() const {
+    unsigned int nDirty = 0;
+    for (CCoinsMap::const_iterator it = cacheCoins.begin(); it != cacheCoins.end(); it++) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY)
+            nDirty++;
+    }
+    return nDirty;
+}
+
 const CTxOut &CCoinsViewCache::GetOutputFor(const CTxIn& input) const
 {
     const CCoins* coins = AccessCoins(input.prevout.hash);
@@ -308,6 +308,10 @@ public:
     }
 };
 
+/**
+ * A cached entry holds the unspent outputs of a whole transaction, like the chainstate
+ * database. Entries per output would need a new database and undo format.
+ */
 struct CCoinsCacheEntry
 {
     CCoins coins; // The actual cached data.
@@ -362,6 +366,15 @@ public:
     //! The passed mapCoins can be modified.
     virtual bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
 
+    //! Write the given entries in place, without taking them over. A large write may be split into several
+    //! calls; the BestBlock change is only applied with the last one (fFinal). Until then the view records
+    //! the range of blocks its state may be from (see GetHeadBlocks).
+    virtual bool BatchWriteEntries(const std::vector<CCoinsMap::const_iterator> &entries, const uint256 &hashBlock, bool fFinal);
+
+    //! Retrieve the range of blocks that may have been only partially written to this view.
+    //! Returns {new tip, old tip} while a write is in progress, an empty vector if the view is consistent.
+    virtual std::vector<uint256> GetHeadBlocks() const;
+
     //! Get a cursor to iterate over the whole state
     virtual CCoinsViewCursor *Cursor() const;
 
@@ -383,6 +396,8 @@ public:
     uint256 GetBestBlock() const;
     void SetBackend(CCoinsView &viewIn);
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    bool BatchWriteEntries(const std::vector<CCoinsMap::const_iterator> &entries, const uint256 &hashBlock, bool fFinal);
+    std::vector<uint256> GetHeadBlocks() const;
     CCoinsViewCursor *Cursor() const;
 };
 
@@ -409,6 +424,9 @@ public:
     friend class CCoinsViewCache;
 };
 
+//! Memory usage of the entries CCoinsViewCache::Sync() hands to its base in one batch
+static const size_t DEFAULT_COINS_WRITE_BATCH_USAGE = 16 << 20;
+
 /** CCoinsView that adds a memory cache for transactions to another CCoinsView */
 class CCoinsViewCache : public CCoinsViewBacked
 {
@@ -427,6 +445,10 @@ protected:
     /* Cached dynamic memory usage for the inner CCoins objects. */
     mutable size_t cachedCoinsUsage;
 
+    /* Lookups served from this cache and lookups that had to go to the backing view. */
+    mutable uint64_t nCacheHits;
+    mutable uint64_t nCacheMisses;
+
 public:
     CCoinsViewCache(CCoinsView *baseIn);
     ~CCoinsViewCache();
@@ -437,6 +459,7 @@ public:
     uint256 GetBestBlock() const;
     void SetBestBlock(const uint256 &hashBlock);
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    bool BatchWriteEntries(const std::vector<CCoinsMap::const_iterator> &entries, const uint256 &hashBlock, bool fFinal);
 
     /**
      * Check if we have the given tx already loaded in this cache.
@@ -477,6 +500,29 @@ public:
      */
     bool Flush();
 
+    /**
+     * Push the modifications applied to this cache to its base like Flush(), but keep
+     * the written entries in this cache (no longer dirty) so they can still be served
+     * from memory. Spent entries are dropped. The entries are written in place, in
+     * batches of about nBatchUsage bytes, and the best block is written with the last one.
+     * If false is returned, the state of this cache (and its backing view) will be undefined.
+     */
+    bool Sync(size_t nBatchUsage = DEFAULT_COINS_WRITE_BATCH_USAGE);
+
+    /**
+     * Write modified entries worth up to nMaxUsage bytes to the base view and keep them
+     * cached like Sync(), without updating the best block of the base. The base records
+     * the blocks to replay instead (see CCoinsView::GetHeadBlocks) until the next Sync().
+     * nWritten is set to the memory usage of the written entries.
+     */
+    bool SyncPartial(size_t nMaxUsage, size_t &nWritten, size_t nBatchUsage = DEFAULT_COINS_WRITE_BATCH_USAGE);
+
+    /**
+     * Evict unmodified entries until the memory usage of the cache drops to nTargetUsage
+     * bytes or only modified entries remain. Returns the number of evicted entries.
+     */
+    size_t Trim(size_t nTargetUsage);
+
     /**
      * Removes the transaction with the given hash from the cache, if it is
      * not modified.
@@ -486,9 +532,18 @@ public:
     //! Calculate the size of the cache (in number of transactions)
     unsigned int GetCacheSize() const;
 
+    //! Calculate the number of cached transactions not yet written to the base view
+    unsigned int GetDirtyCacheSize() const;
+
     //! Calculate the size of the cache (in bytes)
     size_t DynamicMemoryUsage() const;
 
+    //! Number of lookups answered from this cache
+    uint64_t GetCacheHits() const { return nCacheHits; }
+
+    //! Number of lookups that had to query the backing view
+    uint64_t GetCacheMisses() const { return nCacheMisses; }
+
     /** 
      * Amount of bitcoins coming in to a transaction
      * Note that lightweight clients may not know anything besides the hash of previous transactions,
@@ -516,6 +571,8 @@ public:
 private:
     CCoinsMap::iterator FetchCoins(const uint256 &txid);
     CCoinsMap::const_iterator FetchCoins(const uint256 &txid) const;
+    bool WriteDirty(size_t nMaxUsage, size_t nBatchUsage, bool fFinal, size_t &nWritten);
+    void MarkWritten(const std::vector<CCoinsMap::const_iterator> &entries);
 };
 
 #endif // BITCOIN_COINS_H
@@ -6,8 +6,15 @@
 
 #include "util.h"
 #include "random.h"
+#include "sync.h"
+#include "utiltime.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdio.h>
 
 #include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
 
 #include <leveldb/cache.h>
 #include <leveldb/env.h>
@@ -15,31 +22,238 @@
 #include <memenv.h>
 #include <stdint.h>
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+/** Block cache shared by all the databases, counts the lookups of a single database */
+class CCountingCache : public leveldb::Cache
+{
+private:
+    std::shared_ptr<leveldb::Cache> base;
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+public:
+    CCountingCache(std::shared_ptr<leveldb::Cache> baseIn) : base(baseIn), nHits(0), nMisses(0) {}
+
+    Handle* Insert(const leveldb::Slice& key, void* value, size_t charge,
+                   void (*deleter)(const leveldb::Slice& key, void* value)) override
+    {
+        return base->Insert(key, value, charge, deleter);
+    }
+
+    Handle* Lookup(const leveldb::Slice& key) override
+    {
+        Handle* handle = base->Lookup(key);
+        if (handle)
+            nHits++;
+        else
+            nMisses++;
+        return handle;
+    }
+
+    void Release(Handle* handle) override { base->Release(handle); }
+    void* Value(Handle* handle) override { return base->Value(handle); }
+    void Erase(const leveldb::Slice& key) override { base->Erase(key); }
+
+    // Ids keep the blocks of different databases apart in the shared cache
+    uint64_t NewId() override { return base->NewId(); }
+
+    uint64_t GetHits() const { return nHits; }
+    uint64_t GetMisses() const { return nMisses; }
+};
+
+static CCriticalSection cs_dbregistry;
+static std::shared_ptr<leveldb::Cache> sharedBlockCache;
+static size_t nSharedBlockCacheSize = 0;
+static std::vector<CDBInstance*> vOpenDatabases;
+
+void SetSharedDBCacheSize(size_t nSize)
+{
+    LOCK(cs_dbregistry);
+    nSharedBlockCacheSize = nSize;
+    if (nSize > 0)
+        sharedBlockCache.reset(leveldb::NewLRUCache(nSize));
+    else
+        sharedBlockCache.reset();
+}
+
+size_t GetSharedDBCacheSize()
+{
+    LOCK(cs_dbregistry);
+    return nSharedBlockCacheSize;
+}
+
+static bool IsElysiumDB(const std::string& strName)
+{
+    return strName.compare(0, 3, "MP_") == 0 || strName.compare(0, 7, "Exodus_") == 0 ||
+           strName.compare(0, 7, "EXODUS_") == 0;
+}
+
+static bool ApplyDBOption(CDBOptions& opts, const std::string& strSetting, const std::string& strValue)
+{
+    int64_t nValue;
+    if (!ParseInt64(strValue, &nValue) || nValue < 0)
+        return false;
+    if (strSetting == "cache")
+        opts.nBlockCacheSize = (size_t)nValue << 20;
+    else if (strSetting == "writebuffer")
+        opts.nWriteBufferSize = (size_t)nValue << 20;
+    else if (strSetting == "maxopenfiles")
+        opts.nMaxOpenFiles = (int)nValue;
+    else if (strSetting == "bloombits")
+        opts.nBloomFilterBits = (int)nValue;
+    else if (strSetting == "compression")
+        opts.fCompression = nValue != 0;
+    else
+        return false;
+    return true;
+}
+
+CDBOptions GetDBOptions(const std::string& strName, size_t nCacheSize)
+{
+    CDBOptions opts;
+    opts.nBlockCacheSize = GetSharedDBCacheSize() > 0 ? 0 : nCacheSize / 2;
+    opts.nWriteBufferSize = nCacheSize / 4;
+    opts.nMaxOpenFiles = 64;
+    opts.nBloomFilterBits = 10;
+    opts.fCompression = false;
+
+    if (IsElysiumDB(strName)) {
+        // Elysium stores text values which compress well
+        opts.fCompression = true;
+    }
+
+    // -dboption=<name>.<setting>=<value>, later values override earlier ones
+    BOOST_FOREACH(const std::string& strOption, mapMultiArgs["-dboption"]) {
+        size_t nDot = strOption.find('.');
+        size_t nEqual = strOption.find('=');
+        if (nDot == std::string::npos || nEqual == std::string::npos || nEqual < nDot) {
+            LogPrintf("Ignoring invalid -dboption=%s\n", strOption);
+            continue;
+        }
+        if (strOption.substr(0, nDot) != strName)
+            continue;
+        std::string strSetting = strOption.substr(nDot + 1, nEqual - nDot - 1);
+        if (!ApplyDBOption(opts, strSetting, strOption.substr(nEqual + 1)))
+            LogPrintf("Ignoring invalid -dboption=%s\n", strOption);
+    }
+    return opts;
+}
+
+CDBInstance::CDBInstance(const std::string& strNameIn, const CDBOptions& opts) :
+    strName(strNameIn), pcache(NULL), pdb(NULL), nWrites(0), nWriteBytes(0), nWriteMicros(0), nStalls(0)
 {
-    leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    LOCK(cs_dbregistry);
+    std::shared_ptr<leveldb::Cache> cache;
+    if (opts.nBlockCacheSize > 0)
+        cache.reset(leveldb::NewLRUCache(opts.nBlockCacheSize));
+    else if (sharedBlockCache)
+        cache = sharedBlockCache;
+    else
+        cache.reset(leveldb::NewLRUCache(8 << 20)); // LevelDB's default
+    pcache = new CCountingCache(cache);
+
+    options.block_cache = pcache;
+    options.write_buffer_size = opts.nWriteBufferSize;
+    options.filter_policy = opts.nBloomFilterBits > 0 ? leveldb::NewBloomFilterPolicy(opts.nBloomFilterBits) : NULL;
+    options.compression = opts.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = opts.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
         options.paranoid_checks = true;
     }
-    return options;
+    options.create_if_missing = true;
+
+    vOpenDatabases.push_back(this);
+    LogPrint("db", "Options for LevelDB %s: cache=%s writebuffer=%u maxopenfiles=%d bloombits=%d compression=%d\n",
+        strName, opts.nBlockCacheSize > 0 ? strprintf("%u", opts.nBlockCacheSize) : "shared",
+        opts.nWriteBufferSize, opts.nMaxOpenFiles, opts.nBloomFilterBits, opts.fCompression);
+}
+
+CDBInstance::~CDBInstance()
+{
+    {
+        LOCK(cs_dbregistry);
+        vOpenDatabases.erase(std::remove(vOpenDatabases.begin(), vOpenDatabases.end(), this), vOpenDatabases.end());
+    }
+    delete options.filter_policy;
+    options.filter_policy = NULL;
+    delete pcache;
+    options.block_cache = NULL;
+}
+
+void CDBInstance::SetDB(leveldb::DB* pdbIn)
+{
+    LOCK(cs_dbregistry);
+    pdb = pdbIn;
+}
+
+void CDBInstance::RecordWrite(size_t nBytes, int64_t nMicros, bool fSync)
+{
+    nWrites++;
+    nWriteBytes += nBytes;
+    nWriteMicros += nMicros;
+    if (!fSync && nMicros > DB_STALL_MICROS)
+        nStalls++;
+}
+
+CDBStats CDBInstance::GetStats() const
+{
+    AssertLockHeld(cs_dbregistry);
+    CDBStats stats;
+    stats.strName = strName;
+    stats.nCacheHits = pcache->GetHits();
+    stats.nCacheMisses = pcache->GetMisses();
+    stats.nWrites = nWrites;
+    stats.nWriteBytes = nWriteBytes;
+    stats.nWriteMicros = nWriteMicros;
+    stats.nStalls = nStalls;
+    stats.dCompactionSeconds = 0;
+    stats.dCompactionReadMB = 0;
+    stats.dCompactionWriteMB = 0;
+    stats.dSizeMB = 0;
+    if (!pdb)
+        return stats;
+
+    std::string strValue;
+    for (int nLevel = 0; pdb->GetProperty(strprintf("leveldb.num-files-at-level%d", nLevel), &strValue); nLevel++)
+        stats.vFilesPerLevel.push_back(atoi(strValue));
+
+    // One line per level: Level Files Size(MB) Time(sec) Read(MB) Write(MB)
+    if (pdb->GetProperty("leveldb.stats", &strValue)) {
+        std::istringstream stream(strValue);
+        std::string strLine;
+        while (std::getline(stream, strLine)) {
+            int nLevel, nFiles;
+            double dSize, dTime, dRead, dWrite;
+            if (sscanf(strLine.c_str(), "%d %d %lf %lf %lf %lf", &nLevel, &nFiles, &dSize, &dTime, &dRead, &dWrite) != 6)
+                continue;
+            stats.dSizeMB += dSize;
+            stats.dCompactionSeconds += dTime;
+            stats.dCompactionReadMB += dRead;
+            stats.dCompactionWriteMB += dWrite;
+        }
+    }
+    return stats;
+}
+
+std::vector<CDBStats> GetDBStats()
+{
+    LOCK(cs_dbregistry);
+    std::vector<CDBStats> vStats;
+    BOOST_FOREACH(const CDBInstance* instance, vOpenDatabases)
+        vStats.push_back(instance->GetStats());
+    return vStats;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate) :
+    instance(path.filename().string(), GetDBOptions(path.filename().string(), nCacheSize))
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
-    options.create_if_missing = true;
+    leveldb::Options& options = instance.options;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
         options.env = penv;
@@ -54,6 +268,7 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
+    instance.SetDB(pdb);
     LogPrintf("Opened LevelDB successfully\n");
 
     // The base-case obfuscation key, which is a noop.
@@ -78,20 +293,19 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
 
 CDBWrapper::~CDBWrapper()
 {
+    instance.SetDB(NULL);
     delete pdb;
     pdb = NULL;
-    delete options.filter_policy;
-    options.filter_policy = NULL;
-    delete options.block_cache;
-    options.block_cache = NULL;
     delete penv;
-    options.env = NULL;
+    instance.options.env = NULL;
 }
 
 bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
 {
+    int64_t nTimeStart = GetTimeMicros();
     leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
     dbwrapper_private::HandleError(status);
+    instance.RecordWrite(batch.SizeEstimate(), GetTimeMicros() - nTimeStart, fSync);
     return true;
 }
 
@@ -17,6 +17,9 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <atomic>
+#include <vector>
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -24,6 +27,86 @@ public:
 };
 
 class CDBWrapper;
+class CCountingCache;
+
+/** LevelDB settings of a single database */
+struct CDBOptions
+{
+    size_t nBlockCacheSize;     //!< private block cache in bytes, 0 to use the shared block cache
+    size_t nWriteBufferSize;    //!< memtable size in bytes, up to two may be held in memory
+    int nMaxOpenFiles;
+    int nBloomFilterBits;       //!< bits per key, 0 disables the bloom filter
+    bool fCompression;          //!< snappy compression, only effective if LevelDB was built with snappy
+};
+
+/** Counters of a single database, as reported by GetDBStats */
+struct CDBStats
+{
+    std::string strName;
+    uint64_t nCacheHits;
+    uint64_t nCacheMisses;
+    uint64_t nWrites;
+    uint64_t nWriteBytes;
+    uint64_t nWriteMicros;
+    uint64_t nStalls;                   //!< unsynced writes that took longer than DB_STALL_MICROS
+    std::vector<int> vFilesPerLevel;
+    double dCompactionSeconds;
+    double dCompactionReadMB;
+    double dCompactionWriteMB;
+    double dSizeMB;
+};
+
+/** Unsynced writes slower than this were most likely delayed by LevelDB waiting for compactions */
+static const int64_t DB_STALL_MICROS = 1000;
+
+/**
+ * Return the settings of the database named strName, the last component of its path
+ * (e.g. "chainstate", "index" or "MP_txlist"). The built in profile is derived from
+ * nCacheSize and can be overridden with -dboption=<name>.<setting>=<value>.
+ */
+CDBOptions GetDBOptions(const std::string& strName, size_t nCacheSize);
+
+/**
+ * Share a single LRU block cache of nSize bytes between all databases opened from now on,
+ * 0 gives each database its own cache again. Databases already open keep their cache.
+ */
+void SetSharedDBCacheSize(size_t nSize);
+size_t GetSharedDBCacheSize();
+
+/** Return the counters of all open databases */
+std::vector<CDBStats> GetDBStats();
+
+/**
+ * LevelDB options and counters of one open database. Owns the filter policy and the
+ * block cache referenced by options, and makes the database visible to GetDBStats.
+ */
+class CDBInstance
+{
+private:
+    std::string strName;
+    CCountingCache* pcache;
+    leveldb::DB* pdb;
+    std::atomic<uint64_t> nWrites;
+    std::atomic<uint64_t> nWriteBytes;
+    std::atomic<uint64_t> nWriteMicros;
+    std::atomic<uint64_t> nStalls;
+
+    CDBInstance(const CDBInstance&);
+    CDBInstance& operator=(const CDBInstance&);
+
+public:
+    leveldb::Options options;
+
+    CDBInstance(const std::string& strNameIn, const CDBOptions& opts);
+    ~CDBInstance();
+
+    //! Set the database the statistics are read from, NULL before it is closed
+    void SetDB(leveldb::DB* pdbIn);
+
+    void RecordWrite(size_t nBytes, int64_t nMicros, bool fSync);
+
+    CDBStats GetStats() const;
+};
 
 /** These should be considered an implementation detail of the specific database.
  */
@@ -49,12 +132,13 @@ class CDBBatch
 private:
     const CDBWrapper &parent;
     leveldb::WriteBatch batch;
+    size_t size_estimate;
 
 public:
     /**
      * @param[in] parent    CDBWrapper that this batch is to be submitted to
      */
-    CDBBatch(const CDBWrapper &parent) : parent(parent) { };
+    CDBBatch(const CDBWrapper &parent) : parent(parent), size_estimate(0) { };
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
@@ -71,6 +155,13 @@ public:
         leveldb::Slice slValue(&ssValue[0], ssValue.size());
 
         batch.Put(slKey, slValue);
+        // LevelDB serializes writes as:
+        // - byte: header
+        // - varint: key length (1 byte up to 127B, 2 bytes up to 16383B, ...)
+        // - byte[]: key
+        // - varint: value length
+        // - byte[]: value
+        size_estimate += 3 + (slKey.size() > 127) + slKey.size() + (slValue.size() > 127) + slValue.size();
     }
 
     template <typename K>
@@ -82,7 +173,10 @@ public:
         leveldb::Slice slKey(&ssKey[0], ssKey.size());
 
         batch.Delete(slKey);
+        size_estimate += 2 + (slKey.size() > 127) + slKey.size();
     }
+
+    size_t SizeEstimate() const { return size_estimate; }
 };
 
 class CDBIterator
@@ -155,8 +249,8 @@ private:
     //! custom environment this database is using (may be NULL in case of default environment)
     leveldb::Env* penv;
 
-    //! database options used
-    leveldb::Options options;
+    //! database options and counters
+    CDBInstance instance;
 
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
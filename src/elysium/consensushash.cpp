@@ -13,10 +13,13 @@
 #include "elysium/sp.h"
 
 #include "arith_uint256.h"
+#include "crypto/common.h"
 #include "uint256.h"
 
 #include <stdint.h>
 #include <algorithm>
+#include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -24,6 +27,167 @@
 
 namespace elysium
 {
+namespace
+{
+//! Number of buckets the entries of a commitment are spread over
+const unsigned int STATE_HASH_BUCKETS = 4096;
+
+uint256 Sha256(const std::string& data)
+{
+    uint256 hash;
+    SHA256((const unsigned char*)data.data(), data.size(), (unsigned char*)&hash);
+    return hash;
+}
+
+/**
+ * Commitment to a set of keyed entries, updated as entries change.
+ *
+ * Entries are spread over buckets by the hash of their key. A bucket hash covers its
+ * entries in key order, and the root covers the hashes of the non-empty buckets in
+ * bucket order, so a change only requires one bucket to be rehashed. The root is
+ * cached and only recomputed after a change.
+ */
+class StateHashSet
+{
+private:
+    typedef std::map<std::string, uint256> Bucket;
+
+    std::map<unsigned int, Bucket> buckets;
+    std::map<unsigned int, uint256> bucketHashes;
+    std::set<unsigned int> dirtyBuckets;
+    uint256 rootHash;
+    bool fRootValid;
+
+    static unsigned int GetBucket(const std::string& key)
+    {
+        uint256 hash = Sha256(key);
+        return (hash.begin()[0] | (hash.begin()[1] << 8)) % STATE_HASH_BUCKETS;
+    }
+
+public:
+    StateHashSet() : fRootValid(false) {}
+
+    bool IsEmpty() const
+    {
+        return buckets.empty();
+    }
+
+    void Set(const std::string& key, const uint256& entryHash)
+    {
+        unsigned int bucket = GetBucket(key);
+        buckets[bucket][key] = entryHash;
+        dirtyBuckets.insert(bucket);
+    }
+
+    void Erase(const std::string& key)
+    {
+        unsigned int bucket = GetBucket(key);
+        std::map<unsigned int, Bucket>::iterator it = buckets.find(bucket);
+        if (it == buckets.end() || it->second.erase(key) == 0) return;
+        if (it->second.empty()) buckets.erase(it);
+        dirtyBuckets.insert(bucket);
+    }
+
+    uint256 GetHash()
+    {
+        if (fRootValid && dirtyBuckets.empty()) return rootHash;
+
+        for (std::set<unsigned int>::const_iterator it = dirtyBuckets.begin(); it != dirtyBuckets.end(); ++it) {
+            std::map<unsigned int, Bucket>::const_iterator itBucket = buckets.find(*it);
+            if (itBucket == buckets.end()) {
+                bucketHashes.erase(*it);
+                continue;
+            }
+            SHA256_CTX shaCtx;
+            SHA256_Init(&shaCtx);
+            for (Bucket::const_iterator itEntry = itBucket->second.begin(); itEntry != itBucket->second.end(); ++itEntry) {
+                SHA256_Update(&shaCtx, itEntry->first.data(), itEntry->first.size());
+                SHA256_Update(&shaCtx, itEntry->second.begin(), itEntry->second.size());
+            }
+            SHA256_Final((unsigned char*)&bucketHashes[*it], &shaCtx);
+        }
+        dirtyBuckets.clear();
+
+        SHA256_CTX shaCtx;
+        SHA256_Init(&shaCtx);
+        for (std::map<unsigned int, uint256>::const_iterator it = bucketHashes.begin(); it != bucketHashes.end(); ++it) {
+            unsigned char bucket[2];
+            WriteLE16(bucket, it->first);
+            SHA256_Update(&shaCtx, bucket, sizeof(bucket));
+            SHA256_Update(&shaCtx, it->second.begin(), it->second.size());
+        }
+        SHA256_Final((unsigned char*)&rootHash, &shaCtx);
+        fRootValid = true;
+        return rootHash;
+    }
+};
+
+/** Commitments grouped by property identifier, with a combined hash over all properties. */
+class PropertyStateHash
+{
+private:
+    std::map<uint32_t, StateHashSet> properties;
+    uint256 stageHash;
+    bool fStageValid;
+
+public:
+    PropertyStateHash() : fStageValid(false) {}
+
+    void Set(uint32_t propertyId, const std::string& key, const uint256& entryHash)
+    {
+        properties[propertyId].Set(key, entryHash);
+        fStageValid = false;
+    }
+
+    void Erase(uint32_t propertyId, const std::string& key)
+    {
+        std::map<uint32_t, StateHashSet>::iterator it = properties.find(propertyId);
+        if (it == properties.end()) return;
+        it->second.Erase(key);
+        if (it->second.IsEmpty()) properties.erase(it);
+        fStageValid = false;
+    }
+
+    void Clear()
+    {
+        properties.clear();
+        fStageValid = false;
+    }
+
+    /** Hash of the entries of a property, or a null hash if there are none. */
+    uint256 GetHash(uint32_t propertyId)
+    {
+        std::map<uint32_t, StateHashSet>::iterator it = properties.find(propertyId);
+        if (it == properties.end()) return uint256();
+        return it->second.GetHash();
+    }
+
+    /** Hash over the property identifiers and hashes of all properties with entries, cached until a change. */
+    uint256 GetHash()
+    {
+        if (fStageValid) return stageHash;
+
+        SHA256_CTX shaCtx;
+        SHA256_Init(&shaCtx);
+        for (std::map<uint32_t, StateHashSet>::iterator it = properties.begin(); it != properties.end(); ++it) {
+            uint256 propertyHash = it->second.GetHash();
+            unsigned char propertyId[4];
+            WriteLE32(propertyId, it->first);
+            SHA256_Update(&shaCtx, propertyId, sizeof(propertyId));
+            SHA256_Update(&shaCtx, propertyHash.begin(), propertyHash.size());
+        }
+        SHA256_Final((unsigned char*)&stageHash, &shaCtx);
+        fStageValid = true;
+        return stageHash;
+    }
+};
+
+//! Balances by property, keyed by address (requires cs_main)
+PropertyStateHash balancesHash;
+//! Open MetaDEx orders by property for sale, keyed by txid (requires cs_main)
+PropertyStateHash metadexHash;
+} // anonymous namespace
+
 bool ShouldConsensusHashBlock(int block) {
     if (elysium_debug_consensus_hash_every_block) {
         return true;
@@ -106,12 +270,24 @@ std::string GenerateConsensusString(const uint32_t propertyId, const std::string
  * would be needed to hash the data bytes directly), create a string in the following
  * format for each entry to use for hashing:
  *
+ * Balances and MetaDEx trades can be large, so they are not hashed entry by entry. Instead
+ * each entry string is hashed with SHA256 and kept in a commitment that is updated whenever
+ * the entry changes:
+ *
+ *   entryhash    = SHA256(entry string)
+ *   bucket       = first two bytes of SHA256(key), little endian, modulo 4096
+ *   buckethash   = SHA256(key || entryhash || ...) over the entries of a bucket, ordered by key
+ *   propertyhash = SHA256(bucket (uint16 LE) || buckethash || ...) over non-empty buckets, ordered by bucket
+ *   stagehash    = SHA256(propertyid (uint32 LE) || propertyhash || ...) over properties with entries, ordered by property
+ *
+ * The 32 bytes of the stage hash are added to the consensus hash in place of the entries.
+ *
  * ---STAGE 1 - BALANCES---
  * Format specifiers & placeholders:
  *   "%s|%d|%d|%d|%d|%d" - "address|propertyid|balance|selloffer_reserve|accept_reserve|metadex_reserve"
  *
- * Note: empty balance records and the pending tally are ignored. Addresses are sorted based
- * on lexicographical order, and balance records are sorted by the property identifiers.
+ * Note: empty balance records and the pending tally are ignored. Entries are keyed by address
+ * and grouped by property identifier.
  *
  * ---STAGE 2 - DEX SELL OFFERS---
  * Format specifiers & placeholders:
@@ -129,7 +305,7 @@ std::string GenerateConsensusString(const uint32_t propertyId, const std::string
  * Format specifiers & placeholders:
  *   "%s|%s|%d|%d|%d|%d|%d" - "txid|address|propertyidforsale|amountforsale|propertyiddesired|amountdesired|amountremaining"
  *
- * Note: ordered ascending by txid.
+ * Note: entries are keyed by the hex txid and grouped by the property for sale.
  *
  * ---STAGE 5 - CROWDSALES---
  * Format specifiers & placeholders:
@@ -157,25 +333,10 @@ uint256 GetConsensusHash()
 
     if (elysium_debug_consensus_hash) PrintToLog("Beginning generation of current consensus hash...\n");
 
-    // Balances - loop through the tally map, updating the sha context with the data from each balance and tally type
-    // Placeholders:  "address|propertyid|balance|selloffer_reserve|accept_reserve|metadex_reserve"
-    // Sort alphabetically first
-    std::map<std::string, CMPTally> tallyMapSorted;
-    for (std::unordered_map<string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
-        tallyMapSorted.insert(std::make_pair(uoit->first,uoit->second));
-    }
-    for (std::map<string, CMPTally>::iterator my_it = tallyMapSorted.begin(); my_it != tallyMapSorted.end(); ++my_it) {
-        const std::string& address = my_it->first;
-        CMPTally& tally = my_it->second;
-        tally.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = (tally.next()))) {
-            std::string dataStr = GenerateConsensusString(tally, address, propertyId);
-            if (dataStr.empty()) continue; // skip empty balances
-            if (elysium_debug_consensus_hash) PrintToLog("Adding balance data to consensus hash: %s\n", dataStr);
-            SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
-        }
-    }
+    // Balances - the commitment is maintained by update_tally_map, only changed buckets are rehashed
+    uint256 balancesStageHash = balancesHash.GetHash();
+    if (elysium_debug_consensus_hash) PrintToLog("Adding balances hash to consensus hash: %s\n", balancesStageHash.GetHex());
+    SHA256_Update(&shaCtx, balancesStageHash.begin(), balancesStageHash.size());
 
     // DEx sell offers - loop through the DEx and add each sell offer to the consensus hash (ordered by txid)
     // Placeholders: "txid|address|propertyid|offeramount|btcdesired|minfee|timelimit"
@@ -212,26 +373,10 @@ uint256 GetConsensusHash()
         SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
     }
 
-    // MetaDEx trades - loop through the MetaDEx maps and add each open trade to the consensus hash (ordered by txid)
-    // Placeholders: "txid|address|propertyidforsale|amountforsale|propertyiddesired|amountdesired|amountremaining"
-    std::vector<std::pair<arith_uint256, std::string> > vecMetaDExTrades;
-    for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        const md_PricesMap& prices = my_it->second;
-        for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
-            const md_Set& indexes = it->second;
-            for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                const CMPMetaDEx& obj = *it;
-                std::string dataStr = GenerateConsensusString(obj);
-                vecMetaDExTrades.push_back(std::make_pair(arith_uint256(obj.getHash().ToString()), dataStr));
-            }
-        }
-    }
-    std::sort (vecMetaDExTrades.begin(), vecMetaDExTrades.end());
-    for (std::vector<std::pair<arith_uint256, std::string> >::iterator it = vecMetaDExTrades.begin(); it != vecMetaDExTrades.end(); ++it) {
-        const std::string& dataStr = it->second;
-        if (elysium_debug_consensus_hash) PrintToLog("Adding MetaDEx trade data to consensus hash: %s\n", dataStr);
-        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
-    }
+    // MetaDEx trades - the commitment is maintained by the MetaDEx, only changed buckets are rehashed
+    uint256 metadexStageHash = metadexHash.GetHash();
+    if (elysium_debug_consensus_hash) PrintToLog("Adding MetaDEx hash to consensus hash: %s\n", metadexStageHash.GetHex());
+    SHA256_Update(&shaCtx, metadexStageHash.begin(), metadexStageHash.size());
 
     // Crowdsales - loop through open crowdsales and add to the consensus hash (ordered by property ID)
     // Note: the variables of the crowdsale (amount, bonus etc) are not part of the crowdsale map and not included here to
@@ -279,67 +424,51 @@ uint256 GetConsensusHash()
 
 uint256 GetMetaDExHash(const uint32_t propertyId)
 {
-    SHA256_CTX shaCtx;
-    SHA256_Init(&shaCtx);
-
     LOCK(cs_main);
 
-    std::vector<std::pair<arith_uint256, std::string> > vecMetaDExTrades;
-    for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        if (propertyId == 0 || propertyId == my_it->first) {
-            const md_PricesMap& prices = my_it->second;
-            for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
-                const md_Set& indexes = it->second;
-                for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                    const CMPMetaDEx& obj = *it;
-                    std::string dataStr = GenerateConsensusString(obj);
-                    vecMetaDExTrades.push_back(std::make_pair(arith_uint256(obj.getHash().ToString()), dataStr));
-                }
-            }
-        }
-    }
-    std::sort (vecMetaDExTrades.begin(), vecMetaDExTrades.end());
-    for (std::vector<std::pair<arith_uint256, std::string> >::iterator it = vecMetaDExTrades.begin(); it != vecMetaDExTrades.end(); ++it) {
-        const std::string& dataStr = it->second;
-        SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
-    }
-
-    uint256 metadexHash;
-    SHA256_Final((unsigned char*)&metadexHash, &shaCtx);
-
-    return metadexHash;
+    if (propertyId == 0) return metadexHash.GetHash();
+    return metadexHash.GetHash(propertyId);
 }
 
 /** Obtains a hash of the balances for a specific property. */
 uint256 GetBalancesHash(const uint32_t hashPropertyId)
 {
-    SHA256_CTX shaCtx;
-    SHA256_Init(&shaCtx);
-
     LOCK(cs_main);
 
-    std::map<std::string, CMPTally> tallyMapSorted;
-    for (std::unordered_map<string, CMPTally>::iterator uoit = mp_tally_map.begin(); uoit != mp_tally_map.end(); ++uoit) {
-        tallyMapSorted.insert(std::make_pair(uoit->first,uoit->second));
+    return balancesHash.GetHash(hashPropertyId);
+}
+
+void UpdateBalancesHash(const std::string& address, uint32_t propertyId, const CMPTally& tally)
+{
+    AssertLockHeld(cs_main);
+
+    std::string dataStr = GenerateConsensusString(tally, address, propertyId);
+    if (dataStr.empty()) {
+        balancesHash.Erase(propertyId, address);
+    } else {
+        balancesHash.Set(propertyId, address, Sha256(dataStr));
     }
-    for (std::map<string, CMPTally>::iterator my_it = tallyMapSorted.begin(); my_it != tallyMapSorted.end(); ++my_it) {
-        const std::string& address = my_it->first;
-        CMPTally& tally = my_it->second;
-        tally.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = (tally.next()))) {
-            if (propertyId != hashPropertyId) continue;
-            std::string dataStr = GenerateConsensusString(tally, address, propertyId);
-            if (dataStr.empty()) continue;
-            if (elysium_debug_consensus_hash) PrintToLog("Adding data to balances hash: %s\n", dataStr);
-            SHA256_Update(&shaCtx, dataStr.c_str(), dataStr.length());
-        }
+}
+
+void UpdateMetaDExHash(const CMPMetaDEx& tradeObj, bool fErase)
+{
+    AssertLockHeld(cs_main);
+
+    if (fErase) {
+        metadexHash.Erase(tradeObj.getProperty(), tradeObj.getHash().GetHex());
+    } else {
+        metadexHash.Set(tradeObj.getProperty(), tradeObj.getHash().GetHex(), Sha256(GenerateConsensusString(tradeObj)));
     }
+}
 
-    uint256 balancesHash;
-    SHA256_Final((unsigned char*)&balancesHash, &shaCtx);
+void ClearBalancesHash()
+{
+    balancesHash.Clear();
+}
 
-    return balancesHash;
+void ClearMetaDExHash()
+{
+    metadexHash.Clear();
 }
 
 } // namespace elysium
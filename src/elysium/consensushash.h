@@ -3,6 +3,13 @@
 
 #include "uint256.h"
 
+#include <stdint.h>
+
+#include <string>
+
+class CMPMetaDEx;
+class CMPTally;
+
 namespace elysium
 {
 /** Checks if a given block should be consensus hashed. */
@@ -17,6 +24,15 @@ uint256 GetMetaDExHash(const uint32_t propertyId = 0);
 /** Obtains a hash of the balances for a specific property. */
 uint256 GetBalancesHash(const uint32_t hashPropertyId);
 
+/** Updates the balances commitment after the tally of an address changed for a property. */
+void UpdateBalancesHash(const std::string& address, uint32_t propertyId, const CMPTally& tally);
+/** Adds an open MetaDEx order to, or removes it from, the MetaDEx commitment. */
+void UpdateMetaDExHash(const CMPMetaDEx& tradeObj, bool fErase);
+/** Drops the balances commitment, when the tally map is cleared. */
+void ClearBalancesHash();
+/** Drops the MetaDEx commitment, when the order books are cleared. */
+void ClearMetaDExHash();
+
 } // namespace elysium
 
 #endif // ELYSIUM_CONSENSUSHASH_H
@@ -12,6 +12,7 @@
 #include "elysium/elysium.h"
 #include "elysium/rules.h"
 #include "elysium/uint256_extensions.h"
+#include "elysium/walletcache.h"
 
 #include "arith_uint256.h"
 #include "main.h"
@@ -516,6 +517,7 @@ int DEx_payment(const uint256& txid, unsigned int vout, const std::string& addre
 
         bool valid = true;
         p_txlistdb->recordPaymentTX(txid, valid, block, vout, propertyId, amountPurchased, addressBuyer, addressSeller);
+        WalletTXIDCacheAdd(txid, block);
 
         rc = 0;
         PrintToLog("#######################################################\n");
@@ -6,6 +6,7 @@
 #include "dex.h"
 #include "errors.h"
 #include "fees.h"
+#include "holders.h"
 #include "log.h"
 #include "mdex.h"
 #include "notifications.h"
@@ -13,9 +14,12 @@
 #include "pending.h"
 #include "persistence.h"
 #include "rules.h"
+#include "scan.h"
 #include "script.h"
+#include "sigma.h"
 #include "sigmadb.h"
 #include "sp.h"
+#include "statefile.h"
 #include "tally.h"
 #include "tx.h"
 #include "txprocessor.h"
@@ -35,6 +39,7 @@
 #include "../core_io.h"
 #include "../init.h"
 #include "../main.h"
+#include "../memusage.h"
 #include "../primitives/block.h"
 #include "../primitives/transaction.h"
 #include "../script/script.h"
@@ -63,12 +68,15 @@
 #include <openssl/sha.h>
 
 #include "leveldb/db.h"
+#include "leveldb/write_batch.h"
 
 #include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
 #include <map>
 #include <set>
 #include <string>
@@ -129,6 +137,7 @@ CMPSTOList *elysium::s_stolistdb;
 CElysiumTransactionDB *elysium::p_ElysiumTXDB;
 CElysiumFeeCache *elysium::p_feecache;
 CElysiumFeeHistory *elysium::p_feehistory;
+CElysiumMarkerIndex *elysium::p_markerindex;
 
 // indicate whether persistence is enabled at this point, or not
 // used to write/read files, for breakout mode, debugging, etc.
@@ -253,6 +262,35 @@ CMPTally* elysium::getTally(const std::string& address)
     return (CMPTally *) NULL;
 }
 
+/**
+ * Estimates the heap memory used by the tally map.
+ *
+ * This includes the hash table, the nodes with address and tally, address strings, which
+ * don't fit into the small string buffer, and balance records, which are not stored inline.
+ *
+ * @param nRecords[out]  The number of balance records of all addresses
+ * @return The estimated number of bytes
+ */
+size_t elysium::GetTallyMapMemoryUsage(size_t& nRecords)
+{
+    typedef std::unordered_map<std::string, CMPTally>::value_type TallyEntry;
+
+    // a node holds the entry, the link to the next node, and the cached hash
+    size_t nUsage = memusage::MallocUsage(sizeof(void*) * mp_tally_map.bucket_count());
+    nUsage += memusage::MallocUsage(sizeof(TallyEntry) + 2 * sizeof(void*)) * mp_tally_map.size();
+    nRecords = 0;
+
+    for (std::unordered_map<std::string, CMPTally>::const_iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+        if (it->first.capacity() >= sizeof(std::string)) {
+            nUsage += memusage::MallocUsage(it->first.capacity() + 1);
+        }
+        nUsage += it->second.DynamicMemoryUsage();
+        nRecords += it->second.size();
+    }
+
+    return nUsage;
+}
+
 // look at balance for an address
 int64_t getMPbalance(const std::string& address, uint32_t propertyId, TallyType ttype)
 {
@@ -417,7 +455,6 @@ std::string elysium::getTokenLabel(uint32_t propertyId)
 // optionally counts the number of addresses who own that property: n_owners_total
 int64_t elysium::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
 {
-    int64_t prev = 0;
     int64_t owners = 0;
     int64_t totalTokens = 0;
 
@@ -429,18 +466,10 @@ int64_t elysium::getTotalTokens(uint32_t propertyId, int64_t* n_owners_total)
     }
 
     if (!property.fixed || n_owners_total) {
-        for (std::unordered_map<std::string, CMPTally>::const_iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const CMPTally& tally = it->second;
-
-            totalTokens += tally.getMoney(propertyId, BALANCE);
-            totalTokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
-            totalTokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
-            totalTokens += tally.getMoney(propertyId, METADEX_RESERVE);
-
-            if (prev != totalTokens) {
-                prev = totalTokens;
-                owners++;
-            }
+        const PropertyHolders* holders = GetPropertyHolders(propertyId);
+        if (holders) {
+            totalTokens = holders->totalTokens;
+            owners = holders->owners.size();
         }
         int64_t cachedFee = p_feecache->GetCachedAmount(propertyId);
         totalTokens += cachedFee;
@@ -487,6 +516,12 @@ bool elysium::update_tally_map(const std::string& who, uint32_t propertyId, int6
 
     CMPTally& tally = my_it->second;
     bRet = tally.updateMoney(propertyId, amount, ttype);
+    if (bRet) {
+        UpdateBalancesHash(who, propertyId, tally);
+        UpdatePropertyHolders(who, propertyId, tally);
+        RecordTallyChange(who, propertyId);
+        WalletCacheRecordChange(who);
+    }
 
     after = getMPbalance(who, propertyId, ttype);
     if (!bRet) {
@@ -596,15 +631,17 @@ void CheckWalletUpdate(bool forceUpdate)
     global_balance_reserved.clear();
 
     // populate global balance totals and wallet property list - note global balances do not include additional balances from watch-only addresses
-    for (std::unordered_map<std::string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        // check if the address is a wallet address (including watched addresses)
-        std::string address = my_it->first;
-        int addressIsMine = IsMyAddress(address);
-        if (!addressIsMine) continue;
+    std::map<std::string, int> walletAddresses = WalletCacheGetAddresses();
+    for (std::map<std::string, int>::const_iterator wallet_it = walletAddresses.begin(); wallet_it != walletAddresses.end(); ++wallet_it) {
+        // the cache only contains wallet addresses (including watched addresses)
+        const std::string& address = wallet_it->first;
+        int addressIsMine = wallet_it->second;
+        CMPTally* tally = getTally(address);
+        if (tally == NULL) continue;
         // iterate only those properties in the TokenMap for this address
-        my_it->second.init();
+        tally->init();
         uint32_t propertyId;
-        while (0 != (propertyId = (my_it->second).next())) {
+        while (0 != (propertyId = tally->next())) {
             // add to the global wallet property list
             global_wallet_property_list.insert(propertyId);
             // check if the address is spendable (only spendable balances are included in totals)
@@ -1136,6 +1173,10 @@ public:
  * It scans the blockchain, starting at the given block index, to the current
  * tip, much like as if new block were arriving and being processed on the fly.
  *
+ * Blocks are read and checked for transactions with Elysium markers by worker
+ * threads ahead of the scan, while the marked transactions are processed in
+ * block order. Blocks known to have no marked transactions are not read at all.
+ *
  * Every 30 seconds the progress of the scan is reported.
  *
  * In case the current block being processed is not part of the active chain, or
@@ -1152,6 +1193,7 @@ public:
 static int elysium_initial_scan(int nFirstBlock)
 {
     int nTimeBetweenProgressReports = GetArg("-elysiumprogressfrequency", 30);  // seconds
+    int nScanThreads = GetArg("-elysiumscanthreads", DEFAULT_SCAN_THREADS);
     int64_t nNow = GetTime();
     size_t nTxsTotal = 0, nTxsFoundTotal = 0;
     int nBlock = 999999;
@@ -1161,9 +1203,15 @@ static int elysium_initial_scan(int nFirstBlock)
     if (nFirstBlock < 0 || nLastBlock < nFirstBlock) return -1;
     PrintToLog("Scanning for transactions in block %d to block %d..\n", nFirstBlock, nLastBlock);
 
+    if (nScanThreads < 0) nScanThreads = 0;
+    if (nScanThreads > MAX_SCAN_THREADS) nScanThreads = MAX_SCAN_THREADS;
+
     // used to print the progress to the console and notifies the UI
     ProgressReporter progressReporter(chainActive[nFirstBlock], chainActive[nLastBlock]);
 
+    // reads blocks and detects marked transactions in parallel
+    CBlockPrefetcher prefetcher(p_markerindex, nFirstBlock, nLastBlock, nScanThreads);
+
     for (nBlock = nFirstBlock; nBlock <= nLastBlock; ++nBlock)
     {
         if (ShutdownRequested()) {
@@ -1171,8 +1219,10 @@ static int elysium_initial_scan(int nFirstBlock)
             break;
         }
 
-        CBlockIndex* pblockindex = chainActive[nBlock];
-        if (NULL == pblockindex) break;
+        std::shared_ptr<const ScannedBlock> scanned = prefetcher.Next();
+        if (!scanned) break;
+
+        const CBlockIndex* pblockindex = scanned->pindex;
         std::string strBlockHash = pblockindex->GetBlockHash().GetHex();
 
         if (elysium_debug_ely) PrintToLog("%s(%d; max=%d):%s, line %d, file: %s\n",
@@ -1183,20 +1233,22 @@ static int elysium_initial_scan(int nFirstBlock)
             nNow = GetTime();
         }
 
-        // Get block to parse.
-        CBlock block;
-
-        if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
+        if (scanned->fFailed) {
             break;
         }
 
-        // Parse block.
+        // Parse block. Only marked transactions can be Elysium transactions or
+        // have pending amounts, so the other ones don't need to be handled.
         unsigned parsed = 0;
 
         elysium_handler_block_begin(nBlock, pblockindex);
 
-        for (unsigned i = 0; i < block.vtx.size(); i++) {
-            if (elysium_handler_tx(block.vtx[i], nBlock, i, pblockindex)) {
+        if (!scanned->markers.empty()) {
+            elysium_handler_block_spends(nBlock, scanned->block, pblockindex);
+        }
+
+        for (uint32_t i : scanned->markers) {
+            if (elysium_handler_tx(*scanned->block.vtx[i], nBlock, i, pblockindex)) {
                 parsed++;
             }
         }
@@ -1205,7 +1257,7 @@ static int elysium_initial_scan(int nFirstBlock)
 
         // Sum total parsed.
         nTxsFoundTotal += parsed;
-        nTxsTotal += block.vtx.size();
+        nTxsTotal += pblockindex->nTx;
     }
 
     if (nBlock < nLastBlock) {
@@ -1437,6 +1489,8 @@ static int elysium_file_load(const string &filename, int what, bool verifyHash =
   {
     case FILETYPE_BALANCES:
       mp_tally_map.clear();
+      ClearBalancesHash();
+      ClearPropertyHolders();
       inputLineFunc = input_elysium_balances_string;
       break;
 
@@ -1464,7 +1518,7 @@ static int elysium_file_load(const string &filename, int what, bool verifyHash =
       // memory leak ... gotta unallocate inner layers first....
       // TODO
       // ...
-      metadex.clear();
+      MetaDEx_CLEAR();
       inputLineFunc = input_mp_mdexorder_string;
       break;
 
@@ -1553,6 +1607,12 @@ static char const * const statePrefix[NUM_FILETYPES] = {
 static int load_most_relevant_state()
 {
   int res = -1;
+  // make sure all queued state files are on disk
+  FlushStateWriter();
+
+  // the tally is replaced, so the wallet cache has to check all addresses
+  WalletCacheInvalidate();
+
   // check the SP database and roll it back to its latest valid state
   // according to the active chain
   uint256 spWatermark;
@@ -1617,15 +1677,22 @@ static int load_most_relevant_state()
   int abortRollBackBlock;
   if (curTip != NULL) abortRollBackBlock = curTip->nHeight - (MAX_STATE_HISTORY+1);
   while (NULL != curTip && persistedBlocks.size() > 0 && curTip->nHeight > abortRollBackBlock) {
-    if (persistedBlocks.find(spBlockIndex->GetBlockHash()) != persistedBlocks.end()) {
+    if (persistedBlocks.find(curTip->GetBlockHash()) != persistedBlocks.end()) {
       int success = -1;
-      for (int i = 0; i < NUM_FILETYPES; ++i) {
-        boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], curTip->GetBlockHash().ToString());
-        const std::string strFile = path.string();
-        success = elysium_file_load(strFile, i, true);
-        if (success < 0) {
-          break;
+      if (LoadPersistedState(MPPersistencePath, curTip, elysium_prev)) {
+        success = 0;
+      } else {
+        // fall back to the text files written by earlier versions
+        for (int i = 0; i < NUM_FILETYPES; ++i) {
+          boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], curTip->GetBlockHash().ToString());
+          const std::string strFile = path.string();
+          success = elysium_file_load(strFile, i, true);
+          if (success < 0) {
+            break;
+          }
         }
+        // no journal can be written on top of the text files
+        ResetStateJournal();
       }
 
       if (success >= 0) {
@@ -1634,7 +1701,7 @@ static int load_most_relevant_state()
       }
 
       // remove this from the persistedBlock Set
-      persistedBlocks.erase(spBlockIndex->GetBlockHash());
+      persistedBlocks.erase(curTip->GetBlockHash());
     }
 
     // go to the previous block
@@ -1657,179 +1724,6 @@ static int load_most_relevant_state()
   return res;
 }
 
-static int write_elysium_balances(std::ofstream& file, SHA256_CTX* shaCtx)
-{
-    std::unordered_map<std::string, CMPTally>::iterator iter;
-    for (iter = mp_tally_map.begin(); iter != mp_tally_map.end(); ++iter) {
-        bool emptyWallet = true;
-
-        std::string lineOut = (*iter).first;
-        lineOut.append("=");
-        CMPTally& curAddr = (*iter).second;
-        curAddr.init();
-        uint32_t propertyId = 0;
-        while (0 != (propertyId = curAddr.next())) {
-            int64_t balance = (*iter).second.getMoney(propertyId, BALANCE);
-            int64_t sellReserved = (*iter).second.getMoney(propertyId, SELLOFFER_RESERVE);
-            int64_t acceptReserved = (*iter).second.getMoney(propertyId, ACCEPT_RESERVE);
-            int64_t metadexReserved = (*iter).second.getMoney(propertyId, METADEX_RESERVE);
-
-            // we don't allow 0 balances to read in, so if we don't write them
-            // it makes things match up better between persisted state and processed state
-            if (0 == balance && 0 == sellReserved && 0 == acceptReserved && 0 == metadexReserved) {
-                continue;
-            }
-
-            emptyWallet = false;
-
-            lineOut.append(strprintf("%d:%d,%d,%d,%d;",
-                    propertyId,
-                    balance,
-                    sellReserved,
-                    acceptReserved,
-                    metadexReserved));
-        }
-
-        if (false == emptyWallet) {
-            // add the line to the hash
-            SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
-
-            // write the line
-            file << lineOut << endl;
-        }
-    }
-
-    return 0;
-}
-
-static int write_mp_offers(ofstream &file, SHA256_CTX *shaCtx)
-{
-  OfferMap::const_iterator iter;
-  for (iter = my_offers.begin(); iter != my_offers.end(); ++iter) {
-    // decompose the key for address
-    std::vector<std::string> vstr;
-    boost::split(vstr, (*iter).first, boost::is_any_of("-"), token_compress_on);
-    CMPOffer const &offer = (*iter).second;
-    offer.saveOffer(file, shaCtx, vstr[0]);
-  }
-
-
-  return 0;
-}
-
-static int write_mp_metadex(ofstream &file, SHA256_CTX *shaCtx)
-{
-  for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it)
-  {
-    md_PricesMap & prices = my_it->second;
-    for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it)
-    {
-      md_Set & indexes = (it->second);
-      for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it)
-      {
-        CMPMetaDEx meta = *it;
-        meta.saveOffer(file, shaCtx);
-      }
-    }
-  }
-
-  return 0;
-}
-
-static int write_mp_accepts(ofstream &file, SHA256_CTX *shaCtx)
-{
-  AcceptMap::const_iterator iter;
-  for (iter = my_accepts.begin(); iter != my_accepts.end(); ++iter) {
-    // decompose the key for address
-    std::vector<std::string> vstr;
-    boost::split(vstr, (*iter).first, boost::is_any_of("-+"), token_compress_on);
-    CMPAccept const &accept = (*iter).second;
-    accept.saveAccept(file, shaCtx, vstr[0], vstr[1]);
-  }
-
-  return 0;
-}
-
-static int write_globals_state(ofstream &file, SHA256_CTX *shaCtx)
-{
-  unsigned int nextSPID = _my_sps->peekNextSPID(ELYSIUM_PROPERTY_ELYSIUM);
-  unsigned int nextTestSPID = _my_sps->peekNextSPID(ELYSIUM_PROPERTY_TELYSIUM);
-  std::string lineOut = strprintf("%d,%d,%d",
-    elysium_prev,
-    nextSPID,
-    nextTestSPID);
-
-  // add the line to the hash
-  SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
-
-  // write the line
-  file << lineOut << endl;
-
-  return 0;
-}
-
-static int write_mp_crowdsales(std::ofstream& file, SHA256_CTX* shaCtx)
-{
-    for (CrowdMap::const_iterator it = my_crowds.begin(); it != my_crowds.end(); ++it) {
-        // decompose the key for address
-        const CMPCrowd& crowd = it->second;
-        crowd.saveCrowdSale(file, shaCtx, it->first);
-    }
-
-    return 0;
-}
-
-static int write_state_file( CBlockIndex const *pBlockIndex, int what )
-{
-  boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[what], pBlockIndex->GetBlockHash().ToString());
-  const std::string strFile = path.string();
-
-  std::ofstream file;
-  file.open(strFile.c_str());
-
-  SHA256_CTX shaCtx;
-  SHA256_Init(&shaCtx);
-
-  int result = 0;
-
-  switch(what) {
-  case FILETYPE_BALANCES:
-    result = write_elysium_balances(file, &shaCtx);
-    break;
-
-  case FILETYPE_OFFERS:
-    result = write_mp_offers(file, &shaCtx);
-    break;
-
-  case FILETYPE_ACCEPTS:
-    result = write_mp_accepts(file, &shaCtx);
-    break;
-
-  case FILETYPE_GLOBALS:
-    result = write_globals_state(file, &shaCtx);
-    break;
-
-  case FILETYPE_CROWDSALES:
-      result = write_mp_crowdsales(file, &shaCtx);
-      break;
-
-  case FILETYPE_MDEXORDERS:
-      result = write_mp_metadex(file, &shaCtx);
-      break;
-  }
-
-  // generate and wite the double hash of all the contents written
-  uint256 hash1;
-  SHA256_Final((unsigned char*)&hash1, &shaCtx);
-  uint256 hash2;
-  SHA256((unsigned char*)&hash1, sizeof(hash1), (unsigned char*)&hash2);
-  file << "!" << hash2.ToString() << endl;
-
-  file.flush();
-  file.close();
-  return result;
-}
-
 static bool is_state_prefix( std::string const &str )
 {
   for (int i = 0; i < NUM_FILETYPES; ++i) {
@@ -1841,12 +1735,13 @@ static bool is_state_prefix( std::string const &str )
   return false;
 }
 
-static void prune_state_files( CBlockIndex const *topIndex )
+/**
+ * Removes the state files of blocks, which are not among the given ones. Runs on the state
+ * writer, behind the pending writes, so the listing and removal happen outside of cs_main.
+ */
+static void prune_state_files( const boost::filesystem::path& dir, const std::set<uint256>& keepStates, const std::set<uint256>& keepSnapshots )
 {
-  // build a set of blockHashes for which we have any state files
-  std::set<uint256> statefulBlockHashes;
-
-  boost::filesystem::directory_iterator dIter(MPPersistencePath);
+  boost::filesystem::directory_iterator dIter(dir);
   boost::filesystem::directory_iterator endIter;
   for (; dIter != endIter; ++dIter) {
     std::string fName = dIter->path().empty() ? "<invalid>" : (*--dIter->path().end()).string();
@@ -1856,58 +1751,62 @@ static void prune_state_files( CBlockIndex const *topIndex )
       continue;
     }
 
+    uint256 blockHash;
+    bool fSnapshot = false;
+    if (ParseStateFileName(fName, blockHash, fSnapshot)) {
+      if (0 == (fSnapshot ? keepSnapshots : keepStates).count(blockHash)) {
+        if (elysium_debug_persistence) PrintToLog("State from Block:%s is no longer need, removing %s\n", blockHash.ToString(), fName);
+        RemoveStateFile(dir, blockHash, fSnapshot);
+      }
+      continue;
+    }
+
     std::vector<std::string> vstr;
     boost::split(vstr, fName, boost::is_any_of("-."), token_compress_on);
     if (  vstr.size() == 3 &&
           is_state_prefix(vstr[0]) &&
           boost::equals(vstr[2], "dat")) {
-      uint256 blockHash;
       blockHash.SetHex(vstr[1]);
-      statefulBlockHashes.insert(blockHash);
+      if (0 == keepStates.count(blockHash)) {
+        if (elysium_debug_persistence) PrintToLog("State from Block:%s is no longer need, removing %s\n", blockHash.ToString(), fName);
+        boost::filesystem::remove(dIter->path());
+      }
     } else {
       PrintToLog("None state file found in persistence directory : %s\n", fName);
     }
   }
+}
 
-  // for each blockHash in the set, determine the distance from the given block
-  std::set<uint256>::const_iterator iter;
-  for (iter = statefulBlockHashes.begin(); iter != statefulBlockHashes.end(); ++iter) {
-    // look up the CBlockIndex for height info
-    CBlockIndex const *curIndex = GetBlockIndex(*iter);
-
-    // if we have nothing int the index, or this block is too old..
-    if (NULL == curIndex || (topIndex->nHeight - curIndex->nHeight) > MAX_STATE_HISTORY ) {
-     if (elysium_debug_persistence)
-     {
-      if (curIndex) {
-        PrintToLog("State from Block:%s is no longer need, removing files (age-from-tip: %d)\n", (*iter).ToString(), topIndex->nHeight - curIndex->nHeight);
-      } else {
-        PrintToLog("State from Block:%s is no longer need, removing files (not in index)\n", (*iter).ToString());
-      }
-     }
+/**
+ * Queues the removal of state files, which are no longer needed.
+ *
+ * Only the states of the last MAX_STATE_HISTORY blocks of the chain ending in the given block
+ * are kept, snapshots STATE_SNAPSHOT_INTERVAL blocks longer, because the journals after them
+ * depend on them.
+ */
+static void queue_prune_state_files( CBlockIndex const *topIndex )
+{
+  std::set<uint256> keepStates;
+  std::set<uint256> keepSnapshots;
 
-      // destroy the associated files!
-      std::string strBlockHash = iter->ToString();
-      for (int i = 0; i < NUM_FILETYPES; ++i) {
-        boost::filesystem::path path = MPPersistencePath / strprintf("%s-%s.dat", statePrefix[i], strBlockHash);
-        boost::filesystem::remove(path);
-      }
-    }
+  for (CBlockIndex const *curIndex = topIndex; curIndex != NULL; curIndex = curIndex->pprev) {
+    int age = topIndex->nHeight - curIndex->nHeight;
+    if (age > MAX_STATE_HISTORY + STATE_SNAPSHOT_INTERVAL) break;
+    if (age <= MAX_STATE_HISTORY) keepStates.insert(curIndex->GetBlockHash());
+    keepSnapshots.insert(curIndex->GetBlockHash());
   }
+
+  boost::filesystem::path dir = MPPersistencePath;
+  QueueStateTask([dir, keepStates, keepSnapshots]() { prune_state_files(dir, keepStates, keepSnapshots); });
 }
 
 int elysium_save_state( CBlockIndex const *pBlockIndex )
 {
-    // write the new state as of the given block
-    write_state_file(pBlockIndex, FILETYPE_BALANCES);
-    write_state_file(pBlockIndex, FILETYPE_OFFERS);
-    write_state_file(pBlockIndex, FILETYPE_ACCEPTS);
-    write_state_file(pBlockIndex, FILETYPE_GLOBALS);
-    write_state_file(pBlockIndex, FILETYPE_CROWDSALES);
-    write_state_file(pBlockIndex, FILETYPE_MDEXORDERS);
+    // write the new state as of the given block, the file is written in the background
+    PersistState(MPPersistencePath, pBlockIndex, elysium_prev);
 
-    // clean-up the directory
-    prune_state_files(pBlockIndex);
+    // clean-up the directory, after the new state is written
+    queue_prune_state_files(pBlockIndex);
 
     _my_sps->setWatermark(pBlockIndex->GetBlockHash());
 
@@ -1923,10 +1822,15 @@ void clear_all_state()
 
     // Memory based storage
     mp_tally_map.clear();
+    WalletCacheInvalidate();
+    WalletTXIDCacheClear();
+    ClearBalancesHash();
+    ClearPropertyHolders();
+    ResetStateJournal();
     my_offers.clear();
     my_accepts.clear();
     my_crowds.clear();
-    metadex.clear();
+    MetaDEx_CLEAR();
     my_pending.clear();
     ResetConsensusParams();
     ClearActivations();
@@ -2016,6 +1920,7 @@ int elysium_init()
     p_ElysiumTXDB = new CElysiumTransactionDB(GetDataDir() / "Exodus_TXDB", fReindex);
     p_feecache = new CElysiumFeeCache(GetDataDir() / "EXODUS_feecache", fReindex);
     p_feehistory = new CElysiumFeeHistory(GetDataDir() / "EXODUS_feehistory", fReindex);
+    p_markerindex = new CElysiumMarkerIndex(GetDataDir() / "MP_markers", fReindex);
 
     MPPersistencePath = GetDataDir() / "MP_persist";
     TryCreateDirectory(MPPersistencePath);
@@ -2038,6 +1943,8 @@ int elysium_init()
 
     ++elysiumInitialized;
 
+    StartStateWriter();
+
     nWaterlineBlock = load_most_relevant_state();
     bool noPreviousState = (nWaterlineBlock <= 0);
 
@@ -2098,6 +2005,14 @@ int elysium_init()
     // initial scan
     elysium_initial_scan(nWaterlineBlock);
 
+    size_t nTallyRecords = 0;
+    size_t nTallyUsage = GetTallyMapMemoryUsage(nTallyRecords);
+    PrintToLog("Tally map: %d addresses, %d balance records, %.1f MiB\n",
+            mp_tally_map.size(), nTallyRecords, nTallyUsage / 1048576.0);
+
+    // load the Elysium transactions of the wallet
+    WalletTXIDCacheInit();
+
     // display Elysium balance
     int64_t elysium_balance = getMPbalance(GetSystemAddress().ToString(), ELYSIUM_PROPERTY_ELYSIUM, BALANCE);
 
@@ -2119,6 +2034,10 @@ int elysium_shutdown()
 {
     LOCK(cs_main);
 
+    // write the remaining state files, before the databases are closed
+    StopStateWriter();
+
+    WalletTXIDCacheShutdown();
 #ifdef ENABLE_WALLET
     delete wallet; wallet = nullptr;
 #endif
@@ -2131,6 +2050,7 @@ int elysium_shutdown()
     delete p_ElysiumTXDB; p_ElysiumTXDB = nullptr;
     delete p_feecache; p_feecache = nullptr;
     delete p_feehistory; p_feehistory = nullptr;
+    delete p_markerindex; p_markerindex = nullptr;
 
     elysiumInitialized = 0;
 
@@ -2181,6 +2101,7 @@ bool elysium_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, co
             bool bValid = (0 <= interp_ret);
             p_txlistdb->recordTX(tx.GetHash(), bValid, nBlock, mp_obj.getType(), mp_obj.getNewAmount());
             p_ElysiumTXDB->RecordTransaction(tx.GetHash(), idx, interp_ret);
+            WalletTXIDCacheAdd(tx.GetHash(), nBlock);
         }
         fFoundTx |= (interp_ret == 0);
     }
@@ -2193,6 +2114,54 @@ bool elysium_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, co
     return fFoundTx;
 }
 
+/**
+ * This handler is called for every new block, before its transactions are handled.
+ *
+ * The Sigma spends of the block are verified up front, in batches of spends, which refer to the
+ * same anonimity group. The results are picked up, when the spends are processed in block order.
+ *
+ * @return The number of Sigma spends found
+ */
+int elysium_handler_block_spends(int nBlockNow, const CBlock& block, CBlockIndex const * pBlockIndex)
+{
+    LOCK(cs_main);
+
+    ClearSigmaSpendBatch();
+
+    if (nBlockNow < nWaterlineBlock) return 0;
+
+    std::vector<BlockSigmaSpend> spends;
+
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+
+        if (!DeterminePacketClass(tx, nBlockNow)) {
+            continue;
+        }
+
+        CMPTransaction mp_obj;
+        if (parseTransaction(true, tx, nBlockNow, i, mp_obj, pBlockIndex->GetBlockTime()) != 0) {
+            continue;
+        }
+
+        if (!mp_obj.interpret_Transaction() || mp_obj.getType() != ELYSIUM_TYPE_SIMPLE_SPEND) {
+            continue;
+        }
+
+        if (mp_obj.getSpend() && mp_obj.getSerial()) {
+            spends.push_back(BlockSigmaSpend(mp_obj.getProperty(), mp_obj.getDenomination(), mp_obj.getGroup(),
+                mp_obj.getGroupSize(), *mp_obj.getSpend(), *mp_obj.getSerial()));
+        }
+    }
+
+    if (spends.size() > 1) {
+        bool fPadding = nBlockNow >= Params().GetConsensus().nSigmaPaddingBlock;
+        VerifySigmaSpendBatch(spends, fPadding);
+    }
+
+    return spends.size();
+}
+
 /**
  * Determines, whether it is valid to use a Class C transaction for a given payload size.
  *
@@ -2405,21 +2374,99 @@ std::string CElysiumTransactionDB::FetchInvalidReason(const uint256& txid)
     return error_str(processingResult);
 }
 
+namespace {
+
+//! Prefix of the index of transactions by block, keys are height and txid
+const char TXLIST_BLOCK_INDEX = 'B';
+//! Prefix of the index of transactions by type, keys are type, height and txid
+const char TXLIST_TYPE_INDEX = 'T';
+
+//! Upper bound of block ranges, which cover the whole index
+const int TXLIST_MAX_HEIGHT = std::numeric_limits<int>::max();
+
+//! Transaction types, which change the freeze state
+const unsigned int FREEZE_TX_TYPES[] = {
+    ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS,
+    ELYSIUM_TYPE_UNFREEZE_PROPERTY_TOKENS,
+    ELYSIUM_TYPE_ENABLE_FREEZING,
+    ELYSIUM_TYPE_DISABLE_FREEZING
+};
+
+/**
+ * Appends a number in big-endian byte order, so that keys sort by value.
+ */
+void AppendIndexNumber(std::string& key, uint32_t n)
+{
+    key.push_back(static_cast<char>(n >> 24));
+    key.push_back(static_cast<char>(n >> 16));
+    key.push_back(static_cast<char>(n >> 8));
+    key.push_back(static_cast<char>(n));
+}
+
+uint32_t ReadIndexNumber(const char* p)
+{
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return (uint32_t(b[0]) << 24) | (uint32_t(b[1]) << 16) | (uint32_t(b[2]) << 8) | uint32_t(b[3]);
+}
+
+std::string GetBlockIndexKey(uint32_t block)
+{
+    std::string key(1, TXLIST_BLOCK_INDEX);
+    AppendIndexNumber(key, block);
+    return key;
+}
+
+std::string GetTypeIndexKey(unsigned int type, uint32_t block)
+{
+    std::string key(1, TXLIST_TYPE_INDEX);
+    AppendIndexNumber(key, type);
+    AppendIndexNumber(key, block);
+    return key;
+}
+
+uint256 ReadIndexTxid(const Slice& key)
+{
+    uint256 txid;
+    assert(key.size() >= txid.size());
+    memcpy(txid.begin(), key.data() + key.size() - txid.size(), txid.size());
+    return txid;
+}
+
+/**
+ * Returns the height of an index entry, or -1, if the key is no index key.
+ *
+ * Transaction records are keyed by hex encoded txids, so the index prefixes never clash.
+ */
+int ReadIndexHeight(const Slice& key)
+{
+    if (key.size() == 1 + 4 + 32 && key[0] == TXLIST_BLOCK_INDEX) {
+        return ReadIndexNumber(key.data() + 1);
+    }
+    if (key.size() == 1 + 4 + 4 + 32 && key[0] == TXLIST_TYPE_INDEX) {
+        return ReadIndexNumber(key.data() + 5);
+    }
+    return -1;
+}
+
+bool IsIndexKey(const Slice& key)
+{
+    return ReadIndexHeight(key) >= 0;
+}
+
+} // anonymous namespace
+
 std::set<int> CMPTxList::GetSeedBlocks(int startHeight, int endHeight)
 {
     std::set<int> setSeedBlocks;
 
     if (!pdb) return setSeedBlocks;
 
+    std::string endKey = GetBlockIndexKey(static_cast<uint32_t>(endHeight) + 1);
     Iterator* it = NewIterator();
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), boost::token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        int block = atoi(vstr[1]);
-        if (block >= startHeight && block <= endHeight) {
+    for (it->Seek(GetBlockIndexKey(std::max(startHeight, 0))); it->Valid() && it->key().compare(endKey) < 0; it->Next()) {
+        int block = ReadIndexHeight(it->key());
+        if (block >= 0) {
             setSeedBlocks.insert(block);
         }
     }
@@ -2429,27 +2476,69 @@ std::set<int> CMPTxList::GetSeedBlocks(int startHeight, int endHeight)
     return setSeedBlocks;
 }
 
+/**
+ * Returns the transactions recorded in a block, ordered by txid.
+ */
+std::vector<uint256> CMPTxList::GetBlockTransactions(int block)
+{
+    std::vector<uint256> txids;
+
+    if (!pdb) return txids;
+
+    std::string prefix = GetBlockIndexKey(block);
+    Iterator* it = NewIterator();
+
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next()) {
+        if (IsIndexKey(it->key())) {
+            txids.push_back(ReadIndexTxid(it->key()));
+        }
+    }
+
+    delete it;
+
+    return txids;
+}
+
+/**
+ * Returns the transactions of a type recorded within a block range.
+ *
+ * @param type         The transaction type
+ * @param startHeight  The first block (inclusive)
+ * @param endHeight    The last block (inclusive)
+ * @param fValidOnly   Whether to skip invalid transactions
+ * @return The heights and hashes of the transactions, ordered by height and txid
+ */
+std::vector<std::pair<int, uint256> > CMPTxList::GetTransactionsByType(unsigned int type, int startHeight, int endHeight, bool fValidOnly)
+{
+    std::vector<std::pair<int, uint256> > txs;
+
+    if (!pdb) return txs;
+
+    std::string endKey = GetTypeIndexKey(type, static_cast<uint32_t>(endHeight) + 1);
+    Iterator* it = NewIterator();
+
+    for (it->Seek(GetTypeIndexKey(type, std::max(startHeight, 0))); it->Valid() && it->key().compare(endKey) < 0; it->Next()) {
+        int block = ReadIndexHeight(it->key());
+        if (block < 0) continue;
+        if (fValidOnly && (it->value().size() != 1 || it->value()[0] != 1)) continue;
+        txs.push_back(std::make_pair(block, ReadIndexTxid(it->key())));
+    }
+
+    delete it;
+
+    return txs;
+}
+
 bool CMPTxList::CheckForFreezeTxs(int blockHeight)
 {
     assert(pdb);
-    Iterator* it = NewIterator();
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), token_compress_on);
-        if (4 != vstr.size()) continue;
-        int block = atoi(vstr[1]);
-        if (block < blockHeight) continue;
-        uint16_t txtype = atoi(vstr[2]);
-        if (txtype == ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS || txtype == ELYSIUM_TYPE_UNFREEZE_PROPERTY_TOKENS ||
-            txtype == ELYSIUM_TYPE_ENABLE_FREEZING || txtype == ELYSIUM_TYPE_DISABLE_FREEZING) {
-            delete it;
+    for (unsigned int type : FREEZE_TX_TYPES) {
+        if (!GetTransactionsByType(type, blockHeight, TXLIST_MAX_HEIGHT, false).empty()) {
             return true;
         }
     }
 
-    delete it;
     return false;
 }
 
@@ -2458,26 +2547,17 @@ bool CMPTxList::LoadFreezeState(int blockHeight)
     assert(pdb);
     std::vector<std::pair<std::string, uint256> > loadOrder;
     int txnsLoaded = 0;
-    Iterator* it = NewIterator();
     PrintToLog("Loading freeze state from levelDB\n");
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), token_compress_on);
-        if (4 != vstr.size()) continue;
-        uint16_t txtype = atoi(vstr[2]);
-        if (txtype != ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS && txtype != ELYSIUM_TYPE_UNFREEZE_PROPERTY_TOKENS &&
-            txtype != ELYSIUM_TYPE_ENABLE_FREEZING && txtype != ELYSIUM_TYPE_DISABLE_FREEZING) continue;
-        if (atoi(vstr[0]) != 1) continue; // invalid, ignore
-        uint256 txid = uint256S(it->key().ToString());
-        int txPosition = p_ElysiumTXDB->FetchTransactionPosition(txid);
-        std::string sortKey = strprintf("%06d%010d", atoi(vstr[1]), txPosition);
-        loadOrder.push_back(std::make_pair(sortKey, txid));
+    for (unsigned int type : FREEZE_TX_TYPES) {
+        std::vector<std::pair<int, uint256> > txs = GetTransactionsByType(type, 0, TXLIST_MAX_HEIGHT, true);
+        for (std::vector<std::pair<int, uint256> >::const_iterator it = txs.begin(); it != txs.end(); ++it) {
+            int txPosition = p_ElysiumTXDB->FetchTransactionPosition(it->second);
+            std::string sortKey = strprintf("%06d%010d", it->first, txPosition);
+            loadOrder.push_back(std::make_pair(sortKey, it->second));
+        }
     }
 
-    delete it;
-
     std::sort (loadOrder.begin(), loadOrder.end());
 
     for (std::vector<std::pair<std::string, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
@@ -2536,26 +2616,12 @@ void CMPTxList::LoadActivations(int blockHeight)
 {
     if (!pdb) return;
 
-    Slice skey, svalue;
-    Iterator* it = NewIterator();
-
     PrintToLog("Loading feature activations from levelDB\n");
 
-    std::vector<std::pair<int64_t, uint256> > loadOrder;
+    // we only care about valid activations
+    std::vector<std::pair<int, uint256> > loadOrder = GetTransactionsByType(ELYSIUM_MESSAGE_TYPE_ACTIVATION, 0, TXLIST_MAX_HEIGHT, true);
 
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        if (atoi(vstr[2]) != ELYSIUM_MESSAGE_TYPE_ACTIVATION || atoi(vstr[0]) != 1) continue; // we only care about valid activations
-        uint256 txid = uint256S(it->key().ToString());;
-        loadOrder.push_back(std::make_pair(atoi(vstr[1]), txid));
-    }
-
-    std::sort (loadOrder.begin(), loadOrder.end());
-
-    for (std::vector<std::pair<int64_t, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
+    for (std::vector<std::pair<int, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
         uint256 hash = (*it).second;
         uint256 blockHash;
         CTransaction wtx;
@@ -2593,7 +2659,6 @@ void CMPTxList::LoadActivations(int blockHeight)
             continue;
         }
     }
-    delete it;
     CheckLiveActivations(blockHeight);
 
     // This alert never expires as long as custom activations are used
@@ -2606,24 +2671,11 @@ void CMPTxList::LoadActivations(int blockHeight)
 void CMPTxList::LoadAlerts(int blockHeight)
 {
     if (!pdb) return;
-    Slice skey, svalue;
-    Iterator* it = NewIterator();
-
-    std::vector<std::pair<int64_t, uint256> > loadOrder;
-
-    for (it->SeekToFirst(); it->Valid(); it->Next()) {
-        std::string itData = it->value().ToString();
-        std::vector<std::string> vstr;
-        boost::split(vstr, itData, boost::is_any_of(":"), token_compress_on);
-        if (4 != vstr.size()) continue; // unexpected number of tokens
-        if (atoi(vstr[2]) != ELYSIUM_MESSAGE_TYPE_ALERT || atoi(vstr[0]) != 1) continue; // not a valid alert
-        uint256 txid = uint256S(it->key().ToString());;
-        loadOrder.push_back(std::make_pair(atoi(vstr[1]), txid));
-    }
 
-    std::sort (loadOrder.begin(), loadOrder.end());
+    // only valid alerts
+    std::vector<std::pair<int, uint256> > loadOrder = GetTransactionsByType(ELYSIUM_MESSAGE_TYPE_ALERT, 0, TXLIST_MAX_HEIGHT, true);
 
-    for (std::vector<std::pair<int64_t, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
+    for (std::vector<std::pair<int, uint256> >::iterator it = loadOrder.begin(); it != loadOrder.end(); ++it) {
         uint256 txid = (*it).second;
         uint256 blockHash;
         CTransaction wtx;
@@ -2656,7 +2708,6 @@ void CMPTxList::LoadAlerts(int blockHeight)
         }
     }
 
-    delete it;
     int64_t blockTime = 0;
     CBlockIndex* pBlockIndex = chainActive[blockHeight-1];
     if (pBlockIndex != NULL) {
@@ -2769,12 +2820,10 @@ int CMPTxList::getNumberOfSubRecords(const uint256& txid)
 int CMPTxList::getMPTransactionCountTotal()
 {
     int count = 0;
-    Slice skey, svalue;
+    std::string prefix(1, TXLIST_BLOCK_INDEX);
     Iterator* it = NewIterator();
-    for(it->SeekToFirst(); it->Valid(); it->Next())
-    {
-        skey = it->key();
-        if (skey.ToString().length() == 64) { ++count; } //extra entries for cancels and purchases are more than 64 chars long
+    for (it->Seek(prefix); it->Valid() && it->key().starts_with(prefix); it->Next()) {
+        if (IsIndexKey(it->key())) ++count;
     }
     delete it;
     return count;
@@ -2782,26 +2831,7 @@ int CMPTxList::getMPTransactionCountTotal()
 
 int CMPTxList::getMPTransactionCountBlock(int block)
 {
-    int count = 0;
-    Slice skey, svalue;
-    Iterator* it = NewIterator();
-    for(it->SeekToFirst(); it->Valid(); it->Next())
-    {
-        skey = it->key();
-        svalue = it->value();
-        if (skey.ToString().length() == 64)
-        {
-            string strValue = svalue.ToString();
-            std::vector<std::string> vstr;
-            boost::split(vstr, strValue, boost::is_any_of(":"), token_compress_on);
-            if (4 == vstr.size())
-            {
-                if (atoi(vstr[1]) == block) { ++count; }
-            }
-        }
-    }
-    delete it;
-    return count;
+    return GetBlockTransactions(block).size();
 }
 
 string CMPTxList::getKeyValue(string key)
@@ -2932,7 +2962,7 @@ void CMPTxList::recordPaymentTX(const uint256 &txid, bool fValid, int nBlock, un
        uint64_t existingNumberOfPayments = 0;
 
        // Step 1 - Check TXList to see if this payment TXID exists
-       bool paymentEntryExists = p_txlistdb->exists(txid);
+       bool paymentEntryExists = exists(txid);
 
        // Step 2a - If doesn't exist leave number of payments & paymentNumber set to 1
        // Step 2b - If does exist add +1 to existing number of payments and set this paymentNumber as new numberOfPayments
@@ -2979,6 +3009,8 @@ void CMPTxList::recordPaymentTX(const uint256 &txid, bool fValid, int nBlock, un
            subStatus = pdb->Put(writeoptions, subKey, subValue);
            PrintToLog("DEXPAYDEBUG : %s(): %s, line %d, file: %s\n", __FUNCTION__, subStatus.ToString(), __LINE__, __FILE__);
        }
+
+       recordIndexes(txid, fValid, nBlock, type);
 }
 
 void CMPTxList::recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned int type, uint64_t nValue)
@@ -2987,7 +3019,7 @@ void CMPTxList::recordTX(const uint256 &txid, bool fValid, int nBlock, unsigned
 
   // overwrite detection, we should never be overwriting a tx, as that means we have redone something a second time
   // reorgs delete all txs from levelDB above reorg_chain_height
-  if (p_txlistdb->exists(txid)) PrintToLog("LEVELDB TX OVERWRITE DETECTION - %s\n", txid.ToString());
+  if (exists(txid)) PrintToLog("LEVELDB TX OVERWRITE DETECTION - %s\n", txid.ToString());
 
 const string key = txid.ToString();
 const string value = strprintf("%u:%d:%u:%lu", fValid ? 1:0, nBlock, type, nValue);
@@ -3002,6 +3034,28 @@ Status status;
     ++nWritten;
     if (elysium_debug_txdb) PrintToLog("%s(): %s, line %d, file: %s\n", __FUNCTION__, status.ToString(), __LINE__, __FILE__);
   }
+
+  recordIndexes(txid, fValid, nBlock, type);
+}
+
+/**
+ * Adds a transaction to the indexes by block and by type.
+ *
+ * The index values are binary: the block index stores the validity flag and the type, the
+ * type index only the validity flag.
+ */
+void CMPTxList::recordIndexes(const uint256& txid, bool fValid, int nBlock, unsigned int type)
+{
+    std::string txidKey(txid.begin(), txid.end());
+    std::string blockValue(1, fValid ? 1 : 0);
+    AppendIndexNumber(blockValue, type);
+
+    leveldb::WriteBatch batch;
+    batch.Put(GetBlockIndexKey(nBlock) + txidKey, blockValue);
+    batch.Put(GetTypeIndexKey(type, nBlock) + txidKey, std::string(1, fValid ? 1 : 0));
+
+    Status status = pdb->Write(writeoptions, &batch);
+    if (elysium_debug_txdb) PrintToLog("%s(%s): %s\n", __func__, txid.GetHex(), status.ToString());
 }
 
 bool CMPTxList::exists(const uint256 &txid)
@@ -3048,6 +3102,7 @@ Slice skey, svalue;
   {
     skey = it->key();
     svalue = it->value();
+    if (IsIndexKey(skey)) continue;
     ++count;
     PrintToLog("entry #%8d= %s:%s\n", count, skey.ToString(), svalue.ToString());
   }
@@ -3075,6 +3130,17 @@ unsigned int n_found = 0;
 
     ++count;
 
+    // index entries have binary values, but the height is part of the key
+    block = ReadIndexHeight(skey);
+    if (block >= 0)
+    {
+      if ((starting_block <= block) && (block <= ending_block))
+      {
+        if (bDeleteFound) pdb->Delete(writeoptions, skey);
+      }
+      continue;
+    }
+
     string strvalue = it->value().ToString();
 
     // parse the string returned, find the validity flag/bit & other parameters
@@ -3712,6 +3778,7 @@ int elysium_handler_block_begin(int nBlockPrev, CBlockIndex const * pBlockIndex)
 
         // NOTE: The blockNum parameter is inclusive, so deleteAboveBlock(1000) will delete records in block 1000 and above.
         p_txlistdb->isMPinBlockRange(pBlockIndex->nHeight, reorgRecoveryMaxHeight, true);
+        WalletTXIDCacheRemove(pBlockIndex->nHeight);
         t_tradelistdb->deleteAboveBlock(pBlockIndex->nHeight);
         s_stolistdb->deleteAboveBlock(pBlockIndex->nHeight);
         p_feecache->RollBackCache(pBlockIndex->nHeight);
@@ -3792,6 +3859,9 @@ int elysium_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
     // check that pending transactions are still in the mempool
     PendingCheck();
 
+    // results of batch verified spends are only valid within the block
+    ClearSigmaSpendBatch();
+
     // transactions were found in the block, signal the UI accordingly
     if (countMP > 0) CheckWalletUpdate(true);
 
@@ -3816,6 +3886,9 @@ int elysium_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex,
         // save out the state after this block
         if (writePersistence(nBlockNow)) {
             elysium_save_state(pBlockIndex);
+        } else {
+            // nothing is persisted, so the next persisted block needs a full snapshot
+            ResetStateJournal();
         }
     }
 
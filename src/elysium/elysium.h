@@ -1,6 +1,7 @@
 #ifndef ZCOIN_ELYSIUM_ELYSIUM_H
 #define ZCOIN_ELYSIUM_ELYSIUM_H
 
+class CBlock;
 class CBlockIndex;
 class CCoinsView;
 class CCoinsViewCache;
@@ -38,7 +39,7 @@ int const MAX_STATE_HISTORY = 50;
 constexpr size_t ELYSIUM_MAX_SIMPLE_MINTS = std::numeric_limits<uint8_t>::max();
 
 // increment this value to force a refresh of the state (similar to --startclean)
-#define DB_VERSION 6
+#define DB_VERSION 7
 
 // maximum size of string fields
 #define SP_STRING_FIELD_LEN 256
@@ -187,6 +188,10 @@ public:
  */
 class CMPTxList : public CDBBase
 {
+private:
+    /** Adds a transaction to the indexes by block and by type. */
+    void recordIndexes(const uint256& txid, bool fValid, int nBlock, unsigned int type);
+
 public:
     CMPTxList(const boost::filesystem::path& path, bool fWipe)
     {
@@ -223,6 +228,10 @@ public:
     bool getTX(const uint256 &txid, string &value);
 
     std::set<int> GetSeedBlocks(int startHeight, int endHeight);
+    /** Returns the transactions recorded in a block. */
+    std::vector<uint256> GetBlockTransactions(int block);
+    /** Returns the heights and hashes of transactions of a type recorded in a block range, ordered by height. */
+    std::vector<std::pair<int, uint256> > GetTransactionsByType(unsigned int type, int startHeight, int endHeight, bool fValidOnly);
     void LoadAlerts(int blockHeight);
     void LoadActivations(int blockHeight);
     bool LoadFreezeState(int blockHeight);
@@ -264,6 +273,7 @@ int elysium_handler_disc_end(int nBlockNow, CBlockIndex const * pBlockIndex);
 int elysium_handler_block_begin(int nBlockNow, CBlockIndex const * pBlockIndex);
 int elysium_handler_block_end(int nBlockNow, CBlockIndex const * pBlockIndex, unsigned int);
 bool elysium_handler_tx(const CTransaction& tx, int nBlock, unsigned int idx, const CBlockIndex* pBlockIndex);
+int elysium_handler_block_spends(int nBlockNow, const CBlock& block, CBlockIndex const * pBlockIndex);
 int elysium_save_state( CBlockIndex const *pBlockIndex );
 
 namespace elysium
@@ -300,6 +310,8 @@ bool isMainEcosystemProperty(uint32_t propertyId);
 uint32_t GetNextPropertyId(bool maineco); // maybe move into sp
 
 CMPTally* getTally(const std::string& address);
+/** Estimates the heap memory used by the tally map, and counts the balance records. */
+size_t GetTallyMapMemoryUsage(size_t& nRecords);
 
 int64_t getTotalTokens(uint32_t propertyId, int64_t* n_owners_total = NULL);
 
@@ -11,6 +11,7 @@
 #include "elysium/elysium.h"
 #include "elysium/pending.h"
 #include "elysium/utilsbitcoin.h"
+#include "elysium/walletcache.h"
 
 #include "init.h"
 #include "main.h"
@@ -60,33 +61,11 @@ std::map<std::string, uint256> FetchWalletElysiumTransactions(unsigned int count
     if (pwalletMain == NULL) {
         return mapResponse;
     }
+    // the Elysium transactions of the wallet are cached by block and position within block
+    mapResponse = WalletTXIDCacheGet(count, startBlock, endBlock);
     std::set<uint256> seenHashes;
-    std::list<CAccountingEntry> acentries;
-    CWallet::TxItems txOrdered;
-    {
-        LOCK(pwalletMain->cs_wallet);
-        txOrdered = pwalletMain->wtxOrdered;
-    }
-    // Iterate backwards through wallet transactions until we have count items to return:
-    for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
-        const CWalletTx* pwtx = it->second.first;
-        if (pwtx == NULL) continue;
-        const uint256& txHash = pwtx->GetHash();
-        {
-            LOCK(cs_main);
-            if (!p_txlistdb->exists(txHash)) continue;
-        }
-        const uint256& blockHash = pwtx->hashBlock;
-        if (blockHash.IsNull() || (NULL == GetBlockIndex(blockHash))) continue;
-        const CBlockIndex* pBlockIndex = GetBlockIndex(blockHash);
-        if (NULL == pBlockIndex) continue;
-        int blockHeight = pBlockIndex->nHeight;
-        if (blockHeight < startBlock || blockHeight > endBlock) continue;
-        int blockPosition = GetTransactionByteOffset(txHash);
-        std::string sortKey = strprintf("%06d%010d", blockHeight, blockPosition);
-        mapResponse.insert(std::make_pair(sortKey, txHash));
-        seenHashes.insert(txHash);
-        if (mapResponse.size() >= count) break;
+    for (std::map<std::string, uint256>::const_iterator it = mapResponse.begin(); it != mapResponse.end(); ++it) {
+        seenHashes.insert(it->second);
     }
 
     // Insert STO receipts - receiving an STO has no inbound transaction to the wallet, so we will insert these manually into the response
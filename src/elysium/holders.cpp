@@ -0,0 +1,98 @@
+#include "holders.h"
+
+#include "tally.h"
+
+#include "../main.h"
+#include "../sync.h"
+
+#include <string>
+#include <unordered_map>
+
+#include <stdint.h>
+
+namespace elysium {
+
+namespace {
+
+//! Holders of each property, maintained alongside mp_tally_map
+std::unordered_map<uint32_t, PropertyHolders> propertyHolders;
+
+} // anonymous namespace
+
+/**
+ * Returns the number of tokens of a tally, which count as owned for the given property.
+ *
+ * Owned tokens are the available balance and all reserves, but not pending amounts.
+ */
+int64_t GetOwnedTokens(const CMPTally& tally, uint32_t propertyId)
+{
+    int64_t tokens = 0;
+    tokens += tally.getMoney(propertyId, BALANCE);
+    tokens += tally.getMoney(propertyId, SELLOFFER_RESERVE);
+    tokens += tally.getMoney(propertyId, ACCEPT_RESERVE);
+    tokens += tally.getMoney(propertyId, METADEX_RESERVE);
+
+    return tokens;
+}
+
+/**
+ * Updates the holder index after the tally of an address changed for a property.
+ *
+ * Addresses without owned tokens are removed from the index, so iterating the holders of
+ * a property only visits addresses with a positive amount.
+ */
+void UpdatePropertyHolders(const std::string& address, uint32_t propertyId, const CMPTally& tally)
+{
+    AssertLockHeld(cs_main);
+
+    int64_t tokens = GetOwnedTokens(tally, propertyId);
+
+    PropertyHolders& holders = propertyHolders[propertyId];
+    std::unordered_map<std::string, int64_t>::iterator it = holders.owners.find(address);
+
+    if (it != holders.owners.end()) {
+        holders.totalTokens -= it->second;
+        if (tokens > 0) {
+            it->second = tokens;
+        } else {
+            holders.owners.erase(it);
+        }
+    } else if (tokens > 0) {
+        holders.owners.insert(std::make_pair(address, tokens));
+    }
+
+    if (tokens > 0) {
+        holders.totalTokens += tokens;
+    }
+
+    if (holders.owners.empty()) {
+        propertyHolders.erase(propertyId);
+    }
+}
+
+/**
+ * Returns the holders of a property, or NULL, if there are none.
+ *
+ * The returned pointer is only valid while cs_main is held.
+ */
+const PropertyHolders* GetPropertyHolders(uint32_t propertyId)
+{
+    AssertLockHeld(cs_main);
+
+    std::unordered_map<uint32_t, PropertyHolders>::const_iterator it = propertyHolders.find(propertyId);
+    if (it == propertyHolders.end()) {
+        return NULL;
+    }
+
+    return &(it->second);
+}
+
+/**
+ * Drops the holder index, when the tally map is cleared.
+ */
+void ClearPropertyHolders()
+{
+    propertyHolders.clear();
+}
+
+} // namespace elysium
@@ -0,0 +1,37 @@
+#ifndef ELYSIUM_HOLDERS_H
+#define ELYSIUM_HOLDERS_H
+
+#include <stdint.h>
+
+#include <string>
+#include <unordered_map>
+
+class CMPTally;
+
+namespace elysium
+{
+/** Holders of a single property, along with the tokens they own. */
+struct PropertyHolders
+{
+    //! Tokens owned per address, including reserved tokens
+    std::unordered_map<std::string, int64_t> owners;
+    //! Sum of all tokens owned by the holders
+    int64_t totalTokens;
+
+    PropertyHolders() : totalTokens(0) {}
+};
+
+/** Returns the number of tokens of a tally, which count as owned for the given property. */
+int64_t GetOwnedTokens(const CMPTally& tally, uint32_t propertyId);
+
+/** Updates the holder index after the tally of an address changed for a property. */
+void UpdatePropertyHolders(const std::string& address, uint32_t propertyId, const CMPTally& tally);
+
+/** Returns the holders of a property, or NULL, if there are none. */
+const PropertyHolders* GetPropertyHolders(uint32_t propertyId);
+
+/** Drops the holder index, when the tally map is cleared. */
+void ClearPropertyHolders();
+}
+
+#endif // ELYSIUM_HOLDERS_H
@@ -1,11 +1,13 @@
 #include "elysium/mdex.h"
 
+#include "elysium/consensushash.h"
 #include "elysium/errors.h"
 #include "elysium/fees.h"
 #include "elysium/log.h"
 #include "elysium/elysium.h"
 #include "elysium/rules.h"
 #include "elysium/sp.h"
+#include "elysium/statefile.h"
 #include "elysium/tx.h"
 #include "elysium/uint256_extensions.h"
 
@@ -42,16 +44,19 @@ using namespace elysium;
 //! Global map for price and order data
 md_PropertiesMap elysium::metadex;
 
-md_PricesMap* elysium::get_Prices(uint32_t prop)
+//! Open orders by transaction hash, pointing into the sets of the global map
+static std::map<uint256, const CMPMetaDEx*> metadex_txids;
+
+md_PricesMap* elysium::get_Prices(uint32_t prop, uint32_t desprop)
 {
-    md_PropertiesMap::iterator it = metadex.find(prop);
+    md_PropertiesMap::iterator it = metadex.find(std::make_pair(prop, desprop));
 
     if (it != metadex.end()) return &(it->second);
 
     return (md_PricesMap*) NULL;
 }
 
-md_Set* elysium::get_Indexes(md_PricesMap* p, rational_t price)
+md_Set* elysium::get_Indexes(md_PricesMap* p, const rational_t& price)
 {
     md_PricesMap::iterator it = p->find(price);
 
@@ -60,6 +65,35 @@ md_Set* elysium::get_Indexes(md_PricesMap* p, rational_t price)
     return (md_Set*) NULL;
 }
 
+/** Removes an order from its set and the txid index, advancing the iterator. */
+static void EraseOrder(md_Set& indexes, md_Set::iterator& it)
+{
+    metadex_txids.erase(it->getHash());
+    UpdateMetaDExHash(*it, true);
+    RecordMetaDExChange(it->getHash());
+    indexes.erase(it++);
+}
+
+/** Removes the price level if it ran empty, advancing the iterator. */
+static void NextPriceLevel(md_PricesMap& prices, md_PricesMap::iterator& it)
+{
+    if (it->second.empty()) {
+        prices.erase(it++);
+    } else {
+        ++it;
+    }
+}
+
+/** Removes the order book of a property pair if it ran empty, advancing the iterator. */
+static void NextOrderBook(md_PropertiesMap::iterator& it)
+{
+    if (it->second.empty()) {
+        metadex.erase(it++);
+    } else {
+        ++it;
+    }
+}
+
 enum MatchReturnType
 {
     NOTHING = 0,
@@ -142,24 +176,29 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
     if (elysium_debug_metadex1) PrintToLog("%s(%s: prop=%d, desprop=%d, desprice= %s);newo: %s\n",
         __FUNCTION__, pnew->getAddr(), propertyForSale, propertyDesired, xToString(pnew->inversePrice()), pnew->ToString());
 
-    md_PricesMap* const ppriceMap = get_Prices(propertyDesired);
+    // the offers selling the desired property for the property offered by the new order
+    md_PropertiesMap::iterator bookIt = metadex.find(std::make_pair(propertyDesired, propertyForSale));
 
     // nothing for the desired property exists in the market, sorry!
-    if (!ppriceMap) {
+    if (bookIt == metadex.end()) {
         PrintToLog("%s()=%d:%s NOT FOUND ON THE MARKET\n", __FUNCTION__, NewReturn, getTradeReturnType(NewReturn));
         return NewReturn;
     }
 
-    // within the desired property map (given one property) iterate over the items looking at prices
-    for (md_PricesMap::iterator priceIt = ppriceMap->begin(); priceIt != ppriceMap->end(); ++priceIt) { // check all prices
-        const rational_t sellersPrice = priceIt->first;
+    md_PricesMap* const ppriceMap = &(bookIt->second);
+    const rational_t& buyersInversePrice = pnew->inversePrice();
+
+    // within the order book of the pair iterate over the price levels, starting with the best price
+    for (md_PricesMap::iterator priceIt = ppriceMap->begin(); priceIt != ppriceMap->end(); NextPriceLevel(*ppriceMap, priceIt)) {
+        const rational_t& sellersPrice = priceIt->first;
 
         if (elysium_debug_metadex2) PrintToLog("comparing prices: desprice %s needs to be GREATER THAN OR EQUAL TO %s\n",
-            xToString(pnew->inversePrice()), xToString(sellersPrice));
+            xToString(buyersInversePrice), xToString(sellersPrice));
 
         // Is the desired price check satisfied? The buyer's inverse price must be larger than that of the seller.
-        if (pnew->inversePrice() < sellersPrice) {
-            continue;
+        // Price levels are sorted in ascending order, so none of the following levels can match either.
+        if (buyersInversePrice < sellersPrice) {
+            break;
         }
 
         md_Set* const pofferSet = &(priceIt->second);
@@ -173,12 +212,6 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             if (elysium_debug_metadex1) PrintToLog("Looking at existing: %s (its prop= %d, its des prop= %d) = %s\n",
                 xToString(sellersPrice), pold->getProperty(), pold->getDesProperty(), pold->ToString());
 
-            // does the desired property match?
-            if (pold->getDesProperty() != propertyForSale) {
-                ++offerIt;
-                continue;
-            }
-
             if (elysium_debug_metadex1) PrintToLog("MATCH FOUND, Trade: %s = %s\n", xToString(sellersPrice), pold->ToString());
 
             // match found, execute trade now!
@@ -315,12 +348,15 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
 
             if (elysium_debug_metadex1) PrintToLog("++ erased old: %s\n", offerIt->ToString());
             // erase the old seller element
-            pofferSet->erase(offerIt++);
+            EraseOrder(*pofferSet, offerIt);
 
             // insert the updated one in place of the old
             if (0 < seller_replacement.getAmountRemaining()) {
                 PrintToLog("++ inserting seller_replacement: %s\n", seller_replacement.ToString());
-                pofferSet->insert(seller_replacement);
+                md_Set::iterator replacementIt = pofferSet->insert(seller_replacement).first;
+                metadex_txids[replacementIt->getHash()] = &(*replacementIt);
+                UpdateMetaDExHash(*replacementIt, false);
+                RecordMetaDExChange(replacementIt->getHash());
             }
 
             if (bBuyerSatisfied) {
@@ -329,9 +365,14 @@ static MatchReturnType x_Trade(CMPMetaDEx* const pnew)
             }
         } // specific price, check all properties
 
-        if (bBuyerSatisfied) break;
+        if (bBuyerSatisfied) {
+            if (pofferSet->empty()) ppriceMap->erase(priceIt);
+            break;
+        }
     } // check all prices
 
+    if (ppriceMap->empty()) metadex.erase(bookIt);
+
     PrintToLog("%s()=%d:%s\n", __FUNCTION__, NewReturn, getTradeReturnType(NewReturn));
 
     return NewReturn;
@@ -385,18 +426,11 @@ std::string CMPMetaDEx::displayFullUnitPrice() const
     return unitPriceStr;
 }
 
-rational_t CMPMetaDEx::unitPrice() const
+rational_t CMPMetaDEx::calculatePrice(int64_t numerator, int64_t denominator)
 {
-    rational_t effectivePrice;
-    if (amount_forsale) effectivePrice = rational_t(amount_desired, amount_forsale);
-    return effectivePrice;
-}
-
-rational_t CMPMetaDEx::inversePrice() const
-{
-    rational_t inversePrice;
-    if (amount_desired) inversePrice = rational_t(amount_forsale, amount_desired);
-    return inversePrice;
+    rational_t price;
+    if (denominator) price = rational_t(numerator, denominator);
+    return price;
 }
 
 int64_t CMPMetaDEx::getAmountToFill() const
@@ -426,28 +460,6 @@ std::string CMPMetaDEx::ToString() const
         property, FormatMP(property, amount_forsale), desired_property, FormatMP(desired_property, amount_desired));
 }
 
-void CMPMetaDEx::saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const
-{
-    std::string lineOut = strprintf("%s,%d,%d,%d,%d,%d,%d,%d,%s,%d",
-        addr,
-        block,
-        amount_forsale,
-        property,
-        amount_desired,
-        desired_property,
-        subaction,
-        idx,
-        txid.ToString(),
-        amount_remaining
-    );
-
-    // add the line to the hash
-    SHA256_Update(shaCtx, lineOut.c_str(), lineOut.length());
-
-    // write the line
-    file << lineOut << std::endl;
-}
-
 bool MetaDEx_compare::operator()(const CMPMetaDEx &lhs, const CMPMetaDEx &rhs) const
 {
     if (lhs.getBlock() == rhs.getBlock()) return lhs.getIdx() < rhs.getIdx();
@@ -456,39 +468,54 @@ bool MetaDEx_compare::operator()(const CMPMetaDEx &lhs, const CMPMetaDEx &rhs) c
 
 bool elysium::MetaDEx_INSERT(const CMPMetaDEx& objMetaDEx)
 {
-    // Create an empty price map (to use in case price map for this property does not already exist)
-    md_PricesMap temp_prices;
-    // Attempt to obtain the price map for the property
-    md_PricesMap *p_prices = get_Prices(objMetaDEx.getProperty());
+    // Obtain the order book of the pair and the set of metadex objects at this price, creating them as needed
+    md_PricesMap& prices = metadex[std::make_pair(objMetaDEx.getProperty(), objMetaDEx.getDesProperty())];
+    md_Set& indexes = prices[objMetaDEx.unitPrice()];
 
-    // Create an empty set of metadex objects (to use in case no set currently exists at this price)
-    md_Set temp_indexes;
-    md_Set *p_indexes = NULL;
+    // Attempt to insert the metadex object into the set
+    std::pair<md_Set::iterator, bool> ret = indexes.insert(objMetaDEx);
+    if (false == ret.second) return false;
 
-    // Prepare for return code
-    std::pair <md_Set::iterator, bool> ret;
+    metadex_txids[objMetaDEx.getHash()] = &(*ret.first);
+    UpdateMetaDExHash(objMetaDEx, false);
+    RecordMetaDExChange(objMetaDEx.getHash());
 
-    // Attempt to obtain a set of metadex objects for this price from the price map
-    if (p_prices) p_indexes = get_Indexes(p_prices, objMetaDEx.unitPrice());
-    // See if the set was populated, if not no set exists at this price level, use the empty set that we created earlier
-    if (!p_indexes) p_indexes = &temp_indexes;
+    return true;
+}
 
-    // Attempt to insert the metadex object into the set
-    ret = p_indexes->insert(objMetaDEx);
-    if (false == ret.second) return false;
+/**
+ * Removes an open order from the order books.
+ *
+ * @return True, if the order was found and removed
+ */
+bool elysium::MetaDEx_ERASE(const uint256& txid)
+{
+    std::map<uint256, const CMPMetaDEx*>::const_iterator txidIt = metadex_txids.find(txid);
+    if (txidIt == metadex_txids.end()) return false;
 
-    // If a prices map did not exist for this property, set p_prices to the temp empty price map
-    if (!p_prices) p_prices = &temp_prices;
+    const CMPMetaDEx* pold = txidIt->second;
 
-    // Update the prices map with the new set at this price
-    (*p_prices)[objMetaDEx.unitPrice()] = *p_indexes;
+    md_PropertiesMap::iterator bookIt = metadex.find(std::make_pair(pold->getProperty(), pold->getDesProperty()));
+    assert(bookIt != metadex.end());
+    md_PricesMap::iterator priceIt = bookIt->second.find(pold->unitPrice());
+    assert(priceIt != bookIt->second.end());
+    md_Set::iterator it = priceIt->second.find(*pold);
+    assert(it != priceIt->second.end());
 
-    // Set the metadex map for the property to the updated (or new if it didn't exist) price map
-    metadex[objMetaDEx.getProperty()] = *p_prices;
+    EraseOrder(priceIt->second, it);
+    NextPriceLevel(bookIt->second, priceIt);
+    NextOrderBook(bookIt);
 
     return true;
 }
 
+void elysium::MetaDEx_CLEAR()
+{
+    metadex.clear();
+    metadex_txids.clear();
+    ClearMetaDExHash();
+}
+
 // pretty much directly linked to the ADD TX21 command off the wire
 int elysium::MetaDEx_ADD(const std::string& sender_addr, uint32_t prop, int64_t amount, int block, uint32_t property_desired, int64_t amount_desired, const uint256& txid, unsigned int idx)
 {
@@ -529,24 +556,23 @@ int elysium::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block, co
 {
     int rc = METADEX_ERROR -20;
     CMPMetaDEx mdex(sender_addr, 0, prop, amount, property_desired, amount_desired, uint256(), 0, CMPTransaction::CANCEL_AT_PRICE);
-    md_PricesMap* prices = get_Prices(prop);
+    md_PropertiesMap::iterator bookIt = metadex.find(std::make_pair(prop, property_desired));
     const CMPMetaDEx* p_mdex = NULL;
 
     if (elysium_debug_metadex1) PrintToLog("%s():%s\n", __FUNCTION__, mdex.ToString());
 
     if (elysium_debug_metadex2) MetaDEx_debug_print();
 
-    if (!prices) {
+    if (bookIt == metadex.end()) {
         PrintToLog("%s() NOTHING FOUND for %s\n", __FUNCTION__, mdex.ToString());
         return rc -1;
     }
 
-    // within the desired property map (given one property) iterate over the items
-    for (md_PricesMap::iterator my_it = prices->begin(); my_it != prices->end(); ++my_it) {
-        rational_t sellers_price = my_it->first;
-
-        if (mdex.unitPrice() != sellers_price) continue;
+    // within the order book of the pair only the price level of the cancellation is relevant
+    md_PricesMap& prices = bookIt->second;
+    md_PricesMap::iterator my_it = prices.find(mdex.unitPrice());
 
+    if (my_it != prices.end()) {
         md_Set* indexes = &(my_it->second);
 
         for (md_Set::iterator iitt = indexes->begin(); iitt != indexes->end();) {
@@ -554,7 +580,7 @@ int elysium::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block, co
 
             if (elysium_debug_metadex3) PrintToLog("%s(): %s\n", __FUNCTION__, p_mdex->ToString());
 
-            if ((p_mdex->getDesProperty() != property_desired) || (p_mdex->getAddr() != sender_addr)) {
+            if (p_mdex->getAddr() != sender_addr) {
                 ++iitt;
                 continue;
             }
@@ -570,8 +596,11 @@ int elysium::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block, co
             bool bValid = true;
             p_txlistdb->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
 
-            indexes->erase(iitt++);
+            EraseOrder(*indexes, iitt);
         }
+
+        if (indexes->empty()) prices.erase(my_it);
+        if (prices.empty()) metadex.erase(bookIt);
     }
 
     if (elysium_debug_metadex2) MetaDEx_debug_print();
@@ -582,20 +611,21 @@ int elysium::MetaDEx_CANCEL_AT_PRICE(const uint256& txid, unsigned int block, co
 int elysium::MetaDEx_CANCEL_ALL_FOR_PAIR(const uint256& txid, unsigned int block, const std::string& sender_addr, uint32_t prop, uint32_t property_desired)
 {
     int rc = METADEX_ERROR -30;
-    md_PricesMap* prices = get_Prices(prop);
+    md_PropertiesMap::iterator bookIt = metadex.find(std::make_pair(prop, property_desired));
     const CMPMetaDEx* p_mdex = NULL;
 
     PrintToLog("%s(%d,%d)\n", __FUNCTION__, prop, property_desired);
 
     if (elysium_debug_metadex3) MetaDEx_debug_print();
 
-    if (!prices) {
+    if (bookIt == metadex.end()) {
         PrintToLog("%s() NOTHING FOUND\n", __FUNCTION__);
         return rc -1;
     }
 
-    // within the desired property map (given one property) iterate over the items
-    for (md_PricesMap::iterator my_it = prices->begin(); my_it != prices->end(); ++my_it) {
+    // within the order book of the pair iterate over the items
+    md_PricesMap& prices = bookIt->second;
+    for (md_PricesMap::iterator my_it = prices.begin(); my_it != prices.end(); NextPriceLevel(prices, my_it)) {
         md_Set* indexes = &(my_it->second);
 
         for (md_Set::iterator iitt = indexes->begin(); iitt != indexes->end();) {
@@ -603,7 +633,7 @@ int elysium::MetaDEx_CANCEL_ALL_FOR_PAIR(const uint256& txid, unsigned int block
 
             if (elysium_debug_metadex3) PrintToLog("%s(): %s\n", __FUNCTION__, p_mdex->ToString());
 
-            if ((p_mdex->getDesProperty() != property_desired) || (p_mdex->getAddr() != sender_addr)) {
+            if (p_mdex->getAddr() != sender_addr) {
                 ++iitt;
                 continue;
             }
@@ -619,10 +649,12 @@ int elysium::MetaDEx_CANCEL_ALL_FOR_PAIR(const uint256& txid, unsigned int block
             bool bValid = true;
             p_txlistdb->recordMetaDExCancelTX(txid, p_mdex->getHash(), bValid, block, p_mdex->getProperty(), p_mdex->getAmountRemaining());
 
-            indexes->erase(iitt++);
+            EraseOrder(*indexes, iitt);
         }
     }
 
+    if (prices.empty()) metadex.erase(bookIt);
+
     if (elysium_debug_metadex3) MetaDEx_debug_print();
 
     return rc;
@@ -641,17 +673,17 @@ int elysium::MetaDEx_CANCEL_EVERYTHING(const uint256& txid, unsigned int block,
 
     PrintToLog("<<<<<<\n");
 
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        unsigned int prop = my_it->first;
+    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); NextOrderBook(my_it)) {
+        unsigned int prop = my_it->first.first;
 
         // skip property, if it is not in the expected ecosystem
         if (isMainEcosystemProperty(ecosystem) && !isMainEcosystemProperty(prop)) continue;
         if (isTestEcosystemProperty(ecosystem) && !isTestEcosystemProperty(prop)) continue;
 
-        PrintToLog(" ## property: %u\n", prop);
+        PrintToLog(" ## property: %u, desired: %u\n", prop, my_it->first.second);
         md_PricesMap& prices = my_it->second;
 
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
+        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); NextPriceLevel(prices, it)) {
             rational_t price = it->first;
             md_Set& indexes = it->second;
 
@@ -676,7 +708,7 @@ int elysium::MetaDEx_CANCEL_EVERYTHING(const uint256& txid, unsigned int block,
                 bool bValid = true;
                 p_txlistdb->recordMetaDExCancelTX(txid, it->getHash(), bValid, block, it->getProperty(), it->getAmountRemaining());
 
-                indexes.erase(it++);
+                EraseOrder(indexes, it);
             }
         }
     }
@@ -694,18 +726,18 @@ int elysium::MetaDEx_SHUTDOWN_ALLPAIR()
 {
     int rc = 0;
     PrintToLog("%s()\n", __FUNCTION__);
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
+    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); NextOrderBook(my_it)) {
+        // all orders of a book share the pair, so books with an ELYSIUM/TELYSIUM side are kept entirely
+        if (my_it->first.first <= ELYSIUM_PROPERTY_TELYSIUM || my_it->first.second <= ELYSIUM_PROPERTY_TELYSIUM) continue;
         md_PricesMap& prices = my_it->second;
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
+        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); NextPriceLevel(prices, it)) {
             md_Set& indexes = it->second;
             for (md_Set::iterator it = indexes.begin(); it != indexes.end();) {
-                if (it->getDesProperty() > ELYSIUM_PROPERTY_TELYSIUM && it->getProperty() > ELYSIUM_PROPERTY_TELYSIUM) { // no ELYSIUM/TELYSIUM side to the trade
-                    PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, it->ToString());
-                    // move from reserve to balance
-                    assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
-                    assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
-                    indexes.erase(it++);
-                }
+                PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, it->ToString());
+                // move from reserve to balance
+                assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
+                assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
+                EraseOrder(indexes, it);
             }
         }
     }
@@ -723,15 +755,15 @@ int elysium::MetaDEx_SHUTDOWN()
         md_PricesMap& prices = my_it->second;
         for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
             md_Set& indexes = it->second;
-            for (md_Set::iterator it = indexes.begin(); it != indexes.end();) {
+            for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it) {
                 PrintToLog("%s(): REMOVING %s\n", __FUNCTION__, it->ToString());
                 // move from reserve to balance
                 assert(update_tally_map(it->getAddr(), it->getProperty(), -it->getAmountRemaining(), METADEX_RESERVE));
                 assert(update_tally_map(it->getAddr(), it->getProperty(), it->getAmountRemaining(), BALANCE));
-                indexes.erase(it++);
             }
         }
     }
+    MetaDEx_CLEAR();
     return rc;
 }
 
@@ -739,18 +771,9 @@ int elysium::MetaDEx_SHUTDOWN()
 // allows search to be optimized if propertyIdForSale is specified
 bool elysium::MetaDEx_isOpen(const uint256& txid, uint32_t propertyIdForSale)
 {
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        if (propertyIdForSale != 0 && propertyIdForSale != my_it->first) continue;
-        md_PricesMap & prices = my_it->second;
-        for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
-            md_Set & indexes = (it->second);
-            for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                CMPMetaDEx obj = *it;
-                if( obj.getHash().GetHex() == txid.GetHex() ) return true;
-            }
-        }
-    }
-    return false;
+    const CMPMetaDEx* pobj = MetaDEx_RetrieveTrade(txid);
+    if (!pobj) return false;
+    return propertyIdForSale == 0 || propertyIdForSale == pobj->getProperty();
 }
 
 /**
@@ -809,9 +832,9 @@ void elysium::MetaDEx_debug_print(bool bShowPriceLevel, bool bDisplay)
 {
     PrintToLog("<<<\n");
     for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        uint32_t prop = my_it->first;
+        uint32_t prop = my_it->first.first;
 
-        PrintToLog(" ## property: %u\n", prop);
+        PrintToLog(" ## property: %u, desired: %u\n", prop, my_it->first.second);
         md_PricesMap& prices = my_it->second;
 
         for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) {
@@ -837,14 +860,7 @@ void elysium::MetaDEx_debug_print(bool bShowPriceLevel, bool bDisplay)
  */
 const CMPMetaDEx* elysium::MetaDEx_RetrieveTrade(const uint256& txid)
 {
-    for (md_PropertiesMap::iterator propIter = metadex.begin(); propIter != metadex.end(); ++propIter) {
-        md_PricesMap & prices = propIter->second;
-        for (md_PricesMap::iterator pricesIter = prices.begin(); pricesIter != prices.end(); ++pricesIter) {
-            md_Set & indexes = pricesIter->second;
-            for (md_Set::iterator tradesIter = indexes.begin(); tradesIter != indexes.end(); ++tradesIter) {
-                if (txid == (*tradesIter).getHash()) return &(*tradesIter);
-            }
-        }
-    }
+    std::map<uint256, const CMPMetaDEx*>::const_iterator it = metadex_txids.find(txid);
+    if (it != metadex_txids.end()) return it->second;
     return (CMPMetaDEx*) NULL;
 }
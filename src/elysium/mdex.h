@@ -3,6 +3,7 @@
 
 #include "elysium/tx.h"
 
+#include "serialize.h"
 #include "uint256.h"
 
 #include <boost/lexical_cast.hpp>
@@ -10,11 +11,8 @@
 #include <boost/multiprecision/cpp_int.hpp>
 #include <boost/rational.hpp>
 
-#include <openssl/sha.h>
-
 #include <stdint.h>
 
-#include <fstream>
 #include <map>
 #include <set>
 #include <string>
@@ -47,6 +45,11 @@ private:
     int64_t amount_remaining;
     uint8_t subaction;
     std::string addr;
+    // prices depend on the immutable offer amounts only, so they are computed once
+    rational_t unit_price;
+    rational_t inverse_price;
+
+    static rational_t calculatePrice(int64_t numerator, int64_t denominator);
 
 public:
     uint256 getHash() const { return txid; }
@@ -77,29 +80,53 @@ public:
     CMPMetaDEx(const std::string& addr, int b, uint32_t c, int64_t nValue, uint32_t cd, int64_t ad,
                const uint256& tx, uint32_t i, uint8_t suba)
       : block(b), txid(tx), idx(i), property(c), amount_forsale(nValue), desired_property(cd), amount_desired(ad),
-        amount_remaining(nValue), subaction(suba), addr(addr) {}
+        amount_remaining(nValue), subaction(suba), addr(addr),
+        unit_price(calculatePrice(ad, nValue)), inverse_price(calculatePrice(nValue, ad)) {}
 
     CMPMetaDEx(const std::string& addr, int b, uint32_t c, int64_t nValue, uint32_t cd, int64_t ad,
                const uint256& tx, uint32_t i, uint8_t suba, int64_t ar)
       : block(b), txid(tx), idx(i), property(c), amount_forsale(nValue), desired_property(cd), amount_desired(ad),
-        amount_remaining(ar), subaction(suba), addr(addr) {}
+        amount_remaining(ar), subaction(suba), addr(addr),
+        unit_price(calculatePrice(ad, nValue)), inverse_price(calculatePrice(nValue, ad)) {}
 
     CMPMetaDEx(const CMPTransaction& tx)
       : block(tx.block), txid(tx.txid), idx(tx.tx_idx), property(tx.property), amount_forsale(tx.nValue),
         desired_property(tx.desired_property), amount_desired(tx.desired_value), amount_remaining(tx.nValue),
-        subaction(tx.subaction), addr(tx.sender) {}
+        subaction(tx.subaction), addr(tx.sender),
+        unit_price(calculatePrice(tx.desired_value, tx.nValue)), inverse_price(calculatePrice(tx.nValue, tx.desired_value)) {}
 
     std::string ToString() const;
 
-    rational_t unitPrice() const;
-    rational_t inversePrice() const;
+    /** Amount desired per unit for sale, or zero if nothing is for sale. */
+    const rational_t& unitPrice() const { return unit_price; }
+    /** Amount for sale per unit desired, or zero if nothing is desired. */
+    const rational_t& inversePrice() const { return inverse_price; }
 
     /** Used for display of unit prices to 8 decimal places at UI layer. */
     std::string displayUnitPrice() const;
     /** Used for display of unit prices with 50 decimal places at RPC layer. */
     std::string displayFullUnitPrice() const;
 
-    void saveOffer(std::ofstream& file, SHA256_CTX* shaCtx) const;
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(block);
+        READWRITE(txid);
+        READWRITE(idx);
+        READWRITE(property);
+        READWRITE(amount_forsale);
+        READWRITE(desired_property);
+        READWRITE(amount_desired);
+        READWRITE(amount_remaining);
+        READWRITE(subaction);
+        READWRITE(addr);
+
+        if (ser_action.ForRead()) {
+            unit_price = calculatePrice(amount_desired, amount_forsale);
+            inverse_price = calculatePrice(amount_forsale, amount_desired);
+        }
+    }
 };
 
 namespace elysium
@@ -114,15 +141,16 @@ struct MetaDEx_compare
 typedef std::set<CMPMetaDEx, MetaDEx_compare> md_Set;
 //! Map of prices; there is a set of sorted objects for each price
 typedef std::map<rational_t, md_Set> md_PricesMap;
-//! Map of properties; there is a map of prices for each property
-typedef std::map<uint32_t, md_PricesMap> md_PropertiesMap;
+//! Property for sale and property desired of an order book
+typedef std::pair<uint32_t, uint32_t> md_PropertyPair;
+//! Map of property pairs; there is a map of prices for each pair of property for sale and property desired
+typedef std::map<md_PropertyPair, md_PricesMap> md_PropertiesMap;
 
 //! Global map for price and order data
 extern md_PropertiesMap metadex;
 
-// TODO: explore a property-pair, instead of a single property as map's key........
-md_PricesMap* get_Prices(uint32_t prop);
-md_Set* get_Indexes(md_PricesMap* p, rational_t price);
+md_PricesMap* get_Prices(uint32_t prop, uint32_t desprop);
+md_Set* get_Indexes(md_PricesMap* p, const rational_t& price);
 // ---------------
 
 int MetaDEx_ADD(const std::string& sender_addr, uint32_t, int64_t, int block, uint32_t property_desired, int64_t amount_desired, const uint256& txid, unsigned int idx);
@@ -132,6 +160,8 @@ int MetaDEx_CANCEL_EVERYTHING(const uint256& txid, uint32_t block, const std::st
 int MetaDEx_SHUTDOWN();
 int MetaDEx_SHUTDOWN_ALLPAIR();
 bool MetaDEx_INSERT(const CMPMetaDEx& objMetaDEx);
+bool MetaDEx_ERASE(const uint256& txid);
+void MetaDEx_CLEAR();
 void MetaDEx_debug_print(bool bShowPriceLevel = false, bool bDisplay = false);
 bool MetaDEx_isOpen(const uint256& txid, uint32_t propertyIdForSale = 0);
 int MetaDEx_getStatus(const uint256& txid, uint32_t propertyIdForSale, int64_t amountForSale, int64_t totalSold = -1);
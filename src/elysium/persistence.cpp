@@ -16,14 +16,20 @@
  */
 leveldb::Status CDBBase::Open(const boost::filesystem::path& path, bool fWipe)
 {
+    std::string strName = path.filename().string();
+    instance.reset(new CDBInstance(strName, GetDBOptions(strName, ELYSIUM_DB_CACHE_SIZE)));
+
     if (fWipe) {
         if (elysium_debug_persistence) PrintToLog("Wiping LevelDB in %s\n", path.string());
-        leveldb::DestroyDB(path.string(), options);
+        leveldb::DestroyDB(path.string(), instance->options);
     }
     TryCreateDirectory(path);
     if (elysium_debug_persistence) PrintToLog("Opening LevelDB in %s\n", path.string());
 
-    return leveldb::DB::Open(options, path.string(), &pdb);
+    leveldb::Status status = leveldb::DB::Open(instance->options, path.string(), &pdb);
+    if (status.ok())
+        instance->SetDB(pdb);
+    return status;
 }
 
 /**
@@ -58,10 +64,13 @@ void CDBBase::Clear()
  */
 void CDBBase::Close()
 {
+    if (instance)
+        instance->SetDB(NULL);
     if (pdb) {
         delete pdb;
         pdb = NULL;
     }
+    instance.reset();
 }
 
 
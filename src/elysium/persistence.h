@@ -1,6 +1,8 @@
 #ifndef ELYSIUM_PERSISTENCE_H
 #define ELYSIUM_PERSISTENCE_H
 
+#include "dbwrapper.h"
+
 #include "leveldb/db.h"
 
 #include <boost/filesystem/path.hpp>
@@ -8,6 +10,11 @@
 #include <assert.h>
 #include <stddef.h>
 
+#include <memory>
+
+//! Cache budget of each Elysium database, see GetDBOptions
+static const size_t ELYSIUM_DB_CACHE_SIZE = 8 << 20;
+
 /** Base class for LevelDB based storage.
  */
 class CDBBase
@@ -17,8 +24,8 @@ private:
     leveldb::ReadOptions iteroptions;
 
 protected:
-    //! Database options used
-    leveldb::Options options;
+    //! Database options and counters, exists while the database is open
+    std::unique_ptr<CDBInstance> instance;
 
     //! Options used when reading from the database
     leveldb::ReadOptions readoptions;
@@ -40,10 +47,6 @@ protected:
 
     CDBBase() : pdb(NULL), nRead(0), nWritten(0)
     {
-        options.paranoid_checks = true;
-        options.create_if_missing = true;
-        options.compression = leveldb::kNoCompression;
-        options.max_open_files = 64;
         readoptions.verify_checksums = true;
         iteroptions.verify_checksums = true;
         iteroptions.fill_cache = false;
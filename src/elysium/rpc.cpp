@@ -52,6 +52,7 @@
 
 #include <univalue.h>
 
+#include <algorithm>
 #include <map>
 #include <stdexcept>
 #include <string>
@@ -1426,15 +1427,14 @@ UniValue elysium_getorderbook(const UniValue& params, bool fHelp)
     std::vector<CMPMetaDEx> vecMetaDexObjects;
     {
         LOCK(cs_main);
-        for (md_PropertiesMap::const_iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
+        // order books are keyed by property pair, so the books of the property for sale are adjacent
+        md_PropertiesMap::const_iterator my_it = metadex.lower_bound(std::make_pair(propertyIdForSale, filterDesired ? propertyIdDesired : 0));
+        for (; my_it != metadex.end() && my_it->first.first == propertyIdForSale; ++my_it) {
+            if (filterDesired && my_it->first.second != propertyIdDesired) break;
             const md_PricesMap& prices = my_it->second;
             for (md_PricesMap::const_iterator it = prices.begin(); it != prices.end(); ++it) {
                 const md_Set& indexes = it->second;
-                for (md_Set::const_iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                    const CMPMetaDEx& obj = *it;
-                    if (obj.getProperty() != propertyIdForSale) continue;
-                    if (!filterDesired || obj.getDesProperty() == propertyIdDesired) vecMetaDexObjects.push_back(obj);
-                }
+                vecMetaDexObjects.insert(vecMetaDexObjects.end(), indexes.begin(), indexes.end());
             }
         }
     }
@@ -1721,30 +1721,22 @@ UniValue elysium_listblocktransactions(const UniValue& params, bool fHelp)
 
     RequireHeightInChain(blockHeight);
 
-    // next let's obtain the block for this height
-    CBlock block;
-    {
-        LOCK(cs_main);
-        CBlockIndex* pBlockIndex = chainActive[blockHeight];
-
-        if (!ReadBlockFromDisk(block, pBlockIndex, Params().GetConsensus())) {
-            throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to read block from disk");
-        }
-    }
-
     UniValue response(UniValue::VARR);
 
-    // now we want to loop through each of the transactions in the block and run against CMPTxList::exists
-    // those that return positive add to our response array
-
     LOCK(cs_main);
 
-    BOOST_FOREACH(const CTransaction&tx, block.vtx) {
-        if (p_txlistdb->exists(tx.GetHash())) {
-            // later we can add a verbose flag to decode here, but for now callers can send returned txids into gettransaction_MP
-            // add the txid into the response as it's an MP transaction
-            response.push_back(tx.GetHash().GetHex());
-        }
+    // the transactions of the block are taken from the block index of the transaction list,
+    // and ordered by their position within the block
+    std::vector<std::pair<uint32_t, uint256> > blockTransactions;
+    std::vector<uint256> txids = p_txlistdb->GetBlockTransactions(blockHeight);
+    for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); ++it) {
+        blockTransactions.push_back(std::make_pair(p_ElysiumTXDB->FetchTransactionPosition(*it), *it));
+    }
+    std::sort(blockTransactions.begin(), blockTransactions.end());
+
+    for (std::vector<std::pair<uint32_t, uint256> >::const_iterator it = blockTransactions.begin(); it != blockTransactions.end(); ++it) {
+        // later we can add a verbose flag to decode here, but for now callers can send returned txids into gettransaction_MP
+        response.push_back(it->second.GetHex());
     }
 
     return response;
@@ -2107,6 +2099,37 @@ UniValue elysium_getinfo(const UniValue& params, bool fHelp)
     return infoResponse;
 }
 
+UniValue elysium_gettallymapinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "elysium_gettallymapinfo\n"
+            "Returns the size of the balance records held in memory.\n"
+            "The records of all addresses are visited, so this is slow on nodes with many addresses.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"addresses\" : nnnnnn,                  (number) addresses with balance records\n"
+            "  \"records\" : nnnnnn,                    (number) balance records of all addresses\n"
+            "  \"memoryusage\" : nnnnnnnn,              (number) estimated memory used by the balance records in bytes\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("elysium_gettallymapinfo", "")
+            + HelpExampleRpc("elysium_gettallymapinfo", "")
+        );
+
+    LOCK(cs_main);
+
+    size_t records = 0;
+    size_t memoryUsage = GetTallyMapMemoryUsage(records);
+
+    UniValue response(UniValue::VOBJ);
+    response.push_back(Pair("addresses", (uint64_t) mp_tally_map.size()));
+    response.push_back(Pair("records", (uint64_t) records));
+    response.push_back(Pair("memoryusage", (uint64_t) memoryUsage));
+
+    return response;
+}
+
 UniValue elysium_getactivations(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() != 0)
@@ -2427,6 +2450,7 @@ static const CRPCCommand commands[] =
     { "elysium (data retrieval)", "elysium_getfeedistribution",        &elysium_getfeedistribution,         false },
     { "elysium (data retrieval)", "elysium_getfeedistributions",       &elysium_getfeedistributions,        false },
     { "elysium (data retrieval)", "elysium_getbalanceshash",           &elysium_getbalanceshash,            false },
+    { "elysium (data retrieval)", "elysium_gettallymapinfo",           &elysium_gettallymapinfo,            true  },
 #ifdef ENABLE_WALLET
     { "elysium (data retrieval)", "elysium_listtransactions",          &elysium_listtransactions,           false },
     { "elysium (data retrieval)", "elysium_listmints",                 &elysium_listmints,                  false },
@@ -0,0 +1,314 @@
+/**
+ * @file scan.cpp
+ *
+ * Parallel block reading and marker detection for the initial scan.
+ *
+ * Reading blocks from disk and looking for class B and class C markers doesn't depend on the
+ * state, so it is done by worker threads ahead of the scan. Identifying the sender needs the
+ * inputs of a transaction, which are looked up while cs_main is held, so parsing and applying
+ * marked transactions remains sequential in block order.
+ *
+ * The positions of marked transactions are stored per block hash, so later scans don't need
+ * to read blocks without Elysium transactions at all.
+ */
+
+#include "scan.h"
+
+#include "log.h"
+#include "packetencoder.h"
+
+#include "../chain.h"
+#include "../chainparams.h"
+#include "../clientversion.h"
+#include "../main.h"
+#include "../primitives/block.h"
+#include "../serialize.h"
+#include "../streams.h"
+#include "../sync.h"
+#include "../uint256.h"
+#include "../util.h"
+
+#include "leveldb/db.h"
+
+#include <boost/bind.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/thread.hpp>
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace elysium {
+
+namespace {
+
+//! Version of the marker detection rules, the index is rebuilt when it changes
+const int MARKER_INDEX_VERSION = 1;
+
+//! Key of the marker detection rules version
+const std::string VERSION_KEY = "version";
+
+std::string GetMarkerKey(const uint256& blockHash)
+{
+    return "m" + std::string(blockHash.begin(), blockHash.end());
+}
+
+} // anonymous namespace
+
+/**
+ * Returns the positions of all transactions of a block with an Elysium class B or class C marker.
+ *
+ * Transactions without marker are never Elysium transactions, so only the marked ones need
+ * to be parsed.
+ */
+std::vector<uint32_t> FindMarkedTransactions(const CBlock& block, int nHeight)
+{
+    std::vector<uint32_t> positions;
+
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        if (DeterminePacketClass(*block.vtx[i], nHeight)) {
+            positions.push_back(i);
+        }
+    }
+
+    return positions;
+}
+
+CElysiumMarkerIndex::CElysiumMarkerIndex(const boost::filesystem::path& path, bool fWipe)
+{
+    leveldb::Status status = Open(path, fWipe);
+    PrintToLog("Loading marker index database: %s\n", status.ToString());
+
+    std::string strValue;
+    int nVersion = 0;
+    if (pdb->Get(readoptions, VERSION_KEY, &strValue).ok()) {
+        CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> nVersion;
+    }
+
+    if (nVersion != MARKER_INDEX_VERSION) {
+        PrintToLog("Marker index version %d is outdated, rebuilding index\n", nVersion);
+        Clear();
+
+        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+        ssValue << MARKER_INDEX_VERSION;
+        pdb->Put(syncoptions, VERSION_KEY, leveldb::Slice(&ssValue[0], ssValue.size()));
+    }
+}
+
+CElysiumMarkerIndex::~CElysiumMarkerIndex()
+{
+    if (elysium_debug_persistence) PrintToLog("CElysiumMarkerIndex closed\n");
+}
+
+/**
+ * Reads the marked transactions of a block.
+ *
+ * @param blockHash[in]   The hash of the block
+ * @param positions[out]  The positions of the marked transactions within the block
+ * @return True, if the block was indexed
+ */
+bool CElysiumMarkerIndex::ReadMarkers(const uint256& blockHash, std::vector<uint32_t>& positions)
+{
+    assert(pdb);
+
+    std::string strValue;
+    leveldb::Status status = pdb->Get(readoptions, GetMarkerKey(blockHash), &strValue);
+    if (!status.ok()) {
+        return false;
+    }
+
+    try {
+        CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> positions;
+    } catch (const std::exception& e) {
+        PrintToLog("%s: failed to deserialize markers of block %s: %s\n", __func__, blockHash.GetHex(), e.what());
+        return false;
+    }
+
+    ++nRead;
+
+    return true;
+}
+
+/**
+ * Stores the marked transactions of a block.
+ */
+bool CElysiumMarkerIndex::WriteMarkers(const uint256& blockHash, const std::vector<uint32_t>& positions)
+{
+    assert(pdb);
+
+    CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+    ssValue << positions;
+
+    leveldb::Status status = pdb->Put(writeoptions, GetMarkerKey(blockHash), leveldb::Slice(&ssValue[0], ssValue.size()));
+    if (!status.ok()) {
+        PrintToLog("%s: failed to store markers of block %s: %s\n", __func__, blockHash.GetHex(), status.ToString());
+        return false;
+    }
+
+    ++nWritten;
+
+    return true;
+}
+
+CBlockPrefetcher::CBlockPrefetcher(CElysiumMarkerIndex* pindexdb, int nFirstHeight, int nLastHeight, int nThreads)
+  : pindexdb(pindexdb),
+    nNextHeight(nFirstHeight),
+    nQueuedHeight(nFirstHeight),
+    nLastHeight(nLastHeight),
+    nWindow(std::max(1, nThreads * SCAN_BLOCKS_PER_THREAD)),
+    fStopping(false)
+{
+    for (int i = 0; i < nThreads; ++i) {
+        threads.create_thread(boost::bind(&CBlockPrefetcher::Run, this));
+    }
+}
+
+CBlockPrefetcher::~CBlockPrefetcher()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        fStopping = true;
+        condJob.notify_all();
+    }
+    threads.join_all();
+}
+
+/**
+ * Reads a block from disk and detects its marked transactions, unless they are already known.
+ *
+ * Blocks without marked transactions are not kept in memory.
+ */
+void CBlockPrefetcher::Process(const Job& job)
+{
+    ScannedBlock& scanned = *job.result;
+
+    if (!ReadBlockFromDisk(scanned.block, job.pos, job.nHeight, Params().GetConsensus())) {
+        scanned.fFailed = true;
+        return;
+    }
+
+    if (scanned.block.GetHash() != job.blockHash) {
+        PrintToLog("%s: hash of block %d at %s doesn't match index\n", __func__, job.nHeight, job.pos.ToString());
+        scanned.fFailed = true;
+        return;
+    }
+
+    if (!scanned.fIndexed) {
+        scanned.markers = FindMarkedTransactions(scanned.block, job.nHeight);
+    }
+
+    if (scanned.markers.empty()) {
+        scanned.block.SetNull();
+    }
+}
+
+/**
+ * Queues the blocks within the read-ahead window.
+ *
+ * The block index entries are accessed here, because cs_main is held by the scan, but not
+ * by the workers.
+ */
+void CBlockPrefetcher::Refill()
+{
+    AssertLockHeld(cs_main);
+
+    while (nQueuedHeight <= nLastHeight && nQueuedHeight < nNextHeight + nWindow) {
+        const CBlockIndex* pblockindex = chainActive[nQueuedHeight];
+        if (pblockindex == NULL) {
+            nLastHeight = nQueuedHeight - 1;
+            break;
+        }
+
+        Job job;
+        job.nHeight = nQueuedHeight;
+        job.blockHash = pblockindex->GetBlockHash();
+        job.pos = pblockindex->GetBlockPos();
+        job.result.reset(new ScannedBlock());
+        job.result->pindex = pblockindex;
+
+        if (pindexdb != NULL) {
+            job.result->fIndexed = pindexdb->ReadMarkers(job.blockHash, job.result->markers);
+        }
+
+        bool fSkip = job.result->fIndexed && job.result->markers.empty();
+
+        if (!fSkip && threads.size() == 0) {
+            Process(job);
+        }
+
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (fSkip || threads.size() == 0) {
+            done[job.nHeight] = job.result;
+        } else {
+            jobs.push_back(job);
+            condJob.notify_one();
+        }
+
+        ++nQueuedHeight;
+    }
+}
+
+void CBlockPrefetcher::Run()
+{
+    RenameThread("elysium-scan");
+
+    while (true) {
+        Job job;
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (jobs.empty() && !fStopping)
+                condJob.wait(lock);
+            if (fStopping)
+                return;
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        Process(job);
+
+        boost::unique_lock<boost::mutex> lock(cs);
+        done[job.nHeight] = job.result;
+        condDone.notify_all();
+    }
+}
+
+/**
+ * Waits for the next block in chain order.
+ *
+ * Newly classified blocks are added to the marker index, once they are handed to the scan.
+ *
+ * @return The next block, or NULL, if there are no more blocks
+ */
+std::shared_ptr<const ScannedBlock> CBlockPrefetcher::Next()
+{
+    Refill();
+
+    if (nNextHeight >= nQueuedHeight) {
+        return std::shared_ptr<const ScannedBlock>();
+    }
+
+    std::shared_ptr<ScannedBlock> scanned;
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        std::map<int, std::shared_ptr<ScannedBlock> >::iterator it;
+        while ((it = done.find(nNextHeight)) == done.end())
+            condDone.wait(lock);
+        scanned = it->second;
+        done.erase(it);
+    }
+
+    if (pindexdb != NULL && !scanned->fFailed && !scanned->fIndexed) {
+        pindexdb->WriteMarkers(scanned->pindex->GetBlockHash(), scanned->markers);
+    }
+
+    ++nNextHeight;
+
+    return scanned;
+}
+
+} // namespace elysium
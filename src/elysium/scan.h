@@ -0,0 +1,114 @@
+#ifndef ELYSIUM_SCAN_H
+#define ELYSIUM_SCAN_H
+
+#include "elysium/persistence.h"
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/thread.hpp>
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace elysium
+{
+//! Default number of threads used to read and classify blocks during the initial scan
+static const int DEFAULT_SCAN_THREADS = 4;
+//! Maximum number of threads used to read and classify blocks during the initial scan
+static const int MAX_SCAN_THREADS = 16;
+//! Number of blocks each scan thread may read ahead of the block being processed
+static const int SCAN_BLOCKS_PER_THREAD = 16;
+
+/** Returns the positions of all transactions of a block with an Elysium class B or class C marker. */
+std::vector<uint32_t> FindMarkedTransactions(const CBlock& block, int nHeight);
+
+/** LevelDB based storage of the positions of transactions with Elysium markers per block.
+ */
+class CElysiumMarkerIndex : public CDBBase
+{
+public:
+    CElysiumMarkerIndex(const boost::filesystem::path& path, bool fWipe);
+    virtual ~CElysiumMarkerIndex();
+
+    /** Reads the marked transactions of a block, returns false if the block was not indexed yet. */
+    bool ReadMarkers(const uint256& blockHash, std::vector<uint32_t>& positions);
+    /** Stores the marked transactions of a block. */
+    bool WriteMarkers(const uint256& blockHash, const std::vector<uint32_t>& positions);
+};
+
+/** A block of the initial scan, along with its transactions with Elysium markers. */
+struct ScannedBlock
+{
+    //! The block's index entry
+    const CBlockIndex* pindex;
+    //! Whether the block could not be read from disk
+    bool fFailed;
+    //! Whether the markers were taken from the marker index
+    bool fIndexed;
+    //! The block itself, only read when it has marked transactions
+    CBlock block;
+    //! Positions of the transactions with Elysium markers
+    std::vector<uint32_t> markers;
+
+    ScannedBlock() : pindex(NULL), fFailed(false), fIndexed(false) {}
+};
+
+/**
+ * Reads and classifies the blocks of the initial scan ahead of the sequential processing.
+ *
+ * Worker threads read blocks from disk and look for Elysium markers, while the scan applies
+ * the blocks in chain order. Blocks, which are known to have no marked transactions, are not
+ * read at all.
+ */
+class CBlockPrefetcher
+{
+private:
+    //! A block to be read and classified by a worker
+    struct Job
+    {
+        int nHeight;
+        uint256 blockHash;
+        CDiskBlockPos pos;
+        std::shared_ptr<ScannedBlock> result;
+    };
+
+    CElysiumMarkerIndex* pindexdb;
+    int nNextHeight;
+    int nQueuedHeight;
+    int nLastHeight;
+    int nWindow;
+
+    CWaitableCriticalSection cs;
+    CConditionVariable condJob;
+    CConditionVariable condDone;
+    std::deque<Job> jobs;
+    std::map<int, std::shared_ptr<ScannedBlock> > done;
+    bool fStopping;
+    boost::thread_group threads;
+
+    static void Process(const Job& job);
+    void Refill();
+    void Run();
+
+public:
+    CBlockPrefetcher(CElysiumMarkerIndex* pindexdb, int nFirstHeight, int nLastHeight, int nThreads);
+    ~CBlockPrefetcher();
+
+    /** Waits for the next block in chain order, returns NULL when there are no more blocks. */
+    std::shared_ptr<const ScannedBlock> Next();
+};
+
+//! LevelDB based storage of the transactions with Elysium markers per block
+extern CElysiumMarkerIndex* p_markerindex;
+}
+
+#endif // ELYSIUM_SCAN_H
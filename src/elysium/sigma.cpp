@@ -1,16 +1,92 @@
 #include "sigma.h"
 
+#include "log.h"
 #include "sigmadb.h"
 #include "sigmaprimitives.h"
 
+#include "../hash.h"
 #include "../main.h"
 #include "../sync.h"
+#include "../uint256.h"
+#include "../version.h"
 
-#include <iterator>
+#include "../libzerocoin/ParallelTasks.h"
+
+#include <map>
+#include <tuple>
 #include <vector>
 
 namespace elysium {
 
+namespace {
+
+typedef std::tuple<PropertyId, SigmaDenomination, SigmaMintGroup, size_t> SpendGroupKey;
+
+CCriticalSection cs_spendBatch;
+
+//! Results of batch verified spends, by hash of the spend
+std::map<uint256, bool> spendBatchResults;
+
+uint256 GetSpendHash(
+    PropertyId property,
+    SigmaDenomination denomination,
+    SigmaMintGroup group,
+    size_t groupSize,
+    const SigmaProof& proof,
+    const secp_primitives::Scalar& serial,
+    bool fPadding)
+{
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << property << denomination << group << static_cast<uint64_t>(groupSize) << serial << proof << fPadding;
+
+    return hasher.GetHash();
+}
+
+/**
+ * Verifies the spends of one anonimity group, and falls back to verifying them one by one,
+ * if the batch fails, to find the invalid ones.
+ */
+void VerifyGroup(
+    const SigmaAnonimityGroupView& anonimitySet,
+    const std::vector<const BlockSigmaSpend*>& spends,
+    bool fPadding,
+    std::vector<bool>& results)
+{
+    const SigmaParams& params = spends.front()->proof.params;
+
+    std::vector<secp_primitives::GroupElement> commits;
+    commits.reserve(anonimitySet.size());
+    for (auto& pub : anonimitySet) {
+        commits.push_back(pub.commitment);
+    }
+
+    std::vector<secp_primitives::Scalar> serials;
+    std::vector<sigma::SigmaPlusProof<secp_primitives::Scalar, secp_primitives::GroupElement>> proofs;
+    for (auto spend : spends) {
+        serials.push_back(spend->serial);
+        proofs.push_back(spend->proof.proof);
+    }
+
+    sigma::SigmaPlusVerifier<secp_primitives::Scalar, secp_primitives::GroupElement> verifier(
+        params.g,
+        params.h,
+        params.n,
+        params.m
+    );
+
+    if (verifier.batch_verify(commits, serials, proofs, fPadding)) {
+        results.assign(spends.size(), true);
+        return;
+    }
+
+    results.clear();
+    for (auto spend : spends) {
+        results.push_back(spend->proof.Verify(spend->serial, anonimitySet.begin(), anonimitySet.end(), fPadding));
+    }
+}
+
+} // anonymous namespace
+
 bool VerifySigmaSpend(
     PropertyId property,
     SigmaDenomination denomination,
@@ -20,11 +96,21 @@ bool VerifySigmaSpend(
     const secp_primitives::Scalar& serial,
     bool fPadding)
 {
-    std::vector<SigmaPublicKey> anonimitySet; // Don't preallocate the vector due to it will allow attacker to crash all client.
+    {
+        LOCK(cs_spendBatch);
+        if (!spendBatchResults.empty()) {
+            auto it = spendBatchResults.find(GetSpendHash(property, denomination, group, groupSize, proof, serial, fPadding));
+            if (it != spendBatchResults.end()) {
+                return it->second;
+            }
+        }
+    }
+
+    SigmaAnonimityGroupView anonimitySet;
 
     {
         LOCK(cs_main);
-        sigmaDb->GetAnonimityGroup(property, denomination, group, groupSize, std::back_inserter(anonimitySet));
+        anonimitySet = sigmaDb->GetAnonimityGroupView(property, denomination, group, groupSize);
     }
 
     // If the size of anonimity set is not the expected once then no need to verify the proof.
@@ -35,4 +121,76 @@ bool VerifySigmaSpend(
     return proof.Verify(serial, anonimitySet.begin(), anonimitySet.end(), fPadding);
 }
 
+/**
+ * Verifies spends in one batch per anonimity group, and remembers the results.
+ *
+ * Groups are verified in parallel on the shared thread pool. Spends of groups, which don't have
+ * enough mints yet, are skipped, because their set may be completed by mints processed before them.
+ */
+void VerifySigmaSpendBatch(const std::vector<BlockSigmaSpend>& spends, bool fPadding)
+{
+    std::map<SpendGroupKey, std::vector<const BlockSigmaSpend*>> groups;
+    for (auto& spend : spends) {
+        groups[SpendGroupKey(spend.property, spend.denomination, spend.group, spend.groupSize)].push_back(&spend);
+    }
+
+    std::vector<SigmaAnonimityGroupView> anonimitySets;
+    std::vector<std::vector<const BlockSigmaSpend*>> batches;
+    {
+        LOCK(cs_main);
+        for (auto& group : groups) {
+            if (group.second.size() < 2) {
+                continue;
+            }
+
+            PropertyId property;
+            SigmaDenomination denomination;
+            SigmaMintGroup groupId;
+            size_t groupSize;
+            std::tie(property, denomination, groupId, groupSize) = group.first;
+
+            auto anonimitySet = sigmaDb->GetAnonimityGroupView(property, denomination, groupId, groupSize);
+            if (anonimitySet.size() != groupSize) {
+                continue;
+            }
+
+            anonimitySets.push_back(anonimitySet);
+            batches.push_back(group.second);
+        }
+    }
+
+    if (batches.empty()) {
+        return;
+    }
+
+    std::vector<std::vector<bool>> results(batches.size());
+    libzerocoin::ParallelTasks verifications(batches.size(), libzerocoin::PARALLEL_TASK_PRIORITY_HIGH);
+    for (size_t i = 0; i < batches.size(); i++) {
+        verifications.Add([&anonimitySets, &batches, &results, fPadding, i] {
+            VerifyGroup(anonimitySets[i], batches[i], fPadding, results[i]);
+        });
+    }
+    verifications.Wait();
+
+    LOCK(cs_spendBatch);
+    for (size_t i = 0; i < batches.size(); i++) {
+        for (size_t j = 0; j < batches[i].size(); j++) {
+            auto spend = batches[i][j];
+            auto hash = GetSpendHash(spend->property, spend->denomination, spend->group, spend->groupSize,
+                spend->proof, spend->serial, fPadding);
+            spendBatchResults[hash] = results[i][j];
+        }
+    }
+
+    if (elysium_debug_verbose) {
+        PrintToLog("%s(): verified %d spends in %d batches\n", __func__, spendBatchResults.size(), batches.size());
+    }
+}
+
+void ClearSigmaSpendBatch()
+{
+    LOCK(cs_spendBatch);
+    spendBatchResults.clear();
+}
+
 } // namespace elysium
@@ -6,8 +6,28 @@
 
 #include <stddef.h>
 
+#include <vector>
+
 namespace elysium {
 
+/** A Sigma spend of a block, which is verified ahead of processing. */
+struct BlockSigmaSpend
+{
+    PropertyId property;
+    SigmaDenomination denomination;
+    SigmaMintGroup group;
+    size_t groupSize;
+    SigmaProof proof;
+    secp_primitives::Scalar serial;
+
+    BlockSigmaSpend(PropertyId property, SigmaDenomination denomination, SigmaMintGroup group, size_t groupSize,
+        const SigmaProof& proof, const secp_primitives::Scalar& serial)
+        : property(property), denomination(denomination), group(group), groupSize(groupSize),
+          proof(proof), serial(serial)
+    {
+    }
+};
+
 bool VerifySigmaSpend(
     PropertyId property,
     SigmaDenomination denomination,
@@ -17,6 +37,15 @@ bool VerifySigmaSpend(
     const secp_primitives::Scalar& serial,
     bool fPadding);
 
+/**
+ * Verifies spends in one batch per anonimity group, and remembers the results, so that
+ * VerifySigmaSpend doesn't need to verify them again.
+ */
+void VerifySigmaSpendBatch(const std::vector<BlockSigmaSpend>& spends, bool fPadding);
+
+/** Forgets the results of VerifySigmaSpendBatch. */
+void ClearSigmaSpendBatch();
+
 } // namespace elysium
 
 #endif // ZCOIN_ELYSIUM_SIGMA_H
@@ -16,6 +16,8 @@
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
 
+#include <algorithm>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -291,6 +293,7 @@ std::pair<SigmaMintGroup, SigmaMintIndex> SigmaDatabase::RecordMint(
     pubKey.commitment.serialize(buffer.data());
 
     AddEntry(key, GetSlice(buffer), height);
+    AppendCachedMint(propertyId, denomination, lastGroup, nextIdx, pubKey);
 
     // Raise event.
     MintAdded(propertyId, denomination, lastGroup, nextIdx, pubKey, height);
@@ -368,6 +371,7 @@ void SigmaDatabase::DeleteAll(int startBlock)
 
     leveldb::WriteBatch batch;
     std::vector<std::function<void()>> defers; // functions to be called after delete whole keys
+    std::set<GroupKey> affectedGroups;
     for (; it->Valid() && IsSequenceEntry(it.get()); it->Prev()) {
 
         CDataStream deserialized(
@@ -409,6 +413,8 @@ void SigmaDatabase::DeleteAll(int startBlock)
             SigmaPublicKey pub;
             pubkeyDeserialized >> pub;
 
+            affectedGroups.insert(GroupKey(propertyId, denomination, groupId));
+
             // function to trigger event
             defers.push_back([this, propertyId, denomination, pub]() {
                 MintRemoved(propertyId, denomination, pub);
@@ -445,11 +451,27 @@ void SigmaDatabase::DeleteAll(int startBlock)
         throw std::runtime_error("Fail to update database");
     }
 
+    {
+        // Groups only grow in the cache, so drop the ones which lost mints.
+        LOCK(cs_groupCache);
+        for (auto& group : affectedGroups) {
+            groupCache.erase(group);
+        }
+    }
+
     for (auto &defer : defers) {
         defer();
     }
 }
 
+void SigmaDatabase::Clear()
+{
+    CDBBase::Clear();
+
+    LOCK(cs_groupCache);
+    groupCache.clear();
+}
+
 void SigmaDatabase::RecordGroupSize(uint16_t groupSize)
 {
     auto key = CreateGroupSizeKey();
@@ -553,6 +575,81 @@ size_t SigmaDatabase::GetAnonimityGroup(
     return i;
 }
 
+SigmaAnonimityGroupView SigmaDatabase::GetAnonimityGroupView(
+    uint32_t propertyId, uint8_t denomination, uint32_t groupId, size_t count)
+{
+    LOCK(cs_groupCache);
+
+    auto keys = GetCachedGroup(propertyId, denomination, groupId);
+    return SigmaAnonimityGroupView(keys, std::min(count, keys->size()));
+}
+
+SigmaAnonimityGroupView SigmaDatabase::GetAnonimityGroupView(
+    uint32_t propertyId, uint8_t denomination, uint32_t groupId)
+{
+    LOCK(cs_groupCache);
+
+    auto keys = GetCachedGroup(propertyId, denomination, groupId);
+    return SigmaAnonimityGroupView(keys, keys->size());
+}
+
+std::shared_ptr<const std::vector<SigmaPublicKey>> SigmaDatabase::GetCachedGroup(
+    uint32_t propertyId, uint8_t denomination, uint32_t groupId)
+{
+    AssertLockHeld(cs_groupCache);
+
+    GroupKey groupKey(propertyId, denomination, groupId);
+    auto it = groupCache.find(groupKey);
+    if (it != groupCache.end()) {
+        return it->second;
+    }
+
+    auto keys = std::make_shared<std::vector<SigmaPublicKey>>();
+    auto mintCount = GetMintCount(propertyId, denomination, groupId);
+    if (!mintCount) {
+        return keys; // don't cache groups, which don't exist (yet)
+    }
+
+    keys->reserve(mintCount);
+    GetAnonimityGroup(propertyId, denomination, groupId, mintCount, std::back_inserter(*keys));
+
+    groupCache.insert(std::make_pair(groupKey, keys));
+
+    return keys;
+}
+
+void SigmaDatabase::AppendCachedMint(
+    uint32_t propertyId, uint8_t denomination, uint32_t groupId, uint16_t index, const SigmaPublicKey& pubKey)
+{
+    LOCK(cs_groupCache);
+
+    auto it = groupCache.find(GroupKey(propertyId, denomination, groupId));
+    if (it == groupCache.end()) {
+        return; // loaded from the database once requested
+    }
+
+    auto& keys = it->second;
+
+    if (index < keys->size()) {
+        return; // the mint was already loaded from the database
+    }
+
+    if (index > keys->size()) {
+        groupCache.erase(it);
+        return;
+    }
+
+    if (keys->size() == keys->capacity()) {
+        // Views may still point to the current keys, so grow into new storage instead of reallocating.
+        auto grown = std::make_shared<std::vector<SigmaPublicKey>>();
+        grown->reserve(std::min<size_t>(std::max<size_t>(keys->size() * 2, 16), groupSize));
+        grown->assign(keys->begin(), keys->end());
+        keys = std::move(grown);
+    }
+
+    keys->push_back(pubKey);
+}
+
 uint32_t SigmaDatabase::GetLastGroupId(
     uint32_t propertyId,
     uint8_t denomination)
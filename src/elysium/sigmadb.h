@@ -6,6 +6,7 @@
 #include "property.h"
 #include "sigmaprimitives.h"
 
+#include "../sync.h"
 #include "../uint256.h"
 
 #include <univalue.h>
@@ -15,7 +16,10 @@
 
 #include <leveldb/slice.h>
 
+#include <map>
+#include <memory>
 #include <string>
+#include <tuple>
 #include <vector>
 
 #include <inttypes.h>
@@ -34,6 +38,38 @@ struct is_iterator<T, typename std::enable_if<!std::is_same<typename std::iterat
 
 namespace elysium {
 
+/**
+ * Read-only view of the first keys of a cached anonimity group.
+ *
+ * The view shares the decoded keys with the cache. Keys are only ever appended to a group,
+ * so the prefix stays valid while mints are added, and the view keeps its keys alive when
+ * the group is dropped from the cache.
+ */
+class SigmaAnonimityGroupView
+{
+public:
+    typedef const SigmaPublicKey* const_iterator;
+
+public:
+    SigmaAnonimityGroupView() : count(0)
+    {
+    }
+
+    SigmaAnonimityGroupView(std::shared_ptr<const std::vector<SigmaPublicKey>> keys, size_t count)
+        : keys(std::move(keys)), count(count)
+    {
+    }
+
+    const_iterator begin() const { return count ? keys->data() : nullptr; }
+    const_iterator end() const { return begin() + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+private:
+    std::shared_ptr<const std::vector<SigmaPublicKey>> keys;
+    size_t count;
+};
+
 class SigmaDatabase : public CDBBase
 {
 public:
@@ -84,8 +120,16 @@ public:
         return firstIt;
     }
 
+    // Returns up to count keys of a group, the group is decoded once and kept in memory.
+    SigmaAnonimityGroupView GetAnonimityGroupView(
+        uint32_t propertyId, uint8_t denomination, uint32_t groupId, size_t count);
+    SigmaAnonimityGroupView GetAnonimityGroupView(uint32_t propertyId, uint8_t denomination, uint32_t groupId);
+
     void DeleteAll(int startBlock);
 
+    // Deletes all entries, and drops the decoded groups along with them.
+    void Clear();
+
     uint32_t GetLastGroupId(uint32_t propertyId, uint8_t denomination);
     size_t GetMintCount(uint32_t propertyId, uint8_t denomination, uint32_t groupId);
     uint64_t GetNextSequence();
@@ -105,10 +149,21 @@ protected:
     void AddEntry(const leveldb::Slice& key, const leveldb::Slice& value, int block);
 
 private:
+    typedef std::tuple<uint32_t, uint8_t, uint32_t> GroupKey;
+
     void RecordGroupSize(uint16_t groupSize);
 
     std::unique_ptr<leveldb::Iterator> NewIterator() const;
 
+    std::shared_ptr<const std::vector<SigmaPublicKey>> GetCachedGroup(
+        uint32_t propertyId, uint8_t denomination, uint32_t groupId);
+    void AppendCachedMint(
+        uint32_t propertyId, uint8_t denomination, uint32_t groupId, uint16_t index, const SigmaPublicKey& pubKey);
+
+    //! Decoded anonimity groups, which were requested before
+    std::map<GroupKey, std::shared_ptr<std::vector<SigmaPublicKey>>> groupCache;
+    CCriticalSection cs_groupCache;
+
 protected:
     uint16_t InitGroupSize(uint16_t groupSize);
     uint16_t GetGroupSize();
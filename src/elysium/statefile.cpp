@@ -0,0 +1,711 @@
+/**
+ * @file statefile.cpp
+ *
+ * Binary persistence of the in-memory state.
+ *
+ * Every STATE_SNAPSHOT_INTERVAL blocks a full snapshot of balances, DEx offers and accepts,
+ * crowdsales, MetaDEx orders and globals is written. For the blocks in between only a journal
+ * is written, which holds the after-image of everything that changed in the block. The state
+ * of a block is restored by loading the last snapshot and replaying the journals since then.
+ *
+ * The state is serialized while cs_main is held, but checksumming and disk I/O are done by a
+ * background thread, so block processing only pays for the in-memory serialization.
+ */
+
+#include "statefile.h"
+
+#include "consensushash.h"
+#include "dex.h"
+#include "elysium.h"
+#include "holders.h"
+#include "log.h"
+#include "mdex.h"
+#include "sp.h"
+#include "tally.h"
+
+#include "../chain.h"
+#include "../clientversion.h"
+#include "../hash.h"
+#include "../main.h"
+#include "../serialize.h"
+#include "../streams.h"
+#include "../sync.h"
+#include "../tinyformat.h"
+#include "../util.h"
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <stdint.h>
+#include <stdio.h>
+
+namespace elysium {
+
+namespace {
+
+//! Tokens of an address for a single property, pending amounts are not persisted
+struct BalanceEntry
+{
+    uint32_t propertyId;
+    int64_t balance;
+    int64_t sellReserved;
+    int64_t acceptReserved;
+    int64_t metadexReserved;
+
+    BalanceEntry() : propertyId(0), balance(0), sellReserved(0), acceptReserved(0), metadexReserved(0) {}
+
+    BalanceEntry(const CMPTally& tally, uint32_t propertyIdIn)
+      : propertyId(propertyIdIn),
+        balance(tally.getMoney(propertyIdIn, BALANCE)),
+        sellReserved(tally.getMoney(propertyIdIn, SELLOFFER_RESERVE)),
+        acceptReserved(tally.getMoney(propertyIdIn, ACCEPT_RESERVE)),
+        metadexReserved(tally.getMoney(propertyIdIn, METADEX_RESERVE)) {}
+
+    bool IsEmpty() const
+    {
+        return 0 == balance && 0 == sellReserved && 0 == acceptReserved && 0 == metadexReserved;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(propertyId);
+        READWRITE(balance);
+        READWRITE(sellReserved);
+        READWRITE(acceptReserved);
+        READWRITE(metadexReserved);
+    }
+};
+
+//! Balances of addresses
+typedef std::vector<std::pair<std::string, std::vector<BalanceEntry> > > BalanceList;
+
+//! Sections, which are only part of a journal, if they changed in the block
+enum JournalSection
+{
+    JOURNAL_OFFERS = 1 << 0,
+    JOURNAL_ACCEPTS = 1 << 1,
+    JOURNAL_CROWDSALES = 1 << 2,
+};
+
+const char* const SNAPSHOT_PREFIX = "snapshot";
+const char* const JOURNAL_PREFIX = "journal";
+
+//! Tallies changed since the last persisted block
+std::map<std::string, std::set<uint32_t> > changedTallies;
+//! MetaDEx orders changed since the last persisted block
+std::set<uint256> changedOrders;
+//! Block of the last persisted state; a journal can only be written on top of it
+uint256 hashLastPersisted;
+//! Height of the last snapshot, or -1, if there is none
+int nLastSnapshotHeight = -1;
+//! Hashes of the DEx and crowdsale state as of the last persisted block
+uint256 hashLastOffers;
+uint256 hashLastAccepts;
+uint256 hashLastCrowds;
+
+/** Writes state files in the background, in the order they were queued.
+ */
+class CStateWriter
+{
+private:
+    CWaitableCriticalSection cs;
+    CConditionVariable condWork;
+    CConditionVariable condProcessed;
+    std::deque<boost::function<void()> > queue;
+    uint64_t nQueued;
+    uint64_t nProcessed;
+    bool fRunning;
+    bool fStopping;
+    boost::thread thread;
+
+    void Run()
+    {
+        RenameThread("elysium-state");
+        boost::unique_lock<boost::mutex> lock(cs);
+        while (true) {
+            while (queue.empty() && !fStopping)
+                condWork.wait(lock);
+            if (queue.empty())
+                break;
+            boost::function<void()> func = queue.front();
+            queue.pop_front();
+            lock.unlock();
+            func();
+            lock.lock();
+            nProcessed++;
+            condProcessed.notify_all();
+        }
+    }
+
+public:
+    CStateWriter() : nQueued(0), nProcessed(0), fRunning(false), fStopping(false) {}
+
+    void Start()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (fRunning)
+            return;
+        fRunning = true;
+        fStopping = false;
+        thread = boost::thread(boost::bind(&CStateWriter::Run, this));
+    }
+
+    void Stop()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            if (!fRunning)
+                return;
+            fStopping = true;
+            condWork.notify_all();
+        }
+        thread.join();
+        boost::unique_lock<boost::mutex> lock(cs);
+        fRunning = false;
+        condProcessed.notify_all();
+    }
+
+    /** Queues a write, or runs it inline when the thread is not running. */
+    void Enqueue(const boost::function<void()>& func)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            if (fRunning && !fStopping) {
+                queue.push_back(func);
+                nQueued++;
+                condWork.notify_one();
+                return;
+            }
+        }
+        func();
+    }
+
+    void WaitUntilProcessed()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        uint64_t nTarget = nQueued;
+        while (fRunning && nProcessed < nTarget)
+            condProcessed.wait(lock);
+    }
+};
+
+CStateWriter stateWriter;
+
+boost::filesystem::path GetStateFilePath(const boost::filesystem::path& dir, const char* prefix, const uint256& blockHash)
+{
+    return dir / strprintf("%s-%s.dat", prefix, blockHash.ToString());
+}
+
+/**
+ * Writes the serialized state with a trailing checksum to a temporary file and moves it
+ * into place, once the data is on disk.
+ */
+void WriteStateFile(const boost::filesystem::path& path, const std::shared_ptr<CDataStream>& ssState)
+{
+    CDataStream& ss = *ssState;
+    uint256 hash = Hash(ss.begin(), ss.end());
+    ss << hash;
+
+    boost::filesystem::path pathTmp = path.string() + ".new";
+    FILE* file = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull()) {
+        PrintToLog("%s: failed to open file %s\n", __func__, pathTmp.string());
+        return;
+    }
+
+    try {
+        fileout << ss;
+    } catch (const std::exception& e) {
+        PrintToLog("%s: failed to write file %s: %s\n", __func__, pathTmp.string(), e.what());
+        return;
+    }
+
+    FileCommit(fileout.Get());
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, path)) {
+        PrintToLog("%s: failed to rename %s\n", __func__, pathTmp.string());
+        return;
+    }
+
+    if (elysium_debug_persistence) PrintToLog("%s: wrote %s (%d bytes)\n", __func__, path.string(), ss.size());
+}
+
+/**
+ * Reads a state file and verifies its checksum.
+ */
+bool ReadStateFile(const boost::filesystem::path& path, CDataStream& ss)
+{
+    FILE* file = fopen(path.string().c_str(), "rb");
+    CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        PrintToLog("%s: failed to open file %s\n", __func__, path.string());
+        return false;
+    }
+
+    uint64_t fileSize = boost::filesystem::file_size(path);
+    if (fileSize < sizeof(uint256)) {
+        PrintToLog("%s: file %s is truncated\n", __func__, path.string());
+        return false;
+    }
+
+    std::vector<char> vchData(fileSize - sizeof(uint256));
+    uint256 hashIn;
+
+    try {
+        if (!vchData.empty()) filein.read(&vchData[0], vchData.size());
+        filein >> hashIn;
+    } catch (const std::exception& e) {
+        PrintToLog("%s: failed to read file %s: %s\n", __func__, path.string(), e.what());
+        return false;
+    }
+
+    if (hashIn != Hash(vchData.begin(), vchData.end())) {
+        PrintToLog("%s: checksum mismatch in file %s\n", __func__, path.string());
+        return false;
+    }
+
+    ss.clear();
+    ss.write(vchData.data(), vchData.size());
+
+    return true;
+}
+
+void WriteHeader(CDataStream& ss, const CBlockIndex* pindex)
+{
+    uint256 hashPrev;
+    if (pindex->pprev) hashPrev = pindex->pprev->GetBlockHash();
+
+    ss << STATE_FILE_VERSION;
+    ss << pindex->GetBlockHash();
+    ss << hashPrev;
+    ss << pindex->nHeight;
+}
+
+bool ReadHeader(CDataStream& ss, const CBlockIndex* pindex)
+{
+    int nVersion = 0;
+    uint256 hashBlock;
+    uint256 hashPrev;
+    int nHeight = 0;
+
+    ss >> nVersion;
+    ss >> hashBlock;
+    ss >> hashPrev;
+    ss >> nHeight;
+
+    if (nVersion != STATE_FILE_VERSION) {
+        PrintToLog("%s: unsupported state file version %d\n", __func__, nVersion);
+        return false;
+    }
+
+    uint256 hashExpectedPrev;
+    if (pindex->pprev) hashExpectedPrev = pindex->pprev->GetBlockHash();
+
+    if (hashBlock != pindex->GetBlockHash() || hashPrev != hashExpectedPrev || nHeight != pindex->nHeight) {
+        PrintToLog("%s: state file does not belong to block %s\n", __func__, pindex->GetBlockHash().GetHex());
+        return false;
+    }
+
+    return true;
+}
+
+void WriteGlobals(CDataStream& ss, int64_t nDevElysiumPrev)
+{
+    ss << nDevElysiumPrev;
+    ss << _my_sps->peekNextSPID(ELYSIUM_PROPERTY_ELYSIUM);
+    ss << _my_sps->peekNextSPID(ELYSIUM_PROPERTY_TELYSIUM);
+}
+
+void ReadGlobals(CDataStream& ss, int64_t& nDevElysiumPrev)
+{
+    uint32_t nextSPID = 0;
+    uint32_t nextTestSPID = 0;
+
+    ss >> nDevElysiumPrev;
+    ss >> nextSPID;
+    ss >> nextTestSPID;
+
+    _my_sps->init(nextSPID, nextTestSPID);
+}
+
+/**
+ * Sets the tokens of an address to the persisted values.
+ *
+ * This mirrors update_tally_map, but skips the freeze checks, because the restored state was
+ * valid when it was persisted.
+ */
+void RestoreBalance(const std::string& address, const BalanceEntry& entry)
+{
+    const TallyType types[] = {BALANCE, SELLOFFER_RESERVE, ACCEPT_RESERVE, METADEX_RESERVE};
+    const int64_t amounts[] = {entry.balance, entry.sellReserved, entry.acceptReserved, entry.metadexReserved};
+
+    CMPTally& tally = mp_tally_map[address];
+    bool fChanged = false;
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); ++i) {
+        int64_t delta = amounts[i] - tally.getMoney(entry.propertyId, types[i]);
+        if (delta != 0) {
+            if (!tally.updateMoney(entry.propertyId, delta, types[i])) {
+                throw std::runtime_error(strprintf("invalid balance of %s for property %d", address, entry.propertyId));
+            }
+            fChanged = true;
+        }
+    }
+
+    if (fChanged) {
+        UpdateBalancesHash(address, entry.propertyId, tally);
+        UpdatePropertyHolders(address, entry.propertyId, tally);
+    }
+}
+
+void RestoreBalances(const BalanceList& balances)
+{
+    for (BalanceList::const_iterator it = balances.begin(); it != balances.end(); ++it) {
+        for (std::vector<BalanceEntry>::const_iterator entry = it->second.begin(); entry != it->second.end(); ++entry) {
+            RestoreBalance(it->first, *entry);
+        }
+    }
+}
+
+void WriteSnapshot(CDataStream& ss, int64_t nDevElysiumPrev)
+{
+    WriteGlobals(ss, nDevElysiumPrev);
+
+    BalanceList balances;
+    for (std::unordered_map<std::string, CMPTally>::iterator it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
+        std::vector<BalanceEntry> entries;
+        CMPTally& tally = it->second;
+        tally.init();
+        uint32_t propertyId = 0;
+        while (0 != (propertyId = tally.next())) {
+            BalanceEntry entry(tally, propertyId);
+            if (!entry.IsEmpty()) entries.push_back(entry);
+        }
+        if (!entries.empty()) balances.push_back(std::make_pair(it->first, entries));
+    }
+    ss << balances;
+
+    ss << my_offers;
+    ss << my_accepts;
+    ss << my_crowds;
+
+    uint64_t nOrders = 0;
+    for (md_PropertiesMap::const_iterator book = metadex.begin(); book != metadex.end(); ++book) {
+        for (md_PricesMap::const_iterator level = book->second.begin(); level != book->second.end(); ++level) {
+            nOrders += level->second.size();
+        }
+    }
+    WriteCompactSize(ss, nOrders);
+    for (md_PropertiesMap::const_iterator book = metadex.begin(); book != metadex.end(); ++book) {
+        for (md_PricesMap::const_iterator level = book->second.begin(); level != book->second.end(); ++level) {
+            for (md_Set::const_iterator order = level->second.begin(); order != level->second.end(); ++order) {
+                ss << *order;
+            }
+        }
+    }
+}
+
+bool ReadSnapshot(CDataStream& ss, int64_t& nDevElysiumPrev)
+{
+    mp_tally_map.clear();
+    ClearBalancesHash();
+    ClearPropertyHolders();
+    my_offers.clear();
+    my_accepts.clear();
+    my_crowds.clear();
+    MetaDEx_CLEAR();
+
+    ReadGlobals(ss, nDevElysiumPrev);
+
+    BalanceList balances;
+    ss >> balances;
+    RestoreBalances(balances);
+
+    ss >> my_offers;
+    ss >> my_accepts;
+    ss >> my_crowds;
+
+    uint64_t nOrders = ReadCompactSize(ss);
+    for (uint64_t n = 0; n < nOrders; ++n) {
+        CMPMetaDEx order;
+        ss >> order;
+        if (!MetaDEx_INSERT(order)) {
+            PrintToLog("%s: failed to insert MetaDEx order %s\n", __func__, order.getHash().GetHex());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void WriteJournal(CDataStream& ss, int64_t nDevElysiumPrev, uint8_t sections)
+{
+    WriteGlobals(ss, nDevElysiumPrev);
+
+    BalanceList balances;
+    for (std::map<std::string, std::set<uint32_t> >::const_iterator it = changedTallies.begin(); it != changedTallies.end(); ++it) {
+        const CMPTally* tally = getTally(it->first);
+        std::vector<BalanceEntry> entries;
+        for (std::set<uint32_t>::const_iterator prop = it->second.begin(); prop != it->second.end(); ++prop) {
+            entries.push_back(tally ? BalanceEntry(*tally, *prop) : BalanceEntry());
+            entries.back().propertyId = *prop;
+        }
+        balances.push_back(std::make_pair(it->first, entries));
+    }
+    ss << balances;
+
+    std::vector<uint256> vErased;
+    std::vector<CMPMetaDEx> vOrders;
+    for (std::set<uint256>::const_iterator it = changedOrders.begin(); it != changedOrders.end(); ++it) {
+        const CMPMetaDEx* order = MetaDEx_RetrieveTrade(*it);
+        if (order) {
+            vOrders.push_back(*order);
+        } else {
+            vErased.push_back(*it);
+        }
+    }
+    ss << vErased;
+    ss << vOrders;
+
+    ss << sections;
+    if (sections & JOURNAL_OFFERS) ss << my_offers;
+    if (sections & JOURNAL_ACCEPTS) ss << my_accepts;
+    if (sections & JOURNAL_CROWDSALES) ss << my_crowds;
+}
+
+bool ReadJournal(CDataStream& ss, int64_t& nDevElysiumPrev)
+{
+    ReadGlobals(ss, nDevElysiumPrev);
+
+    BalanceList balances;
+    ss >> balances;
+    RestoreBalances(balances);
+
+    std::vector<uint256> vErased;
+    std::vector<CMPMetaDEx> vOrders;
+    ss >> vErased;
+    ss >> vOrders;
+
+    // orders, which were added and removed within the block, are not part of the state
+    for (std::vector<uint256>::const_iterator it = vErased.begin(); it != vErased.end(); ++it) {
+        MetaDEx_ERASE(*it);
+    }
+    for (std::vector<CMPMetaDEx>::const_iterator it = vOrders.begin(); it != vOrders.end(); ++it) {
+        MetaDEx_ERASE(it->getHash());
+        if (!MetaDEx_INSERT(*it)) {
+            PrintToLog("%s: failed to insert MetaDEx order %s\n", __func__, it->getHash().GetHex());
+            return false;
+        }
+    }
+
+    uint8_t sections = 0;
+    ss >> sections;
+    if (sections & JOURNAL_OFFERS) ss >> my_offers;
+    if (sections & JOURNAL_ACCEPTS) ss >> my_accepts;
+    if (sections & JOURNAL_CROWDSALES) ss >> my_crowds;
+
+    return true;
+}
+
+bool LoadStateFile(const boost::filesystem::path& dir, const CBlockIndex* pindex, bool fSnapshot, int64_t& nDevElysiumPrev)
+{
+    boost::filesystem::path path = GetStateFilePath(dir, fSnapshot ? SNAPSHOT_PREFIX : JOURNAL_PREFIX, pindex->GetBlockHash());
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+
+    if (!ReadStateFile(path, ss)) {
+        return false;
+    }
+
+    try {
+        if (!ReadHeader(ss, pindex)) {
+            return false;
+        }
+        return fSnapshot ? ReadSnapshot(ss, nDevElysiumPrev) : ReadJournal(ss, nDevElysiumPrev);
+    } catch (const std::exception& e) {
+        PrintToLog("%s: failed to load %s: %s\n", __func__, path.string(), e.what());
+    }
+
+    return false;
+}
+
+} // anonymous namespace
+
+void RecordTallyChange(const std::string& address, uint32_t propertyId)
+{
+    changedTallies[address].insert(propertyId);
+}
+
+void RecordMetaDExChange(const uint256& txid)
+{
+    changedOrders.insert(txid);
+}
+
+void ResetStateJournal()
+{
+    changedTallies.clear();
+    changedOrders.clear();
+    hashLastPersisted.SetNull();
+    nLastSnapshotHeight = -1;
+    hashLastOffers.SetNull();
+    hashLastAccepts.SetNull();
+    hashLastCrowds.SetNull();
+}
+
+/**
+ * Persists the state after the given block.
+ *
+ * A journal is written, if the state of the previous block was persisted and the last snapshot
+ * is less than STATE_SNAPSHOT_INTERVAL blocks old, otherwise a full snapshot is written. The
+ * state is serialized immediately, the file is written by the background thread.
+ */
+void PersistState(const boost::filesystem::path& dir, const CBlockIndex* pindex, int64_t nDevElysiumPrev)
+{
+    AssertLockHeld(cs_main);
+
+    bool fSnapshot = (NULL == pindex->pprev || hashLastPersisted != pindex->pprev->GetBlockHash() ||
+            nLastSnapshotHeight < 0 || pindex->nHeight - nLastSnapshotHeight >= STATE_SNAPSHOT_INTERVAL);
+
+    uint256 hashOffers = SerializeHash(my_offers);
+    uint256 hashAccepts = SerializeHash(my_accepts);
+    uint256 hashCrowds = SerializeHash(my_crowds);
+
+    std::shared_ptr<CDataStream> ss = std::make_shared<CDataStream>(SER_DISK, CLIENT_VERSION);
+    WriteHeader(*ss, pindex);
+
+    if (fSnapshot) {
+        WriteSnapshot(*ss, nDevElysiumPrev);
+        nLastSnapshotHeight = pindex->nHeight;
+    } else {
+        uint8_t sections = 0;
+        if (hashOffers != hashLastOffers) sections |= JOURNAL_OFFERS;
+        if (hashAccepts != hashLastAccepts) sections |= JOURNAL_ACCEPTS;
+        if (hashCrowds != hashLastCrowds) sections |= JOURNAL_CROWDSALES;
+        WriteJournal(*ss, nDevElysiumPrev, sections);
+    }
+
+    changedTallies.clear();
+    changedOrders.clear();
+    hashLastPersisted = pindex->GetBlockHash();
+    hashLastOffers = hashOffers;
+    hashLastAccepts = hashAccepts;
+    hashLastCrowds = hashCrowds;
+
+    boost::filesystem::path path = GetStateFilePath(dir, fSnapshot ? SNAPSHOT_PREFIX : JOURNAL_PREFIX, pindex->GetBlockHash());
+    stateWriter.Enqueue([path, ss]() { WriteStateFile(path, ss); });
+}
+
+/**
+ * Restores the state after the given block.
+ *
+ * The journals are followed backwards to the last snapshot, which is then loaded, before the
+ * journals are replayed. If this fails, the in-memory state may be partially restored.
+ */
+bool LoadPersistedState(const boost::filesystem::path& dir, const CBlockIndex* pindex, int64_t& nDevElysiumPrev)
+{
+    AssertLockHeld(cs_main);
+
+    FlushStateWriter();
+
+    std::vector<const CBlockIndex*> vJournals;
+    const CBlockIndex* pbase = pindex;
+
+    while (pbase && !boost::filesystem::exists(GetStateFilePath(dir, SNAPSHOT_PREFIX, pbase->GetBlockHash()))) {
+        if (vJournals.size() >= (size_t) MAX_STATE_HISTORY ||
+                !boost::filesystem::exists(GetStateFilePath(dir, JOURNAL_PREFIX, pbase->GetBlockHash()))) {
+            return false;
+        }
+        vJournals.push_back(pbase);
+        pbase = pbase->pprev;
+    }
+
+    if (NULL == pbase || !LoadStateFile(dir, pbase, true, nDevElysiumPrev)) {
+        return false;
+    }
+
+    for (std::vector<const CBlockIndex*>::reverse_iterator it = vJournals.rbegin(); it != vJournals.rend(); ++it) {
+        if (!LoadStateFile(dir, *it, false, nDevElysiumPrev)) {
+            return false;
+        }
+    }
+
+    ResetStateJournal();
+    hashLastPersisted = pindex->GetBlockHash();
+    nLastSnapshotHeight = pbase->nHeight;
+    hashLastOffers = SerializeHash(my_offers);
+    hashLastAccepts = SerializeHash(my_accepts);
+    hashLastCrowds = SerializeHash(my_crowds);
+
+    PrintToLog("Loaded state of block %d from snapshot of block %d and %d journals\n",
+            pindex->nHeight, pbase->nHeight, vJournals.size());
+
+    return true;
+}
+
+bool HasPersistedState(const boost::filesystem::path& dir, const uint256& blockHash)
+{
+    return boost::filesystem::exists(GetStateFilePath(dir, SNAPSHOT_PREFIX, blockHash)) ||
+            boost::filesystem::exists(GetStateFilePath(dir, JOURNAL_PREFIX, blockHash));
+}
+
+bool ParseStateFileName(const std::string& fileName, uint256& blockHash, bool& fSnapshot)
+{
+    std::vector<std::string> vstr;
+    boost::split(vstr, fileName, boost::is_any_of("-."), boost::token_compress_on);
+    if (vstr.size() != 3 || !boost::equals(vstr[2], "dat")) {
+        return false;
+    }
+
+    if (boost::equals(vstr[0], SNAPSHOT_PREFIX)) {
+        fSnapshot = true;
+    } else if (boost::equals(vstr[0], JOURNAL_PREFIX)) {
+        fSnapshot = false;
+    } else {
+        return false;
+    }
+
+    blockHash.SetHex(vstr[1]);
+
+    return true;
+}
+
+void RemoveStateFile(const boost::filesystem::path& dir, const uint256& blockHash, bool fSnapshot)
+{
+    boost::filesystem::remove(GetStateFilePath(dir, fSnapshot ? SNAPSHOT_PREFIX : JOURNAL_PREFIX, blockHash));
+}
+
+void QueueStateTask(const boost::function<void()>& func)
+{
+    stateWriter.Enqueue(func);
+}
+
+void StartStateWriter()
+{
+    stateWriter.Start();
+}
+
+void FlushStateWriter()
+{
+    stateWriter.WaitUntilProcessed();
+}
+
+void StopStateWriter()
+{
+    stateWriter.Stop();
+}
+
+} // namespace elysium
@@ -0,0 +1,52 @@
+#ifndef ELYSIUM_STATEFILE_H
+#define ELYSIUM_STATEFILE_H
+
+#include "uint256.h"
+
+#include <boost/filesystem/path.hpp>
+#include <boost/function.hpp>
+
+#include <stdint.h>
+
+#include <string>
+
+class CBlockIndex;
+
+namespace elysium
+{
+//! Version of the binary snapshot and journal format
+static const int STATE_FILE_VERSION = 1;
+//! Maximum number of blocks between two full snapshots, the blocks in between are persisted as journals
+static const int STATE_SNAPSHOT_INTERVAL = 10;
+
+/** Records that the tally of an address changed for a property. */
+void RecordTallyChange(const std::string& address, uint32_t propertyId);
+/** Records that a MetaDEx order was added, updated or removed. */
+void RecordMetaDExChange(const uint256& txid);
+/** Forgets all recorded changes, so that the next persisted block is stored as full snapshot. */
+void ResetStateJournal();
+
+/** Persists the state after the given block, either as full snapshot or as journal of the block's changes. */
+void PersistState(const boost::filesystem::path& dir, const CBlockIndex* pindex, int64_t nDevElysiumPrev);
+/** Restores the state after the given block from the last snapshot and the journals since then. */
+bool LoadPersistedState(const boost::filesystem::path& dir, const CBlockIndex* pindex, int64_t& nDevElysiumPrev);
+/** Checks whether a snapshot or journal exists for the given block. */
+bool HasPersistedState(const boost::filesystem::path& dir, const uint256& blockHash);
+
+/** Returns true, if the file name belongs to a binary snapshot or journal, and extracts the block hash. */
+bool ParseStateFileName(const std::string& fileName, uint256& blockHash, bool& fSnapshot);
+/** Removes the snapshot or the journal of a block. */
+void RemoveStateFile(const boost::filesystem::path& dir, const uint256& blockHash, bool fSnapshot);
+
+/** Queues a task behind the pending snapshots and journals, or runs it inline when the background thread is not running. */
+void QueueStateTask(const boost::function<void()>& func);
+
+/** Starts the background thread, which writes snapshots and journals. */
+void StartStateWriter();
+/** Waits until all queued snapshots and journals are written. */
+void FlushStateWriter();
+/** Writes all queued snapshots and journals and stops the background thread. */
+void StopStateWriter();
+}
+
+#endif // ELYSIUM_STATEFILE_H
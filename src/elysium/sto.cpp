@@ -1,8 +1,8 @@
 #include "sto.h"
 
 #include "elysium.h"
+#include "holders.h"
 #include "log.h"
-#include "tally.h"
 #include "uint256_extensions.h"
 
 #include "../arith_uint256.h"
@@ -12,6 +12,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 
 #include <assert.h>
@@ -41,30 +42,25 @@ OwnerAddrType STO_GetReceivers(const std::string& sender, uint32_t property, int
 
     {
         LOCK(cs_main);
-        std::unordered_map<std::string, CMPTally>::iterator it;
-
-        for (it = mp_tally_map.begin(); it != mp_tally_map.end(); ++it) {
-            const std::string& address = it->first;
-            const CMPTally& tally = it->second;
-
-            int64_t tokens = 0;
-            tokens += tally.getMoney(property, BALANCE);
-            tokens += tally.getMoney(property, SELLOFFER_RESERVE);
-            tokens += tally.getMoney(property, ACCEPT_RESERVE);
-            tokens += tally.getMoney(property, METADEX_RESERVE);
-
-            // Do not include the sender
-            if (address == sender) {
-                senderTokens = tokens;
-                continue;
-            }
+        const PropertyHolders* holders = GetPropertyHolders(property);
+
+        if (holders) {
+            std::unordered_map<std::string, int64_t>::const_iterator it;
 
-            totalTokens += tokens;
+            for (it = holders->owners.begin(); it != holders->owners.end(); ++it) {
+                const std::string& address = it->first;
+                int64_t tokens = it->second;
+
+                // Do not include the sender
+                if (address == sender) {
+                    senderTokens = tokens;
+                    continue;
+                }
 
-            // Only holders with balance are relevant
-            if (0 < tokens) {
                 ownerAddrSet.insert(std::make_pair(tokens, address));
             }
+
+            totalTokens = holders->totalTokens - senderTokens;
         }
     }
 
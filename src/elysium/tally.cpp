@@ -3,15 +3,61 @@
 #include "elysium/log.h"
 #include "elysium/elysium.h"
 
+#include "memusage.h"
+
 #include <stdint.h>
-#include <map>
+#include <string.h>
+
+#include <limits>
 
 /**
  * Creates an empty tally.
  */
-CMPTally::CMPTally()
+CMPTally::CMPTally() : my_it(0)
 {
-    my_it = mp_token.begin();
+}
+
+/**
+ * Returns the position of the balance record of a token.
+ *
+ * The records are sorted by property identifier, so this is a binary search over a
+ * contiguous array.
+ *
+ * @param propertyId  The identifier of the tally to lookup
+ * @return The position of the record, or the position where it would be inserted
+ */
+size_t CMPTally::find(uint32_t propertyId) const
+{
+    size_t first = 0;
+    size_t count = mp_token.size();
+
+    while (count > 0) {
+        size_t step = count / 2;
+        if (mp_token[first + step].propertyId < propertyId) {
+            first += step + 1;
+            count -= step + 1;
+        } else {
+            count = step;
+        }
+    }
+
+    return first;
+}
+
+/**
+ * Returns the balance record of a token.
+ *
+ * @param propertyId  The identifier of the tally to lookup
+ * @return The balance record, or NULL, if there is none
+ */
+const CMPTally::BalanceRecord* CMPTally::get(uint32_t propertyId) const
+{
+    size_t pos = find(propertyId);
+    if (pos < mp_token.size() && mp_token[pos].propertyId == propertyId) {
+        return &mp_token[pos];
+    }
+
+    return NULL;
 }
 
 /**
@@ -22,9 +68,9 @@ CMPTally::CMPTally()
 uint32_t CMPTally::init()
 {
     uint32_t propertyId = 0;
-    my_it = mp_token.begin();
-    if (my_it != mp_token.end()) {
-        propertyId = my_it->first;
+    my_it = 0;
+    if (my_it < mp_token.size()) {
+        propertyId = mp_token[my_it].propertyId;
     }
     return propertyId;
 }
@@ -37,8 +83,8 @@ uint32_t CMPTally::init()
 uint32_t CMPTally::next()
 {
     uint32_t ret = 0;
-    if (my_it != mp_token.end()) {
-        ret = my_it->first;
+    if (my_it < mp_token.size()) {
+        ret = mp_token[my_it].propertyId;
         ++my_it;
     }
     return ret;
@@ -73,7 +119,14 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
         return false;
     }
     bool fUpdated = false;
-    int64_t now64 = mp_token[propertyId].balance[ttype];
+    size_t pos = find(propertyId);
+    if (pos == mp_token.size() || mp_token[pos].propertyId != propertyId) {
+        BalanceRecord record;
+        memset(&record, 0, sizeof(record));
+        record.propertyId = propertyId;
+        mp_token.insert(mp_token.begin() + pos, record);
+    }
+    int64_t now64 = mp_token[pos].balance[ttype];
 
     if (isOverflow(now64, amount)) {
         PrintToLog("%s(): ERROR: arithmetic overflow [%d + %d]\n", __func__, now64, amount);
@@ -86,7 +139,7 @@ bool CMPTally::updateMoney(uint32_t propertyId, int64_t amount, TallyType ttype)
     } else {
 
         now64 += amount;
-        mp_token[propertyId].balance[ttype] = now64;
+        mp_token[pos].balance[ttype] = now64;
 
         fUpdated = true;
     }
@@ -107,11 +160,10 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
         return 0;
     }
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* record = get(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        money = record.balance[ttype];
+    if (record != NULL) {
+        money = record->balance[ttype];
     }
 
     return money;
@@ -128,14 +180,13 @@ int64_t CMPTally::getMoney(uint32_t propertyId, TallyType ttype) const
  */
 int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 {
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* record = get(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        if (record.balance[PENDING] < 0) {
-            return record.balance[BALANCE] + record.balance[PENDING];
+    if (record != NULL) {
+        if (record->balance[PENDING] < 0) {
+            return record->balance[BALANCE] + record->balance[PENDING];
         } else {
-            return record.balance[BALANCE];
+            return record->balance[BALANCE];
         }
     }
 
@@ -154,13 +205,12 @@ int64_t CMPTally::getMoneyAvailable(uint32_t propertyId) const
 int64_t CMPTally::getMoneyReserved(uint32_t propertyId) const
 {
     int64_t money = 0;
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* record = get(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        money += record.balance[SELLOFFER_RESERVE];
-        money += record.balance[ACCEPT_RESERVE];
-        money += record.balance[METADEX_RESERVE];
+    if (record != NULL) {
+        money += record->balance[SELLOFFER_RESERVE];
+        money += record->balance[ACCEPT_RESERVE];
+        money += record->balance[METADEX_RESERVE];
     }
 
     return money;
@@ -177,28 +227,20 @@ bool CMPTally::operator==(const CMPTally& rhs) const
     if (mp_token.size() != rhs.mp_token.size()) {
         return false;
     }
-    TokenMap::const_iterator pc1 = mp_token.begin();
-    TokenMap::const_iterator pc2 = rhs.mp_token.begin();
+    for (size_t i = 0; i < mp_token.size(); ++i) {
+        const BalanceRecord& record1 = mp_token[i];
+        const BalanceRecord& record2 = rhs.mp_token[i];
 
-    for (unsigned int i = 0; i < mp_token.size(); ++i) {
-        if (pc1->first != pc2->first) {
+        if (record1.propertyId != record2.propertyId) {
             return false;
         }
-        const BalanceRecord& record1 = pc1->second;
-        const BalanceRecord& record2 = pc2->second;
-
         for (int ttype = 0; ttype < TALLY_TYPE_COUNT; ++ttype) {
             if (record1.balance[ttype] != record2.balance[ttype]) {
                 return false;
             }
         }
-        ++pc1;
-        ++pc2;
     }
 
-    assert(pc1 == mp_token.end());
-    assert(pc2 == rhs.mp_token.end());
-
     return true;
 }
 
@@ -228,15 +270,14 @@ int64_t CMPTally::print(uint32_t propertyId, bool bDivisible) const
     int64_t pending = 0;
     int64_t metadex_reserve = 0;
 
-    TokenMap::const_iterator it = mp_token.find(propertyId);
+    const BalanceRecord* record = get(propertyId);
 
-    if (it != mp_token.end()) {
-        const BalanceRecord& record = it->second;
-        balance = record.balance[BALANCE];
-        selloffer_reserve = record.balance[SELLOFFER_RESERVE];
-        accept_reserve = record.balance[ACCEPT_RESERVE];
-        pending = record.balance[PENDING];
-        metadex_reserve = record.balance[METADEX_RESERVE];
+    if (record != NULL) {
+        balance = record->balance[BALANCE];
+        selloffer_reserve = record->balance[SELLOFFER_RESERVE];
+        accept_reserve = record->balance[ACCEPT_RESERVE];
+        pending = record->balance[PENDING];
+        metadex_reserve = record->balance[METADEX_RESERVE];
     }
 
     if (bDivisible) {
@@ -251,3 +292,15 @@ int64_t CMPTally::print(uint32_t propertyId, bool bDivisible) const
 
     return (balance + selloffer_reserve + accept_reserve + metadex_reserve);
 }
+
+/**
+ * Returns the heap memory used by the balance records.
+ *
+ * Tallies with up to TALLY_INLINE_RECORDS tokens don't allocate at all.
+ *
+ * @return The number of bytes allocated for the balance records
+ */
+size_t CMPTally::DynamicMemoryUsage() const
+{
+    return memusage::DynamicUsage(mp_token);
+}
@@ -1,8 +1,10 @@
 #ifndef ELYSIUM_TALLY_H
 #define ELYSIUM_TALLY_H
 
+#include "prevector.h"
+
+#include <stddef.h>
 #include <stdint.h>
-#include <map>
 
 //! Balance record types
 enum TallyType {
@@ -14,21 +16,30 @@ enum TallyType {
     TALLY_TYPE_COUNT
 };
 
+//! Number of balance records stored inline, most entities only hold very few tokens
+static const unsigned int TALLY_INLINE_RECORDS = 2;
+
 /** Balance records of a single entity.
  */
 class CMPTally
 {
 private:
     typedef struct {
+        uint32_t propertyId;
         int64_t balance[TALLY_TYPE_COUNT];
     } BalanceRecord;
 
-    //! Map of balance records
-    typedef std::map<uint32_t, BalanceRecord> TokenMap;
+    //! Balance records sorted by property identifier
+    typedef prevector<TALLY_INLINE_RECORDS, BalanceRecord> TokenMap;
     //! Balance records for different tokens
     TokenMap mp_token;
-    //! Internal iterator pointing to a balance record
-    TokenMap::iterator my_it;
+    //! Internal iterator, as position of a balance record
+    size_t my_it;
+
+    /** Returns the position of the balance record of a token, or the position where it belongs. */
+    size_t find(uint32_t propertyId) const;
+    /** Returns the balance record of a token, or NULL, if there is none. */
+    const BalanceRecord* get(uint32_t propertyId) const;
 
 public:
     /** Creates an empty tally. */
@@ -60,6 +71,12 @@ public:
 
     /** Prints a balance record to the console. */
     int64_t print(uint32_t propertyId = 1, bool bDivisible = true) const;
+
+    /** Returns the number of tokens with a balance record. */
+    size_t size() const { return mp_token.size(); }
+
+    /** Returns the heap memory used by the balance records. */
+    size_t DynamicMemoryUsage() const;
 };
 
 
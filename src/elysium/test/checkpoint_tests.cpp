@@ -1,5 +1,6 @@
 #include "elysium/consensushash.h"
 #include "elysium/dex.h"
+#include "elysium/holders.h"
 #include "elysium/mdex.h"
 #include "elysium/sp.h"
 #include "elysium/elysium.h"
@@ -98,4 +99,70 @@ BOOST_AUTO_TEST_CASE(consensus_string_property_issuer)
             GenerateConsensusString(5, "3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b"));
 }
 
+static void ClearTally()
+{
+    LOCK(cs_main);
+    mp_tally_map.clear();
+    ClearBalancesHash();
+    ClearPropertyHolders();
+}
+
+BOOST_AUTO_TEST_CASE(balances_hash_incremental)
+{
+    ClearTally();
+    BOOST_CHECK(GetBalancesHash(3).IsNull());
+
+    BOOST_CHECK(update_tally_map("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 50, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 5, 10, BALANCE));
+    uint256 hashProperty3 = GetBalancesHash(3);
+    uint256 hashProperty5 = GetBalancesHash(5);
+    BOOST_CHECK(!hashProperty3.IsNull());
+    BOOST_CHECK(hashProperty3 != hashProperty5);
+
+    // the commitment only depends on the state, not on the order of updates
+    ClearTally();
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 5, 10, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 50, BALANCE));
+    BOOST_CHECK(update_tally_map("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, 60, BALANCE));
+    BOOST_CHECK(update_tally_map("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, 40, BALANCE));
+    BOOST_CHECK(GetBalancesHash(3) == hashProperty3);
+    BOOST_CHECK(GetBalancesHash(5) == hashProperty5);
+
+    // moving tokens into a reserve changes the entry, emptied entries are dropped
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 5, -10, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 5, 10, METADEX_RESERVE));
+    BOOST_CHECK(GetBalancesHash(5) != hashProperty5);
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 5, -10, METADEX_RESERVE));
+    BOOST_CHECK(GetBalancesHash(5).IsNull());
+    BOOST_CHECK(GetBalancesHash(3) == hashProperty3);
+
+    ClearTally();
+}
+
+BOOST_AUTO_TEST_CASE(metadex_hash_incremental)
+{
+    MetaDEx_CLEAR();
+    uint256 emptyHash = GetMetaDExHash();
+
+    CMPMetaDEx tradeA("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 395000, 31, 1000000, 1, 2000000,
+            uint256S("2c9a055899147b03b2c5240a020c1f94d243a834ecc06ab8cfa504ee29d07b7d"), 1, 1, 900000);
+    CMPMetaDEx tradeB("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 395001, 1, 500, 31, 100,
+            uint256S("3c9a055899147b03b2c5240a020c1f94d243a834ecc06ab8cfa504ee29d07b7d"), 2, 1, 500);
+
+    BOOST_CHECK(MetaDEx_INSERT(tradeA));
+    uint256 hashA = GetMetaDExHash();
+    BOOST_CHECK(hashA != emptyHash);
+    BOOST_CHECK(MetaDEx_INSERT(tradeB));
+    BOOST_CHECK(GetMetaDExHash() != hashA);
+    BOOST_CHECK(GetMetaDExHash(31) != GetMetaDExHash(1));
+
+    MetaDEx_CLEAR();
+    BOOST_CHECK(GetMetaDExHash() == emptyHash);
+    BOOST_CHECK(MetaDEx_INSERT(tradeA));
+    BOOST_CHECK(GetMetaDExHash() == hashA);
+
+    MetaDEx_CLEAR();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -88,7 +88,7 @@ BOOST_AUTO_TEST_CASE(elysium_parse_normal_tx)
     auto block = getHeighestBlock();
     BOOST_CHECK_EQUAL(2, block.vtx.size());
 
-    CTransaction elysiumTx = block.vtx[1];
+    CTransaction elysiumTx = *block.vtx[1];
     CMPTransaction mp_obj;
 
     BOOST_CHECK_EQUAL(0, ParseTransaction(elysiumTx, chainActive.Height(), 1, mp_obj, block.GetBlockTime()));
@@ -118,7 +118,7 @@ BOOST_AUTO_TEST_CASE(elysium_parse_normal_tx_with_spend)
     auto block = getHeighestBlock();
     BOOST_CHECK_EQUAL(2, block.vtx.size());
 
-    CTransaction elysiumTx = block.vtx[1];
+    CTransaction elysiumTx = *block.vtx[1];
     CMPTransaction mp_obj;
 
     BOOST_CHECK_EQUAL(0, ParseTransaction(elysiumTx, chainActive.Height(), 1, mp_obj, block.GetBlockTime()));
@@ -157,7 +157,7 @@ BOOST_AUTO_TEST_CASE(elysium_parse_sigma_tx_with_non_spend)
     auto block = getHeighestBlock();
     BOOST_CHECK_EQUAL(2, block.vtx.size());
 
-    CTransaction sigmaTx = block.vtx[1];
+    CTransaction sigmaTx = *block.vtx[1];
     CMPTransaction mp_obj;
 
     BOOST_CHECK_EQUAL(0, ParseTransaction(sigmaTx, chainActive.Height(), 1, mp_obj, block.GetBlockTime()));
@@ -189,7 +189,7 @@ BOOST_AUTO_TEST_CASE(elysium_parse_sigma_tx_with_spend)
     auto block = getHeighestBlock();
     BOOST_CHECK_EQUAL(2, block.vtx.size());
 
-    CTransaction sigmaTx = block.vtx[1];
+    CTransaction sigmaTx = *block.vtx[1];
     CMPTransaction mp_obj;
 
     BOOST_CHECK_EQUAL(0, ParseTransaction(sigmaTx, chainActive.Height(), 1, mp_obj, block.GetBlockTime()));
@@ -0,0 +1,118 @@
+#include "elysium/consensushash.h"
+#include "elysium/elysium.h"
+#include "elysium/holders.h"
+#include "elysium/sto.h"
+#include "elysium/tally.h"
+
+#include "main.h"
+#include "sync.h"
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <stdint.h>
+#include <string>
+
+using namespace elysium;
+
+namespace {
+
+void ClearTally()
+{
+    LOCK(cs_main);
+    mp_tally_map.clear();
+    ClearBalancesHash();
+    ClearPropertyHolders();
+}
+
+int64_t GetHolderTokens(uint32_t propertyId, const std::string& address)
+{
+    LOCK(cs_main);
+    const PropertyHolders* holders = GetPropertyHolders(propertyId);
+    if (!holders) return 0;
+
+    std::unordered_map<std::string, int64_t>::const_iterator it = holders->owners.find(address);
+    return (it == holders->owners.end()) ? 0 : it->second;
+}
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(elysium_holders_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(holders_follow_tally)
+{
+    ClearTally();
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(GetPropertyHolders(3) == NULL);
+    }
+
+    BOOST_CHECK(update_tally_map("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 50, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 5, 10, BALANCE));
+    {
+        LOCK(cs_main);
+        const PropertyHolders* holders = GetPropertyHolders(3);
+        BOOST_REQUIRE(holders != NULL);
+        BOOST_CHECK_EQUAL(holders->owners.size(), 2U);
+        BOOST_CHECK_EQUAL(holders->totalTokens, 150);
+    }
+
+    // reserves count as owned, pending amounts do not
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, -20, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 20, METADEX_RESERVE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 7, PENDING));
+    BOOST_CHECK_EQUAL(GetHolderTokens(3, "1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH"), 50);
+
+    // emptied holders are dropped, along with their contribution to the total
+    BOOST_CHECK(update_tally_map("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, -100, BALANCE));
+    BOOST_CHECK_EQUAL(GetHolderTokens(3, "3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b"), 0);
+    {
+        LOCK(cs_main);
+        const PropertyHolders* holders = GetPropertyHolders(3);
+        BOOST_REQUIRE(holders != NULL);
+        BOOST_CHECK_EQUAL(holders->owners.size(), 1U);
+        BOOST_CHECK_EQUAL(holders->totalTokens, 50);
+    }
+
+    // failed updates leave the index untouched
+    BOOST_CHECK(!update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 5, -11, BALANCE));
+    BOOST_CHECK_EQUAL(GetHolderTokens(5, "1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH"), 10);
+
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 5, -10, BALANCE));
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(GetPropertyHolders(5) == NULL);
+    }
+
+    ClearTally();
+}
+
+BOOST_AUTO_TEST_CASE(sto_receivers_from_holders)
+{
+    ClearTally();
+
+    BOOST_CHECK(update_tally_map("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 300, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 100, SELLOFFER_RESERVE));
+    BOOST_CHECK(update_tally_map("1LCShN3ntEbeRrj8XBFWdScGqw5NgDXL5R", 3, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map("1LCShN3ntEbeRrj8XBFWdScGqw5NgDXL5R", 4, 1000, BALANCE));
+
+    // the sender is excluded, the amount is split by the tokens owned
+    OwnerAddrType receivers = STO_GetReceivers("1LCShN3ntEbeRrj8XBFWdScGqw5NgDXL5R", 3, 50);
+    BOOST_REQUIRE_EQUAL(receivers.size(), 2U);
+
+    OwnerAddrType::const_reverse_iterator it = receivers.rbegin();
+    BOOST_CHECK_EQUAL(it->first, 40);
+    BOOST_CHECK_EQUAL(it->second, "1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH");
+    ++it;
+    BOOST_CHECK_EQUAL(it->first, 10);
+    BOOST_CHECK_EQUAL(it->second, "3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b");
+
+    // there is nobody else to receive tokens of property 4
+    BOOST_CHECK(STO_GetReceivers("1LCShN3ntEbeRrj8XBFWdScGqw5NgDXL5R", 4, 50).empty());
+
+    ClearTally();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,298 @@
+#include "elysium/elysium.h"
+#include "elysium/mdex.h"
+#include "elysium/property.h"
+#include "elysium/sp.h"
+#include "elysium/tally.h"
+
+#include "test/test_bitcoin.h"
+#include "uint256.h"
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+using namespace elysium;
+
+namespace {
+
+const std::string seller = "1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH";
+const std::string buyer = "1HG3s4Ext3sTqBTHrgftyUzG3cvx5ZbPCj";
+
+/** Provides the databases trades and cancellations are recorded in, restoring the globals afterwards. */
+struct MetaDExTestingSetup : TestingSetup
+{
+    CMPSPInfo* prevSps;
+    CMPTxList* prevTxList;
+    CMPTradeList* prevTradeList;
+
+    MetaDExTestingSetup() : prevSps(_my_sps), prevTxList(p_txlistdb), prevTradeList(t_tradelistdb)
+    {
+        _my_sps = new CMPSPInfo(pathTemp / "MP_spinfo_test", true);
+        p_txlistdb = new CMPTxList(pathTemp / "MP_txlist_test", true);
+        t_tradelistdb = new CMPTradeList(pathTemp / "MP_tradelist_test", true);
+
+        mp_tally_map.clear();
+        MetaDEx_CLEAR();
+    }
+
+    ~MetaDExTestingSetup()
+    {
+        mp_tally_map.clear();
+        MetaDEx_CLEAR();
+
+        delete t_tradelistdb;
+        delete p_txlistdb;
+        delete _my_sps;
+        t_tradelistdb = prevTradeList;
+        p_txlistdb = prevTxList;
+        _my_sps = prevSps;
+    }
+};
+
+/** Returns the order with the given hash by walking the order books, or NULL. */
+const CMPMetaDEx* FindInBooks(const uint256& txid)
+{
+    for (md_PropertiesMap::const_iterator bookIt = metadex.begin(); bookIt != metadex.end(); ++bookIt) {
+        for (md_PricesMap::const_iterator priceIt = bookIt->second.begin(); priceIt != bookIt->second.end(); ++priceIt) {
+            for (md_Set::const_iterator it = priceIt->second.begin(); it != priceIt->second.end(); ++it) {
+                if (it->getHash() == txid) return &(*it);
+            }
+        }
+    }
+    return NULL;
+}
+
+/** Checks that the txid index and the order books agree, and that no book or price level is left empty. */
+void CheckIndexConsistent(const std::vector<uint256>& txids)
+{
+    for (md_PropertiesMap::const_iterator bookIt = metadex.begin(); bookIt != metadex.end(); ++bookIt) {
+        BOOST_CHECK(!bookIt->second.empty());
+        for (md_PricesMap::const_iterator priceIt = bookIt->second.begin(); priceIt != bookIt->second.end(); ++priceIt) {
+            BOOST_CHECK(!priceIt->second.empty());
+            for (md_Set::const_iterator it = priceIt->second.begin(); it != priceIt->second.end(); ++it) {
+                BOOST_CHECK(MetaDEx_RetrieveTrade(it->getHash()) == &(*it));
+            }
+        }
+    }
+    for (std::vector<uint256>::const_iterator it = txids.begin(); it != txids.end(); ++it) {
+        BOOST_CHECK(MetaDEx_RetrieveTrade(*it) == FindInBooks(*it));
+    }
+}
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(elysium_mdex_tests, MetaDExTestingSetup)
+
+BOOST_AUTO_TEST_CASE(mdex_cached_prices)
+{
+    CMPMetaDEx empty;
+    BOOST_CHECK(empty.unitPrice() == rational_t(0));
+    BOOST_CHECK(empty.inversePrice() == rational_t(0));
+
+    CMPMetaDEx trade("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 395000, 31, 1000000, 1, 2000000,
+            uint256S("2c9a055899147b03b2c5240a020c1f94d243a834ecc06ab8cfa504ee29d07b7d"), 1, 1, 900000);
+    BOOST_CHECK(trade.unitPrice() == rational_t(2));
+    BOOST_CHECK(trade.inversePrice() == rational_t(1, 2));
+
+    trade.setAmountRemaining(100);
+    BOOST_CHECK(trade.unitPrice() == rational_t(2));
+}
+
+BOOST_AUTO_TEST_CASE(mdex_pair_books_and_txid_index)
+{
+    MetaDEx_CLEAR();
+
+    uint256 txidA = uint256S("01");
+    uint256 txidB = uint256S("02");
+    uint256 txidC = uint256S("03");
+
+    CMPMetaDEx tradeA("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 100, 31, 1000, 1, 2000, txidA, 1, 1);
+    CMPMetaDEx tradeB("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 100, 31, 1000, 1, 1000, txidB, 2, 1);
+    CMPMetaDEx tradeC("1HG3s4Ext3sTqBTHrgftyUzG3cvx5ZbPCj", 101, 31, 1000, 3, 1000, txidC, 1, 1);
+
+    BOOST_CHECK(MetaDEx_INSERT(tradeA));
+    BOOST_CHECK(MetaDEx_INSERT(tradeB));
+    BOOST_CHECK(MetaDEx_INSERT(tradeC));
+    BOOST_CHECK(!MetaDEx_INSERT(tradeA));
+
+    // one book per pair of property for sale and property desired
+    BOOST_CHECK_EQUAL(metadex.size(), 2);
+    md_PricesMap* prices = get_Prices(31, 1);
+    BOOST_REQUIRE(prices != NULL);
+    BOOST_CHECK_EQUAL(prices->size(), 2);
+    BOOST_CHECK(prices->begin()->first == tradeB.unitPrice());
+    BOOST_CHECK(get_Prices(1, 31) == NULL);
+
+    const CMPMetaDEx* retrieved = MetaDEx_RetrieveTrade(txidC);
+    BOOST_REQUIRE(retrieved != NULL);
+    BOOST_CHECK_EQUAL(retrieved->getDesProperty(), 3);
+    BOOST_CHECK(MetaDEx_isOpen(txidA));
+    BOOST_CHECK(MetaDEx_isOpen(txidA, 31));
+    BOOST_CHECK(!MetaDEx_isOpen(txidA, 1));
+    BOOST_CHECK(!MetaDEx_isOpen(uint256S("04")));
+
+    MetaDEx_CLEAR();
+    BOOST_CHECK(metadex.empty());
+    BOOST_CHECK(MetaDEx_RetrieveTrade(txidA) == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(mdex_partial_fill_replacement)
+{
+    uint256 txidSell = uint256S("11");
+    uint256 txidBuy = uint256S("12");
+
+    BOOST_CHECK(update_tally_map(seller, 3, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map(buyer, ELYSIUM_PROPERTY_ELYSIUM, 600, BALANCE));
+
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 2000, txidSell, 1), 0);
+    const CMPMetaDEx* original = MetaDEx_RetrieveTrade(txidSell);
+    BOOST_REQUIRE(original != NULL);
+    CheckIndexConsistent({txidSell, txidBuy});
+
+    // the buyer takes 300 of the 1000 units, the seller's order is replaced by one for the remainder
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(buyer, ELYSIUM_PROPERTY_ELYSIUM, 600, 101, 3, 300, txidBuy, 1), 0);
+    BOOST_CHECK(!MetaDEx_isOpen(txidBuy));
+    BOOST_CHECK(get_Prices(ELYSIUM_PROPERTY_ELYSIUM, 3) == NULL);
+
+    const CMPMetaDEx* replacement = MetaDEx_RetrieveTrade(txidSell);
+    BOOST_REQUIRE(replacement != NULL);
+    BOOST_CHECK(replacement == FindInBooks(txidSell));
+    BOOST_CHECK_EQUAL(replacement->getAmountForSale(), 1000);
+    BOOST_CHECK_EQUAL(replacement->getAmountRemaining(), 700);
+    CheckIndexConsistent({txidSell, txidBuy});
+
+    BOOST_CHECK_EQUAL(getMPbalance(seller, 3, METADEX_RESERVE), 700);
+    BOOST_CHECK_EQUAL(getMPbalance(seller, ELYSIUM_PROPERTY_ELYSIUM, BALANCE), 600);
+    BOOST_CHECK_EQUAL(getMPbalance(buyer, 3, BALANCE), 300);
+    BOOST_CHECK_EQUAL(getMPbalance(buyer, ELYSIUM_PROPERTY_ELYSIUM, BALANCE), 0);
+
+    // the replacement is what gets erased by txid
+    BOOST_CHECK(MetaDEx_ERASE(txidSell));
+    BOOST_CHECK(metadex.empty());
+    CheckIndexConsistent({txidSell, txidBuy});
+}
+
+BOOST_AUTO_TEST_CASE(mdex_cancel_at_price)
+{
+    uint256 txidA = uint256S("21");
+    uint256 txidB = uint256S("22");
+    uint256 txidC = uint256S("23");
+    uint256 txidCancel = uint256S("24");
+
+    BOOST_CHECK(update_tally_map(seller, 3, 3000, BALANCE));
+    BOOST_CHECK(update_tally_map(buyer, 3, 1000, BALANCE));
+
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 2000, txidA, 1), 0);
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 3000, txidB, 2), 0);
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(buyer, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 2000, txidC, 3), 0);
+    CheckIndexConsistent({txidA, txidB, txidC});
+
+    // only the sender's orders at the given price are cancelled
+    BOOST_CHECK_EQUAL(MetaDEx_CANCEL_AT_PRICE(txidCancel, 101, seller, 3, 1000, ELYSIUM_PROPERTY_ELYSIUM, 2000), 0);
+    BOOST_CHECK(!MetaDEx_isOpen(txidA));
+    BOOST_CHECK(MetaDEx_isOpen(txidB));
+    BOOST_CHECK(MetaDEx_isOpen(txidC));
+    CheckIndexConsistent({txidA, txidB, txidC});
+
+    BOOST_CHECK_EQUAL(getMPbalance(seller, 3, BALANCE), 2000);
+    BOOST_CHECK_EQUAL(getMPbalance(seller, 3, METADEX_RESERVE), 1000);
+
+    // nothing left to cancel at that price
+    BOOST_CHECK(MetaDEx_CANCEL_AT_PRICE(txidCancel, 101, seller, 3, 1000, ELYSIUM_PROPERTY_ELYSIUM, 2000) != 0);
+
+    // cancelling the last order of a price level removes the level
+    BOOST_CHECK_EQUAL(MetaDEx_CANCEL_AT_PRICE(txidCancel, 102, buyer, 3, 1000, ELYSIUM_PROPERTY_ELYSIUM, 2000), 0);
+    md_PricesMap* prices = get_Prices(3, ELYSIUM_PROPERTY_ELYSIUM);
+    BOOST_REQUIRE(prices != NULL);
+    BOOST_CHECK_EQUAL(prices->size(), 1);
+    CheckIndexConsistent({txidA, txidB, txidC});
+
+    // cancelling the last order of the pair removes the book
+    BOOST_CHECK_EQUAL(MetaDEx_CANCEL_AT_PRICE(txidCancel, 103, seller, 3, 1000, ELYSIUM_PROPERTY_ELYSIUM, 3000), 0);
+    BOOST_CHECK(metadex.empty());
+    CheckIndexConsistent({txidA, txidB, txidC});
+}
+
+BOOST_AUTO_TEST_CASE(mdex_cancel_all_for_pair)
+{
+    uint256 txidA = uint256S("31");
+    uint256 txidB = uint256S("32");
+    uint256 txidC = uint256S("33");
+    uint256 txidD = uint256S("34");
+    uint256 txidCancel = uint256S("35");
+
+    BOOST_CHECK(update_tally_map(seller, 3, 3000, BALANCE));
+    BOOST_CHECK(update_tally_map(buyer, 3, 1000, BALANCE));
+
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 2000, txidA, 1), 0);
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 3000, txidB, 2), 0);
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, 3, 1000, 100, ELYSIUM_PROPERTY_TELYSIUM, 1000, txidC, 3), 0);
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(buyer, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 3000, txidD, 4), 0);
+    CheckIndexConsistent({txidA, txidB, txidC, txidD});
+
+    // all of the sender's orders of the pair go, at every price level
+    BOOST_CHECK_EQUAL(MetaDEx_CANCEL_ALL_FOR_PAIR(txidCancel, 101, seller, 3, ELYSIUM_PROPERTY_ELYSIUM), 0);
+    BOOST_CHECK(!MetaDEx_isOpen(txidA));
+    BOOST_CHECK(!MetaDEx_isOpen(txidB));
+    BOOST_CHECK(MetaDEx_isOpen(txidC));
+    BOOST_CHECK(MetaDEx_isOpen(txidD));
+    CheckIndexConsistent({txidA, txidB, txidC, txidD});
+
+    md_PricesMap* prices = get_Prices(3, ELYSIUM_PROPERTY_ELYSIUM);
+    BOOST_REQUIRE(prices != NULL);
+    BOOST_CHECK_EQUAL(prices->size(), 1);
+    BOOST_CHECK_EQUAL(getMPbalance(seller, 3, BALANCE), 2000);
+    BOOST_CHECK_EQUAL(getMPbalance(seller, 3, METADEX_RESERVE), 1000);
+
+    BOOST_CHECK(MetaDEx_CANCEL_ALL_FOR_PAIR(txidCancel, 102, seller, 3, ELYSIUM_PROPERTY_ELYSIUM) != 0);
+
+    BOOST_CHECK_EQUAL(MetaDEx_CANCEL_ALL_FOR_PAIR(txidCancel, 103, buyer, 3, ELYSIUM_PROPERTY_ELYSIUM), 0);
+    BOOST_CHECK(get_Prices(3, ELYSIUM_PROPERTY_ELYSIUM) == NULL);
+    BOOST_CHECK_EQUAL(metadex.size(), 1);
+    CheckIndexConsistent({txidA, txidB, txidC, txidD});
+}
+
+BOOST_AUTO_TEST_CASE(mdex_cancel_everything)
+{
+    uint256 txidA = uint256S("41");
+    uint256 txidB = uint256S("42");
+    uint256 txidC = uint256S("43");
+    uint256 txidD = uint256S("44");
+    uint256 txidCancel = uint256S("45");
+
+    BOOST_CHECK(update_tally_map(seller, 3, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map(seller, ELYSIUM_PROPERTY_ELYSIUM, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map(seller, TEST_ECO_PROPERTY_1, 1000, BALANCE));
+    BOOST_CHECK(update_tally_map(buyer, 3, 1000, BALANCE));
+
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 2000, txidA, 1), 0);
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(buyer, 3, 1000, 100, ELYSIUM_PROPERTY_ELYSIUM, 5000, txidB, 2), 0);
+    // priced below both offers of property 3, so it doesn't match
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, ELYSIUM_PROPERTY_ELYSIUM, 1000, 100, 3, 1000, txidC, 3), 0);
+    BOOST_CHECK_EQUAL(MetaDEx_ADD(seller, TEST_ECO_PROPERTY_1, 1000, 100, ELYSIUM_PROPERTY_TELYSIUM, 1000, txidD, 4), 0);
+    BOOST_CHECK_EQUAL(metadex.size(), 3);
+    CheckIndexConsistent({txidA, txidB, txidC, txidD});
+
+    // every order of the sender in the main ecosystem goes, across books
+    BOOST_CHECK_EQUAL(MetaDEx_CANCEL_EVERYTHING(txidCancel, 101, seller, ELYSIUM_PROPERTY_ELYSIUM), 0);
+    BOOST_CHECK(!MetaDEx_isOpen(txidA));
+    BOOST_CHECK(MetaDEx_isOpen(txidB));
+    BOOST_CHECK(!MetaDEx_isOpen(txidC));
+    BOOST_CHECK(MetaDEx_isOpen(txidD));
+    BOOST_CHECK(get_Prices(ELYSIUM_PROPERTY_ELYSIUM, 3) == NULL);
+    BOOST_CHECK_EQUAL(metadex.size(), 2);
+    CheckIndexConsistent({txidA, txidB, txidC, txidD});
+
+    BOOST_CHECK_EQUAL(getMPbalance(seller, 3, BALANCE), 1000);
+    BOOST_CHECK_EQUAL(getMPbalance(seller, ELYSIUM_PROPERTY_ELYSIUM, BALANCE), 1000);
+    BOOST_CHECK_EQUAL(getMPbalance(seller, TEST_ECO_PROPERTY_1, METADEX_RESERVE), 1000);
+
+    BOOST_CHECK_EQUAL(MetaDEx_CANCEL_EVERYTHING(txidCancel, 102, seller, ELYSIUM_PROPERTY_TELYSIUM), 0);
+    BOOST_CHECK(!MetaDEx_isOpen(txidD));
+    BOOST_CHECK_EQUAL(metadex.size(), 1);
+    CheckIndexConsistent({txidA, txidB, txidC, txidD});
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,80 @@
+#include "utils_tx.h"
+
+#include "../scan.h"
+
+#include "../../primitives/block.h"
+#include "../../primitives/transaction.h"
+#include "../../test/test_bitcoin.h"
+#include "../../uint256.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <limits>
+#include <stdint.h>
+#include <vector>
+
+namespace elysium {
+
+BOOST_FIXTURE_TEST_SUITE(elysium_scan_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(find_marked_transactions)
+{
+    int nBlock = std::numeric_limits<int>::max();
+
+    CMutableTransaction unrelatedTx;
+    unrelatedTx.vout.push_back(PayToPubKeyHash_Unrelated());
+    unrelatedTx.vout.push_back(OpReturn_Unrelated());
+
+    CMutableTransaction classBTx;
+    classBTx.vout.push_back(PayToPubKeyHash_Elysium());
+    classBTx.vout.push_back(PayToBareMultisig_1of3());
+
+    CMutableTransaction classCTx;
+    classCTx.vout.push_back(OpReturn_SimpleSend());
+
+    CBlock block;
+    BOOST_CHECK(FindMarkedTransactions(block, nBlock).empty());
+
+    block.vtx.push_back(MakeTransactionRef(unrelatedTx));
+    block.vtx.push_back(MakeTransactionRef(classCTx));
+    block.vtx.push_back(MakeTransactionRef(unrelatedTx));
+    block.vtx.push_back(MakeTransactionRef(classBTx));
+
+    std::vector<uint32_t> positions = FindMarkedTransactions(block, nBlock);
+    BOOST_CHECK_EQUAL(positions.size(), 2U);
+    BOOST_CHECK_EQUAL(positions[0], 1U);
+    BOOST_CHECK_EQUAL(positions[1], 3U);
+}
+
+BOOST_AUTO_TEST_CASE(marker_index_roundtrip)
+{
+    uint256 blockA = uint256S("1c9a055899147b03b2c5240a020c1f94d243a834ecc06ab8cfa504ee29d07b7d");
+    uint256 blockB = uint256S("2c9a055899147b03b2c5240a020c1f94d243a834ecc06ab8cfa504ee29d07b7d");
+    uint256 blockC = uint256S("3c9a055899147b03b2c5240a020c1f94d243a834ecc06ab8cfa504ee29d07b7d");
+
+    std::vector<uint32_t> marked;
+    marked.push_back(0);
+    marked.push_back(7);
+
+    {
+        CElysiumMarkerIndex index(pathTemp / "MP_markers_test", true);
+        BOOST_CHECK(index.WriteMarkers(blockA, marked));
+        BOOST_CHECK(index.WriteMarkers(blockB, std::vector<uint32_t>()));
+    }
+
+    // the index is kept, when the database is reopened
+    CElysiumMarkerIndex index(pathTemp / "MP_markers_test", false);
+    std::vector<uint32_t> positions;
+
+    BOOST_CHECK(index.ReadMarkers(blockA, positions));
+    BOOST_CHECK(positions == marked);
+
+    BOOST_CHECK(index.ReadMarkers(blockB, positions));
+    BOOST_CHECK(positions.empty());
+
+    BOOST_CHECK(!index.ReadMarkers(blockC, positions));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace elysium
@@ -100,6 +100,50 @@ BOOST_FIXTURE_TEST_CASE(verify_spend, SigmaDatabaseFixture)
     BOOST_CHECK_EQUAL(VerifySigmaSpend(3, 0, 1, sigmaDb->groupSize, proof, key.serial, false), false);
 }
 
+BOOST_FIXTURE_TEST_CASE(verify_spend_batch, SigmaDatabaseFixture)
+{
+    auto& params = DefaultSigmaParams;
+    std::vector<SigmaPrivateKey> keys(3);
+    std::vector<SigmaPublicKey> anonimitySet;
+
+    for (auto& key : keys) {
+        key.Generate();
+        anonimitySet.push_back(SigmaPublicKey(key, params));
+    }
+
+    for (auto& mint : CreateMints(sigmaDb->groupSize - keys.size())) {
+        anonimitySet.push_back(mint);
+    }
+
+    for (auto& mint : anonimitySet) {
+        sigmaDb->RecordMint(3, 0, mint, 100);
+    }
+
+    std::vector<BlockSigmaSpend> spends;
+    for (auto& key : keys) {
+        SigmaProof proof(params, key, anonimitySet.begin(), anonimitySet.end(), true);
+        spends.push_back(BlockSigmaSpend(3, 0, 0, anonimitySet.size(), proof, key.serial));
+    }
+
+    // valid batch
+    VerifySigmaSpendBatch(spends, true);
+    for (auto& spend : spends) {
+        BOOST_CHECK(VerifySigmaSpend(3, 0, 0, spend.groupSize, spend.proof, spend.serial, true));
+    }
+    ClearSigmaSpendBatch();
+
+    // one spend with a wrong serial fails the batch, but doesn't affect the other spends
+    spends[1].serial = keys[0].serial;
+    VerifySigmaSpendBatch(spends, true);
+    BOOST_CHECK(VerifySigmaSpend(3, 0, 0, spends[0].groupSize, spends[0].proof, spends[0].serial, true));
+    BOOST_CHECK(!VerifySigmaSpend(3, 0, 0, spends[1].groupSize, spends[1].proof, spends[1].serial, true));
+    BOOST_CHECK(VerifySigmaSpend(3, 0, 0, spends[2].groupSize, spends[2].proof, spends[2].serial, true));
+    ClearSigmaSpendBatch();
+
+    BOOST_CHECK(!VerifySigmaSpend(3, 0, 0, spends[1].groupSize, spends[1].proof, spends[1].serial, true));
+    BOOST_CHECK(VerifySigmaSpend(3, 0, 0, spends[2].groupSize, spends[2].proof, spends[2].serial, true));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 } // namespace elysium
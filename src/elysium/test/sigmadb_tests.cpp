@@ -504,6 +504,85 @@ BOOST_AUTO_TEST_CASE(get_anonimity_group_by_iterator)
     BOOST_CHECK_EQUAL(mints, result);
 }
 
+BOOST_AUTO_TEST_CASE(get_anonimity_group_view)
+{
+    auto db = CreateDb();
+    auto mints = CreateMints(20);
+
+    for (size_t i = 0; i < 10; i++) {
+        db->RecordMint(1, 1, mints[i], 10);
+    }
+
+    auto view = db->GetAnonimityGroupView(1, 1, 0, 5);
+    BOOST_CHECK_EQUAL(GetFirstN(mints, 5), std::vector<SigmaPublicKey>(view.begin(), view.end()));
+
+    // views are limited to the existing mints
+    BOOST_CHECK_EQUAL(10, db->GetAnonimityGroupView(1, 1, 0, 11).size());
+    BOOST_CHECK_EQUAL(true, db->GetAnonimityGroupView(1, 1, 1).empty());
+    BOOST_CHECK_EQUAL(true, db->GetAnonimityGroupView(2, 1, 0).empty());
+
+    // new mints are appended to the cached group, while existing views remain unchanged
+    for (size_t i = 10; i < mints.size(); i++) {
+        db->RecordMint(1, 1, mints[i], 11);
+    }
+
+    auto all = db->GetAnonimityGroupView(1, 1, 0);
+    BOOST_CHECK_EQUAL(mints, std::vector<SigmaPublicKey>(all.begin(), all.end()));
+    BOOST_CHECK_EQUAL(db->GetAnonimityGroupAsVector(1, 1, 0, 20), std::vector<SigmaPublicKey>(all.begin(), all.end()));
+    BOOST_CHECK_EQUAL(GetFirstN(mints, 5), std::vector<SigmaPublicKey>(view.begin(), view.end()));
+}
+
+BOOST_AUTO_TEST_CASE(get_anonimity_group_view_after_delete)
+{
+    auto db = CreateDb();
+    auto mints = CreateMints(4);
+
+    db->RecordMint(1, 1, mints[0], 10);
+    db->RecordMint(1, 1, mints[1], 10);
+    db->RecordMint(1, 1, mints[2], 11);
+
+    auto view = db->GetAnonimityGroupView(1, 1, 0);
+    BOOST_CHECK_EQUAL(3, view.size());
+
+    db->DeleteAll(11);
+
+    auto rolledBack = db->GetAnonimityGroupView(1, 1, 0);
+    BOOST_CHECK_EQUAL(GetFirstN(mints, 2), std::vector<SigmaPublicKey>(rolledBack.begin(), rolledBack.end()));
+    BOOST_CHECK_EQUAL(3, view.size());
+
+    db->RecordMint(1, 1, mints[3], 11);
+
+    auto replaced = db->GetAnonimityGroupView(1, 1, 0);
+    BOOST_CHECK_EQUAL(3, replaced.size());
+    BOOST_CHECK(mints[3] == *(replaced.end() - 1));
+}
+
+BOOST_AUTO_TEST_CASE(get_anonimity_group_view_after_clear)
+{
+    auto db = CreateDb();
+    auto mints = CreateMints(4);
+
+    db->RecordMint(1, 1, mints[0], 10);
+    db->RecordMint(1, 1, mints[1], 10);
+    db->RecordMint(1, 1, mints[2], 11);
+
+    auto view = db->GetAnonimityGroupView(1, 1, 0);
+    BOOST_CHECK_EQUAL(3, view.size());
+
+    // a rescan records the group again, the old one must not be served from the cache
+    db->Clear();
+    BOOST_CHECK_EQUAL(true, db->GetAnonimityGroupView(1, 1, 0).empty());
+
+    db->RecordMint(1, 1, mints[0], 10);
+    db->RecordMint(1, 1, mints[3], 10);
+
+    auto rescanned = db->GetAnonimityGroupView(1, 1, 0);
+    BOOST_CHECK_EQUAL(2, rescanned.size());
+    BOOST_CHECK(mints[3] == *(rescanned.end() - 1));
+    BOOST_CHECK_EQUAL(2, db->GetAnonimityGroupView(1, 1, 0, 3).size());
+    BOOST_CHECK_EQUAL(3, view.size());
+}
+
 BOOST_AUTO_TEST_CASE(group_size_default)
 {
     auto db = CreateDb(0);
@@ -0,0 +1,209 @@
+#include "elysium/consensushash.h"
+#include "elysium/dex.h"
+#include "elysium/elysium.h"
+#include "elysium/holders.h"
+#include "elysium/mdex.h"
+#include "elysium/sp.h"
+#include "elysium/statefile.h"
+#include "elysium/tally.h"
+
+#include "arith_uint256.h"
+#include "chain.h"
+#include "main.h"
+#include "sync.h"
+#include "test/test_bitcoin.h"
+#include "uint256.h"
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+using namespace elysium;
+
+namespace {
+
+void ClearState()
+{
+    mp_tally_map.clear();
+    ClearBalancesHash();
+    ClearPropertyHolders();
+    my_offers.clear();
+    my_accepts.clear();
+    my_crowds.clear();
+    MetaDEx_CLEAR();
+}
+
+struct StateFileTestingSetup : TestingSetup
+{
+    boost::filesystem::path dir;
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex> blocks;
+    CMPSPInfo* prevSps;
+
+    StateFileTestingSetup() : dir(pathTemp / "MP_persist_test"), hashes(4), blocks(4), prevSps(_my_sps)
+    {
+        boost::filesystem::create_directories(dir);
+        _my_sps = new CMPSPInfo(pathTemp / "MP_spinfo_test", false);
+
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            hashes[i] = ArithToUint256(arith_uint256(1000 + i));
+            blocks[i].phashBlock = &hashes[i];
+            blocks[i].nHeight = 100 + i;
+            blocks[i].pprev = (i > 0) ? &blocks[i - 1] : NULL;
+        }
+
+        LOCK(cs_main);
+        ClearState();
+        ResetStateJournal();
+    }
+
+    ~StateFileTestingSetup()
+    {
+        {
+            LOCK(cs_main);
+            ClearState();
+            ResetStateJournal();
+        }
+
+        delete _my_sps;
+        _my_sps = prevSps;
+    }
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(elysium_statefile_tests, StateFileTestingSetup)
+
+BOOST_AUTO_TEST_CASE(state_file_names)
+{
+    uint256 blockHash;
+    bool fSnapshot = false;
+
+    BOOST_CHECK(ParseStateFileName("snapshot-" + hashes[0].ToString() + ".dat", blockHash, fSnapshot));
+    BOOST_CHECK(fSnapshot);
+    BOOST_CHECK(blockHash == hashes[0]);
+
+    BOOST_CHECK(ParseStateFileName("journal-" + hashes[1].ToString() + ".dat", blockHash, fSnapshot));
+    BOOST_CHECK(!fSnapshot);
+    BOOST_CHECK(blockHash == hashes[1]);
+
+    BOOST_CHECK(!ParseStateFileName("balances-" + hashes[0].ToString() + ".dat", blockHash, fSnapshot));
+    BOOST_CHECK(!ParseStateFileName("journal-" + hashes[0].ToString() + ".dat.new", blockHash, fSnapshot));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_and_journals_roundtrip)
+{
+    LOCK(cs_main);
+
+    CMPMetaDEx tradeA("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 100, 3, 1000, 1, 2000,
+            uint256S("2c9a055899147b03b2c5240a020c1f94d243a834ecc06ab8cfa504ee29d07b7d"), 1, 1, 1000);
+    CMPMetaDEx tradeB("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 101, 1, 500, 3, 100,
+            uint256S("3c9a055899147b03b2c5240a020c1f94d243a834ecc06ab8cfa504ee29d07b7d"), 2, 1, 500);
+
+    // block 100: written as snapshot
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 5000, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, -1000, BALANCE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 1000, METADEX_RESERVE));
+    BOOST_CHECK(MetaDEx_INSERT(tradeA));
+    my_offers.insert(std::make_pair(STR_SELLOFFER_ADDR_PROP_COMBO("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 1),
+            CMPOffer(100, 700, 1, 1400, 10, 5, uint256S("01"))));
+    PersistState(dir, &blocks[0], 5);
+
+    // block 101: written as journal
+    BOOST_CHECK(update_tally_map("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 1, 500, METADEX_RESERVE));
+    BOOST_CHECK(MetaDEx_INSERT(tradeB));
+    PersistState(dir, &blocks[1], 6);
+
+    // block 102: written as journal, order A removed, address emptied, offer closed
+    BOOST_CHECK(MetaDEx_ERASE(tradeA.getHash()));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, -1000, METADEX_RESERVE));
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, -4000, BALANCE));
+    BOOST_CHECK(update_tally_map("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, 5000, BALANCE));
+    my_offers.clear();
+    PersistState(dir, &blocks[2], 7);
+
+    BOOST_CHECK(HasPersistedState(dir, hashes[0]));
+    BOOST_CHECK(HasPersistedState(dir, hashes[1]));
+    BOOST_CHECK(HasPersistedState(dir, hashes[2]));
+    BOOST_CHECK(!HasPersistedState(dir, hashes[3]));
+
+    uint256 balancesHash = GetBalancesHash(3);
+    uint256 metadexHash = GetMetaDExHash();
+    int64_t nTotal = getMPbalance("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, BALANCE);
+
+    // restore the latest state from the snapshot and both journals
+    ClearState();
+    int64_t nDevElysiumPrev = 0;
+    BOOST_CHECK(LoadPersistedState(dir, &blocks[2], nDevElysiumPrev));
+    BOOST_CHECK_EQUAL(nDevElysiumPrev, 7);
+    BOOST_CHECK(GetBalancesHash(3) == balancesHash);
+    BOOST_CHECK(GetMetaDExHash() == metadexHash);
+    BOOST_CHECK_EQUAL(getMPbalance("3CwZ7FiQ4MqBenRdCkjjc41M5bnoKQGC2b", 3, BALANCE), nTotal);
+    BOOST_CHECK_EQUAL(getMPbalance("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, BALANCE), 0);
+    BOOST_CHECK(!MetaDEx_isOpen(tradeA.getHash()));
+    BOOST_CHECK(MetaDEx_isOpen(tradeB.getHash()));
+    BOOST_CHECK(my_offers.empty());
+
+    // an earlier state is restored from the snapshot and the first journal
+    BOOST_CHECK(LoadPersistedState(dir, &blocks[1], nDevElysiumPrev));
+    BOOST_CHECK_EQUAL(nDevElysiumPrev, 6);
+    BOOST_CHECK_EQUAL(getMPbalance("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, METADEX_RESERVE), 1000);
+    BOOST_CHECK(MetaDEx_isOpen(tradeA.getHash()));
+    BOOST_CHECK_EQUAL(my_offers.size(), 1U);
+
+    // there is no state for a block without snapshot or journal
+    BOOST_CHECK(!LoadPersistedState(dir, &blocks[3], nDevElysiumPrev));
+
+    // journals are useless without the snapshot they are based on
+    RemoveStateFile(dir, hashes[0], true);
+    BOOST_CHECK(!LoadPersistedState(dir, &blocks[2], nDevElysiumPrev));
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_after_gap)
+{
+    LOCK(cs_main);
+
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 5000, BALANCE));
+    PersistState(dir, &blocks[0], 0);
+
+    // block 101 is not persisted, so block 102 can't be stored as journal
+    ResetStateJournal();
+    BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 100, BALANCE));
+    PersistState(dir, &blocks[2], 0);
+
+    ClearState();
+    int64_t nDevElysiumPrev = 0;
+    BOOST_CHECK(LoadPersistedState(dir, &blocks[2], nDevElysiumPrev));
+    BOOST_CHECK_EQUAL(getMPbalance("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, BALANCE), 5100);
+}
+
+BOOST_AUTO_TEST_CASE(state_tasks_after_writes)
+{
+    StartStateWriter();
+
+    bool fWritten = false;
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(update_tally_map("1PxejjeWZc9ZHph7A3SYDo2sk2Up4AcysH", 3, 5000, BALANCE));
+        PersistState(dir, &blocks[0], 0);
+
+        // the task sees the file of the write queued before it
+        boost::filesystem::path dirTask = dir;
+        uint256 hashTask = hashes[0];
+        QueueStateTask([dirTask, hashTask, &fWritten]() {
+            fWritten = HasPersistedState(dirTask, hashTask);
+            RemoveStateFile(dirTask, hashTask, true);
+        });
+    }
+
+    FlushStateWriter();
+    StopStateWriter();
+
+    BOOST_CHECK(fWritten);
+    BOOST_CHECK(!HasPersistedState(dir, hashes[0]));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
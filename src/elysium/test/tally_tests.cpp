@@ -318,5 +318,41 @@ BOOST_AUTO_TEST_CASE(tally_overflow)
     BOOST_CHECK_EQUAL(tally.getMoneyReserved(3), int64_t(9223372036854775807LL));
 }
 
+BOOST_AUTO_TEST_CASE(tally_iteration_order)
+{
+    CMPTally tally;
+    BOOST_CHECK(tally.updateMoney(31, 1, BALANCE));
+    BOOST_CHECK(tally.updateMoney(3, 2, BALANCE));
+    BOOST_CHECK_EQUAL(tally.DynamicMemoryUsage(), 0);
+
+    BOOST_CHECK(tally.updateMoney(2147483651U, 3, BALANCE));
+    BOOST_CHECK(tally.updateMoney(1, 4, BALANCE));
+    BOOST_CHECK(tally.updateMoney(3, 5, METADEX_RESERVE));
+    BOOST_CHECK_EQUAL(tally.size(), 4U);
+    BOOST_CHECK(tally.DynamicMemoryUsage() > 0);
+
+    BOOST_CHECK_EQUAL(tally.init(), 1U);
+    BOOST_CHECK_EQUAL(tally.next(), 1U);
+    BOOST_CHECK_EQUAL(tally.next(), 3U);
+    BOOST_CHECK_EQUAL(tally.next(), 31U);
+    BOOST_CHECK_EQUAL(tally.next(), 2147483651U);
+    BOOST_CHECK_EQUAL(tally.next(), 0U);
+
+    BOOST_CHECK_EQUAL(tally.getMoney(1, BALANCE), 4);
+    BOOST_CHECK_EQUAL(tally.getMoney(3, BALANCE), 2);
+    BOOST_CHECK_EQUAL(tally.getMoney(3, METADEX_RESERVE), 5);
+    BOOST_CHECK_EQUAL(tally.getMoney(31, BALANCE), 1);
+    BOOST_CHECK_EQUAL(tally.getMoney(2147483651U, BALANCE), 3);
+    BOOST_CHECK_EQUAL(tally.getMoney(4, BALANCE), 0);
+
+    CMPTally other;
+    BOOST_CHECK(other.updateMoney(2147483651U, 3, BALANCE));
+    BOOST_CHECK(other.updateMoney(31, 1, BALANCE));
+    BOOST_CHECK(other.updateMoney(3, 2, BALANCE));
+    BOOST_CHECK(other.updateMoney(1, 4, BALANCE));
+    BOOST_CHECK(other != tally);
+    BOOST_CHECK(other.updateMoney(3, 5, METADEX_RESERVE));
+    BOOST_CHECK(other == tally);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
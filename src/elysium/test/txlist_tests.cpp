@@ -0,0 +1,106 @@
+#include "elysium/elysium.h"
+#include "elysium/tx.h"
+
+#include "test/test_bitcoin.h"
+#include "uint256.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
+
+using namespace elysium;
+
+namespace {
+
+struct TxListTestingSetup : TestingSetup
+{
+    CMPTxList db;
+
+    uint256 txSend;
+    uint256 txFreezeInvalid;
+    uint256 txFreeze;
+    uint256 txAlert;
+    uint256 txPayment;
+
+    TxListTestingSetup()
+      : db(pathTemp / "MP_txlist_test", true),
+        txSend(uint256S("01")),
+        txFreezeInvalid(uint256S("02")),
+        txFreeze(uint256S("03")),
+        txAlert(uint256S("04")),
+        txPayment(uint256S("05"))
+    {
+        db.recordTX(txSend, true, 100, ELYSIUM_TYPE_SIMPLE_SEND, 10);
+        db.recordTX(txFreezeInvalid, false, 100, ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS, 0);
+        db.recordTX(txFreeze, true, 102, ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS, 0);
+        db.recordTX(txAlert, true, 105, ELYSIUM_MESSAGE_TYPE_ALERT, 0);
+        db.recordPaymentTX(txPayment, true, 102, 1, 1, 50, "buyer", "seller");
+        db.recordPaymentTX(txPayment, true, 102, 2, 1, 70, "buyer", "seller");
+    }
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(elysium_txlist_tests, TxListTestingSetup)
+
+BOOST_AUTO_TEST_CASE(block_index)
+{
+    std::set<int> expected = {100, 102};
+    std::set<int> seedBlocks = db.GetSeedBlocks(100, 104);
+    BOOST_CHECK(seedBlocks == expected);
+    BOOST_CHECK(db.GetSeedBlocks(106, 200).empty());
+
+    BOOST_CHECK_EQUAL(db.getMPTransactionCountBlock(100), 2);
+    BOOST_CHECK_EQUAL(db.getMPTransactionCountBlock(101), 0);
+    BOOST_CHECK_EQUAL(db.getMPTransactionCountBlock(102), 2);
+    BOOST_CHECK_EQUAL(db.getMPTransactionCountTotal(), 5);
+
+    std::vector<uint256> txids = db.GetBlockTransactions(100);
+    BOOST_CHECK_EQUAL(txids.size(), 2U);
+    BOOST_CHECK(std::find(txids.begin(), txids.end(), txSend) != txids.end());
+    BOOST_CHECK(std::find(txids.begin(), txids.end(), txFreezeInvalid) != txids.end());
+    BOOST_CHECK_EQUAL(db.getNumberOfSubRecords(txPayment), 2);
+}
+
+BOOST_AUTO_TEST_CASE(type_index)
+{
+    std::vector<std::pair<int, uint256> > valid = db.GetTransactionsByType(ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS, 0, 1000, true);
+    BOOST_CHECK_EQUAL(valid.size(), 1U);
+    BOOST_CHECK_EQUAL(valid[0].first, 102);
+    BOOST_CHECK(valid[0].second == txFreeze);
+
+    std::vector<std::pair<int, uint256> > all = db.GetTransactionsByType(ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS, 0, 1000, false);
+    BOOST_CHECK_EQUAL(all.size(), 2U);
+    BOOST_CHECK(all[0].second == txFreezeInvalid);
+    BOOST_CHECK(all[1].second == txFreeze);
+
+    BOOST_CHECK(db.GetTransactionsByType(ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS, 101, 101, false).empty());
+    BOOST_CHECK_EQUAL(db.GetTransactionsByType(ELYSIUM_MESSAGE_TYPE_ALERT, 0, 1000, true).size(), 1U);
+
+    BOOST_CHECK(db.CheckForFreezeTxs(101));
+    BOOST_CHECK(!db.CheckForFreezeTxs(103));
+}
+
+BOOST_AUTO_TEST_CASE(reorg_removes_index)
+{
+    BOOST_CHECK(db.isMPinBlockRange(102, 104, false));
+    BOOST_CHECK(!db.isMPinBlockRange(103, 104, false));
+
+    BOOST_CHECK(db.isMPinBlockRange(102, 1000, true));
+
+    BOOST_CHECK(!db.exists(txFreeze));
+    BOOST_CHECK(!db.exists(txPayment));
+    BOOST_CHECK(db.exists(txSend));
+
+    std::set<int> expected = {100};
+    BOOST_CHECK(db.GetSeedBlocks(0, 1000) == expected);
+    BOOST_CHECK_EQUAL(db.getMPTransactionCountTotal(), 2);
+    BOOST_CHECK(!db.CheckForFreezeTxs(101));
+    BOOST_CHECK(db.GetTransactionsByType(ELYSIUM_MESSAGE_TYPE_ALERT, 0, 1000, true).empty());
+    BOOST_CHECK_EQUAL(db.GetTransactionsByType(ELYSIUM_TYPE_FREEZE_PROPERTY_TOKENS, 0, 1000, false).size(), 1U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
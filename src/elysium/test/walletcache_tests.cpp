@@ -0,0 +1,281 @@
+// Copyright (c) 2020 The Zcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "../elysium.h"
+#include "../tally.h"
+#include "../tx.h"
+#include "../walletcache.h"
+
+#include "../../base58.h"
+#include "../../main.h"
+#include "../../primitives/transaction.h"
+#include "../../sync.h"
+#include "../../uint256.h"
+#include "../../wallet/wallet.h"
+#include "../../wallet/walletdb.h"
+
+#include "../../wallet/test/wallet_test_fixture.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace elysium {
+
+namespace {
+
+const std::string otherAddress = "1HG3s4Ext3sTqBTHrgftyUzG3cvx5ZbPCj";
+
+struct WalletCacheTestingSetup : ::WalletTestingSetup
+{
+    CMPTxList* prevTxList;
+    std::string walletAddress;
+
+    WalletCacheTestingSetup() : prevTxList(p_txlistdb)
+    {
+        p_txlistdb = new CMPTxList(pathTemp / "MP_txlist_test", true);
+
+        {
+            LOCK2(cs_main, pwalletMain->cs_wallet);
+            walletAddress = CBitcoinAddress(pwalletMain->GenerateNewKey().GetID()).ToString();
+        }
+
+        ResetCaches();
+    }
+
+    ~WalletCacheTestingSetup()
+    {
+        ResetCaches();
+        WalletTXIDCacheShutdown();
+
+        delete p_txlistdb;
+        p_txlistdb = prevTxList;
+    }
+
+    void ResetCaches()
+    {
+        {
+            LOCK(cs_main);
+            mp_tally_map.clear();
+        }
+        WalletCacheInvalidate();
+        WalletCacheUpdate();
+        WalletTXIDCacheClear();
+    }
+
+    /** Adds a transaction to the wallet, without notifying the cache. */
+    uint256 AddWalletTx(uint32_t nLockTime)
+    {
+        CMutableTransaction mtx;
+        mtx.nLockTime = nLockTime;
+        CTransaction tx(mtx);
+
+        LOCK(pwalletMain->cs_wallet);
+        pwalletMain->mapWallet.insert(std::make_pair(tx.GetHash(), CWalletTx(pwalletMain, tx)));
+        return tx.GetHash();
+    }
+
+    std::vector<uint256> ListStoredTxs()
+    {
+        std::vector<uint256> hashes;
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        walletdb.ListElysiumTxs<uint256, std::pair<int, unsigned int> >(
+            [&hashes](const uint256& hash, const std::pair<int, unsigned int>&) {
+                hashes.push_back(hash);
+            }
+        );
+        return hashes;
+    }
+
+    bool HasIndexVersion()
+    {
+        int version = 0;
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        return walletdb.ReadElysiumTxIndexVersion(version) && version == WALLET_TX_INDEX_VERSION;
+    }
+};
+
+} // anonymous namespace
+
+BOOST_FIXTURE_TEST_SUITE(elysium_walletcache_tests, WalletCacheTestingSetup)
+
+BOOST_AUTO_TEST_CASE(wallet_cache_update_changed_addresses)
+{
+    BOOST_CHECK(update_tally_map(walletAddress, 3, 100, BALANCE));
+    BOOST_CHECK(update_tally_map(otherAddress, 3, 100, BALANCE));
+
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+    std::map<std::string, int> addresses = WalletCacheGetAddresses();
+    BOOST_CHECK_EQUAL(addresses.size(), 1);
+    BOOST_CHECK_EQUAL(addresses.count(walletAddress), 1);
+
+    // nothing changed
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 0);
+
+    // changes of non-wallet addresses don't change the cache
+    BOOST_CHECK(update_tally_map(otherAddress, 3, 50, BALANCE));
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 0);
+
+    BOOST_CHECK(update_tally_map(walletAddress, 3, -50, BALANCE));
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+
+    // tallies changed without being recorded are not checked
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(mp_tally_map[walletAddress].updateMoney(3, 25, BALANCE));
+    }
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_cache_full_update_after_invalidate)
+{
+    BOOST_CHECK(update_tally_map(walletAddress, 3, 100, BALANCE));
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+
+    // an unrecorded change is picked up by the full pass
+    {
+        LOCK(cs_main);
+        BOOST_CHECK(mp_tally_map[walletAddress].updateMoney(3, 25, BALANCE));
+    }
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 0);
+    WalletCacheInvalidate();
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+
+    // addresses no longer part of the state are removed by the full pass
+    {
+        LOCK(cs_main);
+        mp_tally_map.erase(walletAddress);
+    }
+    WalletCacheInvalidate();
+    BOOST_CHECK_EQUAL(WalletCacheUpdate(), 1);
+    BOOST_CHECK(WalletCacheGetAddresses().empty());
+}
+
+BOOST_AUTO_TEST_CASE(wallet_txid_cache_remove)
+{
+    uint256 tx100 = AddWalletTx(100);
+    uint256 tx101 = AddWalletTx(101);
+    uint256 tx102 = AddWalletTx(102);
+    uint256 txOther = uint256S("01");
+
+    WalletTXIDCacheAdd(tx100, 100);
+    WalletTXIDCacheAdd(tx101, 101);
+    WalletTXIDCacheAdd(tx102, 102);
+    WalletTXIDCacheAdd(txOther, 102);
+
+    std::map<std::string, uint256> transactions = WalletTXIDCacheGet(10, 0, 999999);
+    BOOST_CHECK_EQUAL(transactions.size(), 3);
+    BOOST_CHECK_EQUAL(ListStoredTxs().size(), 3);
+
+    // the transactions of the disconnected blocks are removed from the cache and the wallet
+    WalletTXIDCacheRemove(101);
+    transactions = WalletTXIDCacheGet(10, 0, 999999);
+    BOOST_CHECK_EQUAL(transactions.size(), 1);
+    BOOST_CHECK(transactions.begin()->second == tx100);
+
+    std::vector<uint256> stored = ListStoredTxs();
+    BOOST_CHECK_EQUAL(stored.size(), 1);
+    BOOST_CHECK(stored[0] == tx100);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_txid_cache_same_position)
+{
+    // without a transaction index, the transactions of a block can't be told apart by position
+    uint256 txFirst = AddWalletTx(200);
+    uint256 txSecond = AddWalletTx(201);
+
+    WalletTXIDCacheAdd(txFirst, 100);
+    WalletTXIDCacheAdd(txSecond, 100);
+
+    std::map<std::string, uint256> transactions = WalletTXIDCacheGet(10, 0, 999999);
+    BOOST_CHECK_EQUAL(transactions.size(), 2);
+    BOOST_CHECK_EQUAL(ListStoredTxs().size(), 2);
+
+    // moving one of them to another block leaves the other one cached
+    WalletTXIDCacheAdd(txFirst, 101);
+    transactions = WalletTXIDCacheGet(10, 0, 999999);
+    BOOST_CHECK_EQUAL(transactions.size(), 2);
+    BOOST_CHECK(transactions.begin()->second == txSecond);
+    BOOST_CHECK(transactions.rbegin()->second == txFirst);
+
+    WalletTXIDCacheRemove(101);
+    transactions = WalletTXIDCacheGet(10, 0, 999999);
+    BOOST_CHECK_EQUAL(transactions.size(), 1);
+    BOOST_CHECK(transactions.begin()->second == txSecond);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_txid_cache_high_blocks)
+{
+    uint256 tx999999 = AddWalletTx(999999);
+    uint256 tx1000000 = AddWalletTx(1000000);
+    uint256 tx1000001 = AddWalletTx(1000001);
+
+    WalletTXIDCacheAdd(tx999999, 999999);
+    WalletTXIDCacheAdd(tx1000000, 1000000);
+    WalletTXIDCacheAdd(tx1000001, 1000001);
+
+    BOOST_CHECK_EQUAL(WalletTXIDCacheGet(10, 0, 999999).size(), 1);
+    BOOST_CHECK_EQUAL(WalletTXIDCacheGet(10, 1000000, 1000000).size(), 1);
+    BOOST_CHECK_EQUAL(WalletTXIDCacheGet(10, 0, 2000000).size(), 3);
+
+    // only the transactions at or above the block are removed
+    WalletTXIDCacheRemove(1000001);
+    std::vector<uint256> stored = ListStoredTxs();
+    BOOST_CHECK_EQUAL(stored.size(), 2);
+    BOOST_CHECK(std::find(stored.begin(), stored.end(), tx1000001) == stored.end());
+
+    WalletTXIDCacheRemove(1000000);
+    std::map<std::string, uint256> transactions = WalletTXIDCacheGet(10, 0, 2000000);
+    BOOST_CHECK_EQUAL(transactions.size(), 1);
+    BOOST_CHECK(transactions.begin()->second == tx999999);
+}
+
+BOOST_AUTO_TEST_CASE(wallet_txid_cache_init)
+{
+    uint256 tx100 = AddWalletTx(100);
+    uint256 tx101 = AddWalletTx(101);
+    uint256 txUnrecorded = AddWalletTx(102);
+
+    p_txlistdb->recordTX(tx100, true, 100, ELYSIUM_TYPE_SIMPLE_SEND, 10);
+    p_txlistdb->recordTX(tx101, true, 101, ELYSIUM_TYPE_SIMPLE_SEND, 10);
+
+    // without an index, it is built from the wallet transactions
+    BOOST_CHECK(!HasIndexVersion());
+    WalletTXIDCacheInit();
+    BOOST_CHECK(HasIndexVersion());
+    BOOST_CHECK_EQUAL(WalletTXIDCacheGet(10, 0, 999999).size(), 2);
+    BOOST_CHECK_EQUAL(ListStoredTxs().size(), 2);
+
+    // with an index, only the stored transactions are validated
+    uint256 txLate = AddWalletTx(103);
+    p_txlistdb->recordTX(txLate, true, 103, ELYSIUM_TYPE_SIMPLE_SEND, 10);
+    {
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        walletdb.WriteElysiumTx(txUnrecorded, std::make_pair(102, 0u));
+    }
+
+    WalletTXIDCacheInit();
+    std::vector<uint256> stored = ListStoredTxs();
+    BOOST_CHECK_EQUAL(stored.size(), 2);
+    BOOST_CHECK(std::find(stored.begin(), stored.end(), txUnrecorded) == stored.end());
+    BOOST_CHECK(std::find(stored.begin(), stored.end(), txLate) == stored.end());
+
+    // clearing drops the index, so it is rebuilt
+    WalletTXIDCacheClear();
+    BOOST_CHECK(!HasIndexVersion());
+    BOOST_CHECK(ListStoredTxs().empty());
+    BOOST_CHECK(WalletTXIDCacheGet(10, 0, 999999).empty());
+
+    WalletTXIDCacheInit();
+    BOOST_CHECK_EQUAL(WalletTXIDCacheGet(10, 0, 999999).size(), 3);
+    BOOST_CHECK_EQUAL(ListStoredTxs().size(), 3);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+} // namespace elysium
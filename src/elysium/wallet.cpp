@@ -101,13 +101,10 @@ SigmaSpend Wallet::CreateSigmaSpend(PropertyId property, SigmaDenomination denom
     }
 
     // Get anonimity set for spend.
-    std::vector<SigmaPublicKey> anonimitySet;
-
-    sigmaDb->GetAnonimityGroup(
+    auto anonimitySet = sigmaDb->GetAnonimityGroupView(
         mint->property,
         mint->denomination,
-        mint->chainState.group,
-        std::back_inserter(anonimitySet)
+        mint->chainState.group
     );
 
     if (anonimitySet.size() < 2) {
@@ -1,5 +1,20 @@
+/**
+ * @file walletcache.cpp
+ *
+ * Caches the balances and transactions relevant to the wallet.
+ *
+ * The balance cache is updated incrementally: changes of the tally are recorded per address,
+ * and only those addresses are checked on the next update. All addresses are only checked,
+ * after the state was reloaded, or when the addresses of the wallet changed.
+ *
+ * The Elysium transactions of the wallet are stored in the wallet file, so they don't need
+ * to be searched for in all wallet transactions after every restart.
+ */
+
 #include "walletcache.h"
 
+#include "elysium.h"
+#include "fetchwallettx.h"
 #include "log.h"
 #include "tally.h"
 #include "wallettxs.h"
@@ -7,16 +22,22 @@
 #include "../init.h"
 #include "../main.h"
 #include "../sync.h"
+#include "../tinyformat.h"
 #include "../uint256.h"
 #ifdef ENABLE_WALLET
 #include "../wallet/wallet.h"
+#include "../wallet/walletdb.h"
 #endif
 
-#include <algorithm>
-#include <list>
+#include <boost/algorithm/string.hpp>
+#include <boost/signals2/connection.hpp>
+
+#include <atomic>
+#include <limits>
 #include <map>
 #include <set>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 
@@ -24,110 +45,504 @@
 
 namespace elysium {
 
-//! Global vector of Elysium transactions in the wallet
-std::vector<uint256> walletTXIDCache;
+namespace {
+
+//! Cached balances of a wallet address
+struct WalletBalance
+{
+    //! The ISMINE type of the address
+    int isMine;
+    //! The balances of the address
+    CMPTally tally;
+};
 
 //! Map of wallet balances
-static std::map<std::string, CMPTally> walletBalancesCache;
+std::map<std::string, WalletBalance> walletBalancesCache;
+
+//! Addresses, whose tally changed since the last update
+std::set<std::string> changedAddresses;
+
+//! Whether the next update has to check all addresses
+bool fFullUpdate = true;
+
+//! Whether the addresses of the wallet changed, set by wallet notifications
+std::atomic<bool> fWalletAddressesChanged(false);
+
+//! Block, position within the block and hash of a wallet transaction
+typedef std::tuple<int, unsigned int, uint256> WalletTxKey;
+
+//! Elysium transactions in the wallet, ordered by block and position within the block
+std::set<WalletTxKey> walletTXIDCache;
+
+//! Keys of the transactions in the wallet txid cache
+std::map<uint256, WalletTxKey> walletTXIDKeys;
+
+//! Guards notifiedTransactions
+CCriticalSection cs_walletNotifications;
+
+//! Transactions added to the wallet, which may have been processed already
+std::set<uint256> notifiedTransactions;
+
+//! Subscriptions to wallet notifications
+std::vector<boost::signals2::connection> walletConnections;
 
 /**
- * Adds a txid to the wallet txid cache, performing duplicate detection.
+ * Returns the key of a transaction returned by WalletTXIDCacheGet, ordered by block and position within
+ * the block. The hash is appended, so transactions with the same position don't replace each other.
  */
-void WalletTXIDCacheAdd(const uint256& hash)
+std::string GetSortKey(const WalletTxKey& key)
 {
-    if (elysium_debug_walletcache) PrintToLog("WALLETTXIDCACHE: Adding tx to txid cache : %s\n", hash.GetHex());
-    if (std::find(walletTXIDCache.begin(), walletTXIDCache.end(), hash) != walletTXIDCache.end()) {
-        PrintToLog("ERROR: Wallet TXID Cache blocked duplicate insertion for %s\n", hash.GetHex());
-    } else {
-        walletTXIDCache.push_back(hash);
+    return strprintf("%06d%010d%s", std::get<0>(key), std::get<1>(key), std::get<2>(key).GetHex());
+}
+
+/**
+ * Returns the position of a transaction within its block, used to order the transactions of a block.
+ *
+ * The byte offset from the transaction index is used, or the position recorded by Elysium, if
+ * the transaction index isn't available.
+ */
+unsigned int GetWalletTxPosition(const uint256& hash)
+{
+    unsigned int position = GetTransactionByteOffset(hash);
+    if (position == 0 && p_ElysiumTXDB != NULL) {
+        position = p_ElysiumTXDB->FetchTransactionPosition(hash);
     }
+
+    return position;
 }
 
 /**
- * Performs initial population of the wallet txid cache.
+ * Updates the cached balances of an address.
+ *
+ * @param address  The address
+ * @param tally    The current tally of the address, or NULL, if it has none
+ * @return True, if the balances of a wallet address changed
  */
-void WalletTXIDCacheInit()
+bool UpdateWalletBalance(const std::string& address, const CMPTally* tally)
 {
-    if (elysium_debug_walletcache) PrintToLog("WALLETTXIDCACHE: WalletTXIDCacheInit requested\n");
-#ifdef ENABLE_WALLET
-    LOCK2(cs_main, pwalletMain->cs_wallet);
+    int isMine = (tally != NULL) ? IsMyAddress(address) : 0;
+    std::map<std::string, WalletBalance>::iterator it = walletBalancesCache.find(address);
 
-    std::list<CAccountingEntry> acentries;
-    CWallet::TxItems txOrdered = pwalletMain->wtxOrdered;
-
-    // Iterate through the wallet, checking if each transaction is Elysium (via levelDB)
-    for (CWallet::TxItems::reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it) {
-        const CWalletTx* pwtx = it->second.first;
-        if (pwtx != NULL) {
-            // get the hash of the transaction and check leveldb to see if this is an Elysium tx, if so add to cache
-            const uint256& hash = pwtx->GetHash();
-            if (p_txlistdb->exists(hash)) {
-                walletTXIDCache.push_back(hash);
-                if (elysium_debug_walletcache) PrintToLog("WALLETTXIDCACHE: Adding tx to txid cache : %s\n", hash.GetHex());
-            }
+    if (!isMine) {
+        if (it == walletBalancesCache.end()) {
+            if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: Ignoring non-wallet address %s\n", address);
+            return false;
         }
+        walletBalancesCache.erase(it);
+        if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s removed from cache\n", address);
+        return true;
+    }
+
+    if (it == walletBalancesCache.end()) {
+        WalletBalance balance;
+        balance.isMine = isMine;
+        balance.tally = *tally;
+        walletBalancesCache.insert(std::make_pair(address, balance));
+        if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s not in cache\n", address);
+        return true;
     }
+
+    if (it->second.isMine != isMine || it->second.tally != *tally) {
+        it->second.isMine = isMine;
+        it->second.tally = *tally;
+        if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s balance differs\n", address);
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * Returns the block of a transaction recorded in the transaction list, or -1, if it isn't recorded.
+ */
+int GetRecordedBlock(const uint256& hash)
+{
+    std::string value;
+    if (p_txlistdb == NULL || !p_txlistdb->getTX(hash, value)) {
+        return -1;
+    }
+
+    std::vector<std::string> vstr;
+    boost::split(vstr, value, boost::is_any_of(":"), boost::token_compress_on);
+    if (vstr.size() < 2) {
+        return -1;
+    }
+
+    return atoi(vstr[1]);
+}
+
+/**
+ * Adds a transaction to the wallet txid cache.
+ *
+ * @return True, if the transaction was not cached yet, or its position changed
+ */
+bool InsertWalletTx(const uint256& hash, int block, unsigned int position)
+{
+    WalletTxKey key(block, position, hash);
+    std::map<uint256, WalletTxKey>::iterator it = walletTXIDKeys.find(hash);
+
+    if (it != walletTXIDKeys.end()) {
+        if (it->second == key) {
+            return false;
+        }
+        walletTXIDCache.erase(it->second);
+        it->second = key;
+    } else {
+        walletTXIDKeys.insert(std::make_pair(hash, key));
+    }
+
+    walletTXIDCache.insert(key);
+
+    return true;
+}
+
+#ifdef ENABLE_WALLET
+/**
+ * Adds a wallet transaction to the wallet txid cache, and stores it in the wallet file.
+ */
+void AddWalletTx(CWalletDB& walletdb, const uint256& hash, int block)
+{
+    unsigned int position = GetWalletTxPosition(hash);
+
+    if (InsertWalletTx(hash, block, position)) {
+        walletdb.WriteElysiumTx(hash, std::make_pair(block, position));
+        if (elysium_debug_walletcache) PrintToLog("WALLETTXIDCACHE: Adding tx to txid cache : %s\n", hash.GetHex());
+    }
+}
+
+void OnTransactionChanged(CWallet* pwallet, const uint256& hash, ChangeType status)
+{
+    if (status != CT_NEW) {
+        return;
+    }
+
+    LOCK(cs_walletNotifications);
+    notifiedTransactions.insert(hash);
+}
+
+void OnAddressesChanged()
+{
+    fWalletAddressesChanged = true;
+}
 #endif
+
+/**
+ * Adds the transactions, which were added to the wallet after they were processed.
+ */
+void ProcessNotifiedTransactions()
+{
+    AssertLockHeld(cs_main);
+
+    std::set<uint256> hashes;
+    {
+        LOCK(cs_walletNotifications);
+        hashes.swap(notifiedTransactions);
+    }
+
+    for (std::set<uint256>::const_iterator it = hashes.begin(); it != hashes.end(); ++it) {
+        int block = GetRecordedBlock(*it);
+        if (block >= 0) {
+            WalletTXIDCacheAdd(*it, block);
+        }
+    }
+}
+
+} // anonymous namespace
+
+/**
+ * Records that the tally of an address changed.
+ *
+ * Nothing needs to be recorded, while all addresses are going to be checked anyway.
+ */
+void WalletCacheRecordChange(const std::string& address)
+{
+    AssertLockHeld(cs_main);
+
+    if (!fFullUpdate) {
+        changedAddresses.insert(address);
+    }
+}
+
+/**
+ * Makes the next update check all addresses.
+ */
+void WalletCacheInvalidate()
+{
+    LOCK(cs_main);
+
+    fFullUpdate = true;
+    changedAddresses.clear();
 }
 
 /**
  * Updates the cache with the latest state, returning true if changes were made to wallet addresses (including watch only).
  *
- * Also prepares a list of addresses that were changed (for future usage).
+ * Only the addresses with changed tallies are checked, unless the state was reloaded, or
+ * the addresses of the wallet changed.
  */
 int WalletCacheUpdate()
 {
     if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: Update requested\n");
     int numChanges = 0;
-    std::set<std::string> changedAddresses;
 
     LOCK(cs_main);
 
-    for (std::unordered_map<string, CMPTally>::iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
-        const std::string& address = my_it->first;
+    ProcessNotifiedTransactions();
 
-        // determine if this address is in the wallet
-        int addressIsMine = IsMyAddress(address);
-        if (!addressIsMine) {
-            if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: Ignoring non-wallet address %s\n", address);
-            continue; // ignore this address, not in wallet
-        }
+    if (fWalletAddressesChanged.exchange(false)) {
+        fFullUpdate = true;
+    }
 
-        // obtain & init the tally
-        CMPTally& tally = my_it->second;
-        tally.init();
-
-        // check cache for miss on address
-        std::map<std::string, CMPTally>::iterator search_it = walletBalancesCache.find(address);
-        if (search_it == walletBalancesCache.end()) { // cache miss, new address
-            ++numChanges;
-            changedAddresses.insert(address);
-            walletBalancesCache.insert(std::make_pair(address,tally));
-            if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s not in cache\n", address);
-            continue;
+    if (fFullUpdate) {
+        for (std::unordered_map<std::string, CMPTally>::const_iterator my_it = mp_tally_map.begin(); my_it != mp_tally_map.end(); ++my_it) {
+            if (UpdateWalletBalance(my_it->first, &my_it->second)) ++numChanges;
         }
 
-        // check cache for miss on balance - TODO TRY AND OPTIMIZE THIS
-        CMPTally &cacheTally = search_it->second;
-        uint32_t propertyId;
-        while (0 != (propertyId = (tally.next()))) {
-            if (tally.getMoney(propertyId, BALANCE) != cacheTally.getMoney(propertyId, BALANCE) ||
-                    tally.getMoney(propertyId, PENDING) != cacheTally.getMoney(propertyId, PENDING) ||
-                    tally.getMoney(propertyId, SELLOFFER_RESERVE) != cacheTally.getMoney(propertyId, SELLOFFER_RESERVE) ||
-                    tally.getMoney(propertyId, ACCEPT_RESERVE) != cacheTally.getMoney(propertyId, ACCEPT_RESERVE) ||
-                    tally.getMoney(propertyId, METADEX_RESERVE) != cacheTally.getMoney(propertyId, METADEX_RESERVE)) { // cache miss, balance
+        // remove addresses, which are no longer part of the state
+        std::map<std::string, WalletBalance>::iterator it = walletBalancesCache.begin();
+        while (it != walletBalancesCache.end()) {
+            if (mp_tally_map.count(it->first) == 0) {
+                walletBalancesCache.erase(it++);
                 ++numChanges;
-                changedAddresses.insert(address);
-                walletBalancesCache.erase(search_it);
-                walletBalancesCache.insert(std::make_pair(address,tally));
-                if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: *CACHE MISS* - %s balance for property %d differs\n", address, propertyId);
-                break;
+            } else {
+                ++it;
             }
         }
+
+        fFullUpdate = false;
+    } else {
+        for (std::set<std::string>::const_iterator it = changedAddresses.begin(); it != changedAddresses.end(); ++it) {
+            std::unordered_map<std::string, CMPTally>::const_iterator my_it = mp_tally_map.find(*it);
+            const CMPTally* tally = (my_it != mp_tally_map.end()) ? &my_it->second : NULL;
+            if (UpdateWalletBalance(*it, tally)) ++numChanges;
+        }
     }
+
+    changedAddresses.clear();
+
     if (elysium_debug_walletcache) PrintToLog("WALLETCACHE: Update finished - there were %d changes\n", numChanges);
     return numChanges;
 }
 
+/**
+ * Returns the wallet addresses with balance records, along with their ISMINE type.
+ */
+std::map<std::string, int> WalletCacheGetAddresses()
+{
+    std::map<std::string, int> addresses;
+
+    LOCK(cs_main);
+
+    for (std::map<std::string, WalletBalance>::const_iterator it = walletBalancesCache.begin(); it != walletBalancesCache.end(); ++it) {
+        addresses.insert(std::make_pair(it->first, it->second.isMine));
+    }
+
+    return addresses;
+}
+
+/**
+ * Adds a txid to the wallet txid cache, if the transaction belongs to the wallet.
+ *
+ * @param hash   The hash of the transaction
+ * @param block  The block the transaction was recorded in
+ */
+void WalletTXIDCacheAdd(const uint256& hash, int block)
+{
+#ifdef ENABLE_WALLET
+    if (pwalletMain == NULL) {
+        return;
+    }
+
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+
+    if (pwalletMain->mapWallet.count(hash) == 0) {
+        return;
+    }
+
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+    AddWalletTx(walletdb, hash, block);
+#endif
+}
+
+/**
+ * Removes all transactions at or above the given block from the wallet txid cache.
+ *
+ * Called when the transactions of these blocks are removed from the transaction list.
+ */
+void WalletTXIDCacheRemove(int block)
+{
+    LOCK(cs_main);
+
+    std::set<WalletTxKey>::iterator first = walletTXIDCache.lower_bound(WalletTxKey(block, 0, uint256()));
+    if (first == walletTXIDCache.end()) {
+        return;
+    }
+
+#ifdef ENABLE_WALLET
+    if (pwalletMain != NULL) {
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        for (std::set<WalletTxKey>::const_iterator it = first; it != walletTXIDCache.end(); ++it) {
+            walletdb.EraseElysiumTx(std::get<2>(*it));
+        }
+    }
+#endif
+
+    for (std::set<WalletTxKey>::const_iterator it = first; it != walletTXIDCache.end(); ++it) {
+        walletTXIDKeys.erase(std::get<2>(*it));
+    }
+    walletTXIDCache.erase(first, walletTXIDCache.end());
+}
+
+/**
+ * Removes all transactions from the wallet txid cache and the wallet file.
+ *
+ * Called when the state is cleared. The index version is erased as well, so that the index
+ * is rebuilt from the wallet, if it isn't completed by reprocessing the transactions.
+ */
+void WalletTXIDCacheClear()
+{
+    LOCK(cs_main);
+
+#ifdef ENABLE_WALLET
+    if (pwalletMain != NULL) {
+        LOCK(pwalletMain->cs_wallet);
+
+        CWalletDB walletdb(pwalletMain->strWalletFile);
+        std::vector<uint256> hashes;
+        walletdb.ListElysiumTxs<uint256, std::pair<int, unsigned int> >(
+            [&hashes](const uint256& hash, const std::pair<int, unsigned int>&) {
+                hashes.push_back(hash);
+            }
+        );
+
+        for (size_t i = 0; i < hashes.size(); ++i) {
+            walletdb.EraseElysiumTx(hashes[i]);
+        }
+        walletdb.EraseElysiumTxIndexVersion();
+    }
+#endif
+
+    walletTXIDCache.clear();
+    walletTXIDKeys.clear();
+
+    {
+        LOCK(cs_walletNotifications);
+        notifiedTransactions.clear();
+    }
+}
+
+/**
+ * Loads the wallet txid cache from the wallet file, and subscribes to wallet changes.
+ *
+ * Stored transactions, which are no longer recorded, e.g. after a reorganization, are
+ * dropped. If the wallet has no index yet, all wallet transactions are checked once.
+ */
+void WalletTXIDCacheInit()
+{
+    if (elysium_debug_walletcache) PrintToLog("WALLETTXIDCACHE: WalletTXIDCacheInit requested\n");
+#ifdef ENABLE_WALLET
+    if (pwalletMain == NULL) {
+        return;
+    }
+
+    LOCK2(cs_main, pwalletMain->cs_wallet);
+
+    CWalletDB walletdb(pwalletMain->strWalletFile);
+    int version = 0;
+
+    if (walletdb.ReadElysiumTxIndexVersion(version) && version == WALLET_TX_INDEX_VERSION) {
+        std::vector<std::pair<uint256, std::pair<int, unsigned int> > > entries;
+        walletdb.ListElysiumTxs<uint256, std::pair<int, unsigned int> >(
+            [&entries](const uint256& hash, const std::pair<int, unsigned int>& position) {
+                entries.push_back(std::make_pair(hash, position));
+            }
+        );
+
+        for (size_t i = 0; i < entries.size(); ++i) {
+            const uint256& hash = entries[i].first;
+            int block = GetRecordedBlock(hash);
+            if (block < 0) {
+                walletdb.EraseElysiumTx(hash);
+            } else if (block != entries[i].second.first) {
+                AddWalletTx(walletdb, hash, block);
+            } else {
+                InsertWalletTx(hash, block, entries[i].second.second);
+            }
+        }
+    } else {
+        PrintToLog("Building index of Elysium wallet transactions\n");
+
+        for (std::map<uint256, CWalletTx>::const_iterator it = pwalletMain->mapWallet.begin(); it != pwalletMain->mapWallet.end(); ++it) {
+            int block = GetRecordedBlock(it->first);
+            if (block >= 0) {
+                AddWalletTx(walletdb, it->first, block);
+            }
+        }
+
+        walletdb.WriteElysiumTxIndexVersion(WALLET_TX_INDEX_VERSION);
+    }
+
+    PrintToLog("Loaded %d Elysium wallet transactions\n", walletTXIDCache.size());
+
+    if (walletConnections.empty()) {
+        walletConnections.push_back(pwalletMain->NotifyTransactionChanged.connect(
+            [](CWallet* pwallet, const uint256& hash, ChangeType status) {
+                OnTransactionChanged(pwallet, hash, status);
+            }
+        ));
+        walletConnections.push_back(pwalletMain->NotifyAddressBookChanged.connect(
+            [](CWallet*, const CTxDestination&, const std::string&, bool, const std::string&, ChangeType) {
+                OnAddressesChanged();
+            }
+        ));
+        walletConnections.push_back(pwalletMain->NotifyWatchonlyChanged.connect(
+            [](bool) {
+                OnAddressesChanged();
+            }
+        ));
+    }
+#endif
+}
+
+/**
+ * Unsubscribes from wallet changes, before the wallet is closed.
+ */
+void WalletTXIDCacheShutdown()
+{
+    for (size_t i = 0; i < walletConnections.size(); ++i) {
+        walletConnections[i].disconnect();
+    }
+    walletConnections.clear();
+}
+
+/**
+ * Returns the latest cached wallet transactions within a block range.
+ *
+ * @param count       The maximal number of transactions
+ * @param startBlock  The first block (inclusive)
+ * @param endBlock    The last block (inclusive)
+ * @return The transactions, keyed by block and position within the block
+ */
+std::map<std::string, uint256> WalletTXIDCacheGet(unsigned int count, int startBlock, int endBlock)
+{
+    std::map<std::string, uint256> transactions;
+
+    LOCK(cs_main);
+
+    ProcessNotifiedTransactions();
+
+    std::set<WalletTxKey>::const_iterator first = walletTXIDCache.lower_bound(WalletTxKey(startBlock, 0, uint256()));
+    std::set<WalletTxKey>::const_iterator it = walletTXIDCache.end();
+    if (endBlock < std::numeric_limits<int>::max()) {
+        it = walletTXIDCache.lower_bound(WalletTxKey(endBlock + 1, 0, uint256()));
+    }
+
+    while (it != first && transactions.size() < count) {
+        --it;
+        transactions.insert(std::make_pair(GetSortKey(*it), std::get<2>(*it)));
+    }
+
+    return transactions;
+}
 
 } // namespace elysium
@@ -3,21 +3,43 @@
 
 class uint256;
 
-#include <vector>
+#include <map>
+#include <string>
 
 namespace elysium
 {
-//! Global vector of Elysium transactions in the wallet
-extern std::vector<uint256> walletTXIDCache;
+//! Version of the wallet's index of Elysium transactions, the index is rebuilt when it changes
+static const int WALLET_TX_INDEX_VERSION = 2;
 
-/** Adds a txid to the wallet txid cache, performing duplicate detection */
-void WalletTXIDCacheAdd(const uint256& hash);
+/** Records that the tally of an address changed, so that the next update checks it */
+void WalletCacheRecordChange(const std::string& address);
 
-/** Performs initial population of the wallet txid cache */
-void WalletTXIDCacheInit();
+/** Makes the next update check all addresses, because the state or the wallet's addresses changed */
+void WalletCacheInvalidate();
 
 /** Updates the cache and returns whether any wallet addresses were changed */
 int WalletCacheUpdate();
+
+/** Returns the wallet addresses with balance records, along with their ISMINE type */
+std::map<std::string, int> WalletCacheGetAddresses();
+
+/** Adds a txid to the wallet txid cache, if the transaction belongs to the wallet */
+void WalletTXIDCacheAdd(const uint256& hash, int block);
+
+/** Removes all transactions at or above the given block from the wallet txid cache */
+void WalletTXIDCacheRemove(int block);
+
+/** Removes all transactions and the index version from the wallet txid cache, so that the index is rebuilt */
+void WalletTXIDCacheClear();
+
+/** Loads the wallet txid cache, and subscribes to wallet changes */
+void WalletTXIDCacheInit();
+
+/** Unsubscribes from wallet changes */
+void WalletTXIDCacheShutdown();
+
+/** Returns the cached wallet transactions within a block range, ordered by block and position */
+std::map<std::string, uint256> WalletTXIDCacheGet(unsigned int count, int startBlock, int endBlock);
 }
 
 #endif // ELYSIUM_WALLETCACHE_H
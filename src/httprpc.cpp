@@ -7,7 +7,7 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "httpserver.h"
-#include "mbstring.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
 #include "random.h"
@@ -20,6 +20,7 @@
 #include "utilstrencodings.h"
 
 #include <boost/algorithm/string.hpp> // boost::trim
+#include <boost/bind.hpp>
 #include <boost/foreach.hpp> //BOOST_FOREACH
 
 /** Sanitize UTF-8 encoded strings in RPC responses */
@@ -65,6 +66,45 @@ private:
 };
 
 
+/** Largest request body that is inspected to select the work class, larger ones use the default class */
+static const size_t MAX_CLASSIFIED_BODY_SIZE = 64 * 1024;
+
+/**
+ * Work class of RPC methods unless changed by -rpcmethodclass. Cheap calls get their own threads so
+ * they are never queued behind slow ones, and slow calls can't occupy all the default threads.
+ */
+static const char* const DEFAULT_RPC_METHOD_CLASSES[][2] = {
+    { "getblockcount",         "fast" },
+    { "getbestblockhash",      "fast" },
+    { "getblockhash",          "fast" },
+    { "getblockheader",        "fast" },
+    { "getchainsummary",       "fast" },
+    { "getconnectioncount",    "fast" },
+    { "getdifficulty",         "fast" },
+    { "getmempoolinfo",        "fast" },
+    { "getnetworkinfo",        "fast" },
+    { "getrpcstats",           "fast" },
+    { "gettxout",              "fast" },
+    { "ping",                  "fast" },
+    { "sendrawtransaction",    "fast" },
+    { "validateaddress",       "fast" },
+    { "elysium_*",             "slow" },
+    { "getaddressbalance",     "slow" },
+    { "getaddressdeltas",      "slow" },
+    { "getaddresstxids",       "slow" },
+    { "getaddressutxos",       "slow" },
+    { "gettxoutsetinfo",       "slow" },
+    { "getzerocoinsupply",     "slow" },
+    { "listsigmamints",        "slow" },
+    { "listsigmapubcoins",     "slow" },
+    { "listsigmaspends",       "slow" },
+    { "listunspentsigmamints", "slow" },
+    { "verifychain",           "slow" },
+};
+
+/** Method name, or prefix if it ends with '*', to work class */
+static std::map<std::string, std::string> mapRPCMethodClass;
+
 /* Pre-base64-encoded authentication token */
 static std::string strRPCUserColonPass;
 /* Stored RPC timer interface (for unregistration) */
@@ -87,6 +127,14 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     req->WriteReply(nStatus, strReply);
 }
 
+/** Sink of the JSON writer, sends the reply as it is produced */
+static void WriteJSONReplyChunk(HTTPRequest* req, const std::string& strChunk)
+{
+    if (!req->IsReplyStarted())
+        req->WriteHeader("Content-Type", "application/json");
+    req->WriteReplyChunk(strChunk);
+}
+
 //This function checks username and password against -rpcauth
 //entries from config file.
 static bool multiUserAuthorized(std::string strUserPass)
@@ -177,37 +225,49 @@ static bool HTTPReq_JSONRPC(HTTPRequest* req, const std::string &)
     }
 
     JSONRequest jreq;
+    CJSONWriter writer(boost::bind(&WriteJSONReplyChunk, req, _1), fSanitizeResponse);
     try {
         // Parse request
         UniValue valRequest;
         if (!valRequest.read(req->ReadBody()))
             throw JSONRPCError(RPC_PARSE_ERROR, "Parse error");
 
-        std::string strReply;
         // singleton request
         if (valRequest.isObject()) {
             jreq.parse(valRequest);
 
-            UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-
-            // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
-            if (fSanitizeResponse) {
-                strReply = SanitizeInvalidUTF8(strReply);
-            }
+            writer.BeginObject();
+            writer.Key("result");
+            tableRPC.execute(jreq.strMethod, jreq.params, writer);
+            writer.Pair("error", NullUniValue);
+            writer.Pair("id", jreq.id);
+            writer.EndObject();
 
         // array of requests
         } else if (valRequest.isArray())
-            strReply = JSONRPCExecBatch(valRequest.get_array());
+            JSONRPCExecBatch(valRequest.get_array(), writer);
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        // Small replies are sent at once, large ones finish their chunked reply
+        std::string strRest = writer.Finish();
+        if (!req->IsReplyStarted())
+            req->WriteHeader("Content-Type", "application/json");
+        req->EndChunkedReply(strRest);
     } catch (const UniValue& objError) {
+        if (req->IsReplyStarted()) {
+            LogPrintf("%s: %s failed after part of the reply was sent: %s\n", __func__, jreq.strMethod, find_value(objError, "message").getValStr());
+            req->AbortChunkedReply();
+            return false;
+        }
         JSONErrorReply(req, objError, jreq.id);
         return false;
     } catch (const std::exception& e) {
+        if (req->IsReplyStarted()) {
+            LogPrintf("%s: %s failed after part of the reply was sent: %s\n", __func__, jreq.strMethod, e.what());
+            req->AbortChunkedReply();
+            return false;
+        }
         JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
         return false;
     }
@@ -232,6 +292,77 @@ static bool InitRPCAuthentication()
     return true;
 }
 
+static bool InitRPCMethodClasses()
+{
+    mapRPCMethodClass.clear();
+    for (size_t i = 0; i < sizeof(DEFAULT_RPC_METHOD_CLASSES) / sizeof(DEFAULT_RPC_METHOD_CLASSES[0]); i++)
+        mapRPCMethodClass[DEFAULT_RPC_METHOD_CLASSES[i][0]] = DEFAULT_RPC_METHOD_CLASSES[i][1];
+
+    // -rpcmethodclass=<method>:<class>
+    if (mapMultiArgs.count("-rpcmethodclass")) {
+        BOOST_FOREACH(const std::string& strMethodClass, mapMultiArgs["-rpcmethodclass"]) {
+            size_t nColon = strMethodClass.find(':');
+            if (nColon == 0 || nColon == std::string::npos || nColon + 1 == strMethodClass.size()) {
+                LogPrintf("Invalid -rpcmethodclass=%s, expected <method>:<class>\n", strMethodClass);
+                return false;
+            }
+            mapRPCMethodClass[strMethodClass.substr(0, nColon)] = strMethodClass.substr(nColon + 1);
+        }
+    }
+    return true;
+}
+
+static std::string GetRPCMethodClass(const std::string& strMethod)
+{
+    std::map<std::string, std::string>::const_iterator it = mapRPCMethodClass.find(strMethod);
+    if (it != mapRPCMethodClass.end())
+        return it->second;
+
+    // Longest matching prefix
+    std::string strClass = HTTP_DEFAULT_WORK_CLASS;
+    size_t nPrefixLength = 0;
+    for (it = mapRPCMethodClass.begin(); it != mapRPCMethodClass.end(); ++it) {
+        const std::string& strPattern = it->first;
+        if (strPattern[strPattern.size() - 1] != '*' || strPattern.size() - 1 < nPrefixLength)
+            continue;
+        if (strMethod.compare(0, strPattern.size() - 1, strPattern, 0, strPattern.size() - 1) == 0) {
+            strClass = it->second;
+            nPrefixLength = strPattern.size() - 1;
+        }
+    }
+    return strClass;
+}
+
+/**
+ * Select the work class of a JSON-RPC request from the "method" members of the body. This runs on
+ * the event loop thread, so the body is scanned rather than parsed, a false match only affects
+ * which threads serve the request. Batches of methods from different classes use the default class.
+ */
+static std::string HTTPReq_JSONRPC_Class(HTTPRequest* req, const std::string&)
+{
+    std::string strBody = req->PeekBody(MAX_CLASSIFIED_BODY_SIZE);
+    std::string strClass;
+    size_t nPos = 0;
+    while ((nPos = strBody.find("\"method\"", nPos)) != std::string::npos) {
+        nPos += 8;
+        size_t nStart = strBody.find_first_not_of(" \t\r\n", nPos);
+        if (nStart == std::string::npos || strBody[nStart] != ':')
+            continue;
+        nStart = strBody.find_first_not_of(" \t\r\n", nStart + 1);
+        if (nStart == std::string::npos || strBody[nStart] != '"')
+            continue;
+        size_t nEnd = strBody.find('"', nStart + 1);
+        if (nEnd == std::string::npos)
+            break;
+        std::string strMethodClass = GetRPCMethodClass(strBody.substr(nStart + 1, nEnd - nStart - 1));
+        if (!strClass.empty() && strClass != strMethodClass)
+            return HTTP_DEFAULT_WORK_CLASS;
+        strClass = strMethodClass;
+        nPos = nEnd + 1;
+    }
+    return strClass.empty() ? HTTP_DEFAULT_WORK_CLASS : strClass;
+}
+
 bool StartHTTPRPC()
 {
     LogPrint("rpc", "Starting HTTP RPC server\n");
@@ -241,7 +372,10 @@ bool StartHTTPRPC()
     // Sanitize non-UTF8 compliant RPC responses
     fSanitizeResponse = GetBoolArg("-rpcforceutf8", true);
 
-    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC);
+    if (!InitRPCMethodClasses())
+        return false;
+
+    RegisterHTTPHandler("/", true, HTTPReq_JSONRPC, HTTPReq_JSONRPC_Class);
 
     assert(EventBase());
     httpRPCTimerInterface = new HTTPRPCTimerInterface(EventBase());
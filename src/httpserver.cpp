@@ -7,11 +7,14 @@
 #include "chainparamsbase.h"
 #include "compat.h"
 #include "util.h"
+#include "utilstrencodings.h"
+#include "utiltime.h"
 #include "netbase.h"
 #include "rpc/protocol.h" // For HTTP status codes
 #include "sync.h"
 #include "ui_interface.h"
 
+#include <algorithm>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,12 +37,16 @@
 #endif
 #endif
 
+#include <boost/algorithm/string.hpp>
 #include <boost/algorithm/string/case_conv.hpp> // for to_lower()
 #include <boost/foreach.hpp>
 
 /** Maximum size of http request (request line + headers) */
 static const size_t MAX_HEADERS_SIZE = 8192;
 
+/** Maximum number of bytes of a chunked reply buffered for the client before the worker waits */
+static const size_t HTTP_CHUNKED_REPLY_MAX_PENDING = 1024 * 1024;
+
 /** HTTP request work item */
 class HTTPWorkItem : public HTTPClosure
 {
@@ -67,13 +74,22 @@ template <typename WorkItem>
 class WorkQueue
 {
 private:
+    struct Entry {
+        std::unique_ptr<WorkItem> item;
+        int64_t nEnqueuedMicros;
+    };
+
     /** Mutex protects entire object */
     CWaitableCriticalSection cs;
     CConditionVariable cond;
-    std::deque<std::unique_ptr<WorkItem>> queue;
+    std::deque<Entry> queue;
     bool running;
     size_t maxDepth;
     int numThreads;
+    int numBusy;
+    uint64_t numProcessed;
+    uint64_t numRejected;
+    int64_t waitMicros;
 
     /** RAII object to keep track of number of running worker threads */
     class ThreadCounter
@@ -96,7 +112,11 @@ private:
 public:
     WorkQueue(size_t maxDepth) : running(true),
                                  maxDepth(maxDepth),
-                                 numThreads(0)
+                                 numThreads(0),
+                                 numBusy(0),
+                                 numProcessed(0),
+                                 numRejected(0),
+                                 waitMicros(0)
     {
     }
     /** Precondition: worker threads have all stopped
@@ -110,9 +130,13 @@ public:
     {
         boost::unique_lock<boost::mutex> lock(cs);
         if (queue.size() >= maxDepth) {
+            numRejected++;
             return false;
         }
-        queue.emplace_back(std::unique_ptr<WorkItem>(item));
+        Entry entry;
+        entry.item.reset(item);
+        entry.nEnqueuedMicros = GetTimeMicros();
+        queue.push_back(std::move(entry));
         cond.notify_one();
         return true;
     }
@@ -128,10 +152,17 @@ public:
                     cond.wait(lock);
                 if (!running)
                     break;
-                i = std::move(queue.front());
+                i = std::move(queue.front().item);
+                waitMicros += GetTimeMicros() - queue.front().nEnqueuedMicros;
                 queue.pop_front();
+                numBusy++;
             }
             (*i)();
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                numBusy--;
+                numProcessed++;
+            }
         }
     }
     /** Interrupt and exit loops */
@@ -155,18 +186,37 @@ public:
         boost::unique_lock<boost::mutex> lock(cs);
         return queue.size();
     }
+
+    void GetStats(HTTPWorkQueueStats& stats)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        stats.threads = numThreads;
+        stats.busy = numBusy;
+        stats.depth = queue.size();
+        stats.maxDepth = maxDepth;
+        stats.processed = numProcessed;
+        stats.rejected = numRejected;
+        stats.waitMicros = waitMicros;
+    }
 };
 
 struct HTTPPathHandler
 {
     HTTPPathHandler() {}
-    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler):
-        prefix(prefix), exactMatch(exactMatch), handler(handler)
+    HTTPPathHandler(std::string prefix, bool exactMatch, HTTPRequestHandler handler, HTTPRequestClassifier classifier):
+        prefix(prefix), exactMatch(exactMatch), handler(handler), classifier(classifier)
     {
     }
     std::string prefix;
     bool exactMatch;
     HTTPRequestHandler handler;
+    HTTPRequestClassifier classifier;
+};
+
+/** Work queue and worker threads serving one class of requests */
+struct HTTPWorkClass : public HTTPWorkClassConfig
+{
+    WorkQueue<HTTPClosure>* queue;
 };
 
 /** HTTP module state */
@@ -177,8 +227,8 @@ static struct event_base* eventBase = 0;
 struct evhttp* eventHTTP = 0;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
-//! Work queue for handling longer requests off the event loop thread
-static WorkQueue<HTTPClosure>* workQueue = 0;
+//! Work queues for handling longer requests off the event loop thread, the first one is the default class
+static std::vector<HTTPWorkClass> workClasses;
 //! Handlers for (sub)paths
 std::vector<HTTPPathHandler> pathHandlers;
 //! Bound listening sockets
@@ -242,6 +292,89 @@ static std::string RequestMethodString(HTTPRequest::RequestMethod m)
     }
 }
 
+/** Work class by name, NULL if there is no such class */
+static HTTPWorkClass* FindWorkClass(const std::string& name)
+{
+    BOOST_FOREACH(HTTPWorkClass& workClass, workClasses)
+        if (workClass.name == name)
+            return &workClass;
+    return NULL;
+}
+
+bool ParseHTTPWorkClasses(const std::vector<std::string>& vArgs, std::vector<HTTPWorkClassConfig>& vClasses)
+{
+    std::vector<HTTPWorkClassConfig> vParsed;
+
+    HTTPWorkClassConfig defaultClass;
+    defaultClass.name = HTTP_DEFAULT_WORK_CLASS;
+    defaultClass.threads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
+    defaultClass.maxDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
+    vParsed.push_back(defaultClass);
+
+    HTTPWorkClassConfig fastClass;
+    fastClass.name = "fast";
+    fastClass.threads = DEFAULT_HTTP_FAST_THREADS;
+    fastClass.maxDepth = DEFAULT_HTTP_FAST_WORKQUEUE;
+    vParsed.push_back(fastClass);
+
+    HTTPWorkClassConfig slowClass;
+    slowClass.name = "slow";
+    slowClass.threads = DEFAULT_HTTP_SLOW_THREADS;
+    slowClass.maxDepth = DEFAULT_HTTP_SLOW_WORKQUEUE;
+    vParsed.push_back(slowClass);
+
+    // <class>:<threads>:<depth> adds a class or resizes an existing one
+    BOOST_FOREACH(const std::string& strClass, vArgs) {
+        std::vector<std::string> vParts;
+        boost::split(vParts, strClass, boost::is_any_of(":"));
+        int nThreads, nDepth;
+        if (vParts.size() != 3 || vParts[0].empty() || vParts[0] == HTTP_DEFAULT_WORK_CLASS ||
+                !ParseInt32(vParts[1], &nThreads) || !ParseInt32(vParts[2], &nDepth) || nThreads < 0 || nDepth < 1) {
+            LogPrintf("Invalid -rpcworkclass=%s, expected <class>:<threads>:<depth>\n", strClass);
+            return false;
+        }
+        std::vector<HTTPWorkClassConfig>::iterator it = vParsed.begin();
+        while (it != vParsed.end() && it->name != vParts[0])
+            ++it;
+        if (it == vParsed.end()) {
+            vParsed.push_back(HTTPWorkClassConfig());
+            it = vParsed.end() - 1;
+            it->name = vParts[0];
+        }
+        it->threads = nThreads;
+        it->maxDepth = nDepth;
+    }
+
+    // Classes without threads are served by the default class
+    for (std::vector<HTTPWorkClassConfig>::iterator it = vParsed.begin() + 1; it != vParsed.end();) {
+        if (it->threads == 0)
+            it = vParsed.erase(it);
+        else
+            ++it;
+    }
+
+    vClasses.swap(vParsed);
+    return true;
+}
+
+/** Set up the work classes and their queues, nothing is set up if the configuration is invalid */
+static bool InitHTTPWorkClasses()
+{
+    std::vector<HTTPWorkClassConfig> vConfig;
+    if (!ParseHTTPWorkClasses(mapMultiArgs.count("-rpcworkclass") ? mapMultiArgs["-rpcworkclass"] : std::vector<std::string>(), vConfig))
+        return false;
+
+    workClasses.clear();
+    BOOST_FOREACH(const HTTPWorkClassConfig& config, vConfig) {
+        HTTPWorkClass workClass;
+        static_cast<HTTPWorkClassConfig&>(workClass) = config;
+        LogPrintf("HTTP: creating %s work queue of depth %d\n", workClass.name, workClass.maxDepth);
+        workClass.queue = new WorkQueue<HTTPClosure>(workClass.maxDepth);
+        workClasses.push_back(workClass);
+    }
+    return true;
+}
+
 /** HTTP request callback */
 static void http_request_cb(struct evhttp_request* req, void* arg)
 {
@@ -281,12 +414,16 @@ static void http_request_cb(struct evhttp_request* req, void* arg)
 
     // Dispatch to worker thread
     if (i != iend) {
+        HTTPWorkClass* workClass = i->classifier ? FindWorkClass(i->classifier(hreq.get(), path)) : NULL;
+        if (!workClass)
+            workClass = &workClasses.front();
         std::unique_ptr<HTTPWorkItem> item(new HTTPWorkItem(std::move(hreq), path, i->handler));
-        assert(workQueue);
-        if (workQueue->Enqueue(item.get()))
+        assert(workClass->queue);
+        if (workClass->queue->Enqueue(item.get()))
             item.release(); /* if true, queue took ownership */
         else {
-            LogPrintf("WARNING: request rejected because http work queue depth exceeded, it can be increased with the -rpcworkqueue= setting\n");
+            LogPrintf("WARNING: request rejected because the %s http work queue depth exceeded, it can be increased with the %s setting\n",
+                      workClass->name, workClass->name == HTTP_DEFAULT_WORK_CLASS ? "-rpcworkqueue=" : "-rpcworkclass=");
             item->req->WriteReply(HTTP_INTERNAL, "Work queue depth exceeded");
         }
     } else {
@@ -427,11 +564,13 @@ bool InitHTTPServer()
         return false;
     }
 
-    LogPrint("http", "Initialized HTTP server\n");
-    int workQueueDepth = std::max((long)GetArg("-rpcworkqueue", DEFAULT_HTTP_WORKQUEUE), 1L);
-    LogPrintf("HTTP: creating work queue of depth %d\n", workQueueDepth);
+    if (!InitHTTPWorkClasses()) {
+        evhttp_free(http);
+        event_base_free(base);
+        return false;
+    }
 
-    workQueue = new WorkQueue<HTTPClosure>(workQueueDepth);
+    LogPrint("http", "Initialized HTTP server\n");
     eventBase = base;
     eventHTTP = http;
     return true;
@@ -442,12 +581,13 @@ boost::thread threadHTTP;
 bool StartHTTPServer()
 {
     LogPrint("http", "Starting HTTP server\n");
-    int rpcThreads = std::max((long)GetArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintf("HTTP: starting %d worker threads\n", rpcThreads);
     threadHTTP = boost::thread(boost::bind(&ThreadHTTP, eventBase, eventHTTP));
 
-    for (int i = 0; i < rpcThreads; i++)
-        boost::thread(boost::bind(&HTTPWorkQueueRun, workQueue));
+    BOOST_FOREACH(const HTTPWorkClass& workClass, workClasses) {
+        LogPrintf("HTTP: starting %d %s worker threads\n", workClass.threads, workClass.name);
+        for (int i = 0; i < workClass.threads; i++)
+            boost::thread(boost::bind(&HTTPWorkQueueRun, workClass.queue));
+    }
     return true;
 }
 
@@ -462,17 +602,23 @@ void InterruptHTTPServer()
         // Reject requests on current connections
         evhttp_set_gencb(eventHTTP, http_reject_request_cb, NULL);
     }
-    if (workQueue)
-        workQueue->Interrupt();
+    BOOST_FOREACH(const HTTPWorkClass& workClass, workClasses)
+        if (workClass.queue)
+            workClass.queue->Interrupt();
 }
 
 void StopHTTPServer()
 {
     LogPrint("http", "Stopping HTTP server\n");
-    if (workQueue) {
+    if (!workClasses.empty()) {
         LogPrint("http", "Waiting for HTTP worker threads to exit\n");
-        workQueue->WaitExit();
-        delete workQueue;
+        BOOST_FOREACH(const HTTPWorkClass& workClass, workClasses) {
+            if (!workClass.queue)
+                continue;
+            workClass.queue->WaitExit();
+            delete workClass.queue;
+        }
+        workClasses.clear();
     }
     if (eventBase) {
         LogPrint("http", "Waiting for HTTP event thread to exit\n");
@@ -503,6 +649,20 @@ void StopHTTPServer()
     LogPrint("http", "Stopped HTTP server\n");
 }
 
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats()
+{
+    std::vector<HTTPWorkQueueStats> vStats;
+    BOOST_FOREACH(const HTTPWorkClass& workClass, workClasses) {
+        if (!workClass.queue)
+            continue;
+        HTTPWorkQueueStats stats;
+        stats.name = workClass.name;
+        workClass.queue->GetStats(stats);
+        vStats.push_back(stats);
+    }
+    return vStats;
+}
+
 struct event_base* EventBase()
 {
     return eventBase;
@@ -534,13 +694,119 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+/** Chunked reply in progress. The request is only accessed from the main http thread,
+ * the amount of buffered output is shared with the worker producing the reply.
+ */
+struct HTTPChunkedReply
+{
+    struct evhttp_request* req;
+    //! Bytes handed to the connection since its output buffer last drained (http thread only)
+    size_t nSubmitted;
+
+    CWaitableCriticalSection cs;
+    CConditionVariable cond;
+    //! The connection was closed and req freed by libevent
+    bool fClosed;
+    //! Bytes queued by the worker, but not yet written to the socket
+    size_t nPending;
+
+    HTTPChunkedReply(struct evhttp_request* reqIn) : req(reqIn), nSubmitted(0), fClosed(false), nPending(0) {}
+
+    void Release(size_t nBytes)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        nPending -= std::min(nPending, nBytes);
+        cond.notify_all();
+    }
+};
+
+static void http_chunked_reply_closed_cb(struct evhttp_connection* evcon, void* arg)
+{
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    boost::unique_lock<boost::mutex> lock(reply->cs);
+    reply->fClosed = true;
+    reply->cond.notify_all();
+}
+
+static bool http_chunked_reply_is_closed(HTTPChunkedReply* reply)
+{
+    boost::unique_lock<boost::mutex> lock(reply->cs);
+    return reply->fClosed;
+}
+
+static void http_chunked_reply_start(HTTPChunkedReply* reply)
+{
+    struct evhttp_connection* evcon = evhttp_request_get_connection(reply->req);
+    if (evcon)
+        evhttp_connection_set_closecb(evcon, http_chunked_reply_closed_cb, reply);
+    evhttp_send_reply_start(reply->req, HTTP_OK, NULL);
+}
+
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+static void http_chunked_reply_drained_cb(struct evhttp_connection* evcon, void* arg)
+{
+    // Called once the output buffer of the connection is empty, which covers all chunks sent so far
+    HTTPChunkedReply* reply = (HTTPChunkedReply*)arg;
+    reply->Release(reply->nSubmitted);
+    reply->nSubmitted = 0;
+}
+#endif
+
+static void http_chunked_reply_chunk(HTTPChunkedReply* reply, struct evbuffer* evb)
+{
+    size_t nSize = evbuffer_get_length(evb);
+    if (http_chunked_reply_is_closed(reply)) {
+        reply->Release(nSize);
+    } else {
+#if LIBEVENT_VERSION_NUMBER >= 0x02010100
+        reply->nSubmitted += nSize;
+        evhttp_send_reply_chunk_with_cb(reply->req, evb, http_chunked_reply_drained_cb, reply);
+#else
+        // Without a drain notification only the chunks waiting for the http thread are limited
+        evhttp_send_reply_chunk(reply->req, evb);
+        reply->Release(nSize);
+#endif
+    }
+    evbuffer_free(evb);
+}
+
+static void http_chunked_reply_end(HTTPChunkedReply* reply)
+{
+    if (!http_chunked_reply_is_closed(reply)) {
+        struct evhttp_connection* evcon = evhttp_request_get_connection(reply->req);
+        if (evcon)
+            evhttp_connection_set_closecb(evcon, NULL, NULL);
+        evhttp_send_reply_end(reply->req);
+    }
+    delete reply;
+}
+
+static void http_chunked_reply_abort(HTTPChunkedReply* reply)
+{
+    if (!http_chunked_reply_is_closed(reply)) {
+        struct evhttp_connection* evcon = evhttp_request_get_connection(reply->req);
+        if (evcon) {
+            // Closing the connection without the last chunk tells the client the reply is incomplete
+            evhttp_connection_set_closecb(evcon, NULL, NULL);
+            evhttp_connection_free(evcon);
+        } else {
+            evhttp_send_reply_end(reply->req);
+        }
+    }
+    delete reply;
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request* req) : req(req),
-                                                       replySent(false)
+                                                       replySent(false),
+                                                       chunkedReply(NULL)
 {
 }
 HTTPRequest::~HTTPRequest()
 {
-    if (!replySent) {
+    if (!replySent && chunkedReply) {
+        LogPrintf("%s: Unfinished chunked reply\n", __func__);
+        AbortChunkedReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -559,6 +825,19 @@ std::pair<bool, std::string> HTTPRequest::GetHeader(const std::string& hdr)
         return std::make_pair(false, "");
 }
 
+std::string HTTPRequest::PeekBody(size_t nMaxSize)
+{
+    struct evbuffer* buf = evhttp_request_get_input_buffer(req);
+    if (!buf)
+        return "";
+    size_t size = evbuffer_get_length(buf);
+    if (size == 0 || size > nMaxSize)
+        return "";
+    std::string rv(size, '\0');
+    evbuffer_copyout(buf, &rv[0], size);
+    return rv;
+}
+
 std::string HTTPRequest::ReadBody()
 {
     struct evbuffer* buf = evhttp_request_get_input_buffer(req);
@@ -605,6 +884,56 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     req = 0; // transferred back to main thread
 }
 
+void HTTPRequest::WriteReplyChunk(const std::string& strChunk)
+{
+    assert(!replySent && req);
+    if (!chunkedReply) {
+        chunkedReply = new HTTPChunkedReply(req);
+        HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_reply_start, chunkedReply));
+        ev->trigger(0);
+    }
+    if (strChunk.empty())
+        return;
+
+    {
+        // Don't produce more output while a slow client still has to receive the earlier chunks.
+        // A client that stops reading runs into the server timeout, which closes the connection.
+        boost::unique_lock<boost::mutex> lock(chunkedReply->cs);
+        while (chunkedReply->nPending > HTTP_CHUNKED_REPLY_MAX_PENDING && !chunkedReply->fClosed)
+            chunkedReply->cond.wait(lock);
+        chunkedReply->nPending += strChunk.size();
+    }
+
+    // Events are handled in the order they were triggered, so chunks arrive in order
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_reply_chunk, chunkedReply, evb));
+    ev->trigger(0);
+}
+
+void HTTPRequest::EndChunkedReply(const std::string& strLast)
+{
+    if (!chunkedReply) {
+        WriteReply(HTTP_OK, strLast);
+        return;
+    }
+    WriteReplyChunk(strLast);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_reply_end, chunkedReply));
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
+void HTTPRequest::AbortChunkedReply()
+{
+    assert(chunkedReply && !replySent);
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, boost::bind(http_chunked_reply_abort, chunkedReply));
+    ev->trigger(0);
+    replySent = true;
+    req = 0; // transferred back to main thread
+}
+
 CService HTTPRequest::GetPeer()
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -645,10 +974,10 @@ HTTPRequest::RequestMethod HTTPRequest::GetRequestMethod()
     }
 }
 
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler)
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler, const HTTPRequestClassifier &classifier)
 {
     LogPrint("http", "Registering HTTP handler for %s (exactmatch %d)\n", prefix, exactMatch);
-    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler));
+    pathHandlers.push_back(HTTPPathHandler(prefix, exactMatch, handler, classifier));
 }
 
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch)
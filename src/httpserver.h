@@ -6,6 +6,7 @@
 #define BITCOIN_HTTPSERVER_H
 
 #include <string>
+#include <vector>
 #include <stdint.h>
 #include <boost/thread.hpp>
 #include <boost/scoped_ptr.hpp>
@@ -14,6 +15,13 @@
 static const int DEFAULT_HTTP_THREADS=4;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
+static const int DEFAULT_HTTP_FAST_THREADS=2;
+static const int DEFAULT_HTTP_FAST_WORKQUEUE=64;
+static const int DEFAULT_HTTP_SLOW_THREADS=2;
+static const int DEFAULT_HTTP_SLOW_WORKQUEUE=16;
+
+/** Work class serving requests that no other class was selected for, sized by -rpcthreads and -rpcworkqueue */
+static const char* const HTTP_DEFAULT_WORK_CLASS = "default";
 
 struct evhttp_request;
 struct event_base;
@@ -34,16 +42,51 @@ void InterruptHTTPServer();
 /** Stop HTTP server */
 void StopHTTPServer();
 
+/** Worker threads and work queue depth of one class of requests */
+struct HTTPWorkClassConfig
+{
+    std::string name;
+    int threads;
+    size_t maxDepth;
+};
+
+/**
+ * Set up the default and built-in work classes and apply -rpcworkclass=<class>:<threads>:<depth>
+ * arguments on top of them. Classes without threads are left out, the default class serves
+ * their requests. Returns false if an argument is invalid, vClasses is left untouched then.
+ */
+bool ParseHTTPWorkClasses(const std::vector<std::string>& vArgs, std::vector<HTTPWorkClassConfig>& vClasses);
+
 /** Handler for requests to a certain HTTP path */
 typedef boost::function<bool(HTTPRequest* req, const std::string &)> HTTPRequestHandler;
+/** Selects the work class of a request. Called on the event loop thread, so it must be cheap */
+typedef boost::function<std::string(HTTPRequest* req, const std::string &)> HTTPRequestClassifier;
 /** Register handler for prefix.
  * If multiple handlers match a prefix, the first-registered one will
- * be invoked.
+ * be invoked. Requests are served by the work class the classifier returns,
+ * or by the default class if there is no classifier or no such class.
  */
-void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler);
+void RegisterHTTPHandler(const std::string &prefix, bool exactMatch, const HTTPRequestHandler &handler,
+                         const HTTPRequestClassifier &classifier = HTTPRequestClassifier());
 /** Unregister handler for prefix */
 void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
 
+/** Snapshot of the work queue of a work class */
+struct HTTPWorkQueueStats
+{
+    std::string name;
+    int threads;
+    int busy;
+    size_t depth;
+    size_t maxDepth;
+    uint64_t processed;
+    uint64_t rejected;
+    //! Total time requests spent waiting in the queue
+    int64_t waitMicros;
+};
+
+std::vector<HTTPWorkQueueStats> GetHTTPWorkQueueStats();
+
 /** Return evhttp event base. This can be used by submodules to
  * queue timers or custom events.
  */
@@ -52,11 +95,15 @@ struct event_base* EventBase();
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
+struct HTTPChunkedReply;
+
 class HTTPRequest
 {
 private:
     struct evhttp_request* req;
     bool replySent;
+    //! Set once the first chunk of a chunked reply was sent, owned by the http thread
+    HTTPChunkedReply* chunkedReply;
 
 public:
     HTTPRequest(struct evhttp_request* req);
@@ -96,6 +143,12 @@ public:
      */
     std::string ReadBody();
 
+    /**
+     * Copy of the request body, which is left in place for ReadBody.
+     * Returns an empty string if the body is larger than nMaxSize.
+     */
+    std::string PeekBody(size_t nMaxSize);
+
     /**
      * Write output header.
      *
@@ -112,6 +165,33 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Send part of a HTTP 200 reply.
+     * The first chunk sends the headers, the body is then sent with chunked transfer
+     * encoding as it is produced. Finish the reply with EndChunkedReply.
+     */
+    void WriteReplyChunk(const std::string& strChunk);
+
+    /**
+     * Send the last part of a reply started with WriteReplyChunk. If no chunk has been sent
+     * yet, strLast is sent as a regular HTTP 200 reply instead.
+     *
+     * @note Same as for WriteReply, do not call any other HTTPRequest methods afterwards.
+     */
+    void EndChunkedReply(const std::string& strLast = "");
+
+    /**
+     * Give up on a reply started with WriteReplyChunk, e.g. because producing the rest failed.
+     * The connection is closed without terminating the chunked body, so the client can tell
+     * the reply is incomplete instead of getting truncated content with HTTP 200.
+     *
+     * @note Same as for WriteReply, do not call any other HTTPRequest methods afterwards.
+     */
+    void AbortChunkedReply();
+
+    /** Whether a chunked reply was started, after which no other reply can be sent */
+    bool IsReplyStarted() const { return chunkedReply != NULL; }
 };
 
 /** Event handler closure.
@@ -12,6 +12,7 @@
 
 #include "addrman.h"
 #include "amount.h"
+#include "blockcache.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -22,6 +23,7 @@
 #include "key.h"
 #include "main.h"
 #include "zerocoin.h"
+#include "libzerocoin/ParallelTasks.h"
 #include "miner.h"
 #include "net.h"
 #include "policy/policy.h"
@@ -46,6 +48,7 @@
 
 #ifdef ENABLE_ELYSIUM
 #include "elysium/elysium.h"
+#include "elysium/scan.h"
 #endif
 
 #include <stdint.h>
@@ -87,6 +90,7 @@ static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
 static const bool DEFAULT_DISABLE_SAFEMODE = false;
 static const bool DEFAULT_STOPAFTERBLOCKIMPORT = false;
+static const int DEFAULT_ZKP_THREADS = 0;
 
 
 #if ENABLE_ZMQ
@@ -240,6 +244,8 @@ void Shutdown() {
 
     StopTorControl();
     UnregisterNodeSignals(GetNodeSignals());
+    // Deliver the notifications still queued for wallets and ZMQ while the chain state is around
+    StopValidationInterfaceQueue();
 
     if (fFeeEstimatesInitialized) {
         boost::filesystem::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
@@ -351,8 +357,12 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-version", _("Print version and exit"));
     strUsage += HelpMessageOpt("-alertnotify=<cmd>",
                                _("Execute command when a relevant alert is received or we see a really long fork (%s in cmd is replaced by message)"));
+    strUsage += HelpMessageOpt("-asyncnotifications", strprintf(_("Deliver block and transaction notifications to the wallet and ZMQ on a background thread (default: %u)"), DEFAULT_ASYNC_NOTIFICATIONS));
     strUsage += HelpMessageOpt("-blocknotify=<cmd>",
                                _("Execute command when the best block changes (%s in cmd is replaced by block hash)"));
+    strUsage += HelpMessageOpt("-blockcache=<n>",
+                               strprintf(_("Keep up to <n> megabytes of recently read blocks in memory (0 to disable, default: %u)"),
+                                         DEFAULT_BLOCK_CACHE_SIZE));
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"),
                                                             DEFAULT_BLOCKSONLY));
@@ -373,10 +383,16 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-dbcache=<n>",
                                strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache,
                                          nMaxDbCache, nDefaultDbCache));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-dboption=<db>.<setting>=<n>", "Override a LevelDB setting of the database in the directory <db> (e.g. chainstate, index, MP_txlist). "
+                                   "<setting> is cache (private block cache in megabytes), writebuffer (megabytes), maxopenfiles, bloombits or compression (0 or 1). Can be specified multiple times");
     if (showDebug)
         strUsage += HelpMessageOpt("-feefilter", strprintf(
                 "Tell other nodes to filter invs to us by our mempool min fee (default: %u)", DEFAULT_FEEFILTER));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file on startup"));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-mmapblocks", strprintf("Read blocks from memory mapped block files (default: %u)",
+                                                            DEFAULT_MMAP_BLOCKS));
     strUsage += HelpMessageOpt("-maxorphantx=<n>",
                                strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"),
                                          DEFAULT_MAX_ORPHAN_TRANSACTIONS));
@@ -388,6 +404,18 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-par=<n>", strprintf(
             _("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
             -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-assumevalidzerocoin", strprintf(
+            _("Skip verification of legacy zerocoin spend proofs in blocks below the last checkpoint, spent serials are still tracked (default: %u)"),
+            DEFAULT_ASSUME_VALID_ZEROCOIN));
+    strUsage += HelpMessageOpt("-backgroundzerocoinverify", strprintf(
+            _("Verify the skipped zerocoin spend proofs at low priority after the initial sync (default: %u)"),
+            DEFAULT_BACKGROUND_ZEROCOIN_VERIFY));
+    strUsage += HelpMessageOpt("-zerocoinsnapshotinterval=<n>", strprintf(
+            _("Save zerocoin state to the block index every <n> blocks to speed up startup (0 = disable, default: %d)"),
+            DEFAULT_ZEROCOIN_SNAPSHOT_INTERVAL));
+    strUsage += HelpMessageOpt("-zkpthreads=<n>", strprintf(
+            _("Set the number of threads shared by zero-knowledge proof generation and verification (0 = auto, <0 = leave that many cores free, default: %d)"),
+            DEFAULT_ZKP_THREADS));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), BITCOIN_PID_FILENAME));
 #endif
@@ -508,6 +536,11 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubsigmamint=<address>", _("Enable publish Sigma mints of connected blocks in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubsigmaspend=<address>", _("Enable publish Sigma spent serials of connected blocks in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubelysiumtx=<address>", _("Enable publish raw Elysium transaction in <address>"));
+    if (showDebug)
+        strUsage += HelpMessageOpt("-zmqpubqueue=<n>", strprintf("Number of notifications waiting to be published before new ones are dropped (default: %u)", DEFAULT_ZMQ_PUBLISH_QUEUE));
 #endif
 
     strUsage += HelpMessageGroup(_("Debugging/Testing options:"));
@@ -647,6 +680,11 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-rpcthreads=<n>",
                                strprintf(_("Set the number of threads to service RPC calls (default: %d)"),
                                          DEFAULT_HTTP_THREADS));
+    strUsage += HelpMessageOpt("-rpcworkclass=<class>:<threads>:<depth>",
+                               strprintf(_("Serve the RPC methods of <class> with <threads> threads and a work queue of <depth>, 0 threads serve them with the -rpcthreads threads. Built-in classes are fast (default: %d:%d) and slow (default: %d:%d). This option can be specified multiple times"),
+                                         DEFAULT_HTTP_FAST_THREADS, DEFAULT_HTTP_FAST_WORKQUEUE, DEFAULT_HTTP_SLOW_THREADS, DEFAULT_HTTP_SLOW_WORKQUEUE));
+    strUsage += HelpMessageOpt("-rpcmethodclass=<method>:<class>",
+                               _("Serve the RPC method with the threads of <class>, <method> may end with * to match a prefix. Unknown classes and methods without a class use the -rpcthreads threads. This option can be specified multiple times"));
     if (showDebug) {
         strUsage += HelpMessageOpt("-rpcworkqueue=<n>",
                                    strprintf("Set the depth of the work queue to service RPC calls (default: %d)",
@@ -663,6 +701,7 @@ std::string HelpMessage(HelpMessageMode mode) {
     strUsage += HelpMessageOpt("-startclean", "Clear all persistence files on startup; triggers reparsing of Elysium transactions");
     strUsage += HelpMessageOpt("-elysiumtxcache=<num>", "The maximum number of transactions in the input transaction cache (default: 500000)");
     strUsage += HelpMessageOpt("-elysiumprogressfrequency=<seconds>", "Time in seconds after which the initial scanning progress is reported (default: 30)");
+    strUsage += HelpMessageOpt("-elysiumscanthreads=<n>", strprintf("Number of threads reading blocks during the initial scan, 0 to read blocks sequentially (0-%d, default: %d)", elysium::MAX_SCAN_THREADS, elysium::DEFAULT_SCAN_THREADS));
     strUsage += HelpMessageOpt("-elysiumdebug=<category>", "Enable or disable log categories, can be \"all\" or \"none\"");
     strUsage += HelpMessageOpt("-autocommit=<flag>", "Enable or disable broadcasting of transactions, when creating transactions (default: 1)");
     strUsage += HelpMessageOpt("-overrideforcedshutdown=<flag>", "Disable force shutdown when error (default: 0)");
@@ -1235,6 +1274,8 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
     }
     fCheckBlockIndex = GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fAssumeValidZerocoinProofs = GetBoolArg("-assumevalidzerocoin", DEFAULT_ASSUME_VALID_ZEROCOIN);
+    nZerocoinSnapshotInterval = std::max((int)GetArg("-zerocoinsnapshotinterval", DEFAULT_ZEROCOIN_SNAPSHOT_INTERVAL), 0);
 
     // mempool AC_CONFIG_SUBDIRSlimits
     int64_t nMempoolSizeMax = GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
@@ -1251,6 +1292,13 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    // -zkpthreads=0 means one thread per core
+    int nZkpThreads = GetArg("-zkpthreads", DEFAULT_ZKP_THREADS);
+    if (nZkpThreads <= 0)
+        nZkpThreads = std::max(nZkpThreads + GetNumCores(), 1);
+    if (!libzerocoin::ParallelTasks::SetThreadCount(nZkpThreads))
+        LogPrintf("Unable to change the number of zero-knowledge proof threads, the thread pool is already in use\n");
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
@@ -1413,6 +1461,7 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
     std::ostringstream strErrors;
 
     LogPrintf("Using %u threads for script verification\n", nScriptCheckThreads);
+    LogPrintf("Using %u threads for zero-knowledge proofs\n", libzerocoin::ParallelTasks::GetStats().maxThreads);
     if (nScriptCheckThreads) {
         for (int i = 0; i < nScriptCheckThreads - 1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
@@ -1587,11 +1636,14 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
     const std::string &strDest, mapMultiArgs["-seednode"])
     AddOneShot(strDest);
 
+    if (GetBoolArg("-asyncnotifications", DEFAULT_ASYNC_NOTIFICATIONS))
+        StartValidationInterfaceQueue();
+
 #if ENABLE_ZMQ
     pzmqNotificationInterface = CZMQNotificationInterface::CreateWithArguments(mapArgs);
 
     if (pzmqNotificationInterface) {
-        RegisterValidationInterface(pzmqNotificationInterface);
+        RegisterValidationInterface(pzmqNotificationInterface, true);
     }
 #endif
     if (mapArgs.count("-maxuploadtarget")) {
@@ -1643,12 +1695,19 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
                                     (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
-//    nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
-    nCoinCacheUsage = nTotalCache / 300;
+    nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
+    // The block caches of all the databases, Elysium included, share half of the database budget
+    int64_t nSharedDBCache = (nBlockTreeDBCache + nCoinDBCache) / 2;
+    SetSharedDBCacheSize(nSharedDBCache);
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB of the above for the shared database block cache\n", nSharedDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    int64_t nBlockCache = std::max(GetArg("-blockcache", DEFAULT_BLOCK_CACHE_SIZE), (int64_t)0) << 20;
+    blockCache.SetMaxUsage(nBlockCache);
+    blockFileReader.SetEnabled(GetBoolArg("-mmapblocks", DEFAULT_MMAP_BLOCKS));
+    LogPrintf("* Using %.1fMiB for recently read blocks\n", nBlockCache * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
     while (!fLoaded) {
@@ -1958,6 +2017,10 @@ bool AppInit2(boost::thread_group &threadGroup, CScheduler &scheduler) {
         StartTorControl(threadGroup, scheduler);
 
     StartNode(threadGroup, scheduler);
+
+    if (fAssumeValidZerocoinProofs && fCheckpointsEnabled && GetBoolArg("-backgroundzerocoinverify", DEFAULT_BACKGROUND_ZEROCOIN_VERIFY))
+        threadGroup.create_thread(&ThreadVerifyZerocoinProofs);
+
     // Generate coins in the background
     GenerateBitcoins(GetBoolArg("-gen", DEFAULT_GENERATE), GetArg("-genproclimit", DEFAULT_GENERATE_THREADS),
                      chainparams);
@@ -144,37 +144,37 @@ namespace libzerocoin {
 
         Bignum c = Bignum(hasher.GetHash()); //this hash should be of length k_prime bits
 
-        Bignum st_1_prime = (valueOfCommitmentToCoin.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
-                             sg.pow_mod(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) *
-                             sh.pow_mod(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) %
+        Bignum st_1_prime = (valueOfCommitmentToCoin.pow_mod_public(c, params->accumulatorPoKCommitmentGroup.modulus) *
+                             sg.pow_mod_public(s_alpha, params->accumulatorPoKCommitmentGroup.modulus) *
+                             sh.pow_mod_public(s_phi, params->accumulatorPoKCommitmentGroup.modulus)) %
                             params->accumulatorPoKCommitmentGroup.modulus;
-        Bignum st_2_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin *
+        Bignum st_2_prime = (sg.pow_mod_public(c, params->accumulatorPoKCommitmentGroup.modulus) * ((valueOfCommitmentToCoin *
                                                                                               sg.inverse(
-                                                                                                      params->accumulatorPoKCommitmentGroup.modulus)).pow_mod(
+                                                                                                      params->accumulatorPoKCommitmentGroup.modulus)).pow_mod_public(
                 s_gamma, params->accumulatorPoKCommitmentGroup.modulus)) *
-                             sh.pow_mod(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) %
+                             sh.pow_mod_public(s_psi, params->accumulatorPoKCommitmentGroup.modulus)) %
                             params->accumulatorPoKCommitmentGroup.modulus;
-        Bignum st_3_prime = (sg.pow_mod(c, params->accumulatorPoKCommitmentGroup.modulus) *
-                             (sg * valueOfCommitmentToCoin).pow_mod(s_sigma,
+        Bignum st_3_prime = (sg.pow_mod_public(c, params->accumulatorPoKCommitmentGroup.modulus) *
+                             (sg * valueOfCommitmentToCoin).pow_mod_public(s_sigma,
                                                                     params->accumulatorPoKCommitmentGroup.modulus) *
-                             sh.pow_mod(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) %
+                             sh.pow_mod_public(s_xi, params->accumulatorPoKCommitmentGroup.modulus)) %
                             params->accumulatorPoKCommitmentGroup.modulus;
 
         Bignum t_1_prime =
-                (C_r.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_zeta, params->accumulatorModulus) *
-                 g_n.pow_mod(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
+                (C_r.pow_mod_public(c, params->accumulatorModulus) * h_n.pow_mod_public(s_zeta, params->accumulatorModulus) *
+                 g_n.pow_mod_public(s_epsilon, params->accumulatorModulus)) % params->accumulatorModulus;
         Bignum t_2_prime =
-                (C_e.pow_mod(c, params->accumulatorModulus) * h_n.pow_mod(s_eta, params->accumulatorModulus) *
-                 g_n.pow_mod(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
+                (C_e.pow_mod_public(c, params->accumulatorModulus) * h_n.pow_mod_public(s_eta, params->accumulatorModulus) *
+                 g_n.pow_mod_public(s_alpha, params->accumulatorModulus)) % params->accumulatorModulus;
 
-        Bignum t_3_prime = ((a.getValue()).pow_mod(c, params->accumulatorModulus) *
-                            C_u.pow_mod(s_alpha, params->accumulatorModulus) *
-                            ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
+        Bignum t_3_prime = ((a.getValue()).pow_mod_public(c, params->accumulatorModulus) *
+                            C_u.pow_mod_public(s_alpha, params->accumulatorModulus) *
+                            ((h_n.inverse(params->accumulatorModulus)).pow_mod_public(s_beta, params->accumulatorModulus))) %
                            params->accumulatorModulus;
 
-        Bignum t_4_prime = (C_r.pow_mod(s_alpha, params->accumulatorModulus) *
-                            ((h_n.inverse(params->accumulatorModulus)).pow_mod(s_delta, params->accumulatorModulus)) *
-                            ((g_n.inverse(params->accumulatorModulus)).pow_mod(s_beta, params->accumulatorModulus))) %
+        Bignum t_4_prime = (C_r.pow_mod_public(s_alpha, params->accumulatorModulus) *
+                            ((h_n.inverse(params->accumulatorModulus)).pow_mod_public(s_delta, params->accumulatorModulus)) *
+                            ((g_n.inverse(params->accumulatorModulus)).pow_mod_public(s_beta, params->accumulatorModulus))) %
                            params->accumulatorModulus;
 
         bool result = false;
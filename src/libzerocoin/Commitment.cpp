@@ -117,13 +117,13 @@ bool CommitmentProofOfKnowledge::Verify(const Bignum& A, const Bignum& B) const
 	}
 
 	// Compute T1 = g1^S1 * h1^S2 * inverse(A^{challenge}) mod p1
-	Bignum T1 = A.pow_mod(this->challenge, ap->modulus).inverse(ap->modulus).mul_mod(
-	                (ap->g.pow_mod(S1, ap->modulus).mul_mod(ap->h.pow_mod(S2, ap->modulus), ap->modulus)),
+	Bignum T1 = A.pow_mod_public(this->challenge, ap->modulus).inverse(ap->modulus).mul_mod(
+	                (ap->g.pow_mod_public(S1, ap->modulus).mul_mod(ap->h.pow_mod_public(S2, ap->modulus), ap->modulus)),
 	                ap->modulus);
 
 	// Compute T2 = g2^S1 * h2^S3 * inverse(B^{challenge}) mod p2
-	Bignum T2 = B.pow_mod(this->challenge, bp->modulus).inverse(bp->modulus).mul_mod(
-	                (bp->g.pow_mod(S1, bp->modulus).mul_mod(bp->h.pow_mod(S3, bp->modulus), bp->modulus)),
+	Bignum T2 = B.pow_mod_public(this->challenge, bp->modulus).inverse(bp->modulus).mul_mod(
+	                (bp->g.pow_mod_public(S1, bp->modulus).mul_mod(bp->h.pow_mod_public(S3, bp->modulus), bp->modulus)),
 	                bp->modulus);
 
 	// Hash T1 and T2 along with all of the public parameters
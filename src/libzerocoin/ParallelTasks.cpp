@@ -10,77 +10,221 @@
 * @license    This project is released under the MIT license.
 **/
 
+#define BOOST_THREAD_PROVIDES_FUTURE
+
 #include "Zerocoin.h"
 #include "ParallelTasks.h"
 
-#define BOOST_THREAD_PROVIDES_FUTURE
-
 #include <boost/thread/locks.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
 #include <boost/thread/future.hpp>
+#include <boost/thread/tss.hpp>
 #include <boost/chrono.hpp>
 
-#include <queue>
-#include <vector>
+#include <atomic>
+#include <deque>
 #include <list>
+#include <memory>
+#include <vector>
 #include <algorithm>
 #include <functional>
 
 namespace libzerocoin {
 
+struct ParallelTaskResult {
+    boost::future<void> future;
+
+    explicit ParallelTaskResult(boost::future<void> &&f) : future(std::move(f)) {}
+};
+
+typedef boost::chrono::steady_clock ParallelTasksClock;
+
+static uint64_t MicrosSince(const ParallelTasksClock::time_point &start) {
+    return boost::chrono::duration_cast<boost::chrono::microseconds>(ParallelTasksClock::now() - start).count();
+}
+
+// Lowest priority of the tasks posted from the current thread, set by ParallelTasks::PriorityScope
+// and inherited by the tasks posted from inside other tasks
+static boost::thread_specific_ptr<ParallelTaskPriority> s_priorityFloor;
+
+static ParallelTaskPriority GetPriorityFloor() {
+    ParallelTaskPriority *floor = s_priorityFloor.get();
+    return floor ? *floor : PARALLEL_TASK_PRIORITY_HIGH;
+}
+
 #ifdef ZEROCOIN_THREADING
 
 // Number of seconds before thread shuts down if idle
 constexpr static int secondsBeforeThreadShutdown = 10;
 
-// Simple thread pool class for using multiple cores effeciently
+// Work-stealing thread pool shared by everything that needs heavy crypto computations.
+//
+// Every worker thread owns a queue per priority. Tasks posted from inside a worker (nested
+// parallelism) go to the worker's own queue and are taken by the owner from the back, tasks
+// posted from other threads go to the shared queue. Idle workers take tasks from the shared
+// queue and steal from the front of the other workers' queues. Higher priority tasks are
+// always taken first regardless of the queue they are in.
 
 static class ParallelOpThreadPool {
 private:
-    std::list<boost::thread>                  threads;
-    std::queue<boost::packaged_task<void>>    taskQueue;
+    typedef std::deque<boost::packaged_task<void>> TaskQueue;
+
+    struct Worker {
+        boost::mutex                          mutex;
+        TaskQueue                             queues[PARALLEL_TASK_PRIORITY_COUNT];
+        boost::thread                         thread;
+        bool                                  running;        // guarded by taskQueueMutex
+
+        Worker() : running(false) {}
+    };
+
+    // lock order: taskQueueMutex first, then Worker::mutex
+    std::vector<std::unique_ptr<Worker>>      workers;
+    TaskQueue                                 taskQueues[PARALLEL_TASK_PRIORITY_COUNT];
     boost::mutex                              taskQueueMutex;
     boost::condition_variable                 taskQueueCondition;
+    boost::thread_specific_ptr<Worker>        currentWorker;
 
     bool                                      shutdown;
-    size_t                                    numberOfThreads;
+    size_t                                    runningThreads;
+
+    std::atomic<size_t>                       pendingTasks;
+    std::atomic<size_t>                       queueDepth[PARALLEL_TASK_PRIORITY_COUNT];
+    std::atomic<size_t>                       busyThreads;
+    std::atomic<uint64_t>                     tasksExecuted;
+    std::atomic<uint64_t>                     tasksStolen;
+    std::atomic<uint64_t>                     busyMicros;
+    const ParallelTasksClock::time_point      startTime;
+
+    static void DoNotDelete(Worker *) {}
+
+    static size_t DefaultThreadCount() {
+        return std::max<size_t>(boost::thread::hardware_concurrency(), 1);
+    }
+
+    // should be called with mutex of the queue aquired
+    bool PopTask(TaskQueue &queue, int priority, bool fromBack, boost::packaged_task<void> &task) {
+        if (queue.empty())
+            return false;
+
+        if (fromBack) {
+            task = std::move(queue.back());
+            queue.pop_back();
+        }
+        else {
+            task = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        queueDepth[priority]--;
+        pendingTasks--;
+        return true;
+    }
+
+    // find the next task of priority not lower than lowestPriority
+    bool TryPopTask(Worker *self, ParallelTaskPriority lowestPriority, boost::packaged_task<void> &task, ParallelTaskPriority &taskPriority) {
+        for (int priority = PARALLEL_TASK_PRIORITY_HIGH; priority <= lowestPriority; priority++) {
+            if (queueDepth[priority] == 0)
+                continue;
+
+            taskPriority = (ParallelTaskPriority)priority;
+
+            if (self) {
+                // most recently posted task of our own is the most likely to have its data in cache
+                boost::lock_guard<boost::mutex> lock(self->mutex);
+                if (PopTask(self->queues[priority], priority, true, task))
+                    return true;
+            }
+
+            // taskQueueMutex also protects the worker list from being replaced by SetThreadCount
+            boost::lock_guard<boost::mutex> lock(taskQueueMutex);
+            if (PopTask(taskQueues[priority], priority, false, task))
+                return true;
+
+            for (std::unique_ptr<Worker> &victim: workers) {
+                if (victim.get() == self)
+                    continue;
+
+                boost::lock_guard<boost::mutex> victimLock(victim->mutex);
+                if (PopTask(victim->queues[priority], priority, false, task)) {
+                    tasksStolen++;
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    void ExecuteTask(boost::packaged_task<void> &task, ParallelTaskPriority priority) {
+        ParallelTasksClock::time_point start = ParallelTasksClock::now();
+
+        busyThreads++;
+        {
+            // tasks posted by this one inherit its priority
+            ParallelTasks::PriorityScope priorityScope(priority);
+            task();
+        }
+        busyThreads--;
+
+        busyMicros += MicrosSince(start);
+        tasksExecuted++;
+    }
+
+    void ThreadProc(Worker *self) {
+        currentWorker.reset(self);
 
-    void ThreadProc() {
         for (;;) {
             boost::packaged_task<void> job;
-            {
-                boost::unique_lock<boost::mutex> lock(taskQueueMutex);
-
-                taskQueueCondition.wait_for(lock, boost::chrono::seconds(secondsBeforeThreadShutdown),
-                                            [this] { return !taskQueue.empty() || shutdown; });
-                if (taskQueue.empty()) {
-                    // Either timeout or shutdown. If it's a timeout we need to delete ourself from the thread list and detach the thread
-                    // In case of shutdown thread list will be empty and destructor will wait for this thread completion
-                    boost::thread::id currentId = boost::this_thread::get_id();
-                    auto pThread = find_if(threads.begin(), threads.end(), [=](const boost::thread &t) { return t.get_id() == currentId; });
-                    if (pThread != threads.end()) {
-                        pThread->detach();
-                        threads.erase(pThread);
-                    }
-                    break;
-                }
-                job = std::move(taskQueue.front());
-                taskQueue.pop();
+            ParallelTaskPriority jobPriority;
+            if (TryPopTask(self, PARALLEL_TASK_PRIORITY_LOW, job, jobPriority)) {
+                ExecuteTask(job, jobPriority);
+                continue;
+            }
+
+            boost::unique_lock<boost::mutex> lock(taskQueueMutex);
+
+            taskQueueCondition.wait_for(lock, boost::chrono::seconds(secondsBeforeThreadShutdown),
+                                        [this] { return pendingTasks > 0 || shutdown; });
+            if (pendingTasks == 0) {
+                // Either timeout or shutdown. If it's a timeout we need to free our slot and detach the thread
+                // In case of shutdown the thread object has already been moved out and destructor will wait for its completion
+                if (self->thread.joinable())
+                    self->thread.detach();
+                self->running = false;
+                runningThreads--;
+                break;
             }
-            job();
         }
+
+        currentWorker.release();
     }
 
     void StartThreads() {
         // should be called with mutex aquired
         // start missing threads
-        while(threads.size() < numberOfThreads)
-            threads.emplace_back(std::bind(&ParallelOpThreadPool::ThreadProc, this));
+        for (std::unique_ptr<Worker> &worker: workers) {
+            if (worker->running)
+                continue;
+
+            worker->running = true;
+            runningThreads++;
+            worker->thread = boost::thread(std::bind(&ParallelOpThreadPool::ThreadProc, this, worker.get()));
+        }
     }
 
 public:
-    ParallelOpThreadPool() : shutdown(false), numberOfThreads(boost::thread::hardware_concurrency()) {}
+    ParallelOpThreadPool() : currentWorker(&ParallelOpThreadPool::DoNotDelete), shutdown(false), runningThreads(0),
+            pendingTasks(0), busyThreads(0), tasksExecuted(0), tasksStolen(0), busyMicros(0),
+            startTime(ParallelTasksClock::now()) {
+        for (std::atomic<size_t> &depth: queueDepth)
+            depth = 0;
+
+        size_t numberOfThreads = DefaultThreadCount();
+        for (size_t i = 0; i < numberOfThreads; i++)
+            workers.emplace_back(new Worker());
+    }
 
     ~ParallelOpThreadPool() {
         std::list<boost::thread> threadsToJoin;
@@ -90,8 +234,11 @@ public:
         shutdown = true;
         taskQueueCondition.notify_all();
 
-        // move the list to separate variable to wait for the shutdown process to complete
-        threadsToJoin.swap(threads);
+        // move the threads to separate list to wait for the shutdown process to complete
+        for (std::unique_ptr<Worker> &worker: workers) {
+            if (worker->thread.joinable())
+                threadsToJoin.push_back(std::move(worker->thread));
+        }
 
         taskQueueMutex.unlock();
 
@@ -101,57 +248,172 @@ public:
     }
 
     // Post a task to the thread pool and return a future to wait for its completion
-    boost::future<void> PostTask(function<void()> task) {
+    boost::future<void> PostTask(function<void()> task, ParallelTaskPriority priority) {
         boost::packaged_task<void> packagedTask(std::move(task));
         boost::future<void> ret = packagedTask.get_future();
 
-        taskQueueMutex.lock();
+        Worker *self = currentWorker.get();
 
-        // lazy start threads on first request or after shutdown
-        if (threads.size() < numberOfThreads)
+        boost::lock_guard<boost::mutex> lock(taskQueueMutex);
+
+        // lazy start threads on first request or after idle shutdown
+        if (runningThreads < workers.size())
             StartThreads();
 
-        taskQueue.emplace(std::move(packagedTask));
-        taskQueueCondition.notify_one();
+        if (self) {
+            boost::lock_guard<boost::mutex> workerLock(self->mutex);
+            self->queues[priority].emplace_back(std::move(packagedTask));
+        }
+        else {
+            taskQueues[priority].emplace_back(std::move(packagedTask));
+        }
 
-        taskQueueMutex.unlock();
+        queueDepth[priority]++;
+        pendingTasks++;
+        taskQueueCondition.notify_one();
 
         return ret;
     }
 
+    // Execute one pending task in the calling thread. Used to help the pool while waiting for results
+    bool RunPendingTask(ParallelTaskPriority lowestPriority) {
+        boost::packaged_task<void> job;
+        ParallelTaskPriority jobPriority;
+        if (!TryPopTask(currentWorker.get(), lowestPriority, job, jobPriority))
+            return false;
+
+        ExecuteTask(job, jobPriority);
+        return true;
+    }
+
+    bool SetThreadCount(size_t n) {
+        boost::lock_guard<boost::mutex> lock(taskQueueMutex);
+
+        // worker list can't be changed while anything might be iterating it
+        if (runningThreads > 0 || pendingTasks > 0)
+            return false;
+
+        workers.clear();
+        if (n == 0)
+            n = DefaultThreadCount();
+        for (size_t i = 0; i < n; i++)
+            workers.emplace_back(new Worker());
+
+        return true;
+    }
+
+    ParallelTasksStats GetStats() {
+        ParallelTasksStats stats;
+
+        {
+            boost::lock_guard<boost::mutex> lock(taskQueueMutex);
+            stats.maxThreads = workers.size();
+            stats.threads = runningThreads;
+        }
+
+        stats.busyThreads = busyThreads;
+        for (int priority = PARALLEL_TASK_PRIORITY_HIGH; priority < PARALLEL_TASK_PRIORITY_COUNT; priority++)
+            stats.queueDepth[priority] = queueDepth[priority];
+        stats.tasksExecuted = tasksExecuted;
+        stats.tasksStolen = tasksStolen;
+        stats.busyMicros = busyMicros;
+        stats.uptimeMicros = MicrosSince(startTime);
+
+        return stats;
+    }
+
 } s_parallelOpThreadPool;
 
 #else
 
 static class ParallelOpThreadPool {
+private:
+    std::atomic<uint64_t>                     tasksExecuted;
+    std::atomic<uint64_t>                     busyMicros;
+    const ParallelTasksClock::time_point      startTime;
+
 public:
-    boost::future<void> PostTask(function<void()> task) {
+    ParallelOpThreadPool() : tasksExecuted(0), busyMicros(0), startTime(ParallelTasksClock::now()) {}
+
+    boost::future<void> PostTask(function<void()> task, ParallelTaskPriority) {
+        ParallelTasksClock::time_point start = ParallelTasksClock::now();
         task();
+        busyMicros += MicrosSince(start);
+        tasksExecuted++;
+
         boost::promise<void> promise;
         promise.set_value();
         return promise.get_future();
     }
+
+    bool RunPendingTask(ParallelTaskPriority) {
+        return false;
+    }
+
+    bool SetThreadCount(size_t) {
+        return true;
+    }
+
+    ParallelTasksStats GetStats() {
+        ParallelTasksStats stats = {};
+        stats.tasksExecuted = tasksExecuted;
+        stats.busyMicros = busyMicros;
+        stats.uptimeMicros = MicrosSince(startTime);
+        return stats;
+    }
 } s_parallelOpThreadPool;
 
 #endif
 
 // High level API to create number of parallel tasks and wait for completion
 
-ParallelTasks::ParallelTasks(int n) {
+ParallelTasks::ParallelTasks(int n, ParallelTaskPriority priority) : priority(std::max(priority, GetPriorityFloor())) {
     tasks.reserve(n);
 }
 
 void ParallelTasks::Add(function<void()> task) {
-    tasks.push_back(s_parallelOpThreadPool.PostTask(std::move(task)));
+    tasks.push_back(std::make_shared<ParallelTaskResult>(s_parallelOpThreadPool.PostTask(std::move(task), priority)));
 }
 
 void ParallelTasks::Wait() {
-    for (boost::future<void> &f: tasks)
+    for (std::shared_ptr<ParallelTaskResult> &task: tasks) {
+        boost::future<void> &f = task->future;
+        // don't just block: help the pool with the queued work. This also makes nested parallel
+        // tasks safe when every worker thread is waiting for its own children
+        while (!f.is_ready()) {
+            if (!s_parallelOpThreadPool.RunPendingTask(priority))
+                f.wait_for(boost::chrono::milliseconds(1));
+        }
         f.get();
+    }
 }
 
 void ParallelTasks::Reset() {
     tasks.clear();
 }
 
+ParallelTasks::PriorityScope::PriorityScope(ParallelTaskPriority priority) {
+    ParallelTaskPriority *floor = s_priorityFloor.get();
+    if (floor) {
+        previousPriority = *floor;
+        *floor = priority;
+    }
+    else {
+        previousPriority = PARALLEL_TASK_PRIORITY_HIGH;
+        s_priorityFloor.reset(new ParallelTaskPriority(priority));
+    }
+}
+
+ParallelTasks::PriorityScope::~PriorityScope() {
+    *s_priorityFloor = previousPriority;
+}
+
+bool ParallelTasks::SetThreadCount(size_t n) {
+    return s_parallelOpThreadPool.SetThreadCount(n);
+}
+
+ParallelTasksStats ParallelTasks::GetStats() {
+    return s_parallelOpThreadPool.GetStats();
+}
+
 } // namespace libzerocoin
@@ -14,36 +14,80 @@
 #define PARALLELTASKS_H
 
 /**
- * Implementation of thread pool for parallelizing spend creation and verification
- */ 
+ * Implementation of thread pool for parallelizing spend creation and verification.
+ *
+ * All the users (libzerocoin proofs, sigma spend verification, wallet spend creation)
+ * share a single process-wide work-stealing pool so that the number of busy threads
+ * never exceeds the configured limit no matter how many subsystems post work at once.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
 
 #include <vector>
 #include <functional>
+#include <memory>
 
-#define BOOST_THREAD_PROVIDES_FUTURE
-
-
-#include <boost/thread/future.hpp>
 #include <boost/thread.hpp>
 
 namespace libzerocoin {
 
+// Tasks with higher priority are always picked up first by the pool
+enum ParallelTaskPriority {
+    PARALLEL_TASK_PRIORITY_HIGH = 0,    // block and transaction validation
+    PARALLEL_TASK_PRIORITY_NORMAL,      // wallet proof generation
+    PARALLEL_TASK_PRIORITY_LOW,         // background jobs that may wait for anything else
+    PARALLEL_TASK_PRIORITY_COUNT
+};
+
+// Snapshot of the shared pool counters
+struct ParallelTasksStats {
+    size_t maxThreads;                                  // configured number of worker threads
+    size_t threads;                                     // currently running worker threads
+    size_t busyThreads;                                 // threads executing a task right now
+    size_t queueDepth[PARALLEL_TASK_PRIORITY_COUNT];    // tasks waiting to be executed
+    uint64_t tasksExecuted;                             // total number of tasks executed
+    uint64_t tasksStolen;                               // tasks taken from the queue of another thread
+    uint64_t busyMicros;                                // total time spent executing tasks
+    uint64_t uptimeMicros;                              // time since the pool was created
+};
+
+// Completion state of a posted task. Defined in ParallelTasks.cpp so this header doesn't depend
+// on the boost future flavour selected by BOOST_THREAD_PROVIDES_FUTURE
+struct ParallelTaskResult;
+
 class ParallelTasks {
 private:
-    vector<boost::future<void>> tasks;
+    std::vector<std::shared_ptr<ParallelTaskResult>> tasks;
+    ParallelTaskPriority priority;
 
 public:
-    ParallelTasks(int n=0);
+    ParallelTasks(int n=0, ParallelTaskPriority priority=PARALLEL_TASK_PRIORITY_NORMAL);
 
     // add new task
     void Add(std::function<void()> task);
 
-    // wait for everything added so far
+    // wait for everything added so far, executing pending tasks of the same or higher priority meanwhile
     void Wait();
 
     // clear all the tasks from the waiting list
     void Reset();
 
+    // set the number of worker threads, 0 means number of cores. Should be called before the first task is posted
+    static bool SetThreadCount(size_t n);
+
+    static ParallelTasksStats GetStats();
+
+    // helper class to limit the priority of all the tasks posted from the current thread
+    // (including nested tasks) while the object exists
+    class PriorityScope {
+    private:
+        ParallelTaskPriority previousPriority;
+    public:
+        explicit PriorityScope(ParallelTaskPriority priority);
+        ~PriorityScope();
+    };
+
     // helper class to put thread interruption on pause
     class DoNotDisturb {
     private:
@@ -96,17 +96,21 @@ SerialNumberSignatureOfKnowledge::SerialNumberSignatureOfKnowledge(const Params*
 }
 
 inline Bignum SerialNumberSignatureOfKnowledge::challengeCalculation(const Bignum& a_exp,const Bignum& b_exp,
-        const Bignum& h_exp) const {
+        const Bignum& h_exp, bool fPublicExponents) const {
 
 	Bignum a = params->coinCommitmentGroup.g;
 	Bignum b = params->coinCommitmentGroup.h;
 	Bignum g = params->serialNumberSoKCommitmentGroup.g;
 	Bignum h = params->serialNumberSoKCommitmentGroup.h;
 
-	Bignum exponent = (a.pow_mod(a_exp, params->serialNumberSoKCommitmentGroup.groupOrder)
-	                   * b.pow_mod(b_exp, params->serialNumberSoKCommitmentGroup.groupOrder)) % params->serialNumberSoKCommitmentGroup.groupOrder;
+	auto pow_mod = [fPublicExponents](const Bignum& base, const Bignum& e, const Bignum& m) {
+		return fPublicExponents ? base.pow_mod_public(e, m) : base.pow_mod(e, m);
+	};
 
-	return (g.pow_mod(exponent, params->serialNumberSoKCommitmentGroup.modulus) * h.pow_mod(h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
+	Bignum exponent = (pow_mod(a, a_exp, params->serialNumberSoKCommitmentGroup.groupOrder)
+	                   * pow_mod(b, b_exp, params->serialNumberSoKCommitmentGroup.groupOrder)) % params->serialNumberSoKCommitmentGroup.groupOrder;
+
+	return (pow_mod(g, exponent, params->serialNumberSoKCommitmentGroup.modulus) * pow_mod(h, h_exp, params->serialNumberSoKCommitmentGroup.modulus)) % params->serialNumberSoKCommitmentGroup.modulus;
 }
 
 bool SerialNumberSignatureOfKnowledge::Verify(const Bignum& coinSerialNumber, const Bignum& valueOfCommitmentToCoin,
@@ -133,7 +137,7 @@ bool SerialNumberSignatureOfKnowledge::Verify(const Bignum& coinSerialNumber, co
 	vector<CBigNum> tprime(params->zkp_iterations);
 	unsigned char *hashbytes = (unsigned char*) &this->hash;
 
-    ParallelTasks challenges(params->zkp_iterations);
+    ParallelTasks challenges(params->zkp_iterations, PARALLEL_TASK_PRIORITY_HIGH);
 
 	for(uint32_t i = 0; i < params->zkp_iterations; i++) {
         challenges.Add([this, i, hashbytes, &b, &h, &tprime, &coinSerialNumber, &valueOfCommitmentToCoin] {
@@ -141,11 +145,11 @@ bool SerialNumberSignatureOfKnowledge::Verify(const Bignum& coinSerialNumber, co
             int byte = i / 8;
             bool challenge_bit = ((hashbytes[byte] >> bit) & 0x01);
             if(challenge_bit) {
-                tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], sprime[i]);
+                tprime[i] = challengeCalculation(coinSerialNumber, s_notprime[i], sprime[i], true);
             } else {
-                Bignum exp = b.pow_mod(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
-                tprime[i] = ((valueOfCommitmentToCoin.pow_mod(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
-                             (h.pow_mod(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
+                Bignum exp = b.pow_mod_public(s_notprime[i], params->serialNumberSoKCommitmentGroup.groupOrder);
+                tprime[i] = ((valueOfCommitmentToCoin.pow_mod_public(exp, params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus) *
+                             (h.pow_mod_public(sprime[i], params->serialNumberSoKCommitmentGroup.modulus) % params->serialNumberSoKCommitmentGroup.modulus)) %
                             params->serialNumberSoKCommitmentGroup.modulus;
             }
         });
@@ -69,8 +69,9 @@ private:
 	// define something named s and it conflicts
 	vector<Bignum> s_notprime;
 	vector<Bignum> sprime;
+	// exponents are secret while signing and public while verifying
 	inline Bignum challengeCalculation(const Bignum& a_exp, const Bignum& b_exp,
-	                                   const Bignum& h_exp) const;
+	                                   const Bignum& h_exp, bool fPublicExponents = false) const;
 };
 
 } /* namespace libzerocoin */
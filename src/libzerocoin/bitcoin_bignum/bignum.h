@@ -6,13 +6,20 @@
 #define BITCOIN_BIGNUM_H
 
 #include <stdexcept>
+#include <utility>
 #include <vector>
 #include <openssl/bn.h>
 
+#include <boost/thread/tss.hpp>
+
 #include "../../uint256.h" // for uint64
 #include "../../arith_uint256.h"
 #include "../../version.h"
 #include "../../clientversion.h"
+
+#ifdef USE_GMP
+#include <gmp.h>
+#endif
 /** Errors thrown by the bignum class */
 class bignum_error : public std::runtime_error
 {
@@ -20,25 +27,41 @@ public:
     explicit bignum_error(const std::string& str) : std::runtime_error(str) {}
 };
 
-/** RAII encapsulated BN_CTX (OpenSSL bignum context) */
+/** RAII encapsulated BN_CTX (OpenSSL bignum context)
+ *
+ * Contexts are allocated once per thread and reused. BN_CTX works as a stack of temporaries so
+ * nested users on the same thread don't interfere with each other.
+ */
 class CAutoBN_CTX
 {
 protected:
     BN_CTX* pctx;
     BN_CTX* operator=(BN_CTX* pnew) { return pctx = pnew; }
 
+    static void FreeContext(BN_CTX *ctx)
+    {
+        BN_CTX_free(ctx);
+    }
+
+    static BN_CTX *GetThreadContext()
+    {
+        static boost::thread_specific_ptr<BN_CTX> threadContext(FreeContext);
+        if (threadContext.get() == NULL)
+            threadContext.reset(BN_CTX_new());
+        return threadContext.get();
+    }
+
 public:
     CAutoBN_CTX()
     {
-        pctx = BN_CTX_new();
+        pctx = GetThreadContext();
         if (pctx == NULL)
             throw bignum_error("CAutoBN_CTX : BN_CTX_new() returned NULL");
     }
 
     ~CAutoBN_CTX()
     {
-        if (pctx != NULL)
-            BN_CTX_free(pctx);
+        // context is owned by the thread
     }
 
     operator BN_CTX*() { return pctx; }
@@ -48,6 +71,51 @@ public:
 };
 
 
+#ifdef USE_GMP
+/** RAII encapsulated mpz_t (GMP integer) converted from/to BIGNUM */
+class CAutoMPZ
+{
+public:
+    mpz_t value;
+
+    CAutoMPZ()
+    {
+        mpz_init(value);
+    }
+
+    explicit CAutoMPZ(const BIGNUM *bn)
+    {
+        mpz_init(value);
+        std::vector<unsigned char> vch(BN_num_bytes(bn));
+        if (!vch.empty()) {
+            BN_bn2bin(bn, vch.data());
+            mpz_import(value, vch.size(), 1, 1, 0, 0, vch.data());
+        }
+        if (BN_is_negative(bn))
+            mpz_neg(value, value);
+    }
+
+    ~CAutoMPZ()
+    {
+        mpz_clear(value);
+    }
+
+    void ToBIGNUM(BIGNUM *bn) const
+    {
+        std::vector<unsigned char> vch((mpz_sizeinbase(value, 2) + 7) / 8);
+        size_t count = 0;
+        mpz_export(vch.data(), &count, 1, 1, 0, 0, value);
+        if (!BN_bin2bn(vch.data(), count, bn))
+            throw bignum_error("CAutoMPZ::ToBIGNUM : BN_bin2bn failed");
+        BN_set_negative(bn, mpz_sgn(value) < 0);
+    }
+
+private:
+    CAutoMPZ(const CAutoMPZ&);
+    CAutoMPZ& operator=(const CAutoMPZ&);
+};
+#endif
+
 /** C++ wrapper for BIGNUM (OpenSSL bignum) */class CBigNum
 {
 protected:
@@ -74,13 +142,28 @@ public:
         }
     }
 
+    // Moved-from object may only be assigned to or destroyed
+    CBigNum(CBigNum&& b) noexcept
+    {
+        bn = b.bn;
+        b.bn = NULL;
+    }
+
     CBigNum& operator=(const CBigNum& b)
     {
+        if (bn == NULL)
+            init();
         if (!BN_copy(bn, &b))
             throw bignum_error("CBigNum::operator= : BN_copy failed");
         return (*this);
     }
 
+    CBigNum& operator=(CBigNum&& b) noexcept
+    {
+        std::swap(bn, b.bn);
+        return (*this);
+    }
+
 	CBigNum(const char *hexString)
 	{
 		init();
@@ -535,25 +618,69 @@ public:
 
     /**
      * modular exponentiation: this^e mod n
+     * The exponent is treated as secret, with GMP the exponentiation is done in constant time
      * @param e exponent
      * @param m modulus
      */
     CBigNum pow_mod(const CBigNum& e, const CBigNum& m) const {
+        return pow_mod(e, m, false);
+    }
+
+    /**
+     * modular exponentiation with a public exponent: this^e mod n
+     * Variable time, meant for proof verification where all the values are known to everybody
+     * @param e exponent
+     * @param m modulus
+     */
+    CBigNum pow_mod_public(const CBigNum& e, const CBigNum& m) const {
+        return pow_mod(e, m, true);
+    }
+
+private:
+    CBigNum pow_mod(const CBigNum& e, const CBigNum& m, bool fPublicExponent) const {
         CAutoBN_CTX pctx;
         CBigNum ret;
         if( e < 0){
             // g^-x = (g^-1)^x
             CBigNum inv = this->inverse(m);
             CBigNum posE = e * -1;
+#ifdef USE_GMP
+            if (!BN_is_negative(&m) && !BN_is_zero(&m))
+                return inv.pow_mod_gmp(posE, m, fPublicExponent);
+#endif
             if (!BN_mod_exp(&ret, &inv, &posE, &m, pctx))
                 throw bignum_error("CBigNum::pow_mod: BN_mod_exp failed on negative exponent");
-        }else
-        if (!BN_mod_exp(&ret, bn, &e, &m, pctx))
-            throw bignum_error("CBigNum::pow_mod : BN_mod_exp failed");
+        }else {
+#ifdef USE_GMP
+            if (!BN_is_negative(&m) && !BN_is_zero(&m))
+                return pow_mod_gmp(e, m, fPublicExponent);
+#endif
+            if (!BN_mod_exp(&ret, bn, &e, &m, pctx))
+                throw bignum_error("CBigNum::pow_mod : BN_mod_exp failed");
+        }
+
+        return ret;
+    }
 
+#ifdef USE_GMP
+    /**
+     * modular exponentiation done by GMP: this^e mod m, e >= 0, m > 0
+     * mpz_powm_sec() is constant time but needs an odd modulus and a positive exponent, which holds for all
+     * the libzerocoin moduli. Otherwise, and for public exponents, the faster mpz_powm() is used
+     */
+    CBigNum pow_mod_gmp(const CBigNum& e, const CBigNum& m, bool fPublicExponent) const {
+        CAutoMPZ base(bn), exponent(&e), modulus(&m), result;
+        if (fPublicExponent || !BN_is_odd(&m) || BN_is_zero(&e))
+            mpz_powm(result.value, base.value, exponent.value, modulus.value);
+        else
+            mpz_powm_sec(result.value, base.value, exponent.value, modulus.value);
+        CBigNum ret;
+        result.ToBIGNUM(&ret);
         return ret;
     }
+#endif
 
+public:
     /**
      * Calculates the inverse of this element mod m.
      * i.e. i such this*i = 1 mod m
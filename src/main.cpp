@@ -13,6 +13,8 @@
 
 #include "addrman.h"
 #include "arith_uint256.h"
+#include "blockcache.h"
+#include "chaintip.h"
 #include "blockencodings.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -58,6 +60,7 @@
 
 #ifdef ENABLE_ELYSIUM
 #include "elysium/elysium.h"
+#include "elysium/sigma.h"
 #endif
 
 #include <atomic>
@@ -69,6 +72,7 @@
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
 #include <boost/math/distributions/poisson.hpp>
+#include <boost/scope_exit.hpp>
 #include <boost/thread.hpp>
 
 #include <iostream> // delete me
@@ -244,6 +248,7 @@ namespace {
         CBlockIndex *pindex;                                     //!< Optional.
         bool fValidatedHeaders;                                  //!< Whether this block has validated headers at the time of request.
         std::unique_ptr <PartiallyDownloadedBlock> partialBlock;  //!< Optional, used for CMPCTBLOCK downloads
+        int64_t nTimeRequested;                                  //!< When the block was requested (in microseconds).
     };
     map <uint256, pair<NodeId, list<QueuedBlock>::iterator>> mapBlocksInFlight;
 
@@ -321,6 +326,21 @@ namespace {
         int64_t nDownloadingSince;
         int nBlocksInFlight;
         int nBlocksInFlightValidHeaders;
+        //! Adaptive number of blocks that may be in flight from this peer.
+        int nBlocksInFlightLimit;
+        //! Blocks and bytes this peer delivered after we requested them.
+        uint64_t nBlocksDownloaded;
+        uint64_t nBlockBytesDownloaded;
+        //! Time spent with at least one block in flight (in microseconds), excluding the current busy period.
+        int64_t nBlockDownloadMicros;
+        //! Start of the current busy period, or 0 when no block is in flight.
+        int64_t nBlockDownloadBusySince;
+        //! Moving average of the time between requesting and receiving a block (in microseconds).
+        int64_t nBlockLatencyMicros;
+        //! Blocks taken away from this peer because they took too long.
+        uint64_t nBlocksRerequested;
+        //! Don't request blocks from this peer before this time (in microseconds).
+        int64_t nBlockDownloadBackoffUntil;
         //! Whether we consider this a preferred download peer.
         bool fPreferredDownload;
         //! Whether this peer wants invs or headers (when possible) for block announcements.
@@ -357,6 +377,14 @@ namespace {
             nDownloadingSince = 0;
             nBlocksInFlight = 0;
             nBlocksInFlightValidHeaders = 0;
+            nBlocksInFlightLimit = MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+            nBlocksDownloaded = 0;
+            nBlockBytesDownloaded = 0;
+            nBlockDownloadMicros = 0;
+            nBlockDownloadBusySince = 0;
+            nBlockLatencyMicros = 0;
+            nBlocksRerequested = 0;
+            nBlockDownloadBackoffUntil = 0;
             fPreferredDownload = false;
             fPreferHeaders = false;
             fPreferHeaderAndIDs = false;
@@ -429,14 +457,32 @@ namespace {
         }
     }
 
+// Requires cs_main.
+// Adjust a peer's in-flight limit after it delivered a block we asked it for: grow it while
+// the peer keeps up with a full window, shrink it when blocks queue up behind each other.
+    void UpdateBlockDownloadStats(CNodeState *state, const QueuedBlock &queued, const CBlock *pblock, int64_t nNow) {
+        int64_t nLatency = std::max<int64_t>(0, nNow - queued.nTimeRequested);
+        state->nBlockLatencyMicros = GetAverageBlockLatency(state->nBlockLatencyMicros, nLatency, state->nBlocksDownloaded);
+        state->nBlocksDownloaded++;
+        if (pblock)
+            state->nBlockBytesDownloaded += ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION);
+
+        state->nBlocksInFlightLimit = GetAdaptiveBlocksInFlightLimit(state->nBlocksInFlightLimit, state->nBlocksInFlight,
+                                                                     state->nBlockLatencyMicros);
+    }
+
 // Requires cs_main.
 // Returns a bool indicating whether we requested this block.
 // Also used if a block was /not/ received and timed out or started with another peer
-    bool MarkBlockAsReceived(const uint256 &hash) {
+// When nodeFrom is the peer we requested the block from, its download statistics are updated.
+    bool MarkBlockAsReceived(const uint256 &hash, NodeId nodeFrom = -1, const CBlock *pblock = NULL) {
         map < uint256, pair < NodeId, list<QueuedBlock>::iterator > > ::iterator
         itInFlight = mapBlocksInFlight.find(hash);
         if (itInFlight != mapBlocksInFlight.end()) {
             CNodeState *state = State(itInFlight->second.first);
+            int64_t nNow = GetTimeMicros();
+            if (nodeFrom == itInFlight->second.first)
+                UpdateBlockDownloadStats(state, *itInFlight->second.second, pblock, nNow);
             state->nBlocksInFlightValidHeaders -= itInFlight->second.second->fValidatedHeaders;
             if (state->nBlocksInFlightValidHeaders == 0 && itInFlight->second.second->fValidatedHeaders) {
                 // Last validated block on the queue was received.
@@ -444,10 +490,14 @@ namespace {
             }
             if (state->vBlocksInFlight.begin() == itInFlight->second.second) {
                 // First block on the queue was received, update the start download time for the next one
-                state->nDownloadingSince = std::max(state->nDownloadingSince, GetTimeMicros());
+                state->nDownloadingSince = std::max(state->nDownloadingSince, nNow);
             }
             state->vBlocksInFlight.erase(itInFlight->second.second);
             state->nBlocksInFlight--;
+            if (state->nBlocksInFlight == 0 && state->nBlockDownloadBusySince != 0) {
+                state->nBlockDownloadMicros += nNow - state->nBlockDownloadBusySince;
+                state->nBlockDownloadBusySince = 0;
+            }
             state->nStallingSince = 0;
             mapBlocksInFlight.erase(itInFlight);
             return true;
@@ -478,12 +528,14 @@ namespace {
                                                                        {hash, pindex, pindex != NULL,
                                                                         std::unique_ptr<PartiallyDownloadedBlock>(
                                                                                 pit ? new PartiallyDownloadedBlock(
-                                                                                        &mempool) : NULL)});
+                                                                                        &mempool) : NULL),
+                                                                        GetTimeMicros()});
         state->nBlocksInFlight++;
         state->nBlocksInFlightValidHeaders += it->fValidatedHeaders;
         if (state->nBlocksInFlight == 1) {
             // We're starting a block download (batch) from this peer.
-            state->nDownloadingSince = GetTimeMicros();
+            state->nDownloadingSince = it->nTimeRequested;
+            state->nBlockDownloadBusySince = it->nTimeRequested;
         }
         if (state->nBlocksInFlightValidHeaders == 1 && pindex != NULL) {
             nPeersWithValidatedDownloads++;
@@ -689,6 +741,30 @@ namespace {
 
 } // anon namespace
 
+int64_t GetAverageBlockLatency(int64_t nAverageLatency, int64_t nLatency, uint64_t nBlocksDownloaded) {
+    if (nBlocksDownloaded == 0)
+        return nLatency;
+    return (7 * nAverageLatency + nLatency) / 8;
+}
+
+int GetAdaptiveBlocksInFlightLimit(int nLimit, int nBlocksInFlight, int64_t nAverageLatency) {
+    // Grow while the peer keeps up with a full window, shrink when blocks queue up behind each other
+    if (nAverageLatency < BLOCK_DOWNLOAD_TARGET_LATENCY) {
+        if (nBlocksInFlight >= nLimit)
+            return std::min(nLimit + 1, MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+        return nLimit;
+    }
+    return std::max(nLimit - 1, MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+}
+
+int GetReducedBlocksInFlightLimit(int nLimit) {
+    return std::max(nLimit / 2, MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+}
+
+int64_t GetBlockRerequestTimeout(int64_t nAverageLatency) {
+    return std::max<int64_t>(1000000 * BLOCK_REREQUEST_TIMEOUT, 4 * nAverageLatency);
+}
+
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
     LOCK(cs_main);
     CNodeState *state = State(nodeid);
@@ -702,6 +778,14 @@ bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats) {
         if (queue.pindex)
             stats.vHeightInFlight.push_back(queue.pindex->nHeight);
     }
+    stats.nBlocksInFlightLimit = state->nBlocksInFlightLimit;
+    stats.nBlocksDownloaded = state->nBlocksDownloaded;
+    stats.nBlockBytesDownloaded = state->nBlockBytesDownloaded;
+    stats.nBlockDownloadMicros = state->nBlockDownloadMicros;
+    if (state->nBlockDownloadBusySince != 0)
+        stats.nBlockDownloadMicros += GetTimeMicros() - state->nBlockDownloadBusySince;
+    stats.nBlockLatencyMicros = state->nBlockLatencyMicros;
+    stats.nBlocksRerequested = state->nBlocksRerequested;
     return true;
 }
 
@@ -1955,8 +2039,8 @@ GetTransaction(const uint256 &hash, CTransaction &txOut, const Consensus::Params
     if (pindexSlow) {
         CBlock block;
         if (ReadBlockFromDisk(block, pindexSlow, consensusParams)) {
-            BOOST_FOREACH(
-            const CTransaction &tx, block.vtx) {
+            for (const CTransactionRef &ptx: block.vtx) {
+                const CTransaction &tx = *ptx;
                 if (tx.GetHash() == hash) {
                     txOut = tx;
                     hashBlock = pindexSlow->GetBlockHash();
@@ -2048,17 +2132,20 @@ bool WriteBlockToDisk(const CBlock &block, CDiskBlockPos &pos, const CMessageHea
 bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, int nHeight, const Consensus::Params &consensusParams) {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull())
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    // Deserialize straight from the memory mapped block file if possible, fall back to reading the file
+    if (!blockFileReader.ReadBlock(block, pos)) {
+        // Open history file to read
+        CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
 
-    // Read block
-    try {
-        filein >> block;
-    }
-    catch (const std::exception &e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            filein >> block;
+        }
+        catch (const std::exception &e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
@@ -2072,6 +2159,9 @@ bool ReadBlockFromDisk(CBlock &block, const CDiskBlockPos &pos, int nHeight, con
 }
 
 bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus::Params &consensusParams) {
+    if (blockCache.Get(pindex->GetBlockHash(), block))
+        return true;
+
     if (!ReadBlockFromDisk(block, pindex->GetBlockPos(), pindex->nHeight, consensusParams))
         return false;
 
@@ -2079,6 +2169,7 @@ bool ReadBlockFromDisk(CBlock &block, const CBlockIndex *pindex, const Consensus
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
                      pindex->ToString(), pindex->GetBlockPos().ToString());
     }
+    blockCache.Insert(pindex->GetBlockHash(), block);
     return true;
 }
 
@@ -2640,7 +2731,7 @@ bool DisconnectBlock(const CBlock &block, CValidationState &state, const CBlockI
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
-        const CTransaction &tx = block.vtx[i];
+        const CTransaction &tx = *block.vtx[i];
 
         uint256 hash = tx.GetHash();
 
@@ -2700,7 +2791,7 @@ bool DisconnectBlock(const CBlock &block, CValidationState &state, const CBlockI
                 AbortNode(state, "Failed to write address unspent index");
                 return error("Failed to write address unspent index");
             }
-            if (!pblocktree->AddTotalSupply(-(block.vtx[0].GetValueOut() - nFees))) {
+            if (!pblocktree->AddTotalSupply(-(block.vtx[0]->GetValueOut() - nFees))) {
                 AbortNode(state, "Failed to write total supply");
                 return error("Failed to write total supply");
             }
@@ -2829,11 +2920,11 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
         return true;
     }
 	// Set proof-of-stake hash modifier
-    pindex->nStakeModifier = ComputeStakeModifier(pindex->pprev, block.IsProofOfStake() ? block.vtx[1].vin[0].prevout.hash : block.GetHash());
+    pindex->nStakeModifier = ComputeStakeModifier(pindex->pprev, block.IsProofOfStake() ? block.vtx[1]->vin[0].prevout.hash : block.GetHash());
 
     // Check proof-of-stake
     if (block.IsProofOfStake()) {
-         const COutPoint &prevout = block.vtx[1].vin[0].prevout;
+         const COutPoint &prevout = block.vtx[1]->vin[0].prevout;
          const CCoins *coins = view.AccessCoins(prevout.hash);
           if (!coins)
               return state.DoS(100, error("ConnectBlock(): kernel input unavailable"),
@@ -2847,7 +2938,7 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
          if(!CheckStakeBlockTimestamp(block.nTime))
               return state.DoS(100, error("ConnectBlock(): proof-of-stake time check failed"),
                                  REJECT_INVALID, "bad-cs-timecheck");
-        if (!CheckProofOfStake(pindex->pprev, block.vtx[1], block.nTime, block.nBits, state,mapBlockIndex[block.hashPrevBlock]))
+        if (!CheckProofOfStake(pindex->pprev, *block.vtx[1], block.nTime, block.nBits, state,mapBlockIndex[block.hashPrevBlock]))
               return state.DoS(100, error("ConnectBlock(): proof-of-stake check failed"),
                                  REJECT_INVALID, "bad-cs-proofhash");
         
@@ -2886,8 +2977,8 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
     // If we're on the known chain at height greater than where BIP34 activated, we can save the db accesses needed for the BIP30 check.
     bool fEnforceBIP30 = true;
     if (fEnforceBIP30) {
-        BOOST_FOREACH(
-        const CTransaction &tx, block.vtx) {
+        for (const CTransactionRef &ptx: block.vtx) {
+            const CTransaction &tx = *ptx;
             const CCoins *coins = view.AccessCoins(tx.GetHash());
             if (coins && !coins->IsPruned())
                 return state.DoS(100, error("ConnectBlock(): tried to overwrite transaction"), REJECT_INVALID,
@@ -2961,8 +3052,11 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
     block.zerocoinTxInfo = std::make_shared<CZerocoinTxInfo>();
     block.sigmaTxInfo = std::make_shared<sigma::CSigmaTxInfo>();
 
+    // Same as with scripts legacy zerocoin spend proofs are not verified below the checkpoint, serials are still tracked
+    block.zerocoinTxInfo->fAssumeValidProofs = fCheckpointsEnabled && IsZerocoinProofAssumedValid(pindex, chainparams.Checkpoints());
+
     for (unsigned int i = 0; i < block.vtx.size(); i++) {
-        const CTransaction &tx = block.vtx[i];
+        const CTransaction &tx = *block.vtx[i];
 
         uint256 txHash = tx.GetHash();
         if (txIds.count(txHash) > 0)
@@ -3062,9 +3156,9 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
     //btzc: Add time to check
     CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight);
 	if (block.IsProofOfWork()) {
-        if (block.vtx[0].GetValueOut() > blockReward)
+        if (block.vtx[0]->GetValueOut() > blockReward)
             return state.DoS(100, error("ConnectBlock(): coinbase pays too much (actual=%d vs limit=%d)",
-                                        block.vtx[0].GetValueOut(), blockReward),
+                                        block.vtx[0]->GetValueOut(), blockReward),
                              REJECT_INVALID, "bad-cb-amount");
     }
 
@@ -3117,7 +3211,7 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
         if (!pblocktree->UpdateAddressUnspentIndex(dbIndexHelper.getAddressUnspentIndex()))
             return AbortNode(state, "Failed to write address unspent index");
 
-        if (!pblocktree->AddTotalSupply(block.vtx[0].GetValueOut() - nFees))
+        if (!pblocktree->AddTotalSupply(block.vtx[0]->GetValueOut() - nFees))
             return AbortNode(state, "Failed to write total supply");
     }
 
@@ -3140,7 +3234,7 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
     // Watch for changes to the previous coinbase transaction.
     static uint256 hashPrevBestCoinBase;
     GetMainSignals().UpdatedTransaction(hashPrevBestCoinBase);
-    hashPrevBestCoinBase = block.vtx[0].GetHash();
+    hashPrevBestCoinBase = block.vtx[0]->GetHash();
 
     // Erase orphan transactions include or precluded by this block
     if (vOrphanErase.size()) {
@@ -3155,7 +3249,8 @@ bool ConnectBlock(const CBlock &block, CValidationState &state, CBlockIndex *pin
     // Erase conflicting zerocoin txs from the mempool
     CZerocoinState *zcState = CZerocoinState::GetZerocoinState();
     sigma::CSigmaState *sigmaState = sigma::CSigmaState::GetState();
-    BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+    for (const CTransactionRef &ptx: block.vtx) {
+        const CTransaction &tx = *ptx;
         if (tx.IsZerocoinSpend() || tx.IsZerocoinRemint()) {
             BOOST_FOREACH(
             const CTxIn &txin, tx.vin)
@@ -3271,11 +3366,29 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
         // It's been very long since we flushed the cache. Do this infrequently, to optimize cache usage.
         bool fPeriodicFlush =
                 mode == FLUSH_STATE_PERIODIC && nNow > nLastFlush + (int64_t) DATABASE_FLUSH_INTERVAL * 1000000;
-        // Combine all conditions that result in a full cache flush.
+        // Combine all conditions that result in the chainstate being written.
         bool fDoFullFlush =
                 (mode == FLUSH_STATE_ALWAYS) || fCacheLarge || fCacheCritical || fPeriodicFlush || fFlushForPrune;
+        // The cache is filling up: write a part of the modified entries now so that the cache never has to be
+        // written all at once. The coins database is only consistent with a block again after the next full
+        // flush, until then an interrupted node replays the blocks on startup.
+        bool fDoPartialFlush = !fDoFullFlush && (mode == FLUSH_STATE_IF_NEEDED || mode == FLUSH_STATE_PERIODIC) &&
+                cacheSize > nCoinCacheUsage / 100 * COINS_CACHE_PARTIAL_FLUSH_PERCENT;
+        if (fDoPartialFlush) {
+            // Everything written since the last full flush has to come from blocks of the current chain
+            std::vector<uint256> vhashHeads = pcoinsTip->GetHeadBlocks();
+            if (!vhashHeads.empty()) {
+                BlockMap::iterator itHead = mapBlockIndex.find(vhashHeads[0]);
+                BlockMap::iterator itBest = mapBlockIndex.find(pcoinsTip->GetBestBlock());
+                if (itHead == mapBlockIndex.end() || itBest == mapBlockIndex.end() ||
+                        itBest->second->GetAncestor(itHead->second->nHeight) != itHead->second) {
+                    fDoPartialFlush = false;
+                    fDoFullFlush = true;
+                }
+            }
+        }
         // Write blocks and block index to disk.
-        if (fDoFullFlush || fPeriodicWrite) {
+        if (fDoFullFlush || fDoPartialFlush || fPeriodicWrite) {
             // Depend on nMinDiskSpace to ensure we can write block index
             if (!CheckDiskSpace(0))
                 return state.Error("out of disk space");
@@ -3292,6 +3405,8 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 std::vector<const CBlockIndex *> vBlocks;
                 vBlocks.reserve(setDirtyBlockIndex.size());
                 for (set<CBlockIndex *>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end();) {
+                    // Entries below the zerocoin snapshot have to get their mint data back before being rewritten
+                    ZerocoinLoadIndexData(*it);
                     vBlocks.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
@@ -3304,6 +3419,17 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                 UnlinkPrunedFiles(setFilesToPrune);
             nLastWrite = nNow;
         }
+        // Write a part of the chainstate. Like the full flush, this needs the block index written first.
+        if (fDoPartialFlush) {
+            size_t nWritten = 0;
+            if (!CheckDiskSpace(nCoinCacheUsage / 100 * COINS_CACHE_PARTIAL_WRITE_PERCENT * 2))
+                return state.Error("out of disk space");
+            if (!pcoinsTip->SyncPartial(nCoinCacheUsage / 100 * COINS_CACHE_PARTIAL_WRITE_PERCENT, nWritten))
+                return AbortNode(state, "Failed to write to coin database");
+            size_t nEvicted = pcoinsTip->Trim(nCoinCacheUsage / 100 * COINS_CACHE_TRIM_PERCENT);
+            LogPrint("coindb", "Wrote %.1fMiB of the coins cache, evicted %u entries, %.1fMiB left\n",
+                     nWritten * (1.0 / 1024 / 1024), nEvicted, pcoinsTip->DynamicMemoryUsage() * (1.0 / 1024 / 1024));
+        }
         // Flush best chain related state. This can only be done if the blocks / block index write was also done.
         if (fDoFullFlush) {
             // Typical CCoins structures on disk are around 128 bytes in size.
@@ -3311,12 +3437,24 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             // twice (once in the log, and once in the tables). This is already
             // an overestimation, as most will delete an existing entry or
             // overwrite one. Still, use a conservative safety factor of 2.
-            if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
+            if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetDirtyCacheSize()))
                 return state.Error("out of disk space");
-            // Flush the chainstate (which may refer to block index entries).
-            if (!pcoinsTip->Flush())
+            // Write the modified part of the chainstate (which may refer to block index entries).
+            // Entries stay cached so the next blocks don't have to read them back from disk.
+            if (!pcoinsTip->Sync())
                 return AbortNode(state, "Failed to write to coin database");
+            if (fCacheLarge || fCacheCritical) {
+                // Only drop as many unmodified entries as needed to get well below the limit
+                size_t nEvicted = pcoinsTip->Trim(nCoinCacheUsage / 100 * COINS_CACHE_TRIM_PERCENT);
+                LogPrint("coindb", "Evicted %u entries from the coins cache, %.1fMiB left\n",
+                         nEvicted, pcoinsTip->DynamicMemoryUsage() * (1.0 / 1024 / 1024));
+            }
             nLastFlush = nNow;
+            // Zerocoin state matches the best block of the coins database which may be ahead of chainActive
+            // in the middle of ConnectTip()/DisconnectTip(). Failure to write the snapshot isn't fatal
+            BlockMap::iterator itBest = mapBlockIndex.find(pcoinsTip->GetBestBlock());
+            if (itBest != mapBlockIndex.end())
+                ZerocoinWriteStateSnapshotIfNeeded(itBest->second);
         }
         if (fDoFullFlush || ((mode == FLUSH_STATE_ALWAYS || mode == FLUSH_STATE_PERIODIC) &&
                              nNow > nLastSetChain + (int64_t) DATABASE_WRITE_INTERVAL * 1000000)) {
@@ -3345,6 +3483,7 @@ void PruneAndFlush() {
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams &chainParams) {
     LogPrintf("UpdateTip() pindexNew.nHeight=%s\n", pindexNew->nHeight);
     chainActive.SetTip(pindexNew);
+    PublishChainTipSnapshot(pindexNew);
     GetMainSignals().UpdatedBlockTip(chainActive.Tip());
 
     // New best block
@@ -3424,7 +3563,7 @@ bool static DisconnectTip(CValidationState &state, const CChainParams &chainpara
     // retrieve all mints
     block.sigmaTxInfo = std::make_shared<sigma::CSigmaTxInfo>();
     for (auto const& tx : block.vtx) {
-        CheckTransaction(tx, state, tx.GetHash(), false, pindexDelete->pprev->nHeight,
+        CheckTransaction(*tx, state, tx->GetHash(), false, pindexDelete->pprev->nHeight,
             false, false, nullptr, block.sigmaTxInfo.get());
     }
 
@@ -3448,7 +3587,8 @@ bool static DisconnectTip(CValidationState &state, const CChainParams &chainpara
     if (!fBare) {
         // Resurrect mempool transactions from the disconnected block.
         std::vector <uint256> vHashUpdate;
-        BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+        for (const CTransactionRef &ptx: block.vtx) {
+            const CTransaction &tx = *ptx;
             // ignore validation errors in resurrected transactions
             list <CTransaction> removed;
             CValidationState stateDummy;
@@ -3515,7 +3655,8 @@ bool static DisconnectTip(CValidationState &state, const CChainParams &chainpara
 
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
-    BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+    for (const CTransactionRef &ptx: block.vtx) {
+        const CTransaction &tx = *ptx;
         SyncWithWallets(tx, pindexDelete->pprev, NULL);
     }
 
@@ -3617,9 +3758,21 @@ ConnectTip(CValidationState &state, const CChainParams &chainparams, CBlockIndex
     const CTransaction &tx, txConflicted) {
         SyncWithWallets(tx, pindexNew, NULL);
     }
+#ifdef ENABLE_ELYSIUM
+    //! Elysium: verify the Sigma spends of the block in batches
+    if (fElysium) {
+        elysium_handler_block_spends(GetHeight(), *pblock, pindexNew);
+    }
+
+    //! Elysium: the results are only valid within the block, also if connecting it is aborted
+    BOOST_SCOPE_EXIT(void) {
+        elysium::ClearSigmaSpendBatch();
+    } BOOST_SCOPE_EXIT_END
+#endif
+
     // ... and about transactions that got confirmed:
-    BOOST_FOREACH(
-    const CTransaction &tx, pblock->vtx) {
+    for (const CTransactionRef &ptx: pblock->vtx) {
+        const CTransaction &tx = *ptx;
         SyncWithWallets(tx, pindexNew, pblock);
 
 #ifdef ENABLE_ELYSIUM
@@ -3712,26 +3865,28 @@ bool DisconnectBlocks(int blocks) {
 }
 
 void ReprocessBlocks(int nBlocks) {
-    LOCK(cs_main);
+    {
+        LOCK(cs_main);
 
-    std::map<uint256, int64_t>::iterator it = mapRejectedBlocks.begin();
-    while (it != mapRejectedBlocks.end()) {
-        //use a window twice as large as is usual for the nBlocks we want to reset
-        if ((*it).second > GetTime() - (nBlocks * 60 * 5)) {
-            BlockMap::iterator mi = mapBlockIndex.find((*it).first);
-            if (mi != mapBlockIndex.end() && (*mi).second) {
+        std::map<uint256, int64_t>::iterator it = mapRejectedBlocks.begin();
+        while (it != mapRejectedBlocks.end()) {
+            //use a window twice as large as is usual for the nBlocks we want to reset
+            if ((*it).second > GetTime() - (nBlocks * 60 * 5)) {
+                BlockMap::iterator mi = mapBlockIndex.find((*it).first);
+                if (mi != mapBlockIndex.end() && (*mi).second) {
 
-                CBlockIndex *pindex = (*mi).second;
-                LogPrintf("ReprocessBlocks -- %s\n", (*it).first.ToString());
+                    CBlockIndex *pindex = (*mi).second;
+                    LogPrintf("ReprocessBlocks -- %s\n", (*it).first.ToString());
 
-                CValidationState state;
-                ReconsiderBlock(state, pindex);
+                    CValidationState state;
+                    ReconsiderBlock(state, pindex);
+                }
             }
+            ++it;
         }
-        ++it;
-    }
 
-    DisconnectBlocks(nBlocks);
+        DisconnectBlocks(nBlocks);
+    }
 
     CValidationState state;
     ActivateBestChain(state, Params());
@@ -3943,6 +4098,10 @@ bool ActivateBestChain(CValidationState &state, const CChainParams &chainparams,
         if (ShutdownRequested())
             break;
 
+        // Don't connect further blocks while the listeners are falling behind, so the
+        // notifications of a long reorg or a reindex don't pile up in memory
+        LimitValidationInterfaceQueue();
+
         const CBlockIndex *pindexFork;
         bool fInitialDownload;
         int nNewHeight;
@@ -4349,7 +4508,7 @@ bool GetBlockPublicKey(const CBlock& block, std::vector<unsigned char>& vchPubKe
         return error("Block signature is empty for PoS Block\n");
     
     vector<vector<unsigned char> > vSolutions;
-    const CTxOut& txout = block.vtx[1].vout[1];
+    const CTxOut& txout = block.vtx[1]->vout[1];
     txnouttype whichType;
     Solver(txout.scriptPubKey,whichType, vSolutions);
 
@@ -4470,27 +4629,27 @@ bool CheckBlock(const CBlock &block, CValidationState &state,
             return state.DoS(100, false, REJECT_INVALID, "bad-blk-length", false, "size limits failed");
         }
         // First transaction must be coinbase, the rest must not be
-        if (block.vtx.empty() || !block.vtx[0].IsCoinBase()) {
+        if (block.vtx.empty() || !block.vtx[0]->IsCoinBase()) {
             LogPrintf("CheckBlock - first tx is not coinbase -> failed!\n");
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-missing", false, "first tx is not coinbase");
         }
         for (unsigned int i = 1; i < block.vtx.size(); i++) {
-            if (block.vtx[i].IsCoinBase()) {
+            if (block.vtx[i]->IsCoinBase()) {
                 LogPrintf("CheckBlock - more than one coinbase -> failed!\n");
                 return state.DoS(100, false, REJECT_INVALID, "bad-cb-multiple", false, "more than one coinbase");
             }
         }
 		if (block.IsProofOfStake()) {
             // Coinbase output must be empty if proof-of-stake block
-            if (block.vtx[0].vout.size() != 1 || !block.vtx[0].vout[0].IsEmpty())
+            if (block.vtx[0]->vout.size() != 1 || !block.vtx[0]->vout[0].IsEmpty())
                 return state.DoS(100, false, REJECT_INVALID, "bad-cb-not-empty", false, "coinbase output not empty for proof-of-stake block");
 
             // Second transaction must be coinstake, the rest must not be
-            if (block.vtx.size() < 2 || !block.vtx[1].IsCoinStake())
+            if (block.vtx.size() < 2 || !block.vtx[1]->IsCoinStake())
                 return state.DoS(100, false, REJECT_INVALID, "bad-cs-missing", false, "second tx is not coinstake");
 
             for (unsigned int i = 2; i < block.vtx.size(); i++)
-                if (block.vtx[i].IsCoinStake())
+                if (block.vtx[i]->IsCoinStake())
                 return state.DoS(100, false, REJECT_INVALID, "bad-cs-multiple", false, "more than one coinstake");
         }
 
@@ -4504,12 +4663,13 @@ bool CheckBlock(const CBlock &block, CValidationState &state,
         // Check transactions
         if (nHeight == INT_MAX)
             nHeight = ZerocoinGetNHeight(block.GetBlockHeader());
-        CTransaction genOutTx = block.IsProofOfStake() ? block.vtx[1]:block.vtx[0];
+        const CTransaction &genOutTx = block.IsProofOfStake() ? *block.vtx[1] : *block.vtx[0];
         if (!CheckZerocoinFoundersInputs(genOutTx, state, Params().GetConsensus(), nHeight)) {
             return state.Invalid(false, state.GetRejectCode(), state.GetRejectReason(), "Founders' reward check failed");
         }
 
-        BOOST_FOREACH(const CTransaction &tx, block.vtx) {
+        for (const CTransactionRef &ptx: block.vtx) {
+            const CTransaction &tx = *ptx;
             // We don't check transactions against zerocoin state here, we'll check it again later in ConnectBlock
             if (!CheckTransaction(tx, state, tx.GetHash(), isVerifyDB, nHeight, false, false, NULL, NULL)) {
                 LogPrintf("block=%s\n", block.ToString());
@@ -4520,9 +4680,8 @@ bool CheckBlock(const CBlock &block, CValidationState &state,
         }
 
         unsigned int nSigOps = 0;
-        BOOST_FOREACH(
-        const CTransaction &tx, block.vtx)
-        {
+        for (const CTransactionRef &ptx: block.vtx) {
+            const CTransaction &tx = *ptx;
             nSigOps += GetLegacySigOpCount(tx);
         }
         if (nSigOps * WITNESS_SCALE_FACTOR > MAX_BLOCK_SIGOPS_COST)
@@ -4569,11 +4728,11 @@ bool IsWitnessEnabled(const CBlockIndex *pindexPrev, const Consensus::Params &pa
 // commitment occurs, or -1 if not found.
 static int GetWitnessCommitmentIndex(const CBlock &block) {
     int commitpos = -1;
-    for (size_t o = 0; o < block.vtx[0].vout.size(); o++) {
-        if (block.vtx[0].vout[o].scriptPubKey.size() >= 38 && block.vtx[0].vout[o].scriptPubKey[0] == OP_RETURN &&
-            block.vtx[0].vout[o].scriptPubKey[1] == 0x24 && block.vtx[0].vout[o].scriptPubKey[2] == 0xaa &&
-            block.vtx[0].vout[o].scriptPubKey[3] == 0x21 && block.vtx[0].vout[o].scriptPubKey[4] == 0xa9 &&
-            block.vtx[0].vout[o].scriptPubKey[5] == 0xed) {
+    for (size_t o = 0; o < block.vtx[0]->vout.size(); o++) {
+        if (block.vtx[0]->vout[o].scriptPubKey.size() >= 38 && block.vtx[0]->vout[o].scriptPubKey[0] == OP_RETURN &&
+            block.vtx[0]->vout[o].scriptPubKey[1] == 0x24 && block.vtx[0]->vout[o].scriptPubKey[2] == 0xaa &&
+            block.vtx[0]->vout[o].scriptPubKey[3] == 0x21 && block.vtx[0]->vout[o].scriptPubKey[4] == 0xa9 &&
+            block.vtx[0]->vout[o].scriptPubKey[5] == 0xed) {
             commitpos = o;
         }
     }
@@ -4584,10 +4743,12 @@ void UpdateUncommittedBlockStructures(CBlock &block, const CBlockIndex *pindexPr
                                       const Consensus::Params &consensusParams) {
     int commitpos = GetWitnessCommitmentIndex(block);
     static const std::vector<unsigned char> nonce(32, 0x00);
-    if (commitpos != -1 && IsWitnessEnabled(pindexPrev, consensusParams) && block.vtx[0].wit.IsEmpty()) {
-        block.vtx[0].wit.vtxinwit.resize(1);
-        block.vtx[0].wit.vtxinwit[0].scriptWitness.stack.resize(1);
-        block.vtx[0].wit.vtxinwit[0].scriptWitness.stack[0] = nonce;
+    if (commitpos != -1 && IsWitnessEnabled(pindexPrev, consensusParams) && block.vtx[0]->wit.IsEmpty()) {
+        CMutableTransaction tx(*block.vtx[0]);
+        tx.wit.vtxinwit.resize(1);
+        tx.wit.vtxinwit[0].scriptWitness.stack.resize(1);
+        tx.wit.vtxinwit[0].scriptWitness.stack[0] = nonce;
+        block.vtx[0] = MakeTransactionRef(std::move(tx));
     }
 }
 
@@ -4612,8 +4773,9 @@ GenerateCoinbaseCommitment(CBlock &block, const CBlockIndex *pindexPrev, const C
             memcpy(&out.scriptPubKey[6], witnessroot.begin(), 32);
             commitment = std::vector < unsigned
             char > (out.scriptPubKey.begin(), out.scriptPubKey.end());
-            const_cast<std::vector <CTxOut> *>(&block.vtx[0].vout)->push_back(out);
-            block.vtx[0].UpdateHash();
+            CMutableTransaction tx(*block.vtx[0]);
+            tx.vout.push_back(out);
+            block.vtx[0] = MakeTransactionRef(std::move(tx));
         }
     }
     UpdateUncommittedBlockStructures(block, pindexPrev, consensusParams);
@@ -4691,8 +4853,8 @@ bool ContextualCheckBlock(const CBlock &block, CValidationState &state, CBlockIn
                               : block.GetBlockTime();
 
     // Check that all transactions are finalized
-    BOOST_FOREACH(
-    const CTransaction &tx, block.vtx) {
+    for (const CTransactionRef &ptx: block.vtx) {
+        const CTransaction &tx = *ptx;
         if (!IsFinalTx(tx, nHeight, nLockTimeCutoff)) {
             return state.DoS(10, false, REJECT_INVALID, "bad-txns-nonfinal", false, "non-final transaction");
         }
@@ -4704,8 +4866,8 @@ bool ContextualCheckBlock(const CBlock &block, CValidationState &state, CBlockIn
         IsSuperMajority(2, pindexPrev, consensusParams.nMajorityEnforceBlockUpgrade, consensusParams)) {
         CScript expect = CScript() << nHeight;
 //        LogPrintf("block.vtx[0].vin[0].scriptSig.begin()=%s\n", block.vtx[0].vin[0].scriptSig.begin());
-        if (block.vtx[0].vin[0].scriptSig.size() < expect.size() ||
-            !std::equal(expect.begin(), expect.end(), block.vtx[0].vin[0].scriptSig.begin())) {
+        if (block.vtx[0]->vin[0].scriptSig.size() < expect.size() ||
+            !std::equal(expect.begin(), expect.end(), block.vtx[0]->vin[0].scriptSig.begin())) {
             return state.DoS(100, false, REJECT_INVALID, "bad-cb-height", false, "block height mismatch in coinbase");
         }
     }
@@ -4727,14 +4889,14 @@ bool ContextualCheckBlock(const CBlock &block, CValidationState &state, CBlockIn
             // The malleation check is ignored; as the transaction tree itself
             // already does not permit it, it is impossible to trigger in the
             // witness tree.
-            if (block.vtx[0].wit.vtxinwit.size() != 1 || block.vtx[0].wit.vtxinwit[0].scriptWitness.stack.size() != 1 ||
-                block.vtx[0].wit.vtxinwit[0].scriptWitness.stack[0].size() != 32) {
+            if (block.vtx[0]->wit.vtxinwit.size() != 1 || block.vtx[0]->wit.vtxinwit[0].scriptWitness.stack.size() != 1 ||
+                block.vtx[0]->wit.vtxinwit[0].scriptWitness.stack[0].size() != 32) {
                 return state.DoS(100, error("%s : invalid witness nonce size", __func__), REJECT_INVALID,
                                  "bad-witness-nonce-size", true);
             }
-            CHash256().Write(hashWitness.begin(), 32).Write(&block.vtx[0].wit.vtxinwit[0].scriptWitness.stack[0][0],
+            CHash256().Write(hashWitness.begin(), 32).Write(&block.vtx[0]->wit.vtxinwit[0].scriptWitness.stack[0][0],
                                                             32).Finalize(hashWitness.begin());
-            if (memcmp(hashWitness.begin(), &block.vtx[0].vout[commitpos].scriptPubKey[6], 32)) {
+            if (memcmp(hashWitness.begin(), &block.vtx[0]->vout[commitpos].scriptPubKey[6], 32)) {
                 return state.DoS(100, error("%s : witness merkle commitment mismatch", __func__), REJECT_INVALID,
                                  "bad-witness-merkle-match", true);
             }
@@ -4745,7 +4907,7 @@ bool ContextualCheckBlock(const CBlock &block, CValidationState &state, CBlockIn
     // No witness data is allowed in blocks that don't commit to witness data, as this would otherwise leave room for spam
     if (!fHaveWitness) {
         for (size_t i = 0; i < block.vtx.size(); i++) {
-            if (!block.vtx[i].wit.IsNull()) {
+            if (!block.vtx[i]->wit.IsNull()) {
                 return state.DoS(100, error("%s : unexpected witness data found", __func__), REJECT_INVALID,
                                  "unexpected-witness", true);
             }
@@ -4774,12 +4936,12 @@ bool CheckStake(CBlock* pblock, CWallet& wallet, const CChainParams& chainparams
 
     CValidationState state;
     // verify hash target and signature of coinstake tx
-    if (!CheckProofOfStake(mapBlockIndex[pblock->hashPrevBlock], pblock->vtx[1], pblock->nTime, pblock->nBits, state,mapBlockIndex[pblock->hashPrevBlock]))
+    if (!CheckProofOfStake(mapBlockIndex[pblock->hashPrevBlock], *pblock->vtx[1], pblock->nTime, pblock->nBits, state,mapBlockIndex[pblock->hashPrevBlock]))
         return error("CheckStake() : proof-of-stake checking failed");
 
     //// debug print
     LogPrintf("%s\n", pblock->ToString());
-    LogPrintf("out %s\n", FormatMoney(pblock->vtx[1].GetValueOut()));
+    LogPrintf("out %s\n", FormatMoney(pblock->vtx[1]->GetValueOut()));
 
     // Found a solution
     {
@@ -4792,11 +4954,12 @@ bool CheckStake(CBlock* pblock, CWallet& wallet, const CChainParams& chainparams
             LOCK(wallet.cs_wallet);
             wallet.mapRequestCount[hashBlock] = 0;
         }
-        // Process this block the same as if we had received it from another node
-        if (!ProcessNewBlock(state, chainparams, NULL, pblock, true, NULL, false))
-            return error("CheckStake() : ProcessNewBlock, block not accepted");
     }
 
+    // Process this block the same as if we had received it from another node, without cs_main held
+    if (!ProcessNewBlock(state, chainparams, NULL, pblock, true, NULL, false))
+        return error("CheckStake() : ProcessNewBlock, block not accepted");
+
     return true;
 }
 
@@ -4814,7 +4977,7 @@ bool SignBlock(CBlock& block, CWallet& wallet, int64_t& nFees, CBlockTemplate *p
     static int64_t nLastCoinStakeSearchTime = GetAdjustedTime(); // startup timestamp
 
     CKey key;
-    CMutableTransaction txCoinBase(block.vtx[0]);
+    CMutableTransaction txCoinBase(*block.vtx[0]);
     CMutableTransaction txCoinStake;
 
     int64_t nStakeTime = GetAdjustedTime();
@@ -4829,9 +4992,9 @@ bool SignBlock(CBlock& block, CWallet& wallet, int64_t& nFees, CBlockTemplate *p
                 // make sure coinstake would meet timestamp protocol
                 // as it would be the same as the block timestamp
                 block.nTime = nSearchTime;
-                block.vtx[0] = txCoinBase;
+                block.vtx[0] = MakeTransactionRef(std::move(txCoinBase));
 
-                block.vtx.insert(block.vtx.begin() + 1, txCoinStake);
+                block.vtx.insert(block.vtx.begin() + 1, MakeTransactionRef(std::move(txCoinStake)));
 
                 block.hashMerkleRoot = BlockMerkleRoot(block);
                 // append a signature to our block
@@ -5007,7 +5170,7 @@ bool ProcessNewBlock(CValidationState &state, const CChainParams &chainparams, C
     //    LogPrint("ProcessNewBlock", "block=%s", pblock->ToString());
     {
         LOCK(cs_main);
-        bool fRequested = MarkBlockAsReceived(pblock->GetHash());
+        bool fRequested = MarkBlockAsReceived(pblock->GetHash(), pfrom ? pfrom->GetId() : -1, pblock);
         fRequested |= fForceProcessing;
 
         // Store to disk
@@ -5110,6 +5273,7 @@ void PruneOneBlockFile(const int fileNumber) {
 void UnlinkPrunedFiles(std::set<int> &setFilesToPrune) {
     for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+        blockFileReader.Invalidate(*it);
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -5226,6 +5390,68 @@ CBlockIndex *InsertBlockIndex(uint256 hash) {
     return pindexNew;
 }
 
+/** Apply the coin changes of a block to a view that may already contain some of them */
+static void RollforwardBlock(const CBlock &block, const CBlockIndex *pindex, CCoinsViewCache &view) {
+    BOOST_FOREACH(const CTransactionRef &ptx, block.vtx) {
+        const CTransaction &tx = *ptx;
+        if (!tx.IsCoinBase() && !tx.IsZerocoinSpend() && !tx.IsSigmaSpend() && !tx.IsZerocoinRemint()) {
+            BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+                // The output may have been spent on disk already
+                view.ModifyCoins(txin.prevout.hash)->Spend(txin.prevout.n);
+            }
+        }
+        // Overwrite whatever was written for this transaction, later blocks spend it again
+        view.ModifyCoins(tx.GetHash())->FromTx(tx, pindex->nHeight);
+    }
+}
+
+/**
+ * Finish a chainstate write interrupted after some of the batches of CCoinsViewCache::Sync()/SyncPartial().
+ * The coins database then holds the coins of its old best block with changes from blocks up to the recorded
+ * new tip applied on top, so the blocks in between are applied again.
+ */
+static bool ReplayBlocks(const CChainParams &chainparams, CCoinsViewCache *view) {
+    std::vector<uint256> vhashHeads = view->GetHeadBlocks();
+    if (vhashHeads.empty())
+        return true;
+    if (vhashHeads.size() != 2)
+        return error("%s: unknown inconsistent coins database state", __func__);
+
+    BlockMap::iterator itNew = mapBlockIndex.find(vhashHeads[0]);
+    if (itNew == mapBlockIndex.end())
+        return error("%s: coins database head block %s not found", __func__, vhashHeads[0].ToString());
+    const CBlockIndex *pindexNew = itNew->second;
+    const CBlockIndex *pindexOld = NULL;
+    if (!vhashHeads[1].IsNull()) {
+        BlockMap::iterator itOld = mapBlockIndex.find(vhashHeads[1]);
+        if (itOld == mapBlockIndex.end())
+            return error("%s: coins database best block %s not found", __func__, vhashHeads[1].ToString());
+        pindexOld = itOld->second;
+        // Partial writes only ever move the coins database forward along one chain
+        if (pindexNew->GetAncestor(pindexOld->nHeight) != pindexOld)
+            return error("%s: coins database head %s doesn't descend from %s, reindex the chainstate", __func__,
+                         pindexNew->GetBlockHash().ToString(), pindexOld->GetBlockHash().ToString());
+    }
+
+    uiInterface.ShowProgress(_("Replaying blocks..."), 0);
+    int nStartHeight = pindexOld ? pindexOld->nHeight + 1 : 1;
+    LogPrintf("Replaying blocks %d to %d of an interrupted coins database write\n", nStartHeight, pindexNew->nHeight);
+    CCoinsViewCache cache(view);
+    for (int nHeight = nStartHeight; nHeight <= pindexNew->nHeight; nHeight++) {
+        const CBlockIndex *pindex = pindexNew->GetAncestor(nHeight);
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
+            return error("%s: failed to read block %s", __func__, pindex->GetBlockHash().ToString());
+        RollforwardBlock(block, pindex, cache);
+        uiInterface.ShowProgress(_("Replaying blocks..."),
+                                 (nHeight - nStartHeight + 1) * 100 / (pindexNew->nHeight - nStartHeight + 1));
+    }
+    cache.SetBestBlock(pindexNew->GetBlockHash());
+    uiInterface.ShowProgress("", 100);
+    // Writing the replayed coins with the best block clears the head blocks
+    return cache.Flush() && view->Flush();
+}
+
 bool static LoadBlockIndexDB() {
     LogPrintf("LoadBlockIndexDB\n");
     const CChainParams &chainparams = Params();
@@ -5338,6 +5564,9 @@ bool static LoadBlockIndexDB() {
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
 
+    if (!ReplayBlocks(chainparams, pcoinsTip))
+        return false;
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end()) {
@@ -5356,6 +5585,10 @@ bool static LoadBlockIndexDB() {
         setDirtyBlockIndex.insert(changes.begin(), changes.end());
         FlushStateToDisk();
     }
+    {
+        LOCK(cs_main);
+        PublishChainTipSnapshot(chainActive.Tip());
+    }
 
     LogPrintf("%s: hashBestChain=%s height=%d date=%s progress=%f\n", __func__,
               chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(),
@@ -5571,6 +5804,7 @@ void UnloadBlockIndex() {
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
     chainActive.SetTip(NULL);
+    PublishChainTipSnapshot(NULL);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -5594,6 +5828,7 @@ void UnloadBlockIndex() {
         warningcache[b].clear();
     }
 
+    ZerocoinForgetPrunedIndexData();
     BOOST_FOREACH(BlockMap::value_type & entry, mapBlockIndex)
     {
         delete entry.second;
@@ -5719,10 +5954,15 @@ bool LoadExternalBlockFile(const CChainParams &chainparams, FILE *fileIn, CDiskB
                 }
                 // process in case the block isn't known yet
                 if (mapBlockIndex.count(hash) == 0 || (mapBlockIndex[hash]->nStatus & BLOCK_HAVE_DATA) == 0) {
-                    LOCK(cs_main);
                     CValidationState state;
                     int nHeight = ZerocoinGetNHeight(block.GetBlockHeader());
-                    if (AcceptBlock(block, state, chainparams, NULL, true, dbp, NULL)) {
+                    bool fAccepted;
+                    {
+                        LOCK(cs_main);
+                        fAccepted = AcceptBlock(block, state, chainparams, NULL, true, dbp, NULL);
+                    }
+                    // ActivateBestChain waits for the notification queue, so it is called without cs_main
+                    if (fAccepted) {
                         nLoaded++;
 //                        if (fReindex) {
 //                            ReOrgZerocoin(block, nHeight);
@@ -6675,7 +6915,7 @@ bool static ProcessMessage(CNode *pfrom, string strCommand,
                     pfrom->PushMessage(NetMsgType::GETHEADERS, chainActive.GetLocator(pindexBestHeader), inv.hash);
                     CNodeState *nodestate = State(pfrom->GetId());
                     if (CanDirectFetch(chainparams.GetConsensus()) &&
-                        nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER &&
+                        nodestate->nBlocksInFlight < nodestate->nBlocksInFlightLimit &&
                         (!IsWitnessEnabled(chainActive.Tip(), chainparams.GetConsensus()) ||
                          State(pfrom->GetId())->fHaveWitness)) {
                         inv.type |= nFetchFlags;
@@ -7234,7 +7474,7 @@ bool static ProcessMessage(CNode *pfrom, string strCommand,
         // We want to be a bit conservative just to be extra careful about DoS
         // possibilities in compact block processing...
         if (pindex->nHeight <= chainActive.Height() + 2) {
-            if ((!fAlreadyInFlight && nodestate->nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) ||
+            if ((!fAlreadyInFlight && nodestate->nBlocksInFlight < nodestate->nBlocksInFlightLimit) ||
                 (fAlreadyInFlight && blockInFlightIt->second.first == pfrom->GetId())) {
                 list<QueuedBlock>::iterator *queuedBlockIt = NULL;
                 if (!MarkBlockAsInFlight(pfrom->GetId(), pindex->GetBlockHash(), chainparams.GetConsensus(), pindex,
@@ -7298,7 +7538,7 @@ bool static ProcessMessage(CNode *pfrom, string strCommand,
                     // TODO: don't ignore failures
                     return true;
                 }
-                std::vector <CTransaction> dummy;
+                std::vector <CTransactionRef> dummy;
                 status = tempBlock.FillBlock(block, dummy);
                 if (status == READ_STATUS_OK) {
                     fBlockReconstructed = true;
@@ -7346,6 +7586,7 @@ bool static ProcessMessage(CNode *pfrom, string strCommand,
                     return true;
                 }
             }
+            LimitValidationInterfaceQueue();
             CValidationState state;
             ProcessNewBlock(state, chainparams, pfrom, &block, true, NULL, false);
             // TODO: could send reject message if block is invalid?
@@ -7400,6 +7641,7 @@ bool static ProcessMessage(CNode *pfrom, string strCommand,
             // though the block was successfully read, and rely on the
             // handling in ProcessNewBlock to ensure the block index is
             // updated, reject messages go out, etc.
+            LimitValidationInterfaceQueue();
             CValidationState state;
             // BIP 152 permits peers to relay compact blocks after validating
             // the header only; we should not punish peers if the block turns
@@ -7544,7 +7786,7 @@ bool static ProcessMessage(CNode *pfrom, string strCommand,
                     // Download as much as possible, from earliest to latest.
                     BOOST_REVERSE_FOREACH(CBlockIndex * pindex, vToFetch)
                     {
-                        if (nodestate->nBlocksInFlight >= MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+                        if (nodestate->nBlocksInFlight >= nodestate->nBlocksInFlightLimit) {
                             // Can't download any more from this peer
                             break;
                         }
@@ -7588,6 +7830,7 @@ bool static ProcessMessage(CNode *pfrom, string strCommand,
         // conditions in AcceptBlock().
 //        int nHeight = ZerocoinGetNHeight(block.GetBlockHeader());
         bool forceProcessing = pfrom->fWhitelisted && !IsInitialBlockDownload();
+        LimitValidationInterfaceQueue();
         ProcessNewBlock(state, chainparams, pfrom, &block, forceProcessing, NULL, true);
         int nDoS;
         if (state.IsInvalid(nDoS)) {
@@ -8393,16 +8636,34 @@ bool SendMessages(CNode *pto) {
                 pto->fDisconnect = true;
             }
         }
+        // During initial block download, don't let a slow peer hold up the window until the timeout above:
+        // once the oldest block requested from it is overdue compared to its own delivery latency, hand the
+        // block to the other peers and back off from this one for a while.
+        if (!pto->fDisconnect && state.vBlocksInFlight.size() > 0 && mapNodeState.size() > 1 &&
+            IsInitialBlockDownload()) {
+            QueuedBlock &queuedBlock = state.vBlocksInFlight.front();
+            int64_t nTimeout = GetBlockRerequestTimeout(state.nBlockLatencyMicros);
+            if (!queuedBlock.partialBlock && nNow - queuedBlock.nTimeRequested > nTimeout) {
+                LogPrint("net", "Block %s from peer=%d overdue after %dms, requesting it elsewhere\n",
+                         queuedBlock.hash.ToString(), pto->id, (nNow - queuedBlock.nTimeRequested) / 1000);
+                // queuedBlock is erased from the list by MarkBlockAsReceived, don't pass a reference into it
+                uint256 hash = queuedBlock.hash;
+                MarkBlockAsReceived(hash);
+                state.nBlocksRerequested++;
+                state.nBlocksInFlightLimit = GetReducedBlocksInFlightLimit(state.nBlocksInFlightLimit);
+                state.nBlockDownloadBackoffUntil = nNow + nTimeout;
+            }
+        }
 
         //
         // Message: getdata (blocks)
         //
         vector <CInv> vGetData;
         if (!pto->fDisconnect && !pto->fClient && (fFetch || !IsInitialBlockDownload()) &&
-            state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+            state.nBlocksInFlight < state.nBlocksInFlightLimit && nNow >= state.nBlockDownloadBackoffUntil) {
             vector < CBlockIndex * > vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(pto->GetId(), MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload,
+            FindNextBlocksToDownload(pto->GetId(), state.nBlocksInFlightLimit - state.nBlocksInFlight, vToDownload,
                                      staller, consensusParams);
             BOOST_FOREACH(CBlockIndex * pindex, vToDownload)
             {
@@ -8415,6 +8676,7 @@ bool SendMessages(CNode *pto) {
             if (state.nBlocksInFlight == 0 && staller != -1) {
                 if (State(staller)->nStallingSince == 0) {
                     State(staller)->nStallingSince = nNow;
+                    State(staller)->nBlocksInFlightLimit = GetReducedBlocksInFlightLimit(State(staller)->nBlocksInFlightLimit);
                     LogPrint("net", "Stall started peer=%d\n", staller);
                 }
             }
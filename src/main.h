@@ -95,10 +95,18 @@ static const unsigned int DEFAULT_BLOCK_PRIORITY_SIZE = 50000; // 50KB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
-/** Number of blocks that can be requested at any given time from a single peer. */
+/** Number of blocks that can be requested at any given time from a single peer before its throughput is known. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
+/** Lower bound of the adaptive per-peer in-flight block limit. */
+static const int MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER = 4;
+/** Upper bound of the adaptive per-peer in-flight block limit. */
+static const int MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER = 128;
+/** Average block delivery latency (in microseconds) below which a busy peer's in-flight limit grows, and above which it shrinks. */
+static const int64_t BLOCK_DOWNLOAD_TARGET_LATENCY = 2 * 1000000;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
 static const unsigned int BLOCK_STALLING_TIMEOUT = 2;
+/** Minimum time in seconds a block may be in flight from a peer during initial block download before it is requested from another peer. */
+static const unsigned int BLOCK_REREQUEST_TIMEOUT = 5;
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 2000;
@@ -116,6 +124,12 @@ static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
 static const unsigned int DATABASE_WRITE_INTERVAL = 60 * 60;
 /** Time to wait (in seconds) between flushing chainstate to disk. */
 static const unsigned int DATABASE_FLUSH_INTERVAL = 24 * 60 * 60;
+/** Share of the coins cache budget (in percent) kept warm after the cache went over its limit and was written to disk. */
+static const unsigned int COINS_CACHE_TRIM_PERCENT = 50;
+/** Usage of the coins cache budget (in percent) above which a part of the modified entries is written ahead of a full flush. */
+static const unsigned int COINS_CACHE_PARTIAL_FLUSH_PERCENT = 80;
+/** Share of the coins cache budget (in percent) written by one partial flush. */
+static const unsigned int COINS_CACHE_PARTIAL_WRITE_PERCENT = 25;
 /** Maximum length of reject messages. */
 static const unsigned int MAX_REJECT_MESSAGE_LENGTH = 111;
 /** Average delay between local address broadcasts in seconds. */
@@ -335,6 +349,14 @@ bool AbortNode(const std::string &strMessage, const std::string &userMessage);
 void AlertNotify(const std::string &strMessage);
 /** Get statistics from node state */
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
+/** Moving average of a peer's block delivery latency after it delivered its nBlocksDownloaded-th block. */
+int64_t GetAverageBlockLatency(int64_t nAverageLatency, int64_t nLatency, uint64_t nBlocksDownloaded);
+/** In-flight limit of a peer after it delivered a block, given the blocks it still had in flight. */
+int GetAdaptiveBlocksInFlightLimit(int nLimit, int nBlocksInFlight, int64_t nAverageLatency);
+/** In-flight limit of a peer that stalled the download or had a block requested elsewhere. */
+int GetReducedBlocksInFlightLimit(int nLimit);
+/** Time (in microseconds) a block may be in flight from a peer during initial block download before it is requested elsewhere. */
+int64_t GetBlockRerequestTimeout(int64_t nAverageLatency);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch);
 /** Flush all state, indexes and buffers to disk. */
@@ -366,6 +388,12 @@ struct CNodeStateStats {
     int nSyncHeight;
     int nCommonHeight;
     std::vector<int> vHeightInFlight;
+    int nBlocksInFlightLimit;
+    uint64_t nBlocksDownloaded;
+    uint64_t nBlockBytesDownloaded;
+    int64_t nBlockDownloadMicros;
+    int64_t nBlockLatencyMicros;
+    uint64_t nBlocksRerequested;
 };
 
 
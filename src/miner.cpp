@@ -187,7 +187,7 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(
     }
 
     // Add dummy coinbase tx as first transaction
-    pblock->vtx.push_back(CTransaction());
+    pblock->vtx.push_back(MakeTransactionRef());
     pblocktemplate->vTxFees.push_back(-1); // updated at end
     pblocktemplate->vTxSigOpsCost.push_back(-1); // updated at end
 
@@ -405,7 +405,7 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(
 
                 CAmount nTxFees = iter->GetFee();
 
-                pblock->vtx.push_back(tx);
+                pblock->vtx.push_back(iter->GetSharedTx());
                 pblocktemplate->vTxFees.push_back(nTxFees);
                 pblocktemplate->vTxSigOpsCost.push_back(nTxSigOps);
                 nBlockSize += nTxSize;
@@ -433,7 +433,7 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(
             }
             CAmount nTxFees = iter->GetFee();
             // Added
-            pblock->vtx.push_back(tx);
+            pblock->vtx.push_back(iter->GetSharedTx());
             pblocktemplate->vTxFees.push_back(nTxFees);
             pblocktemplate->vTxSigOpsCost.push_back(nTxSigOps);
             nBlockSize += nTxSize;
@@ -481,7 +481,7 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(
             coinbaseTx.vout[0].nValue += blockReward;
                 
         coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
-        pblock->vtx[0] = coinbaseTx;
+        pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
         pblocktemplate->vTxFees[0] = -nFees;
 
         // Fill in header
@@ -492,7 +492,7 @@ CBlockTemplate* BlockAssembler::CreateNewBlock(
         pblock->nBits          = GetNextWorkRequired(pindexPrev, pblock, chainparams.GetConsensus(),fProofOfStake);
         pblock->nNonce         = fProofOfStake ? 0 : 1;
 
-        pblocktemplate->vTxSigOpsCost[0] = GetLegacySigOpCount(pblock->vtx[0]);
+        pblocktemplate->vTxSigOpsCost[0] = GetLegacySigOpCount(*pblock->vtx[0]);
         // LogPrintf("%s\n",coinbaseTx.ToString());
         //LogPrintf("CreateNewBlock(): AFTER pblocktemplate->vTxSigOpsCost[0] = GetLegacySigOpCount(pblock->vtx[0])\n");
 
@@ -653,7 +653,7 @@ bool BlockAssembler::TestForBlock(CTxMemPool::txiter iter)
 
 void BlockAssembler::AddToBlock(CTxMemPool::txiter iter)
 {
-    pblock->vtx.push_back(iter->GetTx());
+    pblock->vtx.push_back(iter->GetSharedTx());
     pblocktemplate->vTxFees.push_back(iter->GetFee());
     pblocktemplate->vTxSigOpsCost.push_back(iter->GetSigOpCost());
     if (fNeedSizeAccounting) {
@@ -880,7 +880,7 @@ void BlockAssembler::addPriorityTxs()
     {
         double dPriority = mi->GetPriority(nHeight);
         CAmount dummy;
-        CTransaction tx = mi->GetTx();
+        const CTransaction &tx = mi->GetTx();
         mempool.ApplyDeltas(tx.GetHash(), dPriority, dummy);
         vecPriority.push_back(TxCoinAgePriority(dPriority, mi));
         //add Lava validation
@@ -910,7 +910,7 @@ void BlockAssembler::addPriorityTxs()
             if (tx.IsSigmaSpend())
                 nTxFees = mi->GetFee();
 
-            pblock->vtx.push_back(tx);
+            pblock->vtx.push_back(mi->GetSharedTx());
             pblocktemplate->vTxFees.push_back(nTxFees);
             pblocktemplate->vTxSigOpsCost.push_back(nTxSigOps);
             nBlockSize += nTxSize;
@@ -1013,7 +1013,7 @@ void BlockAssembler::addPriorityTxs()
 static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainparams)
 {
     LogPrintf("%s\n", pblock->ToString());
-    LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0].vout[0].nValue));
+    LogPrintf("generated %s\n", FormatMoney(pblock->vtx[0]->vout[0].nValue));
 
     // Found a solution
     {
@@ -1275,10 +1275,10 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     }
     ++nExtraNonce;
     unsigned int nHeight = pindexPrev->nHeight+1; // Height first in coinbase required for block.version=2
-    CMutableTransaction txCoinbase(pblock->vtx[0]);
+    CMutableTransaction txCoinbase(*pblock->vtx[0]);
     txCoinbase.vin[0].scriptSig = (CScript() << nHeight << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
     assert(txCoinbase.vin[0].scriptSig.size() <= 100);
 
-    pblock->vtx[0] = txCoinbase;
+    pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
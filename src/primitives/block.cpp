@@ -59,7 +59,7 @@ std::string CBlock::ToString() const {
             nTime, nBits, nNonce,
             vtx.size());
     for (unsigned int i = 0; i < vtx.size(); i++) {
-        s << "  " << vtx[i].ToString() << "\n";
+        s << "  " << vtx[i]->ToString() << "\n";
     }
     return s.str();
 }
@@ -132,7 +132,7 @@ class CBlock : public CBlockHeader
 {
 public:
     // network and disk
-    std::vector<CTransaction> vtx;
+    std::vector<CTransactionRef> vtx;
     std::vector<unsigned char> vchBlockSig;
 
     // memory only
@@ -187,7 +187,7 @@ public:
     // two types of block: proof-of-work or proof-of-stake
     bool IsProofOfStake() const
     {
-        return ( nNonce == 0 || (vtx.size() > 1 && vtx[1].IsCoinStake()));
+        return ( nNonce == 0 || (vtx.size() > 1 && vtx[1]->IsCoinStake()));
     }
 
     bool IsProofOfWork() const
@@ -163,8 +163,11 @@ void MetaDExDialog::UpdateProperties()
     ui->comboPairTokenA->clear();
     ui->comboPairTokenB->clear();
 
+    uint32_t lastPropertyId = 0;
     for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        uint32_t propertyId = my_it->first;
+        uint32_t propertyId = my_it->first.first;
+        if (propertyId == lastPropertyId) continue; // one entry per property, not per pair
+        lastPropertyId = propertyId;
         if ((testEco && !isTestEcosystemProperty(propertyId)) || (!testEco && isTestEcosystemProperty(propertyId))) continue;
         string spName;
         spName = getPropertyName(propertyId).c_str();
@@ -347,16 +350,15 @@ void MetaDExDialog::UpdateOffers()
     bool divisSale = isPropertyDivisible(GetPropForSale());
     bool divisDes = isPropertyDivisible(GetPropDesired());
 
-    for (md_PropertiesMap::iterator my_it = metadex.begin(); my_it != metadex.end(); ++my_it) {
-        if ((my_it->first != GetPropForSale())) continue; // not the property we're looking for, don't waste any more work
-        md_PricesMap & prices = my_it->second;
+    md_PricesMap* pprices = get_Prices(GetPropForSale(), GetPropDesired());
+    if (pprices) {
+        md_PricesMap & prices = *pprices;
         for (md_PricesMap::iterator it = prices.begin(); it != prices.end(); ++it) { // loop through the sell prices for the property
             std::string unitPriceStr;
             bool includesMe = false;
             md_Set & indexes = (it->second);
             for (md_Set::iterator it = indexes.begin(); it != indexes.end(); ++it) { // multiple sell offers can exist at the same price, sum them for the UI
                 const CMPMetaDEx& obj = *it;
-                if ((obj.getDesProperty() != GetPropDesired())) continue; // not the property we're interested in
                 if (IsMyAddress(obj.getAddr())) includesMe = true;
                 std::string strAvail;
                 if (divisSale) {
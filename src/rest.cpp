@@ -3,12 +3,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "primitives/block.h"
 #include "primitives/transaction.h"
 #include "main.h"
 #include "httpserver.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
@@ -17,6 +19,7 @@
 #include "version.h"
 
 #include <boost/algorithm/string.hpp>
+#include <boost/bind.hpp>
 #include <boost/dynamic_bitset.hpp>
 
 #include <univalue.h>
@@ -24,6 +27,8 @@
 using namespace std;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
+static const int MAX_REST_BLOCKS = 100; // blocks returned by a single /rest/blocks/ request
+static const int MAX_REST_SIGMA_BLOCKS = 2000; // blocks returned by a single /rest/sigma/ request
 
 enum RetFormat {
     RF_UNDEF,
@@ -58,10 +63,30 @@ struct CCoin {
     }
 };
 
+/** Sigma mints and spends of a block, as returned by /rest/sigma/ */
+struct CSigmaBlockEntry {
+    uint256 hash;
+    int nHeight;
+    std::map<std::pair<sigma::CoinDenomination, int>, std::vector<sigma::PublicCoin>> mints;
+    sigma::spend_info_container spends;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion)
+    {
+        READWRITE(hash);
+        READWRITE(nHeight);
+        READWRITE(mints);
+        READWRITE(spends);
+    }
+};
+
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
-extern UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false);
+extern bool getAddressFromIndex(AddressType const & type, const uint160 &hash, std::string &address);
+extern void blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, CJSONWriter& result);
 extern UniValue mempoolInfoToJSON();
-extern UniValue mempoolToJSON(bool fVerbose = false);
+extern void mempoolToJSON(bool fVerbose, CJSONWriter& result);
 extern void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
 extern UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
@@ -72,6 +97,32 @@ static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, string message
     return false;
 }
 
+/** Send part of a reply, the content type is set with the first part */
+static void WriteReplyChunk(HTTPRequest* req, const std::string& strContentType, const std::string& strChunk)
+{
+    if (!req->IsReplyStarted())
+        req->WriteHeader("Content-Type", strContentType);
+    req->WriteReplyChunk(strChunk);
+}
+
+static void EndReply(HTTPRequest* req, const std::string& strContentType, const std::string& strLast)
+{
+    if (!req->IsReplyStarted())
+        req->WriteHeader("Content-Type", strContentType);
+    req->EndChunkedReply(strLast);
+}
+
+/** Sink of the JSON writer, sends the reply as it is produced */
+static void WriteJSONReplyChunk(HTTPRequest* req, const std::string& strChunk)
+{
+    WriteReplyChunk(req, "application/json", strChunk);
+}
+
+static void EndJSONReply(HTTPRequest* req, CJSONWriter& writer)
+{
+    EndReply(req, "application/json", writer.Finish());
+}
+
 static enum RetFormat ParseDataFormat(std::string& param, const std::string& strReq)
 {
     const std::string::size_type pos = strReq.rfind('.');
@@ -230,11 +281,10 @@ static bool rest_block(HTTPRequest* req,
             return RESTERR(req, HTTP_NOT_FOUND, hashStr + " not found");
     }
 
-    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
-    ssBlock << block;
-
     switch (rf) {
     case RF_BINARY: {
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+        ssBlock << block;
         string binaryBlock = ssBlock.str();
         req->WriteHeader("Content-Type", "application/octet-stream");
         req->WriteReply(HTTP_OK, binaryBlock);
@@ -242,6 +292,8 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RF_HEX: {
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+        ssBlock << block;
         string strHex = HexStr(ssBlock.begin(), ssBlock.end()) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
         req->WriteReply(HTTP_OK, strHex);
@@ -249,10 +301,9 @@ static bool rest_block(HTTPRequest* req,
     }
 
     case RF_JSON: {
-        UniValue objBlock = blockToJSON(block, pblockindex, showTxDetails);
-        string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        CJSONWriter writer(boost::bind(&WriteJSONReplyChunk, req, _1));
+        blockToJSON(block, pblockindex, showTxDetails, writer);
+        EndJSONReply(req, writer);
         return true;
     }
 
@@ -337,11 +388,9 @@ static bool rest_mempool_contents(HTTPRequest* req, const std::string& strURIPar
 
     switch (rf) {
     case RF_JSON: {
-        UniValue mempoolObject = mempoolToJSON(true);
-
-        string strJSON = mempoolObject.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        CJSONWriter writer(boost::bind(&WriteJSONReplyChunk, req, _1));
+        mempoolToJSON(true, writer);
+        EndJSONReply(req, writer);
         return true;
     }
     default: {
@@ -405,6 +454,313 @@ static bool rest_tx(HTTPRequest* req, const std::string& strURIPart)
     return true; // continue to process further HTTP reqs on this cxn
 }
 
+/** Parse the <start>/<count> of a range request */
+static bool ParseBlockRange(const std::vector<std::string>& path, int nMaxCount, int& nStart, int& nCount)
+{
+    return path.size() == 2 && ParseInt32(path[0], &nStart) && ParseInt32(path[1], &nCount) &&
+           nStart >= 0 && nCount >= 1 && nCount <= nMaxCount;
+}
+
+/** Blocks of the active chain from height nStart on, at most nCount */
+static std::vector<const CBlockIndex*> GetActiveChainRange(int nStart, int nCount)
+{
+    AssertLockHeld(cs_main);
+    std::vector<const CBlockIndex*> vIndex;
+    // Computed in 64 bits, nStart + nCount may not fit an int
+    int nEnd = (int)std::min<int64_t>((int64_t)nStart + nCount - 1, chainActive.Height());
+    for (int nHeight = nStart; nHeight <= nEnd; nHeight++)
+        vIndex.push_back(chainActive[nHeight]);
+    return vIndex;
+}
+
+static bool rest_blocks(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    vector<string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    int nStart, nCount;
+    if (!ParseBlockRange(path, MAX_REST_BLOCKS, nStart, nCount))
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Invalid range. Use /rest/blocks/<start>/<count>.<ext> with a count of 1 to %d.", MAX_REST_BLOCKS));
+    if (rf != RF_BINARY && rf != RF_HEX && rf != RF_JSON)
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+
+    std::vector<const CBlockIndex*> vIndex;
+    {
+        LOCK(cs_main);
+        vIndex = GetActiveChainRange(nStart, nCount);
+        BOOST_FOREACH(const CBlockIndex* pindex, vIndex) {
+            if (fHavePruned && !(pindex->nStatus & BLOCK_HAVE_DATA) && pindex->nTx > 0)
+                return RESTERR(req, HTTP_NOT_FOUND, strprintf("block %d not available (pruned data)", pindex->nHeight));
+        }
+    }
+
+    // Blocks are read and sent one at a time, so a request holds at most one block in memory
+    CJSONWriter writer(boost::bind(&WriteJSONReplyChunk, req, _1));
+    if (rf == RF_JSON)
+        writer.BeginArray();
+    BOOST_FOREACH(const CBlockIndex* pindex, vIndex) {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            if (!req->IsReplyStarted())
+                return RESTERR(req, HTTP_NOT_FOUND, strprintf("block %d not found", pindex->nHeight));
+            // Part of the reply is out, closing the connection is the only way left to report the failure
+            LogPrintf("%s: can't read block %d, reply aborted\n", __func__, pindex->nHeight);
+            req->AbortChunkedReply();
+            return false;
+        }
+
+        if (rf == RF_JSON) {
+            blockToJSON(block, pindex, true, writer);
+            continue;
+        }
+
+        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+        ssBlock << block;
+        if (rf == RF_BINARY)
+            WriteReplyChunk(req, "application/octet-stream", ssBlock.str());
+        else
+            WriteReplyChunk(req, "text/plain", HexStr(ssBlock.begin(), ssBlock.end()) + "\n");
+    }
+
+    if (rf == RF_JSON) {
+        writer.EndArray();
+        EndJSONReply(req, writer);
+    } else {
+        EndReply(req, rf == RF_BINARY ? "application/octet-stream" : "text/plain", "");
+    }
+    return true;
+}
+
+static bool rest_sigma(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    vector<string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    int nStart, nCount;
+    if (!ParseBlockRange(path, MAX_REST_SIGMA_BLOCKS, nStart, nCount))
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Invalid range. Use /rest/sigma/<start>/<count>.<ext> with a count of 1 to %d.", MAX_REST_SIGMA_BLOCKS));
+
+    std::vector<CSigmaBlockEntry> vEntries;
+    {
+        LOCK(cs_main);
+        BOOST_FOREACH(const CBlockIndex* pindex, GetActiveChainRange(nStart, nCount)) {
+            CSigmaBlockEntry entry;
+            entry.hash = pindex->GetBlockHash();
+            entry.nHeight = pindex->nHeight;
+            entry.mints = pindex->sigmaMintedPubCoins;
+            entry.spends = pindex->sigmaSpentSerials;
+            vEntries.push_back(entry);
+        }
+    }
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssSigma(SER_NETWORK, PROTOCOL_VERSION);
+        ssSigma << vEntries;
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssSigma.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssSigma.begin(), ssSigma.end()) + "\n");
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        CJSONWriter writer(boost::bind(&WriteJSONReplyChunk, req, _1));
+        writer.BeginArray();
+        BOOST_FOREACH(const CSigmaBlockEntry& entry, vEntries) {
+            writer.BeginObject();
+            writer.Pair("hash", entry.hash.GetHex());
+            writer.Pair("height", entry.nHeight);
+            writer.Key("mints");
+            writer.BeginArray();
+            for (const auto& mints : entry.mints) {
+                UniValue pubcoins(UniValue::VARR);
+                BOOST_FOREACH(const sigma::PublicCoin& pubcoin, mints.second)
+                    pubcoins.push_back(pubcoin.getValue().GetHex());
+                writer.BeginObject();
+                writer.Pair("denomination", sigma::DenominationToString(mints.first.first));
+                writer.Pair("id", mints.first.second);
+                writer.Pair("pubcoins", pubcoins);
+                writer.EndObject();
+            }
+            writer.EndArray();
+            writer.Key("spends");
+            writer.BeginArray();
+            for (const auto& spend : entry.spends) {
+                writer.BeginObject();
+                writer.Pair("serial", spend.first.GetHex());
+                writer.Pair("denomination", sigma::DenominationToString(spend.second.denomination));
+                writer.Pair("id", spend.second.coinGroupId);
+                writer.EndObject();
+            }
+            writer.EndArray();
+            writer.EndObject();
+        }
+        writer.EndArray();
+        EndJSONReply(req, writer);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+/** Parse the address of an address index request */
+static bool ParseIndexAddress(const std::string& strAddress, uint160& hashBytes, AddressType& type)
+{
+    CBitcoinAddress address(strAddress);
+    type = AddressType::unknown;
+    return address.GetIndexKey(hashBytes, type);
+}
+
+static bool rest_address_deltas(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+    vector<string> path;
+    boost::split(path, param, boost::is_any_of("/"));
+
+    // /rest/address/deltas/<address> or /rest/address/deltas/<start>/<end>/<address>
+    int nStart = 0, nEnd = 0;
+    if (path.size() == 3) {
+        if (!ParseInt32(path[0], &nStart) || !ParseInt32(path[1], &nEnd) || nStart <= 0 || nEnd < nStart)
+            return RESTERR(req, HTTP_BAD_REQUEST, "Invalid height range: " + path[0] + "/" + path[1]);
+    } else if (path.size() != 1) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Use /rest/address/deltas/<address>.<ext> or /rest/address/deltas/<start>/<end>/<address>.<ext>.");
+    }
+
+    uint160 hashBytes;
+    AddressType type;
+    if (!ParseIndexAddress(path.back(), hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + path.back());
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    if (!GetAddressIndex(hashBytes, type, addressIndex, nStart, nEnd))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address (is -addressindex enabled?)");
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssDeltas(SER_NETWORK, PROTOCOL_VERSION);
+        ssDeltas << addressIndex;
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssDeltas.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssDeltas.begin(), ssDeltas.end()) + "\n");
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        std::string strAddress;
+        getAddressFromIndex(type, hashBytes, strAddress);
+        CJSONWriter writer(boost::bind(&WriteJSONReplyChunk, req, _1));
+        writer.BeginArray();
+        for (const auto& delta : addressIndex) {
+            writer.BeginObject();
+            writer.Pair("satoshis", delta.second);
+            writer.Pair("txid", delta.first.txhash.GetHex());
+            writer.Pair("index", (int)delta.first.index);
+            writer.Pair("blockindex", (int)delta.first.txindex);
+            writer.Pair("height", delta.first.blockHeight);
+            writer.Pair("address", strAddress);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        EndJSONReply(req, writer);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
+static bool rest_address_utxos(HTTPRequest* req, const std::string& strURIPart)
+{
+    if (!CheckWarmup(req))
+        return false;
+    std::string param;
+    const RetFormat rf = ParseDataFormat(param, strURIPart);
+
+    uint160 hashBytes;
+    AddressType type;
+    if (!ParseIndexAddress(param, hashBytes, type))
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid address: " + param);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    if (!GetAddressUnspent(hashBytes, type, unspentOutputs))
+        return RESTERR(req, HTTP_NOT_FOUND, "No information available for address (is -addressindex enabled?)");
+
+    switch (rf) {
+    case RF_BINARY:
+    case RF_HEX: {
+        CDataStream ssUtxos(SER_NETWORK, PROTOCOL_VERSION);
+        ssUtxos << unspentOutputs;
+        if (rf == RF_BINARY) {
+            req->WriteHeader("Content-Type", "application/octet-stream");
+            req->WriteReply(HTTP_OK, ssUtxos.str());
+        } else {
+            req->WriteHeader("Content-Type", "text/plain");
+            req->WriteReply(HTTP_OK, HexStr(ssUtxos.begin(), ssUtxos.end()) + "\n");
+        }
+        return true;
+    }
+
+    case RF_JSON: {
+        std::string strAddress;
+        getAddressFromIndex(type, hashBytes, strAddress);
+        CJSONWriter writer(boost::bind(&WriteJSONReplyChunk, req, _1));
+        writer.BeginArray();
+        for (const auto& utxo : unspentOutputs) {
+            writer.BeginObject();
+            writer.Pair("address", strAddress);
+            writer.Pair("txid", utxo.first.txhash.GetHex());
+            writer.Pair("outputIndex", (int)utxo.first.index);
+            writer.Pair("script", HexStr(utxo.second.script.begin(), utxo.second.script.end()));
+            writer.Pair("satoshis", utxo.second.satoshis);
+            writer.Pair("height", utxo.second.blockHeight);
+            writer.EndObject();
+        }
+        writer.EndArray();
+        EndJSONReply(req, writer);
+        return true;
+    }
+
+    default: {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: " + AvailableDataFormatsString() + ")");
+    }
+    }
+
+    // not reached
+    return true; // continue to process further HTTP reqs on this cxn
+}
+
 static bool rest_getutxos(HTTPRequest* req, const std::string& strURIPart)
 {
     if (!CheckWarmup(req))
@@ -613,6 +969,10 @@ static const struct {
       {"/rest/mempool/contents", rest_mempool_contents},
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
+      {"/rest/blocks/", rest_blocks},
+      {"/rest/sigma/", rest_sigma},
+      {"/rest/address/deltas/", rest_address_deltas},
+      {"/rest/address/utxos/", rest_address_utxos},
 };
 
 bool StartREST()
@@ -7,15 +7,19 @@
 #include "base58.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "chaintip.h"
 #include "checkpoints.h"
 #include "coins.h"
 #include "consensus/validation.h"
+#include "dbwrapper.h"
 #include "main.h"
 #include "policy/policy.h"
+#include "rpc/jsonwriter.h"
 #include "primitives/transaction.h"
 #include "rpc/server.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
@@ -31,6 +35,8 @@ using namespace std;
 
 extern void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry);
 void ScriptPubKeyToJSON(const CScript& scriptPubKey, UniValue& out, bool fIncludeHex);
+void getblock_streamed(const UniValue& params, CJSONWriter& result);
+void getrawmempool_streamed(const UniValue& params, CJSONWriter& result);
 
 double GetDifficulty(const CBlockIndex* blockindex)
 {
@@ -101,7 +107,7 @@ double GetPoSKernelPS()
 //Start Extra Blockinfo code
 CTransaction GetBlockRewardTransaction(const CBlock& block){
     int RewardTXIndex = block.IsProofOfStake() ? 1:0;
-    return block.vtx[RewardTXIndex];
+    return *block.vtx[RewardTXIndex];
 }
 
 CTxOut GetStakeTXOut(const CTxIn& txin){
@@ -134,14 +140,10 @@ float GetBlockInput(const CBlock& block){
 }
 //End extra block info code
 
-UniValue blockheaderToJSON(const CBlockIndex* blockindex)
+static UniValue blockheaderToJSON(const CBlockIndex* blockindex, int confirmations, const CBlockIndex* pnext)
 {
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
-    int confirmations = -1;
-    // Only report confirmations if the block is on the main chain
-    if (chainActive.Contains(blockindex))
-        confirmations = chainActive.Height() - blockindex->nHeight + 1;
     result.push_back(Pair("confirmations", confirmations));
     result.push_back(Pair("height", blockindex->nHeight));
     result.push_back(Pair("version", blockindex->nVersion));
@@ -156,65 +158,83 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 
     if (blockindex->pprev)
         result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
     if (pnext)
         result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
     return result;
 }
 
-UniValue blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails = false)
+UniValue blockheaderToJSON(const CBlockIndex* blockindex)
 {
-    UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hash", blockindex->GetBlockHash().GetHex()));
     int confirmations = -1;
-    float blockInput = 0.0;
     // Only report confirmations if the block is on the main chain
     if (chainActive.Contains(blockindex))
         confirmations = chainActive.Height() - blockindex->nHeight + 1;
-    result.push_back(Pair("confirmations", confirmations));
-    result.push_back(Pair("strippedsize", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS)));
-    result.push_back(Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
-    result.push_back(Pair("weight", (int)::GetBlockWeight(block)));
-    result.push_back(Pair("height", blockindex->nHeight));
-    result.push_back(Pair("version", block.nVersion));
-    result.push_back(Pair("versionHex", strprintf("%08x", block.nVersion)));
-    result.push_back(Pair("merkleroot", block.hashMerkleRoot.GetHex()));
-    UniValue txs(UniValue::VARR);
-    BOOST_FOREACH(const CTransaction&tx, block.vtx)
+    return blockheaderToJSON(blockindex, confirmations, chainActive.Next(blockindex));
+}
+
+void blockToJSON(const CBlock& block, const CBlockIndex* blockindex, bool txDetails, CJSONWriter& result)
+{
+    int confirmations = -1;
+    float blockInput = 0.0;
+    std::string strRewardWinner;
+    CBlockIndex *pnext;
     {
+        // Only the chain state is read under the lock, the transactions are written without it
+        LOCK(cs_main);
+        // Only report confirmations if the block is on the main chain
+        if (chainActive.Contains(blockindex))
+            confirmations = chainActive.Height() - blockindex->nHeight + 1;
+        if(block.IsProofOfStake())
+            blockInput = GetBlockInput(block);
+        strRewardWinner = GetBlockRewardWinner(block);
+        pnext = chainActive.Next(blockindex);
+    }
+
+    result.BeginObject();
+    result.Pair("hash", blockindex->GetBlockHash().GetHex());
+    result.Pair("confirmations", confirmations);
+    result.Pair("strippedsize", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    result.Pair("size", (int)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION));
+    result.Pair("weight", (int)::GetBlockWeight(block));
+    result.Pair("height", blockindex->nHeight);
+    result.Pair("version", block.nVersion);
+    result.Pair("versionHex", strprintf("%08x", block.nVersion));
+    result.Pair("merkleroot", block.hashMerkleRoot.GetHex());
+    // Only one transaction is held as UniValue at a time
+    result.Key("tx");
+    result.BeginArray();
+    for (const CTransactionRef &ptx: block.vtx) {
+        const CTransaction &tx = *ptx;
         if(txDetails)
         {
             UniValue objTx(UniValue::VOBJ);
             TxToJSON(tx, uint256(), objTx);
-            txs.push_back(objTx);
+            result.Value(objTx);
         }
         else
-            txs.push_back(tx.GetHash().GetHex());
+            result.Value(tx.GetHash().GetHex());
     }
-    result.push_back(Pair("tx", txs));
-    result.push_back(Pair("time", block.GetBlockTime()));
-    result.push_back(Pair("mediantime", (int64_t)blockindex->GetMedianTimePast()));
-    result.push_back(Pair("nonce", (uint64_t)block.nNonce));
-    result.push_back(Pair("bits", strprintf("%08x", block.nBits)));
-    result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
-    result.push_back(Pair("chainwork", blockindex->nChainWork.GetHex()));
+    result.EndArray();
+    result.Pair("time", block.GetBlockTime());
+    result.Pair("mediantime", (int64_t)blockindex->GetMedianTimePast());
+    result.Pair("nonce", (uint64_t)block.nNonce);
+    result.Pair("bits", strprintf("%08x", block.nBits));
+    result.Pair("difficulty", GetDifficulty(blockindex));
+    result.Pair("chainwork", blockindex->nChainWork.GetHex());
 
     if (blockindex->pprev)
-        result.push_back(Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex *pnext = chainActive.Next(blockindex);
+        result.Pair("previousblockhash", blockindex->pprev->GetBlockHash().GetHex());
     if (pnext)
-        result.push_back(Pair("nextblockhash", pnext->GetBlockHash().GetHex()));
-        result.push_back(Pair("type",block.IsProofOfStake() ? "PoS":"PoW"));
-    if(block.IsProofOfStake())
-        blockInput = GetBlockInput(block);
+        result.Pair("nextblockhash", pnext->GetBlockHash().GetHex());
+    result.Pair("type", block.IsProofOfStake() ? "PoS":"PoW");
     if(blockInput > 0)
-            result.push_back(Pair("inputamount",blockInput));
-    result.push_back(Pair("rewardadress",GetBlockRewardWinner(block)));
+        result.Pair("inputamount", blockInput);
+    result.Pair("rewardadress", strRewardWinner);
     if (block.IsProofOfStake()){
-        result.push_back(Pair("modifier", blockindex->nStakeModifier.GetHex()));
-        result.push_back(Pair("signature", HexStr(block.vchBlockSig.begin(), block.vchBlockSig.end())));
+        result.Pair("modifier", blockindex->nStakeModifier.GetHex());
+        result.Pair("signature", HexStr(block.vchBlockSig.begin(), block.vchBlockSig.end()));
     }
-    return result;
+    result.EndObject();
 }
 
 UniValue getblockcount(const UniValue& params, bool fHelp)
@@ -230,8 +250,7 @@ UniValue getblockcount(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockcount", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Height();
+    return GetChainTipSnapshot()->nHeight;
 }
 
 UniValue getbestblockhash(const UniValue& params, bool fHelp)
@@ -247,8 +266,7 @@ UniValue getbestblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getbestblockhash", "")
         );
 
-    LOCK(cs_main);
-    return chainActive.Tip()->GetBlockHash().GetHex();
+    return GetChainTipSnapshot()->hashBlock.GetHex();
 }
 
 UniValue getdifficulty(const UniValue& params, bool fHelp)
@@ -264,8 +282,51 @@ UniValue getdifficulty(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getdifficulty", "")
         );
 
-    LOCK(cs_main);
-    return GetDifficulty();
+    CChainTipSnapshotRef tip = GetChainTipSnapshot();
+    if (!tip->pindexTip)
+        return 1.0;
+    return GetDifficulty(tip->pindexTip);
+}
+
+UniValue getchainsummary(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getchainsummary\n"
+            "\nReturns a summary of the tip of the active chain. Unlike getblockchaininfo this doesn't wait for block validation.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": n,              (numeric) the height of the tip\n"
+            "  \"bestblockhash\": \"hash\", (string) the hash of the tip\n"
+            "  \"time\": ttt,              (numeric) the block time of the tip\n"
+            "  \"mediantime\": ttt,        (numeric) the median time of the tip\n"
+            "  \"bits\": \"1d00ffff\",      (string) the bits of the tip\n"
+            "  \"difficulty\": x.xxx,      (numeric) the difficulty of the tip\n"
+            "  \"chainwork\": \"xxxx\",     (string) total amount of work in the active chain, in hexadecimal\n"
+            "  \"sigmamints\": n,          (numeric) the number of Sigma coins minted\n"
+            "  \"sigmaspends\": n,         (numeric) the number of Sigma serials spent\n"
+            "  \"zerocoinmints\": n,       (numeric) the number of Zerocoin coins minted\n"
+            "  \"zerocoinspends\": n       (numeric) the number of Zerocoin serials spent\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getchainsummary", "")
+            + HelpExampleRpc("getchainsummary", "")
+        );
+
+    CChainTipSnapshotRef tip = GetChainTipSnapshot();
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("blocks", tip->nHeight));
+    result.push_back(Pair("bestblockhash", tip->hashBlock.GetHex()));
+    result.push_back(Pair("time", tip->nTime));
+    result.push_back(Pair("mediantime", tip->nMedianTime));
+    result.push_back(Pair("bits", strprintf("%08x", tip->nBits)));
+    result.push_back(Pair("difficulty", tip->pindexTip ? GetDifficulty(tip->pindexTip) : 1.0));
+    result.push_back(Pair("chainwork", tip->nChainWork.GetHex()));
+    result.push_back(Pair("sigmamints", (uint64_t)tip->nSigmaMints));
+    result.push_back(Pair("sigmaspends", (uint64_t)tip->nSigmaSpends));
+    result.push_back(Pair("zerocoinmints", (uint64_t)tip->nZerocoinMints));
+    result.push_back(Pair("zerocoinspends", (uint64_t)tip->nZerocoinSpends));
+    return result;
 }
 
 std::string EntryDescriptionString()
@@ -322,31 +383,30 @@ void entryToJSON(UniValue &info, const CTxMemPoolEntry &e)
     info.push_back(Pair("depends", depends));
 }
 
-UniValue mempoolToJSON(bool fVerbose = false)
+void mempoolToJSON(bool fVerbose, CJSONWriter& result)
 {
     if (fVerbose)
     {
         LOCK(mempool.cs);
-        UniValue o(UniValue::VOBJ);
+        result.BeginObject();
         BOOST_FOREACH(const CTxMemPoolEntry& e, mempool.mapTx)
         {
             const uint256& hash = e.GetTx().GetHash();
             UniValue info(UniValue::VOBJ);
             entryToJSON(info, e);
-            o.push_back(Pair(hash.ToString(), info));
+            result.Pair(hash.ToString(), info);
         }
-        return o;
+        result.EndObject();
     }
     else
     {
         vector<uint256> vtxid;
         mempool.queryHashes(vtxid);
 
-        UniValue a(UniValue::VARR);
+        result.BeginArray();
         BOOST_FOREACH(const uint256& hash, vtxid)
-            a.push_back(hash.ToString());
-
-        return a;
+            result.Value(hash.ToString());
+        result.EndArray();
     }
 }
 
@@ -374,11 +434,19 @@ UniValue getrawmempool(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getrawmempool", "true")
         );
 
+    return CallStreamedRPC(getrawmempool_streamed, params);
+}
+
+void getrawmempool_streamed(const UniValue& params, CJSONWriter& result)
+{
+    if (params.size() > 1)
+        getrawmempool(params, true); // throws the help text
+
     bool fVerbose = false;
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
 
-    return mempoolToJSON(fVerbose);
+    mempoolToJSON(fVerbose, result);
 }
 
 UniValue clearmempool(const UniValue& params, bool fHelp)
@@ -620,13 +688,11 @@ UniValue getblockhash(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockhash", "1000")
         );
 
-    LOCK(cs_main);
-
     int nHeight = params[0].get_int();
-    if (nHeight < 0 || nHeight > chainActive.Height())
+    const CBlockIndex* pblockindex = GetChainTipSnapshot()->GetBlockAt(nHeight);
+    if (!pblockindex)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range");
 
-    CBlockIndex* pblockindex = chainActive[nHeight];
     return pblockindex->GetBlockHash().GetHex();
 }
 
@@ -664,8 +730,6 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblockheader", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
-
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -673,22 +737,36 @@ UniValue getblockheader(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    // Blocks of the active chain are found through the block tree database and the chain tip
+    // snapshot without cs_main. Blocks not written to the database yet and blocks of other
+    // chains are looked up in mapBlockIndex
+    CChainTipSnapshotRef tip = GetChainTipSnapshot();
+    const CBlockIndex* pblockindex = NULL;
+    CDiskBlockIndex diskindex;
+    if (pblocktree->ReadBlockIndex(hash, diskindex)) {
+        const CBlockIndex* pindex = tip->GetBlockAt(diskindex.nHeight);
+        if (pindex && pindex->GetBlockHash() == hash)
+            pblockindex = pindex;
+    }
 
-    if (!fVerbose)
-    {
-    	CBlock block;
-    	ReadBlockFromDisk(block, pblockindex, Params().GetConsensus());
-        CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
-        ssBlock << block.GetBlockHeader();
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+    if (pblockindex) {
+        if (fVerbose)
+            return blockheaderToJSON(pblockindex, tip->nHeight - pblockindex->nHeight + 1, tip->GetBlockAt(pblockindex->nHeight + 1));
+    } else {
+        LOCK(cs_main);
+        BlockMap::const_iterator it = mapBlockIndex.find(hash);
+        if (it == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+        pblockindex = it->second;
+        if (fVerbose)
+            return blockheaderToJSON(pblockindex);
     }
 
-    return blockheaderToJSON(pblockindex);
+    CBlock block;
+    ReadBlockFromDisk(block, pblockindex, Params().GetConsensus());
+    CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION);
+    ssBlock << block.GetBlockHeader();
+    return HexStr(ssBlock.begin(), ssBlock.end());
 }
 
 UniValue getblock(const UniValue& params, bool fHelp)
@@ -732,7 +810,13 @@ UniValue getblock(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getblock", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
         );
 
-    LOCK(cs_main);
+    return CallStreamedRPC(getblock_streamed, params);
+}
+
+void getblock_streamed(const UniValue& params, CJSONWriter& result)
+{
+    if (params.size() < 1 || params.size() > 2)
+        getblock(params, true); // throws the help text
 
     std::string strHash = params[0].get_str();
     uint256 hash(uint256S(strHash));
@@ -741,27 +825,33 @@ UniValue getblock(const UniValue& params, bool fHelp)
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
     CBlock block;
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    CBlockIndex* pblockindex;
+    {
+        // The block is read under the lock and written to the client without it
+        LOCK(cs_main);
 
-    if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
 
-    if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+        pblockindex = mapBlockIndex[hash];
+
+        if (fHavePruned && !(pblockindex->nStatus & BLOCK_HAVE_DATA) && pblockindex->nTx > 0)
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Block not available (pruned data)");
+
+        if(!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus()))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
+    }
 
     if (!fVerbose)
     {
         CDataStream ssBlock(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
         ssBlock << block;
-        std::string strHex = HexStr(ssBlock.begin(), ssBlock.end());
-        return strHex;
+        result.Value(HexStr(ssBlock.begin(), ssBlock.end()));
+        return;
     }
 
-    return blockToJSON(block, pblockindex);
+    blockToJSON(block, pblockindex, false, result);
 }
 
 struct CCoinsStats
@@ -834,6 +924,14 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
             "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
             "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
             "  \"total_amount\": x.xxx          (numeric) The total amount\n"
+            "  \"cache\": {                     (json object) In-memory UTXO cache\n"
+            "     \"transactions\": n,          (numeric) The number of cached transactions\n"
+            "     \"usage\": n,                 (numeric) Memory used by the cache in bytes\n"
+            "     \"limit\": n,                 (numeric) Memory the cache may use before it is written to disk, in bytes\n"
+            "     \"hits\": n,                  (numeric) Lookups answered from memory since startup\n"
+            "     \"misses\": n,                (numeric) Lookups that had to read the chainstate database since startup\n"
+            "     \"hitrate\": x.xxx            (numeric) Share of lookups answered from memory\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
@@ -855,6 +953,82 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp)
     } else {
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
     }
+
+    {
+        LOCK(cs_main);
+        uint64_t nHits = pcoinsTip->GetCacheHits();
+        uint64_t nMisses = pcoinsTip->GetCacheMisses();
+        UniValue cache(UniValue::VOBJ);
+        cache.push_back(Pair("transactions", (int64_t)pcoinsTip->GetCacheSize()));
+        cache.push_back(Pair("usage", (int64_t)pcoinsTip->DynamicMemoryUsage()));
+        cache.push_back(Pair("limit", (int64_t)nCoinCacheUsage));
+        cache.push_back(Pair("hits", (int64_t)nHits));
+        cache.push_back(Pair("misses", (int64_t)nMisses));
+        cache.push_back(Pair("hitrate", nHits + nMisses > 0 ? (double)nHits / (nHits + nMisses) : 0.0));
+        ret.push_back(Pair("cache", cache));
+    }
+    return ret;
+}
+
+UniValue getdbstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns LevelDB statistics of every open database.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"sharedcache\": n,             (numeric) Size of the block cache shared by the databases in bytes\n"
+            "  \"databases\": [                (json array) One entry per open database\n"
+            "    {\n"
+            "      \"name\": \"name\",           (string) The database directory, e.g. chainstate\n"
+            "      \"cachehits\": n,           (numeric) Block reads answered from the block cache\n"
+            "      \"cachemisses\": n,         (numeric) Block reads that went to disk\n"
+            "      \"writes\": n,              (numeric) Number of write batches\n"
+            "      \"writebytes\": n,          (numeric) Approximate size of the written batches\n"
+            "      \"writetime\": x.xxx,       (numeric) Time spent writing in seconds\n"
+            "      \"stalls\": n,              (numeric) Writes delayed by pending compactions\n"
+            "      \"files\": [n,...],         (json array) Number of table files at each level\n"
+            "      \"size\": x.xxx,            (numeric) Size of the table files in MB\n"
+            "      \"compactiontime\": x.xxx,  (numeric) Time spent compacting in seconds\n"
+            "      \"compactionread\": x.xxx,  (numeric) Data read by compactions in MB\n"
+            "      \"compactionwrite\": x.xxx  (numeric) Data written by compactions in MB\n"
+            "    }\n"
+            "    ,...\n"
+            "  ]\n"
+            "}\n"
+            "\nWrites of the Elysium databases are not counted. Blocks of table files LevelDB has mapped into memory\n"
+            "are read without going through the block cache, these reads show up as cache misses.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue databases(UniValue::VARR);
+    BOOST_FOREACH(const CDBStats& stats, GetDBStats()) {
+        UniValue files(UniValue::VARR);
+        BOOST_FOREACH(int nFiles, stats.vFilesPerLevel)
+            files.push_back(nFiles);
+
+        UniValue db(UniValue::VOBJ);
+        db.push_back(Pair("name", stats.strName));
+        db.push_back(Pair("cachehits", (int64_t)stats.nCacheHits));
+        db.push_back(Pair("cachemisses", (int64_t)stats.nCacheMisses));
+        db.push_back(Pair("writes", (int64_t)stats.nWrites));
+        db.push_back(Pair("writebytes", (int64_t)stats.nWriteBytes));
+        db.push_back(Pair("writetime", stats.nWriteMicros * 0.000001));
+        db.push_back(Pair("stalls", (int64_t)stats.nStalls));
+        db.push_back(Pair("files", files));
+        db.push_back(Pair("size", stats.dSizeMB));
+        db.push_back(Pair("compactiontime", stats.dCompactionSeconds));
+        db.push_back(Pair("compactionread", stats.dCompactionReadMB));
+        db.push_back(Pair("compactionwrite", stats.dCompactionWriteMB));
+        databases.push_back(db);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("sharedcache", (int64_t)GetSharedDBCacheSize()));
+    ret.push_back(Pair("databases", databases));
     return ret;
 }
 
@@ -1340,17 +1514,19 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getblockchaininfo",      &getblockchaininfo,      true  },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       true  },
     { "blockchain",         "getblockcount",          &getblockcount,          true  },
-    { "blockchain",         "getblock",               &getblock,               true  },
+    { "blockchain",         "getblock",               &getblock,               true,  &getblock_streamed },
     { "blockchain",         "getblockhash",           &getblockhash,           true  },
     { "blockchain",         "getblockhashes",         &getblockhashes,         true  },
     { "blockchain",         "getblockheader",         &getblockheader,         true  },
+    { "blockchain",         "getchainsummary",        &getchainsummary,        true  },
     { "blockchain",         "getchaintips",           &getchaintips,           true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true  },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    true  },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true  },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true  },
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
-    { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
+    { "blockchain",         "getrawmempool",          &getrawmempool,          true,  &getrawmempool_streamed },
     { "blockchain",         "clearmempool",           &clearmempool,           true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
@@ -0,0 +1,181 @@
+#include "rpc/jsonwriter.h"
+
+#include "mbstring.h"
+
+#include <assert.h>
+
+CJSONWriter::CJSONWriter(const Sink& sinkIn, bool fSanitizeIn, size_t nChunkSizeIn) :
+    sink(sinkIn), fSanitize(fSanitizeIn), nChunkSize(nChunkSizeIn), fAfterKey(false), nWritten(0), pTree(NULL)
+{
+    buffer.reserve(nChunkSize);
+}
+
+CJSONWriter::CJSONWriter(UniValue& treeIn) :
+    fSanitize(false), nChunkSize(0), fAfterKey(false), nWritten(0), pTree(&treeIn)
+{
+}
+
+void CJSONWriter::Insert(const std::string& key, const UniValue& value)
+{
+    if (vOpen.empty())
+        *pTree = value;
+    else if (vOpen.back().second.isObject())
+        vOpen.back().second.pushKV(key, value);
+    else
+        vOpen.back().second.push_back(value);
+}
+
+void CJSONWriter::Open(const UniValue::VType type)
+{
+    vOpen.push_back(std::make_pair(fAfterKey ? strKey : std::string(), UniValue(type)));
+    fAfterKey = false;
+}
+
+void CJSONWriter::Close()
+{
+    assert(!vOpen.empty() && !fAfterKey);
+    const std::pair<std::string, UniValue>& element = vOpen.back();
+    if (vOpen.size() == 1)
+        *pTree = element.second;
+    else if (vOpen[vOpen.size() - 2].second.isObject())
+        vOpen[vOpen.size() - 2].second.pushKV(element.first, element.second);
+    else
+        vOpen[vOpen.size() - 2].second.push_back(element.second);
+    vOpen.pop_back();
+}
+
+void CJSONWriter::Separate()
+{
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (vFirst.empty())
+        return;
+    if (!vFirst.back())
+        Append(",");
+    vFirst.back() = false;
+}
+
+void CJSONWriter::Append(const std::string& str)
+{
+    buffer += str;
+    nWritten += str.size();
+    if (buffer.size() >= nChunkSize)
+        Flush();
+}
+
+void CJSONWriter::BeginObject()
+{
+    if (pTree) {
+        Open(UniValue::VOBJ);
+        return;
+    }
+    Separate();
+    Append("{");
+    vFirst.push_back(true);
+}
+
+void CJSONWriter::EndObject()
+{
+    if (pTree) {
+        Close();
+        return;
+    }
+    assert(!vFirst.empty() && !fAfterKey);
+    vFirst.pop_back();
+    Append("}");
+}
+
+void CJSONWriter::BeginArray()
+{
+    if (pTree) {
+        Open(UniValue::VARR);
+        return;
+    }
+    Separate();
+    Append("[");
+    vFirst.push_back(true);
+}
+
+void CJSONWriter::EndArray()
+{
+    if (pTree) {
+        Close();
+        return;
+    }
+    assert(!vFirst.empty() && !fAfterKey);
+    vFirst.pop_back();
+    Append("]");
+}
+
+void CJSONWriter::Key(const std::string& key)
+{
+    assert(!fAfterKey);
+    if (pTree) {
+        assert(!vOpen.empty() && vOpen.back().second.isObject());
+        strKey = key;
+        fAfterKey = true;
+        return;
+    }
+    Separate();
+    Append((fSanitize ? SanitizeInvalidUTF8(UniValue(key).write()) : UniValue(key).write()) + ":");
+    fAfterKey = true;
+}
+
+void CJSONWriter::Value(const UniValue& value)
+{
+    if (pTree) {
+        Insert(fAfterKey ? strKey : std::string(), value);
+        fAfterKey = false;
+        return;
+    }
+    Separate();
+    Append(fSanitize ? SanitizeInvalidUTF8(value.write()) : value.write());
+}
+
+void CJSONWriter::Flush()
+{
+    if (pTree || buffer.empty())
+        return;
+    sink(buffer);
+    buffer.clear();
+}
+
+CJSONWriter::Checkpoint CJSONWriter::GetCheckpoint() const
+{
+    Checkpoint cp;
+    cp.nWritten = nWritten;
+    cp.vFirst = vFirst;
+    cp.fAfterKey = fAfterKey;
+    return cp;
+}
+
+bool CJSONWriter::Rollback(const Checkpoint& cp)
+{
+    if (pTree)
+        return false;
+    assert(cp.nWritten <= nWritten);
+    uint64_t nDiscard = nWritten - cp.nWritten;
+    if (nDiscard > buffer.size())
+        return false;
+    buffer.resize(buffer.size() - nDiscard);
+    nWritten = cp.nWritten;
+    vFirst = cp.vFirst;
+    fAfterKey = cp.fAfterKey;
+    return true;
+}
+
+std::string CJSONWriter::Finish()
+{
+    if (pTree) {
+        assert(vOpen.empty() && !fAfterKey);
+        return std::string();
+    }
+    assert(vFirst.empty() && !fAfterKey);
+    buffer += "\n";
+    nWritten++;
+    std::string strRest;
+    strRest.swap(buffer);
+    return strRest;
+}
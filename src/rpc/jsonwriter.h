@@ -0,0 +1,113 @@
+#ifndef BITCOIN_RPC_JSONWRITER_H
+#define BITCOIN_RPC_JSONWRITER_H
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include <boost/function.hpp>
+
+#include <univalue.h>
+
+/** Amount of buffered JSON text that is handed to the sink at once */
+static const size_t JSON_WRITER_CHUNK_SIZE = 64 * 1024;
+
+/**
+ * Incremental JSON serializer.
+ *
+ * Documents are written element by element and handed to the sink in chunks, so that large
+ * results never have to exist as a single UniValue tree or string. Elements are formatted by
+ * UniValue::write(), the output is the same as writing the whole document as a UniValue.
+ *
+ * A writer constructed with a UniValue instead of a sink builds the document as a tree, for
+ * callers that need the result as UniValue anyway.
+ */
+class CJSONWriter
+{
+public:
+    typedef boost::function<void(const std::string& chunk)> Sink;
+
+private:
+    Sink sink;
+    bool fSanitize;
+    size_t nChunkSize;
+    std::string buffer;
+    //! One entry per open object or array, true until the first element is written
+    std::vector<bool> vFirst;
+    bool fAfterKey;
+    uint64_t nWritten;
+
+    //! Document built as a tree, NULL when writing text
+    UniValue* pTree;
+    //! Open objects and arrays of the tree with the key they have in their parent
+    std::vector<std::pair<std::string, UniValue> > vOpen;
+    std::string strKey;
+
+    void Separate();
+    void Append(const std::string& str);
+    void Insert(const std::string& key, const UniValue& value);
+    void Open(const UniValue::VType type);
+    void Close();
+
+public:
+    /**
+     * @param[in] sinkIn      Receives the JSON text in order
+     * @param[in] fSanitizeIn Replace invalid UTF-8 in keys and values, see SanitizeInvalidUTF8
+     */
+    CJSONWriter(const Sink& sinkIn, bool fSanitizeIn = false, size_t nChunkSizeIn = JSON_WRITER_CHUNK_SIZE);
+
+    /** @param[out] treeIn Receives the document, once its top level element is complete */
+    explicit CJSONWriter(UniValue& treeIn);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    //! Write the key of the next object member
+    void Key(const std::string& key);
+
+    //! Write a complete value, which may be an object or array itself
+    void Value(const UniValue& value);
+
+    void Pair(const std::string& key, const UniValue& value)
+    {
+        Key(key);
+        Value(value);
+    }
+
+    template <typename T>
+    void Pair(const std::string& key, const T& value)
+    {
+        Key(key);
+        Value(UniValue(value));
+    }
+
+    //! Hand the buffered text to the sink
+    void Flush();
+
+    //! Terminate the document with a newline and return the text not handed to the sink yet
+    std::string Finish();
+
+    //! Number of bytes written so far, including the ones still buffered
+    uint64_t GetBytesWritten() const { return nWritten; }
+
+    /** Position in the document that can be returned to with Rollback */
+    struct Checkpoint
+    {
+        uint64_t nWritten;
+        std::vector<bool> vFirst;
+        bool fAfterKey;
+    };
+
+    Checkpoint GetCheckpoint() const;
+
+    /**
+     * Discard everything written since cp, e.g. because producing the value failed.
+     * Returns false if part of it was handed to the sink already, or when building a tree.
+     */
+    bool Rollback(const Checkpoint& cp);
+};
+
+#endif // BITCOIN_RPC_JSONWRITER_H
@@ -9,6 +9,7 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "timedata.h"
 #include "txmempool.h"
@@ -20,6 +21,10 @@
 #endif
 #include "txdb.h"
 #include "zerocoin.h"
+#if ENABLE_ZMQ
+#include "zmq/zmqnotificationinterface.h"
+#endif
+#include "libzerocoin/ParallelTasks.h"
 
 #include <stdint.h>
 
@@ -734,6 +739,13 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
                 + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
         );
 
+    return CallStreamedRPC(getaddressdeltas_streamed, params);
+}
+
+void getaddressdeltas_streamed(const UniValue& params, CJSONWriter& result)
+{
+    if (params.size() != 1 || !params[0].isObject())
+        getaddressdeltas(params, true); // throws the help text
 
     UniValue startValue = find_value(params[0].get_obj(), "start");
     UniValue endValue = find_value(params[0].get_obj(), "end");
@@ -769,7 +781,7 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
         }
     }
 
-    UniValue result(UniValue::VARR);
+    result.BeginArray();
 
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
         std::string address;
@@ -777,17 +789,17 @@ UniValue getaddressdeltas(const UniValue& params, bool fHelp)
             throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown address type");
         }
 
-        UniValue delta(UniValue::VOBJ);
-        delta.push_back(Pair("satoshis", it->second));
-        delta.push_back(Pair("txid", it->first.txhash.GetHex()));
-        delta.push_back(Pair("index", (int)it->first.index));
-        delta.push_back(Pair("blockindex", (int)it->first.txindex));
-        delta.push_back(Pair("height", it->first.blockHeight));
-        delta.push_back(Pair("address", address));
-        result.push_back(delta);
+        result.BeginObject();
+        result.Pair("satoshis", it->second);
+        result.Pair("txid", it->first.txhash.GetHex());
+        result.Pair("index", (int)it->first.index);
+        result.Pair("blockindex", (int)it->first.txindex);
+        result.Pair("height", it->first.blockHeight);
+        result.Pair("address", address);
+        result.EndObject();
     }
 
-    return result;
+    result.EndArray();
 }
 
 UniValue getaddressbalance(const UniValue& params, bool fHelp)
@@ -1068,6 +1080,92 @@ bool getZerocoinSupply(CAmount & amount) {
 }
 }
 
+UniValue getzkpthreadpoolinfo(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getzkpthreadpoolinfo\n"
+            "\nReturns statistics of the thread pool shared by zero-knowledge proof generation and verification.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"maxthreads\": n,          (numeric) the configured number of worker threads\n"
+            "  \"threads\": n,             (numeric) the number of running worker threads\n"
+            "  \"busythreads\": n,         (numeric) the number of threads executing a task right now\n"
+            "  \"queuedepth\": {           (json object) the number of tasks waiting to be executed\n"
+            "    \"high\": n,              (numeric) block and transaction validation\n"
+            "    \"normal\": n,            (numeric) wallet proof generation\n"
+            "    \"low\": n                (numeric) background jobs\n"
+            "  },\n"
+            "  \"tasksexecuted\": n,       (numeric) the total number of executed tasks\n"
+            "  \"tasksstolen\": n,         (numeric) the number of tasks taken from the queue of another thread\n"
+            "  \"busytime\": n,            (numeric) the total time spent executing tasks, in microseconds\n"
+            "  \"uptime\": n,              (numeric) the time since the pool was created, in microseconds\n"
+            "  \"utilization\": x.xxx      (numeric) the fraction of the pool capacity used since creation\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getzkpthreadpoolinfo", "")
+            + HelpExampleRpc("getzkpthreadpoolinfo", "")
+        );
+
+    libzerocoin::ParallelTasksStats stats = libzerocoin::ParallelTasks::GetStats();
+
+    UniValue queueDepth(UniValue::VOBJ);
+    queueDepth.push_back(Pair("high", (uint64_t)stats.queueDepth[libzerocoin::PARALLEL_TASK_PRIORITY_HIGH]));
+    queueDepth.push_back(Pair("normal", (uint64_t)stats.queueDepth[libzerocoin::PARALLEL_TASK_PRIORITY_NORMAL]));
+    queueDepth.push_back(Pair("low", (uint64_t)stats.queueDepth[libzerocoin::PARALLEL_TASK_PRIORITY_LOW]));
+
+    double capacity = (double)stats.uptimeMicros * std::max<size_t>(stats.maxThreads, 1);
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("maxthreads", (uint64_t)stats.maxThreads));
+    result.push_back(Pair("threads", (uint64_t)stats.threads));
+    result.push_back(Pair("busythreads", (uint64_t)stats.busyThreads));
+    result.push_back(Pair("queuedepth", queueDepth));
+    result.push_back(Pair("tasksexecuted", stats.tasksExecuted));
+    result.push_back(Pair("tasksstolen", stats.tasksStolen));
+    result.push_back(Pair("busytime", stats.busyMicros));
+    result.push_back(Pair("uptime", stats.uptimeMicros));
+    result.push_back(Pair("utilization", capacity > 0 ? stats.busyMicros / capacity : 0.0));
+
+    return result;
+}
+
+#if ENABLE_ZMQ
+UniValue getzmqstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getzmqstats\n"
+            "\nReturns statistics of the thread publishing ZeroMQ notifications.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queued\": n,            (numeric) the number of messages waiting to be published\n"
+            "  \"maxqueued\": n,         (numeric) the number of messages that can wait before new ones are dropped, see -zmqpubqueue\n"
+            "  \"highwater\": n,         (numeric) the largest number of messages that were waiting at once\n"
+            "  \"published\": n,         (numeric) the number of messages published\n"
+            "  \"dropped\": n,           (numeric) the number of messages dropped because the queue was full\n"
+            "  \"failed\": n,            (numeric) the number of messages that couldn't be produced or sent\n"
+            "  \"batches\": n            (numeric) the number of times the queued messages were taken by the thread\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getzmqstats", "")
+            + HelpExampleRpc("getzmqstats", "")
+        );
+
+    CZMQPublisherStats stats = GetZMQPublisherStats();
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("queued", (uint64_t)stats.nQueued));
+    result.push_back(Pair("maxqueued", (uint64_t)stats.nMaxQueued));
+    result.push_back(Pair("highwater", (uint64_t)stats.nHighWater));
+    result.push_back(Pair("published", stats.nPublished));
+    result.push_back(Pair("dropped", stats.nDropped));
+    result.push_back(Pair("failed", stats.nFailed));
+    result.push_back(Pair("batches", stats.nBatches));
+    return result;
+}
+#endif
+
 UniValue getzerocoinsupply(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 1)
@@ -1151,11 +1249,15 @@ static const CRPCCommand commands[] =
     { "util",               "createmultisig",         &createmultisig,         true  },
     { "util",               "verifymessage",          &verifymessage,          true  },
     { "util",               "signmessagewithprivkey", &signmessagewithprivkey, true  },
+    { "util",               "getzkpthreadpoolinfo",   &getzkpthreadpoolinfo,   true  },
+#if ENABLE_ZMQ
+    { "util",               "getzmqstats",            &getzmqstats,            true  },
+#endif
 
         /* Address index */
     { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
     { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, &getaddressdeltas_streamed },
     { "addressindex",       "getaddresstxids",        &getaddresstxids,        false },
     { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
     { "addressindex",       "gettotalsupply",         &gettotalsupply,         false },
@@ -111,6 +111,14 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
             "       n,                        (numeric) The heights of blocks we're currently asking from this peer\n"
             "       ...\n"
             "    ]\n"
+            "    \"blockdownload\": {\n"
+            "       \"inflightlimit\": n,      (numeric) How many blocks may currently be requested from this peer at once\n"
+            "       \"blocks\": n,             (numeric) Requested blocks delivered by this peer\n"
+            "       \"bytes\": n,              (numeric) Size of the requested blocks delivered by this peer\n"
+            "       \"throughput\": n,         (numeric) Bytes per second while blocks were in flight from this peer\n"
+            "       \"latency\": n,            (numeric) Average time in seconds between requesting and receiving a block\n"
+            "       \"rerequested\": n         (numeric) Blocks requested from other peers because this peer was too slow\n"
+            "    }\n"
             "    \"bytessent_per_msg\": {\n"
             "       \"addr\": n,             (numeric) The total bytes sent aggregated by message type\n"
             "       ...\n"
@@ -172,6 +180,15 @@ UniValue getpeerinfo(const UniValue& params, bool fHelp)
                 heights.push_back(height);
             }
             obj.push_back(Pair("inflight", heights));
+            UniValue download(UniValue::VOBJ);
+            download.push_back(Pair("inflightlimit", statestats.nBlocksInFlightLimit));
+            download.push_back(Pair("blocks", statestats.nBlocksDownloaded));
+            download.push_back(Pair("bytes", statestats.nBlockBytesDownloaded));
+            download.push_back(Pair("throughput", statestats.nBlockDownloadMicros > 0 ?
+                    (int64_t)(statestats.nBlockBytesDownloaded * 1000000 / statestats.nBlockDownloadMicros) : 0));
+            download.push_back(Pair("latency", statestats.nBlockLatencyMicros / 1e6));
+            download.push_back(Pair("rerequested", statestats.nBlocksRerequested));
+            obj.push_back(Pair("blockdownload", download));
         }
         obj.push_back(Pair("whitelisted", stats.fWhitelisted));
 
@@ -15,6 +15,7 @@
 #include "net.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
+#include "rpc/jsonwriter.h"
 #include "rpc/server.h"
 #include "script/script.h"
 #include "script/script_error.h"
@@ -190,6 +191,8 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 }
 
 
+void getrawtransaction_streamed(const UniValue& params, CJSONWriter& result);
+
 UniValue getrawtransaction(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() < 1 || params.size() > 2)
@@ -260,6 +263,14 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
             + HelpExampleRpc("getrawtransaction", "\"mytxid\", 1")
         );
 
+    return CallStreamedRPC(getrawtransaction_streamed, params);
+}
+
+void getrawtransaction_streamed(const UniValue& params, CJSONWriter& result)
+{
+    if (params.size() < 1 || params.size() > 2)
+        getrawtransaction(params, true); // throws the help text
+
     LOCK(cs_main);
 
     uint256 hash = ParseHashV(params[0], "parameter 1");
@@ -273,15 +284,19 @@ UniValue getrawtransaction(const UniValue& params, bool fHelp)
     if (!GetTransaction(hash, tx, Params().GetConsensus(), hashBlock, true))
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available about transaction");
 
-    string strHex = EncodeHexTx(tx, RPCSerializationFlags());
-
-    if (!fVerbose)
-        return strHex;
+    if (!fVerbose) {
+        result.Value(EncodeHexTx(tx, RPCSerializationFlags()));
+        return;
+    }
 
-    UniValue result(UniValue::VOBJ);
-    result.push_back(Pair("hex", strHex));
-    TxToJSON(tx, hashBlock, result);
-    return result;
+    result.BeginObject();
+    result.Pair("hex", EncodeHexTx(tx, RPCSerializationFlags()));
+    UniValue entry(UniValue::VOBJ);
+    TxToJSON(tx, hashBlock, entry);
+    std::vector<std::string> keys = entry.getKeys();
+    for (size_t i = 0; i < keys.size(); i++)
+        result.Pair(keys[i], entry[i]);
+    result.EndObject();
 }
 
 UniValue gettxoutproof(const UniValue& params, bool fHelp)
@@ -352,8 +367,8 @@ UniValue gettxoutproof(const UniValue& params, bool fHelp)
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
 
     unsigned int ntxFound = 0;
-    BOOST_FOREACH(const CTransaction&tx, block.vtx)
-        if (setTxids.count(tx.GetHash()))
+    for (const CTransactionRef& tx : block.vtx)
+        if (setTxids.count(tx->GetHash()))
             ntxFound++;
     if (ntxFound != setTxids.size())
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "(Not all) transactions not found in specified block");
@@ -971,7 +986,7 @@ UniValue sendrawtransaction(const UniValue& params, bool fHelp)
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         okSafeMode
   //  --------------------- ------------------------  -----------------------  ----------
-    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true  },
+    { "rawtransactions",    "getrawtransaction",      &getrawtransaction,      true,  &getrawtransaction_streamed },
     { "rawtransactions",    "createrawtransaction",   &createrawtransaction,   true  },
     { "rawtransactions",    "decoderawtransaction",   &decoderawtransaction,   true  },
     { "rawtransactions",    "decodescript",           &decodescript,           true  },
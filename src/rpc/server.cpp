@@ -4,8 +4,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "rpc/server.h"
+#include "rpc/jsonwriter.h"
 
 #include "base58.h"
+#include "httpserver.h"
 #include "init.h"
 #include "random.h"
 #include "sync.h"
@@ -262,6 +264,132 @@ UniValue stop(const UniValue& params, bool fHelp)
     return "Lava server stopping";
 }
 
+static CCriticalSection cs_rpcStats;
+static std::map<std::string, CRPCMethodStats> mapRPCMethodStats;
+
+/** Counts a call in the method statistics for as long as it exists */
+class CRPCCallTracker
+{
+private:
+    std::string strMethod;
+    int64_t nStartMicros;
+    bool fSuccess;
+
+public:
+    CRPCCallTracker(const std::string& strMethodIn) : strMethod(strMethodIn), nStartMicros(GetTimeMicros()), fSuccess(false)
+    {
+        LOCK(cs_rpcStats);
+        mapRPCMethodStats[strMethod].nInFlight++;
+    }
+
+    void Success() { fSuccess = true; }
+
+    ~CRPCCallTracker()
+    {
+        int64_t nMicros = GetTimeMicros() - nStartMicros;
+        size_t nBucket = 0;
+        while (nBucket < RPC_LATENCY_BUCKET_COUNT - 1 && nMicros > RPC_LATENCY_BUCKETS_MS[nBucket] * 1000)
+            nBucket++;
+
+        LOCK(cs_rpcStats);
+        CRPCMethodStats& stats = mapRPCMethodStats[strMethod];
+        stats.nInFlight--;
+        stats.nCalls++;
+        if (!fSuccess)
+            stats.nErrors++;
+        stats.nTotalMicros += nMicros;
+        stats.nMaxMicros = std::max(stats.nMaxMicros, nMicros);
+        stats.vLatency[nBucket]++;
+    }
+};
+
+std::map<std::string, CRPCMethodStats> GetRPCMethodStats()
+{
+    LOCK(cs_rpcStats);
+    return mapRPCMethodStats;
+}
+
+UniValue getrpcstats(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getrpcstats\n"
+            "\nReturns statistics of the RPC work queues and of the RPC methods called since startup.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"queues\": [             (json array) the HTTP work classes, see -rpcworkclass and -rpcmethodclass\n"
+            "    {\n"
+            "      \"name\": \"xxx\",       (string) the work class\n"
+            "      \"threads\": n,        (numeric) the number of worker threads\n"
+            "      \"busythreads\": n,    (numeric) the number of threads serving a request right now\n"
+            "      \"depth\": n,          (numeric) the number of requests waiting in the queue\n"
+            "      \"maxdepth\": n,       (numeric) the number of requests the queue holds before rejecting more\n"
+            "      \"processed\": n,      (numeric) the number of requests served\n"
+            "      \"rejected\": n,       (numeric) the number of requests rejected because the queue was full\n"
+            "      \"waittime\": n        (numeric) the total time requests waited in the queue, in microseconds\n"
+            "    }, ...\n"
+            "  ],\n"
+            "  \"latencybuckets\": [ n, ... ], (json array) upper bounds of the latency histogram buckets in milliseconds,\n"
+            "                              the last bucket of a histogram holds the slower calls\n"
+            "  \"methods\": {\n"
+            "    \"method\": {\n"
+            "      \"calls\": n,          (numeric) the number of finished calls\n"
+            "      \"errors\": n,         (numeric) the number of calls that failed\n"
+            "      \"inflight\": n,       (numeric) the number of calls being executed right now\n"
+            "      \"totaltime\": n,      (numeric) the total execution time, in microseconds\n"
+            "      \"maxtime\": n,        (numeric) the longest execution time, in microseconds\n"
+            "      \"latency\": [ n, ... ] (json array) the number of calls per latency bucket\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getrpcstats", "")
+            + HelpExampleRpc("getrpcstats", "")
+        );
+
+    UniValue queues(UniValue::VARR);
+    BOOST_FOREACH(const HTTPWorkQueueStats& stats, GetHTTPWorkQueueStats()) {
+        UniValue queue(UniValue::VOBJ);
+        queue.push_back(Pair("name", stats.name));
+        queue.push_back(Pair("threads", stats.threads));
+        queue.push_back(Pair("busythreads", stats.busy));
+        queue.push_back(Pair("depth", (uint64_t)stats.depth));
+        queue.push_back(Pair("maxdepth", (uint64_t)stats.maxDepth));
+        queue.push_back(Pair("processed", stats.processed));
+        queue.push_back(Pair("rejected", stats.rejected));
+        queue.push_back(Pair("waittime", stats.waitMicros));
+        queues.push_back(queue);
+    }
+
+    UniValue buckets(UniValue::VARR);
+    for (size_t i = 0; i < RPC_LATENCY_BUCKET_COUNT - 1; i++)
+        buckets.push_back(RPC_LATENCY_BUCKETS_MS[i]);
+
+    UniValue methods(UniValue::VOBJ);
+    std::map<std::string, CRPCMethodStats> mapStats = GetRPCMethodStats();
+    for (std::map<std::string, CRPCMethodStats>::const_iterator it = mapStats.begin(); it != mapStats.end(); ++it) {
+        const CRPCMethodStats& stats = it->second;
+        UniValue latency(UniValue::VARR);
+        for (size_t i = 0; i < RPC_LATENCY_BUCKET_COUNT; i++)
+            latency.push_back(stats.vLatency[i]);
+
+        UniValue method(UniValue::VOBJ);
+        method.push_back(Pair("calls", stats.nCalls));
+        method.push_back(Pair("errors", stats.nErrors));
+        method.push_back(Pair("inflight", stats.nInFlight));
+        method.push_back(Pair("totaltime", stats.nTotalMicros));
+        method.push_back(Pair("maxtime", stats.nMaxMicros));
+        method.push_back(Pair("latency", latency));
+        methods.push_back(Pair(it->first, method));
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.push_back(Pair("queues", queues));
+    result.push_back(Pair("latencybuckets", buckets));
+    result.push_back(Pair("methods", methods));
+    return result;
+}
+
 /**
  * Call Table
  */
@@ -271,10 +399,11 @@ static const CRPCCommand vRPCCommands[] =
     /* Overall control/query calls */
     { "control",            "help",                   &help,                   true  },
     { "control",            "stop",                   &stop,                   true  },
+    { "control",            "getrpcstats",            &getrpcstats,            true  },
         /* Address index */
     { "addressindex",       "getaddressmempool",      &getaddressmempool,      true  },
     { "addressindex",       "getaddressutxos",        &getaddressutxos,        false },
-    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false },
+    { "addressindex",       "getaddressdeltas",       &getaddressdeltas,       false, &getaddressdeltas_streamed },
     { "addressindex",       "getaddresstxids",        &getaddresstxids,        false },
     { "addressindex",       "getaddressbalance",      &getaddressbalance,      false },
 };
@@ -391,37 +520,43 @@ void JSONRequest::parse(const UniValue& valRequest)
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array");
 }
 
-static UniValue JSONRPCExecOne(const UniValue& req)
+static void JSONRPCExecOne(const UniValue& req, CJSONWriter& writer)
 {
-    UniValue rpc_result(UniValue::VOBJ);
-
     JSONRequest jreq;
+    CJSONWriter::Checkpoint cp = writer.GetCheckpoint();
+    UniValue objError;
     try {
         jreq.parse(req);
 
-        UniValue result = tableRPC.execute(jreq.strMethod, jreq.params);
-        rpc_result = JSONRPCReplyObj(result, NullUniValue, jreq.id);
+        writer.BeginObject();
+        writer.Key("result");
+        tableRPC.execute(jreq.strMethod, jreq.params, writer);
+        writer.Pair("error", NullUniValue);
+        writer.Pair("id", jreq.id);
+        writer.EndObject();
+        return;
     }
-    catch (const UniValue& objError)
+    catch (const UniValue& e)
     {
-        rpc_result = JSONRPCReplyObj(NullUniValue, objError, jreq.id);
+        objError = e;
     }
     catch (const std::exception& e)
     {
-        rpc_result = JSONRPCReplyObj(NullUniValue,
-                                     JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        objError = JSONRPCError(RPC_PARSE_ERROR, e.what());
     }
 
-    return rpc_result;
+    // A partial result that was sent already can't be replaced by the error
+    if (!writer.Rollback(cp))
+        throw objError;
+    writer.Value(JSONRPCReplyObj(NullUniValue, objError, jreq.id));
 }
 
-std::string JSONRPCExecBatch(const UniValue& vReq)
+void JSONRPCExecBatch(const UniValue& vReq, CJSONWriter& writer)
 {
-    UniValue ret(UniValue::VARR);
+    writer.BeginArray();
     for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(vReq[reqIdx]));
-
-    return ret.write() + "\n";
+        JSONRPCExecOne(vReq[reqIdx], writer);
+    writer.EndArray();
 }
 
 UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
@@ -439,11 +574,14 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
         throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found");
 
     g_rpcSignals.PreCommand(*pcmd);
+    CRPCCallTracker tracker(strMethod);
 
     try
     {
         // Execute
-        return pcmd->actor(params, false);
+        UniValue result = pcmd->actor(params, false);
+        tracker.Success();
+        return result;
     }
     catch (const std::exception& e)
     {
@@ -453,6 +591,50 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     g_rpcSignals.PostCommand(*pcmd);
 }
 
+void CRPCTable::execute(const std::string &strMethod, const UniValue &params, CJSONWriter& result) const
+{
+    // Return immediately if in warmup
+    {
+        LOCK(cs_rpcWarmup);
+        if (fRPCInWarmup)
+            throw JSONRPCError(RPC_IN_WARMUP, rpcWarmupStatus);
+    }
+
+    // Find method
+    const CRPCCommand *pcmd = tableRPC[strMethod];
+    if (!pcmd)
+        throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found");
+
+    g_rpcSignals.PreCommand(*pcmd);
+    CRPCCallTracker tracker(strMethod);
+
+    try
+    {
+        // Execute
+        if (pcmd->streamActor)
+            pcmd->streamActor(params, result);
+        else
+            result.Value(pcmd->actor(params, false));
+        tracker.Success();
+    }
+    catch (const std::exception& e)
+    {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+
+    g_rpcSignals.PostCommand(*pcmd);
+}
+
+UniValue CallStreamedRPC(rpcstreamfn_type fn, const UniValue& params)
+{
+    // In-process callers get the tree directly, without a round trip through JSON text
+    UniValue result;
+    CJSONWriter writer(result);
+    fn(params, writer);
+    writer.Finish();
+    return result;
+}
+
 std::vector<std::string> CRPCTable::listCommands() const
 {
     std::vector<std::string> commandList;
@@ -10,6 +10,7 @@
 #include "rpc/protocol.h"
 #include "uint256.h"
 
+#include <algorithm>
 #include <list>
 #include <map>
 #include <stdint.h>
@@ -124,17 +125,58 @@ void RPCUnsetTimerInterface(RPCTimerInterface *iface);
  */
 void RPCRunLater(const std::string& name, boost::function<void(void)> func, int64_t nSeconds);
 
+class CJSONWriter;
+
 typedef UniValue(*rpcfn_type)(const UniValue& params, bool fHelp);
+typedef void(*rpcstreamfn_type)(const UniValue& params, CJSONWriter& result);
 
 class CRPCCommand
 {
 public:
+    CRPCCommand(const std::string& categoryIn, const std::string& nameIn, rpcfn_type actorIn, bool okSafeModeIn)
+        : category(categoryIn), name(nameIn), actor(actorIn), okSafeMode(okSafeModeIn), streamActor(NULL) {}
+
+    CRPCCommand(const std::string& categoryIn, const std::string& nameIn, rpcfn_type actorIn, bool okSafeModeIn,
+            rpcstreamfn_type streamActorIn)
+        : category(categoryIn), name(nameIn), actor(actorIn), okSafeMode(okSafeModeIn), streamActor(streamActorIn) {}
+
     std::string category;
     std::string name;
     rpcfn_type actor;
     bool okSafeMode;
+    //! Optional, writes the result incrementally when called over HTTP
+    rpcstreamfn_type streamActor;
+};
+
+/**
+ * Call a streaming RPC implementation and return its result as UniValue, for the
+ * callers that need the whole result.
+ */
+UniValue CallStreamedRPC(rpcstreamfn_type fn, const UniValue& params);
+
+/** Upper bounds of the RPC latency histogram buckets in milliseconds, slower calls go to a last bucket */
+static const int64_t RPC_LATENCY_BUCKETS_MS[] = {1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 30000};
+static const size_t RPC_LATENCY_BUCKET_COUNT = sizeof(RPC_LATENCY_BUCKETS_MS) / sizeof(RPC_LATENCY_BUCKETS_MS[0]) + 1;
+
+/** Counters of the calls of one RPC method */
+struct CRPCMethodStats
+{
+    uint64_t nCalls;
+    uint64_t nErrors;
+    int nInFlight;
+    int64_t nTotalMicros;
+    int64_t nMaxMicros;
+    uint64_t vLatency[RPC_LATENCY_BUCKET_COUNT];
+
+    CRPCMethodStats() : nCalls(0), nErrors(0), nInFlight(0), nTotalMicros(0), nMaxMicros(0)
+    {
+        std::fill(vLatency, vLatency + RPC_LATENCY_BUCKET_COUNT, 0);
+    }
 };
 
+/** Statistics of the methods that have been called since startup */
+std::map<std::string, CRPCMethodStats> GetRPCMethodStats();
+
 /**
  * Bitcoin RPC command dispatcher.
  */
@@ -156,6 +198,14 @@ public:
      */
     UniValue execute(const std::string &method, const UniValue &params) const;
 
+    /**
+     * Execute a method and write its result to result. Methods which have a
+     * streaming implementation write the result as it is produced.
+     * @throws an exception (UniValue) when an error happens. Check
+     * result.GetBytesWritten() to know whether part of the result was written already.
+     */
+    void execute(const std::string &method, const UniValue &params, CJSONWriter& result) const;
+
     /**
     * Returns a list of registered commands
     * @returns List of registered commands.
@@ -194,6 +244,7 @@ extern std::string HelpExampleRpc(const std::string& methodname, const std::stri
 extern UniValue getaddressmempool(const UniValue& params, bool fHelp);
 extern UniValue getaddressutxos(const UniValue& params, bool fHelp);
 extern UniValue getaddressdeltas(const UniValue& params, bool fHelp);
+extern void getaddressdeltas_streamed(const UniValue& params, CJSONWriter& result);
 extern UniValue getaddresstxids(const UniValue& params, bool fHelp);
 extern UniValue getaddressbalance(const UniValue& params, bool fHelp);
 
@@ -202,7 +253,7 @@ extern void EnsureWalletIsUnlocked();
 bool StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const UniValue& vReq);
+void JSONRPCExecBatch(const UniValue& vReq, CJSONWriter& writer);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
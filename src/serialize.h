@@ -618,6 +618,19 @@ void Serialize(Stream &s, const std::shared_ptr <T> &item, int nType, int nVersi
 template<typename Stream, typename T>
 void Unserialize(Stream &s, std::shared_ptr <T> &item, int nType, int nVersion);
 
+/**
+ * shared_ptr to immutable object, serialized as the object itself
+ */
+
+template<typename T>
+unsigned int GetSerializeSize(const std::shared_ptr <const T> &item, int nType, int nVersion);
+
+template<typename Stream, typename T>
+void Serialize(Stream &s, const std::shared_ptr <const T> &item, int nType, int nVersion);
+
+template<typename Stream, typename T>
+void Unserialize(Stream &s, std::shared_ptr <const T> &item, int nType, int nVersion);
+
 
 // Lava - MTP
 /**
@@ -1131,6 +1144,26 @@ void Unserialize(Stream &os, std::shared_ptr <T> &item, int nType, int nVersion)
     }
 }
 
+/**
+ * shared_ptr to immutable object
+ */
+template<typename T>
+unsigned int GetSerializeSize(const std::shared_ptr <const T> &item, int nType, int nVersion) {
+    return ::GetSerializeSize(*item, nType, nVersion);
+}
+
+template<typename Stream, typename T>
+void Serialize(Stream &os, const std::shared_ptr <const T> &item, int nType, int nVersion) {
+    ::Serialize(os, *item, nType, nVersion);
+}
+
+template<typename Stream, typename T>
+void Unserialize(Stream &is, std::shared_ptr <const T> &item, int nType, int nVersion) {
+    std::shared_ptr<T> newItem = std::make_shared<T>();
+    ::Unserialize(is, *newItem, nType, nVersion);
+    item = newItem;
+}
+
 
 
 
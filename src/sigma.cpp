@@ -14,6 +14,7 @@
 #include "sigma/coin.h"
 #include "sigma/remint.h"
 #include "primitives/zerocoin.h"
+#include "libzerocoin/ParallelTasks.h"
 
 #include <atomic>
 #include <sstream>
@@ -136,7 +137,8 @@ bool CheckSigmaBlock(CValidationState &state, const CBlock& block) {
     size_t blockSpendsAmount = 0;
     CAmount blockSpendsValue(0);
 
-    for (const auto& tx : block.vtx) {
+    for (const auto& ptx : block.vtx) {
+        const CTransaction& tx = *ptx;
         // Check zerocoin to sigma remints against the same limit as sigma spends
 
         auto txSpendsValue = tx.IsZerocoinRemint() ? CoinRemintToV3::GetAmount(tx) : GetSpendAmount(tx);
@@ -198,6 +200,25 @@ bool CheckSigmaSpendTransaction(
              return state.DoS(100, error("Sigma is disabled at this period."));
     }
 
+    // Spends waiting for the proof verification
+    struct SpendToVerify {
+        std::unique_ptr<sigma::CoinSpend> spend;
+        uint32_t coinGroupId;
+        std::vector<sigma::PublicCoin> anonymity_set;
+        sigma::SpendMetaData metaData;
+        bool fPadding;
+    };
+    std::vector<SpendToVerify> spendsToVerify;
+
+    // Obtain the hash of the transaction sans the zerocoin part
+    CMutableTransaction txTemp = tx;
+    BOOST_FOREACH(CTxIn &txTempIn, txTemp.vin) {
+        if (txTempIn.scriptSig.IsSigmaSpend()) {
+            txTempIn.scriptSig.clear();
+        }
+    }
+    uint256 txHashForMetadata = txTemp.GetHash();
+
     for (const CTxIn &txin : tx.vin)
     {
         std::unique_ptr<sigma::CoinSpend> spend;
@@ -226,17 +247,6 @@ bool CheckSigmaSpendTransaction(
                              "CTransaction::CheckTransaction() : Error: incorrect spend transaction verion");
         }
 
-        uint256 txHashForMetadata;
-
-        // Obtain the hash of the transaction sans the zerocoin part
-        CMutableTransaction txTemp = tx;
-        BOOST_FOREACH(CTxIn &txTempIn, txTemp.vin) {
-            if (txTempIn.scriptSig.IsSigmaSpend()) {
-                txTempIn.scriptSig.clear();
-            }
-        }
-        txHashForMetadata = txTemp.GetHash();
-
         LogPrintf("CheckSigmaSpendTransaction: tx version=%d, tx metadata hash=%s, serial=%s\n",
                 spend->getVersion(), txHashForMetadata.ToString(),
                 spend->getCoinSerialNumber().tostring());
@@ -250,7 +260,6 @@ bool CheckSigmaSpendTransaction(
             return state.DoS(100, false, NO_MINT_ZEROCOIN,
                     "CheckSigmaSpendTransaction: Error: no coins were minted with such parameters");
 
-        bool passVerify = false;
         CBlockIndex *index = coinGroup.lastBlock;
         pair<sigma::CoinDenomination, int> denominationAndId = std::make_pair(
             targetDenominations[vinIndex], coinGroupId);
@@ -289,36 +298,52 @@ bool CheckSigmaSpendTransaction(
                 return state.DoS(1, error("Incorrect sigma spend transaction version"));
         }
 
-        passVerify = spend->Verify(anonymity_set, newMetaData, fPadding);
-        if (passVerify) {
-            Scalar serial = spend->getCoinSerialNumber();
-            // do not check for duplicates in case we've seen exact copy of this tx in this block before
-            if (!(sigmaTxInfo && sigmaTxInfo->zcTransactions.count(hashTx) > 0)) {
-                if (!CheckSigmaSpendSerial(
-                            state, sigmaTxInfo, serial, nHeight, false)) {
-                    LogPrintf("CheckSigmaSpendTransaction: serial check failed, serial=%s\n", serial);
-                    return false;
-                }
-            }
+        spendsToVerify.push_back(SpendToVerify{
+            std::move(spend), coinGroupId, std::move(anonymity_set), newMetaData, fPadding});
+    }
 
-            // check duplicated serials in same transaction.
-            if (!txSerials.insert(serial).second) {
-                return state.DoS(100,
-                    error("CheckSigmaSpendTransaction: two or more spends with same serial in the same transaction"));
-            }
+    // Proofs are independent from each other so verify all of them at once on the shared thread pool
+    std::vector<char> passVerify(spendsToVerify.size(), false);
+    libzerocoin::ParallelTasks verifications(spendsToVerify.size(), libzerocoin::PARALLEL_TASK_PRIORITY_HIGH);
+    for (size_t i = 0; i < spendsToVerify.size(); i++) {
+        verifications.Add([&spendsToVerify, &passVerify, i] {
+            const SpendToVerify &toVerify = spendsToVerify[i];
+            passVerify[i] = toVerify.spend->Verify(toVerify.anonymity_set, toVerify.metaData, toVerify.fPadding);
+        });
+    }
+    verifications.Wait();
 
-            if(!isVerifyDB && !isCheckWallet) {
-                if (sigmaTxInfo && !sigmaTxInfo->fInfoIsComplete) {
-                    // add spend information to the index
-                    sigmaTxInfo->spentSerials.insert(std::make_pair(
-                                serial, CSpendCoinInfo::make(spend->getDenomination(), coinGroupId)));
-                }
-            }
-        }
-        else {
+    for (size_t i = 0; i < spendsToVerify.size(); i++) {
+        const SpendToVerify &verified = spendsToVerify[i];
+
+        if (!passVerify[i]) {
             LogPrintf("CheckSigmaSpendTransaction: verification failed at block %d\n", nHeight);
             return false;
         }
+
+        Scalar serial = verified.spend->getCoinSerialNumber();
+        // do not check for duplicates in case we've seen exact copy of this tx in this block before
+        if (!(sigmaTxInfo && sigmaTxInfo->zcTransactions.count(hashTx) > 0)) {
+            if (!CheckSigmaSpendSerial(
+                        state, sigmaTxInfo, serial, nHeight, false)) {
+                LogPrintf("CheckSigmaSpendTransaction: serial check failed, serial=%s\n", serial);
+                return false;
+            }
+        }
+
+        // check duplicated serials in same transaction.
+        if (!txSerials.insert(serial).second) {
+            return state.DoS(100,
+                error("CheckSigmaSpendTransaction: two or more spends with same serial in the same transaction"));
+        }
+
+        if(!isVerifyDB && !isCheckWallet) {
+            if (sigmaTxInfo && !sigmaTxInfo->fInfoIsComplete) {
+                // add spend information to the index
+                sigmaTxInfo->spentSerials.insert(std::make_pair(
+                            serial, CSpendCoinInfo::make(verified.spend->getDenomination(), verified.coinGroupId)));
+            }
+        }
     }
 
     if(!isVerifyDB && !isCheckWallet) {
@@ -635,7 +660,8 @@ bool ConnectBlockSigma(
 bool GetOutPointFromBlock(COutPoint& outPoint, const GroupElement &pubCoinValue, const CBlock &block){
     secp_primitives::GroupElement txPubCoinValue;
     // cycle transaction hashes, looking for this pubcoin.
-    BOOST_FOREACH(CTransaction tx, block.vtx){
+    for (const CTransactionRef& ptx: block.vtx) {
+        const CTransaction& tx = *ptx;
         uint32_t nIndex = 0;
         for (const CTxOut &txout: tx.vout) {
             if (txout.scriptPubKey.IsSigmaMint()){
@@ -17,7 +17,22 @@ public:
                 const SigmaPlusProof<Exponent, GroupElement>& proof,
                 bool fPadding) const;
 
+    // Verifies proofs of different serials against the same set of commitments at once.
+    // The commitments must not be offset by the serials, unlike for verify().
+    bool batch_verify(const std::vector<GroupElement>& commits,
+                      const std::vector<Exponent>& serials,
+                      const std::vector<SigmaPlusProof<Exponent, GroupElement>>& proofs,
+                      bool fPadding) const;
+
 private:
+    // Checks everything but the final equation, and computes the exponents of the commitments.
+    bool compute_fis(const SigmaPlusProof<Exponent, GroupElement>& proof,
+                     std::size_t N,
+                     bool fPadding,
+                     Exponent& challenge_x,
+                     std::vector<Exponent>& f_i_) const;
+
+
     GroupElement g_;
     std::vector<GroupElement> h_;
     int n;
@@ -18,6 +18,111 @@ bool SigmaPlusVerifier<Exponent, GroupElement>::verify(
         const SigmaPlusProof<Exponent, GroupElement>& proof,
         bool fPadding) const {
 
+    if (commits.empty()) {
+        LogPrintf("No mints in the anonymity set");
+        return false;
+    }
+
+    Exponent challenge_x;
+    std::vector<Exponent> f_i_;
+    if (!compute_fis(proof, commits.size(), fPadding, challenge_x, f_i_))
+        return false;
+
+    secp_primitives::MultiExponent mult(commits, f_i_);
+    GroupElement t1 = mult.get_multiple();
+
+    const std::vector <GroupElement>& Gk = proof.Gk_;
+    GroupElement t2;
+    Exponent x_k(uint64_t(1));
+    for(int k = 0; k < m; ++k){
+        t2 += (Gk[k] * (x_k.negate()));
+        x_k *= challenge_x;
+    }
+
+    GroupElement left(t1 + t2);
+    if (left != SigmaPrimitives<Exponent, GroupElement>::commit(g_, Exponent(uint64_t(0)), h_[0], proof.z_)) {
+        LogPrintf("Sigma spend failed due to final proof verification failure.");
+        return false;
+    }
+
+    return true;
+}
+
+template<class Exponent, class GroupElement>
+bool SigmaPlusVerifier<Exponent, GroupElement>::batch_verify(
+        const std::vector<GroupElement>& commits,
+        const std::vector<Exponent>& serials,
+        const std::vector<SigmaPlusProof<Exponent, GroupElement>>& proofs,
+        bool fPadding) const {
+
+    if (commits.empty()) {
+        LogPrintf("No mints in the anonymity set");
+        return false;
+    }
+
+    if (serials.size() != proofs.size()) {
+        return false;
+    }
+
+    /*
+     * Each proof j satisfies \sum_i f_{j,i} (C_i - s_j g) + t2_j - z_j h_0 = 0. Weighting the equations
+     * with random y_j and adding them up needs only one multi-exponentiation over the commitments:
+     *
+     * \sum_i (\sum_j y_j f_{j,i}) C_i - (\sum_j y_j s_j \sum_i f_{j,i}) g + \sum_j y_j t2_j - (\sum_j y_j z_j) h_0 = 0
+     */
+    std::size_t N = commits.size();
+    std::vector<Exponent> f_sum(N, Exponent(uint64_t(0)));
+    Exponent g_exp(uint64_t(0));
+    Exponent h_exp(uint64_t(0));
+    GroupElement t2;
+
+    for (std::size_t j = 0; j < proofs.size(); ++j) {
+        const SigmaPlusProof<Exponent, GroupElement>& proof = proofs[j];
+
+        Exponent challenge_x;
+        std::vector<Exponent> f_i_;
+        if (!compute_fis(proof, N, fPadding, challenge_x, f_i_))
+            return false;
+
+        Exponent y;
+        y.randomize();
+
+        Exponent f_i_sum(uint64_t(0));
+        for (std::size_t i = 0; i < N; ++i) {
+            f_sum[i] += f_i_[i] * y;
+            f_i_sum += f_i_[i];
+        }
+
+        g_exp += f_i_sum * serials[j] * y;
+        h_exp += proof.z_ * y;
+
+        Exponent x_k(y);
+        for (int k = 0; k < m; ++k) {
+            t2 += (proof.Gk_[k] * (x_k.negate()));
+            x_k *= challenge_x;
+        }
+    }
+
+    secp_primitives::MultiExponent mult(commits, f_sum);
+    GroupElement t1 = mult.get_multiple();
+
+    GroupElement left(t1 + t2 + (g_ * g_exp).inverse() + (h_[0] * h_exp).inverse());
+    if (!left.isInfinity()) {
+        LogPrintf("Sigma spends failed due to final batch verification failure.");
+        return false;
+    }
+
+    return true;
+}
+
+template<class Exponent, class GroupElement>
+bool SigmaPlusVerifier<Exponent, GroupElement>::compute_fis(
+        const SigmaPlusProof<Exponent, GroupElement>& proof,
+        std::size_t N,
+        bool fPadding,
+        Exponent& challenge_x,
+        std::vector<Exponent>& f_i_) const {
+
     R1ProofVerifier<Exponent, GroupElement> r1ProofVerifier(g_, h_, proof.B_, n, m);
     std::vector<Exponent> f;
     const R1Proof<Exponent, GroupElement>& r1Proof = proof.r1Proof_;
@@ -44,7 +149,6 @@ bool SigmaPlusVerifier<Exponent, GroupElement>::verify(
         r1Proof.A_, proof.B_, r1Proof.C_, r1Proof.D_};
 
     group_elements.insert(group_elements.end(), Gk.begin(), Gk.end());
-    Exponent challenge_x;
     SigmaPrimitives<Exponent, GroupElement>::generate_challenge(group_elements, challenge_x);
 
     // Now verify the final response of r1 proof. Values of "f" are finalized only after this call.
@@ -58,13 +162,7 @@ bool SigmaPlusVerifier<Exponent, GroupElement>::verify(
         return false;
     }
 
-    if (commits.empty()) {
-        LogPrintf("No mints in the anonymity set");
-        return false;
-    }
-
-    std::size_t N = commits.size();
-    std::vector<Exponent> f_i_;
+    f_i_.clear();
     f_i_.reserve(N);
 
     // if fPadding is true last index is special
@@ -112,22 +210,6 @@ bool SigmaPlusVerifier<Exponent, GroupElement>::verify(
         f_i_.emplace_back(pow);
     }
 
-    secp_primitives::MultiExponent mult(commits, f_i_);
-    GroupElement t1 = mult.get_multiple();
-
-    GroupElement t2;
-    Exponent x_k(uint64_t(1));
-    for(int k = 0; k < m; ++k){
-        t2 += (Gk[k] * (x_k.negate()));
-        x_k *= challenge_x;
-    }
-
-    GroupElement left(t1 + t2);
-    if (left != SigmaPrimitives<Exponent, GroupElement>::commit(g_, Exponent(uint64_t(0)), h_[0], proof.z_)) {
-        LogPrintf("Sigma spend failed due to final proof verification failure.");
-        return false;
-    }
-
     return true;
 }
 
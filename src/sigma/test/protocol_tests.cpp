@@ -209,4 +209,63 @@ BOOST_AUTO_TEST_CASE(prove_coin_not_in_set)
     BOOST_CHECK(!verifier.verify(commits, proof, true));
 }
 
+BOOST_AUTO_TEST_CASE(batch_verify)
+{
+    auto params = sigma::Params::get_default();
+    int N = 1000;
+    int n = params->get_n();
+    int m = params->get_m();
+    std::vector<int> indexes = {0, 500, 999};
+
+    secp_primitives::GroupElement g;
+    g.randomize();
+    std::vector<secp_primitives::GroupElement> h_gens;
+    h_gens.resize(n * m);
+    for(int i = 0; i < n * m; ++i ){
+        h_gens[i].randomize();
+    }
+    sigma::SigmaPlusProver<secp_primitives::Scalar,secp_primitives::GroupElement> prover(g,h_gens, n, m);
+
+    std::vector<secp_primitives::GroupElement> commits(N);
+    for(int i = 0; i < N; ++i){
+        commits[i].randomize();
+    }
+
+    std::vector<secp_primitives::Scalar> serials(indexes.size());
+    std::vector<secp_primitives::Scalar> randomness(indexes.size());
+    for(size_t j = 0; j < indexes.size(); ++j){
+        serials[j].randomize();
+        randomness[j].randomize();
+        commits[indexes[j]] = sigma::SigmaPrimitives<secp_primitives::Scalar,secp_primitives::GroupElement>::commit(
+            g, serials[j], h_gens[0], randomness[j]);
+    }
+
+    std::vector<sigma::SigmaPlusProof<secp_primitives::Scalar,secp_primitives::GroupElement>> proofs;
+    for(size_t j = 0; j < indexes.size(); ++j){
+        // proofs are created for the commitments offset by the serial
+        secp_primitives::GroupElement gs = (g * serials[j]).inverse();
+        std::vector<secp_primitives::GroupElement> offsetCommits;
+        for(int i = 0; i < N; ++i){
+            offsetCommits.push_back(commits[i] + gs);
+        }
+
+        sigma::SigmaPlusProof<secp_primitives::Scalar,secp_primitives::GroupElement> proof(n, m);
+        prover.proof(offsetCommits, indexes[j], randomness[j], true, proof);
+        proofs.push_back(proof);
+    }
+
+    sigma::SigmaPlusVerifier<secp_primitives::Scalar,secp_primitives::GroupElement> verifier(g, h_gens, n, m);
+    BOOST_CHECK(verifier.batch_verify(commits, serials, proofs, true));
+
+    // a single proof with the wrong serial fails the whole batch
+    std::vector<secp_primitives::Scalar> swapped(serials);
+    std::swap(swapped[0], swapped[1]);
+    BOOST_CHECK(!verifier.batch_verify(commits, swapped, proofs, true));
+
+    // proofs don't verify against a different set
+    std::vector<secp_primitives::GroupElement> otherCommits(commits);
+    otherCommits[indexes[1]].randomize();
+    BOOST_CHECK(!verifier.batch_verify(otherCommits, serials, proofs, true));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
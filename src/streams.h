@@ -490,6 +490,57 @@ public:
     }
 };
 
+/** Read-only stream over a range of memory owned by the caller, e.g. a memory mapped file.
+ *  Deserializes in place without copying the data into a buffer first.
+ */
+class CMemoryReader
+{
+private:
+    int nType;
+    int nVersion;
+
+    const unsigned char* pbegin;
+    size_t nSize;
+    size_t nPos;
+
+public:
+    CMemoryReader(const unsigned char* pbeginIn, size_t nSizeIn, int nTypeIn, int nVersionIn)
+        : nType(nTypeIn), nVersion(nVersionIn), pbegin(pbeginIn), nSize(nSizeIn), nPos(0) {}
+
+    //
+    // Stream subset
+    //
+    int GetType()                { return nType; }
+    int GetVersion()             { return nVersion; }
+    bool empty() const           { return nPos == nSize; }
+    size_t size() const          { return nSize - nPos; }
+
+    CMemoryReader& read(char* pch, size_t nRead)
+    {
+        if (nRead > nSize - nPos)
+            throw std::ios_base::failure("CMemoryReader::read(): end of data");
+        memcpy(pch, pbegin + nPos, nRead);
+        nPos += nRead;
+        return (*this);
+    }
+
+    CMemoryReader& ignore(size_t nSkip)
+    {
+        if (nSkip > nSize - nPos)
+            throw std::ios_base::failure("CMemoryReader::ignore(): end of data");
+        nPos += nSkip;
+        return (*this);
+    }
+
+    template<typename T>
+    CMemoryReader& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 /** Non-refcounted RAII wrapper around a FILE* that implements a ring buffer to
  *  deserialize from. It guarantees the ability to rewind a given number of bytes.
  *
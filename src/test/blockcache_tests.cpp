@@ -0,0 +1,88 @@
+#include "blockcache.h"
+#include "clientversion.h"
+#include "random.h"
+#include "streams.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockcache_tests, BasicTestingSetup)
+
+static CBlock BuildBlock(unsigned int nTx)
+{
+    CBlock block;
+    block.nVersion = 2;
+    block.hashPrevBlock = GetRandHash();
+    block.nTime = 1500000000;
+    for (unsigned int i = 0; i < nTx; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout.hash = GetRandHash();
+        tx.vout.resize(1);
+        tx.vout[0].nValue = i;
+        block.vtx.push_back(MakeTransactionRef(std::move(tx)));
+    }
+    return block;
+}
+
+BOOST_AUTO_TEST_CASE(memory_reader)
+{
+    CBlock block = BuildBlock(3);
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << block;
+    std::vector<unsigned char> data(stream.begin(), stream.end());
+
+    CMemoryReader reader(data.data(), data.size(), SER_DISK, CLIENT_VERSION);
+    CBlock block2;
+    reader >> block2;
+    BOOST_CHECK(reader.empty());
+    BOOST_CHECK(block2.GetHash() == block.GetHash());
+    BOOST_CHECK_EQUAL(block2.vtx.size(), 3);
+    BOOST_CHECK(block2.vtx[2]->GetHash() == block.vtx[2]->GetHash());
+
+    // Reading past the end of the range must fail instead of touching memory beyond it
+    CMemoryReader truncated(data.data(), data.size() - 1, SER_DISK, CLIENT_VERSION);
+    CBlock block3;
+    BOOST_CHECK_THROW(truncated >> block3, std::ios_base::failure);
+}
+
+BOOST_AUTO_TEST_CASE(block_cache_lru)
+{
+    CBlockCache cache;
+    CBlock block1 = BuildBlock(2), block2 = BuildBlock(2), block3 = BuildBlock(2);
+
+    CBlock out;
+    BOOST_CHECK(!cache.Get(block1.GetHash(), out));
+    cache.Insert(block1.GetHash(), block1);
+    BOOST_CHECK(cache.Get(block1.GetHash(), out));
+    BOOST_CHECK(out.GetHash() == block1.GetHash());
+    // Transactions are shared with the cached block
+    BOOST_CHECK(out.vtx[0] == block1.vtx[0]);
+    BOOST_CHECK_EQUAL(cache.GetHits(), 1);
+    BOOST_CHECK_EQUAL(cache.GetMisses(), 1);
+
+    // Room for two blocks only
+    cache.SetMaxUsage(cache.GetUsage() * 2);
+    cache.Insert(block2.GetHash(), block2);
+    // Touch block1 so block2 becomes the least recently used one
+    BOOST_CHECK(cache.Get(block1.GetHash(), out));
+    cache.Insert(block3.GetHash(), block3);
+    BOOST_CHECK(cache.Get(block1.GetHash(), out));
+    BOOST_CHECK(!cache.Get(block2.GetHash(), out));
+    BOOST_CHECK(cache.Get(block3.GetHash(), out));
+
+    // Memory only state of the caller doesn't end up in the cache
+    block1.fChecked = true;
+    cache.Clear();
+    cache.Insert(block1.GetHash(), block1);
+    BOOST_CHECK(cache.Get(block1.GetHash(), out));
+    BOOST_CHECK(!out.fChecked);
+
+    cache.SetMaxUsage(0);
+    BOOST_CHECK_EQUAL(cache.GetUsage(), 0);
+    cache.Insert(block2.GetHash(), block2);
+    BOOST_CHECK(!cache.Get(block2.GetHash(), out));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
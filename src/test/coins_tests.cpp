@@ -9,6 +9,7 @@
 #include "utilstrencodings.h"
 #include "test/test_bitcoin.h"
 #include "main.h"
+#include "txdb.h"
 #include "consensus/validation.h"
 
 #include <vector>
@@ -346,6 +347,166 @@ BOOST_AUTO_TEST_CASE(updatecoins_simulation_test)
     BOOST_CHECK(spent_a_duplicate_coinbase);
 }
 
+BOOST_AUTO_TEST_CASE(coins_cache_sync_trim)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+
+    std::vector<uint256> txids;
+    for (int i = 0; i < 10; i++) {
+        txids.push_back(GetRandHash());
+        CCoinsModifier coins = cache.ModifyNewCoins(txids.back(), false);
+        coins->vout.resize(1);
+        coins->vout[0].nValue = i + 1;
+        coins->vout[0].scriptPubKey.assign(insecure_rand() & 0x3F, 0);
+    }
+    BOOST_CHECK_EQUAL(cache.GetDirtyCacheSize(), 10);
+
+    // Sync writes everything but keeps the entries cached
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetDirtyCacheSize(), 0);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 10);
+    cache.SelfTest();
+    CCoins coins;
+    BOOST_CHECK(base.GetCoins(txids[0], coins) && coins.vout[0].nValue == 1);
+
+    uint64_t nHits = cache.GetCacheHits(), nMisses = cache.GetCacheMisses();
+    BOOST_CHECK(cache.AccessCoins(txids[0]) != NULL);
+    BOOST_CHECK_EQUAL(cache.GetCacheHits(), nHits + 1);
+    BOOST_CHECK_EQUAL(cache.GetCacheMisses(), nMisses);
+
+    // Spent entries are written and dropped
+    cache.ModifyCoins(txids[1])->Spend(0);
+    BOOST_CHECK_EQUAL(cache.GetDirtyCacheSize(), 1);
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 9);
+    BOOST_CHECK(!base.GetCoins(txids[1], coins) || coins.IsPruned());
+    cache.SelfTest();
+
+    // Trim never evicts modified entries
+    cache.ModifyCoins(txids[2])->vout[0].nValue = 100;
+    BOOST_CHECK_EQUAL(cache.Trim(0), 8);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 1);
+    BOOST_CHECK(cache.HaveCoinsInCache(txids[2]));
+    cache.SelfTest();
+
+    // Evicted entries are read back from the base view
+    nMisses = cache.GetCacheMisses();
+    const CCoins *pcoins = cache.AccessCoins(txids[3]);
+    BOOST_CHECK(pcoins != NULL && pcoins->vout[0].nValue == 4);
+    BOOST_CHECK_EQUAL(cache.GetCacheMisses(), nMisses + 1);
+
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(base.GetCoins(txids[2], coins) && coins.vout[0].nValue == 100);
+}
+
+BOOST_FIXTURE_TEST_CASE(coins_cache_partial_sync, TestingSetup)
+{
+    CCoinsViewDB db(1 << 20, true);
+    uint256 hashOld = GetRandHash(), hashMid = GetRandHash(), hashNew = GetRandHash();
+    {
+        CCoinsViewCache cache(&db);
+        cache.SetBestBlock(hashOld);
+        BOOST_CHECK(cache.Sync());
+    }
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK(db.GetBestBlock() == hashOld);
+
+    CCoinsViewCacheTest cache(&db);
+    std::vector<uint256> txids;
+    for (int i = 0; i < 20; i++) {
+        txids.push_back(GetRandHash());
+        CCoinsModifier coins = cache.ModifyNewCoins(txids.back(), false);
+        coins->vout.resize(1);
+        coins->vout[0].nValue = i + 1;
+    }
+    cache.SetBestBlock(hashMid);
+
+    // A partial write keeps the best block of the database and records the blocks to replay instead
+    size_t nWritten = 0;
+    BOOST_CHECK(cache.SyncPartial(1, nWritten));
+    BOOST_CHECK(nWritten > 0);
+    BOOST_CHECK_EQUAL(cache.GetDirtyCacheSize(), 19);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 20);
+    std::vector<uint256> vhashHeads = db.GetHeadBlocks();
+    BOOST_CHECK(vhashHeads.size() == 2 && vhashHeads[0] == hashMid && vhashHeads[1] == hashOld);
+    BOOST_CHECK(db.GetBestBlock().IsNull());
+    cache.SelfTest();
+
+    // Later partial writes move the new head only
+    cache.SetBestBlock(hashNew);
+    BOOST_CHECK(cache.SyncPartial(1, nWritten));
+    BOOST_CHECK_EQUAL(cache.GetDirtyCacheSize(), 18);
+    vhashHeads = db.GetHeadBlocks();
+    BOOST_CHECK(vhashHeads.size() == 2 && vhashHeads[0] == hashNew && vhashHeads[1] == hashOld);
+
+    // A full sync in small batches writes everything and makes the database consistent again
+    BOOST_CHECK(cache.Sync(1));
+    BOOST_CHECK_EQUAL(cache.GetDirtyCacheSize(), 0);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 20);
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK(db.GetBestBlock() == hashNew);
+    for (int i = 0; i < 20; i++) {
+        CCoins coins;
+        BOOST_CHECK(db.GetCoins(txids[i], coins) && coins.vout[0].nValue == i + 1);
+    }
+    cache.SelfTest();
+}
+
+BOOST_AUTO_TEST_CASE(coins_cache_batched_sync)
+{
+    // Views without in place writes get the batches as copies and keep their best block until the last one
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache(&base);
+    uint256 hashBlock = GetRandHash();
+    for (int i = 0; i < 10; i++) {
+        CCoinsModifier coins = cache.ModifyNewCoins(GetRandHash(), false);
+        coins->vout.resize(1);
+        coins->vout[0].nValue = i + 1;
+    }
+    cache.SetBestBlock(hashBlock);
+    size_t nWritten = 0;
+    BOOST_CHECK(cache.SyncPartial(std::numeric_limits<size_t>::max(), nWritten, 1));
+    BOOST_CHECK_EQUAL(cache.GetDirtyCacheSize(), 0);
+    BOOST_CHECK(base.GetBestBlock().IsNull());
+    BOOST_CHECK(cache.Sync(1));
+    BOOST_CHECK(base.GetBestBlock() == hashBlock);
+    cache.SelfTest();
+}
+
+BOOST_AUTO_TEST_CASE(coins_cache_batched_sync_pruned)
+{
+    // Pruned entries are erased from the cache as their batch is written, also when they complete it
+    CCoinsViewTest base;
+    std::vector<uint256> txids;
+    {
+        CCoinsViewCacheTest cache(&base);
+        for (int i = 0; i < 10; i++) {
+            txids.push_back(GetRandHash());
+            CCoinsModifier coins = cache.ModifyNewCoins(txids.back(), false);
+            coins->vout.resize(1);
+            coins->vout[0].nValue = i + 1;
+        }
+        cache.SetBestBlock(GetRandHash());
+        BOOST_CHECK(cache.Sync(1));
+    }
+
+    CCoinsViewCacheTest cache(&base);
+    for (size_t i = 0; i < txids.size(); i++) {
+        cache.ModifyCoins(txids[i])->Clear();
+    }
+    BOOST_CHECK_EQUAL(cache.GetDirtyCacheSize(), txids.size());
+
+    size_t nWritten = 0;
+    BOOST_CHECK(cache.SyncPartial(std::numeric_limits<size_t>::max(), nWritten, 1));
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0);
+    for (size_t i = 0; i < txids.size(); i++) {
+        CCoins coins;
+        BOOST_CHECK(!base.GetCoins(txids[i], coins) || coins.IsPruned());
+    }
+    cache.SelfTest();
+}
+
 BOOST_AUTO_TEST_CASE(ccoins_serialization)
 {
     // Good example
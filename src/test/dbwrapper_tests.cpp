@@ -9,6 +9,7 @@
 
 #include <boost/assign/std/vector.hpp> // for 'operator+=()'
 #include <boost/assert.hpp>
+#include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
                     
 using namespace std;
@@ -323,5 +324,57 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 }
 
 
+BOOST_AUTO_TEST_CASE(dbwrapper_options)
+{
+    mapMultiArgs["-dboption"].clear();
+    CDBOptions opts = GetDBOptions("chainstate", 8 << 20);
+    BOOST_CHECK_EQUAL(opts.nWriteBufferSize, (size_t)2 << 20);
+    BOOST_CHECK_EQUAL(opts.nBloomFilterBits, 10);
+    BOOST_CHECK(!opts.fCompression);
+    BOOST_CHECK(GetDBOptions("MP_txlist", 8 << 20).fCompression);
+
+    mapMultiArgs["-dboption"].push_back("chainstate.writebuffer=16");
+    mapMultiArgs["-dboption"].push_back("chainstate.bloombits=0");
+    mapMultiArgs["-dboption"].push_back("chainstate.compression=1");
+    mapMultiArgs["-dboption"].push_back("index.maxopenfiles=500");
+    mapMultiArgs["-dboption"].push_back("chainstate.unknown=1");
+    mapMultiArgs["-dboption"].push_back("chainstate.maxopenfiles=x");
+    opts = GetDBOptions("chainstate", 8 << 20);
+    BOOST_CHECK_EQUAL(opts.nWriteBufferSize, (size_t)16 << 20);
+    BOOST_CHECK_EQUAL(opts.nBloomFilterBits, 0);
+    BOOST_CHECK_EQUAL(opts.nMaxOpenFiles, 64);
+    BOOST_CHECK(opts.fCompression);
+    BOOST_CHECK_EQUAL(GetDBOptions("index", 8 << 20).nMaxOpenFiles, 500);
+    mapMultiArgs["-dboption"].clear();
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_stats)
+{
+    SetSharedDBCacheSize(1 << 20);
+    BOOST_CHECK_EQUAL(GetDBOptions("chainstate", 8 << 20).nBlockCacheSize, (size_t)0);
+    std::string strName = unique_path().string();
+    {
+        CDBWrapper dbw(temp_directory_path() / strName, (1 << 20), true, false, false);
+        BOOST_CHECK(dbw.Write('k', GetRandHash()));
+        CDBBatch batch(dbw);
+        batch.Write('a', GetRandHash());
+        batch.Erase('b');
+        BOOST_CHECK(dbw.WriteBatch(batch));
+
+        int nFound = 0;
+        BOOST_FOREACH(const CDBStats& stats, GetDBStats()) {
+            if (stats.strName != strName)
+                continue;
+            nFound++;
+            BOOST_CHECK_EQUAL(stats.nWrites, 2U);
+            BOOST_CHECK(stats.nWriteBytes > 2 * 32);
+            BOOST_CHECK(!stats.vFilesPerLevel.empty());
+        }
+        BOOST_CHECK_EQUAL(nFound, 1);
+    }
+    BOOST_FOREACH(const CDBStats& stats, GetDBStats())
+        BOOST_CHECK(stats.strName != strName);
+    SetSharedDBCacheSize(0);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
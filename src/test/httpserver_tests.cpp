@@ -0,0 +1,64 @@
+// Copyright (c) 2020 The Zcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "httpserver.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/assign/list_of.hpp>
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(httpserver_tests, BasicTestingSetup)
+
+static const HTTPWorkClassConfig* FindClass(const std::vector<HTTPWorkClassConfig>& vClasses, const std::string& name)
+{
+    BOOST_FOREACH(const HTTPWorkClassConfig& config, vClasses)
+        if (config.name == name)
+            return &config;
+    return NULL;
+}
+
+BOOST_AUTO_TEST_CASE(http_work_classes)
+{
+    std::vector<HTTPWorkClassConfig> vClasses;
+    BOOST_CHECK(ParseHTTPWorkClasses(std::vector<std::string>(), vClasses));
+    BOOST_CHECK_EQUAL(vClasses.size(), 3);
+    BOOST_CHECK_EQUAL(vClasses[0].name, HTTP_DEFAULT_WORK_CLASS);
+    BOOST_CHECK(FindClass(vClasses, "fast") && FindClass(vClasses, "slow"));
+
+    // Classes can be added, resized and disabled
+    std::vector<std::string> vArgs = boost::assign::list_of("fast:0:1")("slow:3:5")("index:1:20");
+    BOOST_CHECK(ParseHTTPWorkClasses(vArgs, vClasses));
+    BOOST_CHECK_EQUAL(vClasses[0].name, HTTP_DEFAULT_WORK_CLASS);
+    BOOST_CHECK(!FindClass(vClasses, "fast"));
+    const HTTPWorkClassConfig* slow = FindClass(vClasses, "slow");
+    BOOST_CHECK(slow && slow->threads == 3 && slow->maxDepth == 5);
+    const HTTPWorkClassConfig* index = FindClass(vClasses, "index");
+    BOOST_CHECK(index && index->threads == 1 && index->maxDepth == 20);
+}
+
+BOOST_AUTO_TEST_CASE(http_work_classes_invalid)
+{
+    std::vector<std::string> vInvalid = boost::assign::list_of
+        ("default:1:1")(":1:1")("slow:1")("slow:1:1:1")("slow:-1:1")("slow:1:0")("slow:a:1")("slow:1:b");
+    BOOST_FOREACH(const std::string& strArg, vInvalid) {
+        // A valid argument before the invalid one must not be applied either
+        std::vector<std::string> vArgs;
+        vArgs.push_back("index:1:1");
+        vArgs.push_back(strArg);
+        std::vector<HTTPWorkClassConfig> vClasses(1);
+        vClasses[0].name = "untouched";
+        BOOST_CHECK_MESSAGE(!ParseHTTPWorkClasses(vArgs, vClasses), strArg);
+        BOOST_CHECK_EQUAL(vClasses.size(), 1);
+        BOOST_CHECK_EQUAL(vClasses[0].name, "untouched");
+    }
+
+    // Shutting down a server that was never set up doesn't touch any work queue
+    InterruptHTTPServer();
+    StopHTTPServer();
+    BOOST_CHECK(GetHTTPWorkQueueStats().empty());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
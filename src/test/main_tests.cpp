@@ -86,4 +86,48 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+
+BOOST_AUTO_TEST_CASE(block_download_adaptive_limit)
+{
+    const int64_t nFast = BLOCK_DOWNLOAD_TARGET_LATENCY / 4;
+    const int64_t nSlow = BLOCK_DOWNLOAD_TARGET_LATENCY * 2;
+    int nLimit = MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+
+    // a fast peer only gets more blocks while it keeps the window full
+    BOOST_CHECK_EQUAL(GetAdaptiveBlocksInFlightLimit(nLimit, nLimit - 1, nFast), nLimit);
+    BOOST_CHECK_EQUAL(GetAdaptiveBlocksInFlightLimit(nLimit, nLimit, nFast), nLimit + 1);
+    for (int i = 0; i < 2 * MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER; i++)
+        nLimit = GetAdaptiveBlocksInFlightLimit(nLimit, nLimit, nFast);
+    BOOST_CHECK_EQUAL(nLimit, MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+
+    // a slow peer loses one block per delivery, down to the minimum
+    BOOST_CHECK_EQUAL(GetAdaptiveBlocksInFlightLimit(nLimit, nLimit, nSlow), nLimit - 1);
+    BOOST_CHECK_EQUAL(GetAdaptiveBlocksInFlightLimit(nLimit, 0, nSlow), nLimit - 1);
+    for (int i = 0; i < 2 * MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER; i++)
+        nLimit = GetAdaptiveBlocksInFlightLimit(nLimit, nLimit, nSlow);
+    BOOST_CHECK_EQUAL(nLimit, MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+
+    // the first delivery sets the average, later ones move it by an eighth
+    BOOST_CHECK_EQUAL(GetAverageBlockLatency(0, nSlow, 0), nSlow);
+    BOOST_CHECK_EQUAL(GetAverageBlockLatency(nSlow, nSlow + 8000, 1), nSlow + 1000);
+    int64_t nAverage = nSlow;
+    for (int i = 0; i < 100; i++)
+        nAverage = GetAverageBlockLatency(nAverage, nFast, i + 1);
+    BOOST_CHECK(nAverage < BLOCK_DOWNLOAD_TARGET_LATENCY);
+}
+
+BOOST_AUTO_TEST_CASE(block_download_rerequest)
+{
+    // a stalling peer has its limit halved, but not below the minimum
+    BOOST_CHECK_EQUAL(GetReducedBlocksInFlightLimit(MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER), MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER / 2);
+    BOOST_CHECK_EQUAL(GetReducedBlocksInFlightLimit(MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER + 1), MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+    BOOST_CHECK_EQUAL(GetReducedBlocksInFlightLimit(MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER), MIN_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER);
+
+    // blocks are re-requested after the fixed timeout, unless the peer is known to be slower than that
+    const int64_t nMinTimeout = 1000000 * BLOCK_REREQUEST_TIMEOUT;
+    BOOST_CHECK_EQUAL(GetBlockRerequestTimeout(0), nMinTimeout);
+    BOOST_CHECK_EQUAL(GetBlockRerequestTimeout(nMinTimeout / 4), nMinTimeout);
+    BOOST_CHECK_EQUAL(GetBlockRerequestTimeout(nMinTimeout), 4 * nMinTimeout);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
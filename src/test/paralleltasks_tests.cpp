@@ -0,0 +1,62 @@
+#include "libzerocoin/ParallelTasks.h"
+
+#include "test/test_bitcoin.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <atomic>
+#include <stdexcept>
+
+BOOST_AUTO_TEST_SUITE(paralleltasks_tests)
+
+BOOST_AUTO_TEST_CASE(all_tasks_executed)
+{
+    std::atomic<int> counter(0);
+    uint64_t executedBefore = libzerocoin::ParallelTasks::GetStats().tasksExecuted;
+
+    libzerocoin::ParallelTasks tasks(100);
+    for (int i = 0; i < 100; i++)
+        tasks.Add([&counter] { counter++; });
+    tasks.Wait();
+
+    BOOST_CHECK_EQUAL(counter, 100);
+
+    libzerocoin::ParallelTasksStats stats = libzerocoin::ParallelTasks::GetStats();
+    BOOST_CHECK(stats.tasksExecuted >= executedBefore + 100);
+    BOOST_CHECK(stats.maxThreads > 0);
+}
+
+BOOST_AUTO_TEST_CASE(nested_tasks)
+{
+    // every outer task waits for its own children, this must not dead-lock even if
+    // there are more outer tasks than threads in the pool
+    std::atomic<int> counter(0);
+
+    libzerocoin::ParallelTasks outer(64, libzerocoin::PARALLEL_TASK_PRIORITY_HIGH);
+    for (int i = 0; i < 64; i++) {
+        outer.Add([&counter] {
+            libzerocoin::ParallelTasks inner(16, libzerocoin::PARALLEL_TASK_PRIORITY_HIGH);
+            for (int j = 0; j < 16; j++)
+                inner.Add([&counter] { counter++; });
+            inner.Wait();
+        });
+    }
+    outer.Wait();
+
+    BOOST_CHECK_EQUAL(counter, 64 * 16);
+
+    libzerocoin::ParallelTasksStats stats = libzerocoin::ParallelTasks::GetStats();
+    for (size_t depth: stats.queueDepth)
+        BOOST_CHECK_EQUAL(depth, 0);
+}
+
+BOOST_AUTO_TEST_CASE(exception_propagated)
+{
+    libzerocoin::ParallelTasks tasks(2, libzerocoin::PARALLEL_TASK_PRIORITY_LOW);
+    tasks.Add([] {});
+    tasks.Add([] { throw std::runtime_error("task failed"); });
+
+    BOOST_CHECK_THROW(tasks.Wait(), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,8 +4,11 @@
 
 #include "rpc/server.h"
 #include "rpc/client.h"
+#include "rpc/jsonwriter.h"
 
 #include "base58.h"
+#include "chainparams.h"
+#include "main.h"
 #include "netbase.h"
 
 #include "test/test_bitcoin.h"
@@ -332,4 +335,168 @@ BOOST_AUTO_TEST_CASE(rpc_convert_values_generatetoaddress)
     BOOST_CHECK_EQUAL(result[2].get_int(), 9);
 }
 
+BOOST_AUTO_TEST_CASE(rpc_jsonwriter)
+{
+    std::string strJSON;
+    int nChunks = 0;
+    // A tiny chunk size makes every element go to the sink on its own
+    CJSONWriter writer([&](const std::string& chunk) { strJSON += chunk; nChunks++; }, false, 4);
+
+    UniValue expected(UniValue::VOBJ);
+    expected.push_back(Pair("hash", "00ff"));
+    expected.push_back(Pair("height", 7));
+    expected.push_back(Pair("amount", ValueFromAmount(123456789)));
+    expected.push_back(Pair("quoted \"key\"", "line\nbreak"));
+    UniValue tx(UniValue::VARR);
+    tx.push_back("a");
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("empty", UniValue(UniValue::VARR)));
+    tx.push_back(obj);
+    expected.push_back(Pair("tx", tx));
+    expected.push_back(Pair("next", NullUniValue));
+
+    writer.BeginObject();
+    writer.Pair("hash", "00ff");
+    writer.Pair("height", 7);
+    writer.Pair("amount", ValueFromAmount(123456789));
+    writer.Pair("quoted \"key\"", "line\nbreak");
+    writer.Key("tx");
+    writer.BeginArray();
+    writer.Value("a");
+    writer.BeginObject();
+    writer.Key("empty");
+    writer.BeginArray();
+    writer.EndArray();
+    writer.EndObject();
+    writer.EndArray();
+    writer.Pair("next", NullUniValue);
+    writer.EndObject();
+    strJSON += writer.Finish();
+
+    BOOST_CHECK_EQUAL(strJSON, expected.write() + "\n");
+    BOOST_CHECK(nChunks > 1);
+    BOOST_CHECK_EQUAL(writer.GetBytesWritten(), strJSON.size());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_jsonwriter_tree)
+{
+    // Built as a tree, the document is the same as the one written as text
+    UniValue result;
+    CJSONWriter writer(result);
+    writer.BeginObject();
+    writer.Pair("hash", "00ff");
+    writer.Key("tx");
+    writer.BeginArray();
+    writer.Value("a");
+    writer.BeginObject();
+    writer.Key("empty");
+    writer.BeginArray();
+    writer.EndArray();
+    writer.EndObject();
+    writer.EndArray();
+    writer.Pair("next", NullUniValue);
+    writer.EndObject();
+    BOOST_CHECK(writer.Finish().empty());
+    BOOST_CHECK_EQUAL(result.write(), "{\"hash\":\"00ff\",\"tx\":[\"a\",{\"empty\":[]}],\"next\":null}");
+
+    // Trees can't be rolled back
+    UniValue value;
+    CJSONWriter single(value);
+    CJSONWriter::Checkpoint cp = single.GetCheckpoint();
+    single.Value(5);
+    BOOST_CHECK(!single.Rollback(cp));
+    BOOST_CHECK_EQUAL(value.get_int(), 5);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_jsonwriter_rollback)
+{
+    std::string strJSON;
+    CJSONWriter writer([&](const std::string& chunk) { strJSON += chunk; });
+
+    writer.BeginArray();
+    writer.Value(1);
+    CJSONWriter::Checkpoint cp = writer.GetCheckpoint();
+    writer.BeginObject();
+    writer.Key("partial");
+    BOOST_CHECK(writer.Rollback(cp));
+    writer.Value(2);
+    writer.EndArray();
+    strJSON += writer.Finish();
+    BOOST_CHECK_EQUAL(strJSON, "[1,2]\n");
+
+    // Text that was handed to the sink can't be taken back
+    strJSON.clear();
+    writer.BeginArray();
+    cp = writer.GetCheckpoint();
+    writer.Value("written");
+    writer.Flush();
+    BOOST_CHECK(!writer.Rollback(cp));
+}
+
+BOOST_AUTO_TEST_CASE(rpc_streamed_result)
+{
+    // Streaming methods return the same result when called without a writer
+    UniValue result = CallRPC("getrawmempool true");
+    BOOST_CHECK(result.isObject());
+    result = CallRPC("getrawmempool");
+    BOOST_CHECK(result.isArray());
+    BOOST_CHECK_THROW(CallRPC("getrawmempool true extra"), runtime_error);
+
+    std::string strTip = CallRPC("getbestblockhash").get_str();
+    result = CallRPC("getblock " + strTip);
+    BOOST_CHECK_EQUAL(find_value(result, "hash").get_str(), strTip);
+    BOOST_CHECK_EQUAL(find_value(result, "confirmations").get_int(), 1);
+    BOOST_CHECK(find_value(result, "tx").isArray() && find_value(result, "tx").size() > 0);
+    BOOST_CHECK(CallRPC("getblock " + strTip + " false").isStr());
+}
+
+BOOST_AUTO_TEST_CASE(rpc_method_stats)
+{
+    CRPCMethodStats before = GetRPCMethodStats()["getblockcount"];
+    CallRPC("getblockcount");
+    BOOST_CHECK_THROW(CallRPC("getblockcount extra"), runtime_error);
+
+    CRPCMethodStats after = GetRPCMethodStats()["getblockcount"];
+    BOOST_CHECK_EQUAL(after.nCalls, before.nCalls + 2);
+    BOOST_CHECK_EQUAL(after.nErrors, before.nErrors + 1);
+    BOOST_CHECK_EQUAL(after.nInFlight, 0);
+    uint64_t nBucketed = 0;
+    for (size_t i = 0; i < RPC_LATENCY_BUCKET_COUNT; i++)
+        nBucketed += after.vLatency[i];
+    BOOST_CHECK_EQUAL(nBucketed, after.nCalls);
+
+    // Unknown methods are not tracked
+    BOOST_CHECK_THROW(CallRPC("nosuchmethod"), runtime_error);
+    BOOST_CHECK(GetRPCMethodStats().count("nosuchmethod") == 0);
+
+    UniValue result = CallRPC("getrpcstats");
+    BOOST_CHECK(find_value(result, "methods")["getblockcount"].isObject());
+    BOOST_CHECK_EQUAL(find_value(result, "latencybuckets").size(), RPC_LATENCY_BUCKET_COUNT - 1);
+}
+
+BOOST_AUTO_TEST_CASE(rpc_chain_tip_snapshot)
+{
+    // The lock-free calls agree with chainActive
+    int nHeight;
+    uint256 hashTip;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height();
+        hashTip = chainActive.Tip()->GetBlockHash();
+    }
+    BOOST_CHECK_EQUAL(CallRPC("getblockcount").get_int(), nHeight);
+    BOOST_CHECK_EQUAL(CallRPC("getbestblockhash").get_str(), hashTip.GetHex());
+    BOOST_CHECK_EQUAL(CallRPC("getblockhash 0").get_str(), Params().GenesisBlock().GetHash().GetHex());
+    BOOST_CHECK_THROW(CallRPC(strprintf("getblockhash %d", nHeight + 1)), runtime_error);
+
+    UniValue header = CallRPC("getblockheader " + hashTip.GetHex());
+    BOOST_CHECK_EQUAL(find_value(header, "height").get_int(), nHeight);
+    BOOST_CHECK_EQUAL(find_value(header, "confirmations").get_int(), 1);
+    BOOST_CHECK_THROW(CallRPC("getblockheader " + uint256().GetHex()), runtime_error);
+
+    UniValue summary = CallRPC("getchainsummary");
+    BOOST_CHECK_EQUAL(find_value(summary, "blocks").get_int(), nHeight);
+    BOOST_CHECK_EQUAL(find_value(summary, "bestblockhash").get_str(), hashTip.GetHex());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
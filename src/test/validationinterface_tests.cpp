@@ -0,0 +1,69 @@
+// Copyright (c) 2012-2015 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "arith_uint256.h"
+#include "uint256.h"
+#include "validationinterface.h"
+
+#include "test/test_bitcoin.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+#include <boost/thread.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, BasicTestingSetup)
+
+class CTestListener : public CValidationInterface
+{
+public:
+    std::vector<uint256> vUpdated;
+    std::vector<boost::thread::id> vThreads;
+
+protected:
+    void UpdatedTransaction(const uint256 &hash)
+    {
+        vUpdated.push_back(hash);
+        vThreads.push_back(boost::this_thread::get_id());
+    }
+};
+
+BOOST_AUTO_TEST_CASE(validationinterface_async_order)
+{
+    StartValidationInterfaceQueue();
+
+    CTestListener listener;
+    RegisterValidationInterface(&listener, true);
+
+    std::vector<uint256> vExpected;
+    for (int i = 0; i < 100; i++) {
+        uint256 hash = ArithToUint256(arith_uint256(i));
+        vExpected.push_back(hash);
+        GetMainSignals().UpdatedTransaction(hash);
+    }
+    SyncWithValidationInterfaceQueue();
+
+    BOOST_CHECK_EQUAL(GetValidationInterfaceQueueSize(), 0);
+    BOOST_CHECK(listener.vUpdated == vExpected);
+    BOOST_CHECK(listener.vThreads.front() != boost::this_thread::get_id());
+
+    UnregisterValidationInterface(&listener);
+    GetMainSignals().UpdatedTransaction(uint256());
+    BOOST_CHECK_EQUAL(listener.vUpdated.size(), 100);
+
+    StopValidationInterfaceQueue();
+}
+
+BOOST_AUTO_TEST_CASE(validationinterface_sync_without_queue)
+{
+    // Without the notification thread an asynchronous listener is called inline
+    CTestListener listener;
+    RegisterValidationInterface(&listener, true);
+    GetMainSignals().UpdatedTransaction(uint256());
+    BOOST_CHECK_EQUAL(listener.vUpdated.size(), 1);
+    BOOST_CHECK(listener.vThreads.front() == boost::this_thread::get_id());
+    UnregisterValidationInterface(&listener);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -575,5 +575,202 @@ BOOST_AUTO_TEST_CASE(zerocoin_mintspend_numinputs){
     mempool.clear();
     zerocoinState->mempoolCoinSerials.clear();
 }
+
+BOOST_AUTO_TEST_CASE(zerocoin_state_snapshot)
+{
+    const Consensus::Params &params = Params().GetConsensus();
+    pair<int,int> denomAndId(1, 1);
+
+    CBlockIndex *mintBlocks[] = {chainActive[10], chainActive[20]};
+    for (CBlockIndex *index: mintBlocks) {
+        index->mintedPubCoins[denomAndId] = {CBigNum(1000 + index->nHeight)};
+        index->accumulatorChanges[denomAndId] = make_pair(CBigNum(index->nHeight), 1);
+    }
+
+    CZerocoinState state;
+    for (CBlockIndex *index: mintBlocks)
+        state.AddBlock(index, params);
+    state.AddSpend(CBigNum(42));
+
+    CZerocoinStateSnapshot snapshot, restoredSnapshot;
+    state.GetSnapshot(chainActive.Tip(), snapshot);
+
+    CDataStream stream(SER_DISK, CLIENT_VERSION);
+    stream << snapshot;
+    stream >> restoredSnapshot;
+
+    CZerocoinState restoredState;
+    BOOST_CHECK(restoredState.ApplySnapshot(&chainActive, restoredSnapshot));
+
+    CZerocoinState::CoinGroupInfo coinGroup;
+    BOOST_CHECK(restoredState.GetCoinGroupInfo(1, 1, coinGroup));
+    BOOST_CHECK(coinGroup.firstBlock == mintBlocks[0]);
+    BOOST_CHECK(coinGroup.lastBlock == mintBlocks[1]);
+    BOOST_CHECK_EQUAL(coinGroup.nCoins, 2);
+    BOOST_CHECK(restoredState.HasCoin(CBigNum(1010)));
+    BOOST_CHECK(restoredState.HasCoin(CBigNum(1020)));
+    BOOST_CHECK(restoredState.IsUsedCoinSerial(CBigNum(42)));
+
+    // snapshot of the block not in the active chain must be rejected
+    restoredSnapshot.blockHash = uint256S("01");
+    BOOST_CHECK(!restoredState.ApplySnapshot(&chainActive, restoredSnapshot));
+    BOOST_CHECK(!restoredState.HasCoin(CBigNum(1010)));
+
+    for (CBlockIndex *index: mintBlocks) {
+        index->mintedPubCoins.clear();
+        index->accumulatorChanges.clear();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_coingroup_at_height)
+{
+    const Consensus::Params &params = Params().GetConsensus();
+    pair<int,int> denomAndId(1, 1);
+
+    CBlockIndex *mintBlocks[] = {chainActive[10], chainActive[20], chainActive[30]};
+    for (CBlockIndex *index: mintBlocks) {
+        index->mintedPubCoins[denomAndId] = {CBigNum(1000 + index->nHeight), CBigNum(2000 + index->nHeight)};
+        index->accumulatorChanges[denomAndId] = make_pair(CBigNum(index->nHeight), 2);
+    }
+
+    CZerocoinState state;
+    for (CBlockIndex *index: mintBlocks)
+        state.AddBlock(index, params);
+
+    CZerocoinState::CoinGroupInfo coinGroup;
+    BOOST_CHECK(state.GetCoinGroupInfoAtHeight(1, 1, 31, coinGroup));
+    BOOST_CHECK(coinGroup.firstBlock == mintBlocks[0]);
+    BOOST_CHECK(coinGroup.lastBlock == mintBlocks[2]);
+    BOOST_CHECK_EQUAL(coinGroup.nCoins, 6);
+
+    // coins minted in the block itself or later can't be spent in it
+    BOOST_CHECK(state.GetCoinGroupInfoAtHeight(1, 1, 30, coinGroup));
+    BOOST_CHECK(coinGroup.lastBlock == mintBlocks[1]);
+    BOOST_CHECK_EQUAL(coinGroup.nCoins, 4);
+
+    BOOST_CHECK(state.GetCoinGroupInfoAtHeight(1, 1, 20, coinGroup));
+    BOOST_CHECK(coinGroup.firstBlock == mintBlocks[0]);
+    BOOST_CHECK(coinGroup.lastBlock == mintBlocks[0]);
+    BOOST_CHECK_EQUAL(coinGroup.nCoins, 2);
+
+    BOOST_CHECK(!state.GetCoinGroupInfoAtHeight(1, 1, 10, coinGroup));
+    BOOST_CHECK(!state.GetCoinGroupInfoAtHeight(1, 2, 31, coinGroup));
+
+    for (CBlockIndex *index: mintBlocks) {
+        index->mintedPubCoins.clear();
+        index->accumulatorChanges.clear();
+    }
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_assume_valid)
+{
+    CCheckpointData checkpoints = {};
+    checkpoints.mapCheckpoints[100] = chainActive[100]->GetBlockHash();
+
+    bool fAssumeValid = fAssumeValidZerocoinProofs;
+
+    fAssumeValidZerocoinProofs = true;
+    BOOST_CHECK(IsZerocoinProofAssumedValid(chainActive[50], checkpoints));
+    BOOST_CHECK(IsZerocoinProofAssumedValid(chainActive[100], checkpoints));
+    BOOST_CHECK(!IsZerocoinProofAssumedValid(chainActive[101], checkpoints));
+
+    // unknown checkpoint doesn't make anything assumed valid
+    CCheckpointData unknownCheckpoints = {};
+    unknownCheckpoints.mapCheckpoints[100] = uint256S("01");
+    BOOST_CHECK(!IsZerocoinProofAssumedValid(chainActive[50], unknownCheckpoints));
+
+    fAssumeValidZerocoinProofs = false;
+    BOOST_CHECK(!IsZerocoinProofAssumedValid(chainActive[50], checkpoints));
+
+    fAssumeValidZerocoinProofs = fAssumeValid;
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_background_verify)
+{
+    const Consensus::Params &params = Params().GetConsensus();
+
+    int nVerifiedHeight;
+    BOOST_CHECK(pblocktree->ReadZerocoinVerifiedHeight(nVerifiedHeight));
+    BOOST_CHECK_EQUAL(nVerifiedHeight, 0);
+
+    // progress is saved so the next run continues from there
+    BOOST_CHECK(VerifyAssumedValidZerocoinProofs(100));
+    BOOST_CHECK(pblocktree->ReadZerocoinVerifiedHeight(nVerifiedHeight));
+    BOOST_CHECK_EQUAL(nVerifiedHeight, 100);
+
+    BOOST_CHECK(VerifyAssumedValidZerocoinProofs(50));
+    BOOST_CHECK(pblocktree->ReadZerocoinVerifiedHeight(nVerifiedHeight));
+    BOOST_CHECK_EQUAL(nVerifiedHeight, 100);
+
+    BOOST_CHECK(VerifyAssumedValidZerocoinProofs(chainActive.Height()));
+    BOOST_CHECK(pblocktree->ReadZerocoinVerifiedHeight(nVerifiedHeight));
+    BOOST_CHECK_EQUAL(nVerifiedHeight, chainActive.Height());
+
+    // blocks above the tip can't be verified
+    BOOST_CHECK(!VerifyAssumedValidZerocoinProofs(chainActive.Height() + 1));
+
+    // malformed spend never passes verification
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_ZEROCOINSPEND;
+    tx.vin[0].nSequence = 1;
+    BOOST_CHECK(!VerifyZerocoinSpendProofs(tx, 100, params));
+}
+
+BOOST_AUTO_TEST_CASE(zerocoin_index_data_pruning)
+{
+    const Consensus::Params &params = Params().GetConsensus();
+    pair<int,int> denomAndId(1, 1);
+
+    LOCK(cs_main);
+
+    CBlockIndex *mintBlocks[] = {chainActive[10], chainActive[20]};
+    for (CBlockIndex *index: mintBlocks) {
+        index->mintedPubCoins[denomAndId] = {CBigNum(1000 + index->nHeight)};
+        index->accumulatorChanges[denomAndId] = make_pair(CBigNum(index->nHeight), 1);
+    }
+
+    std::vector<std::pair<int, const CBlockFileInfo*>> files;
+    std::vector<const CBlockIndex*> blocks(std::begin(mintBlocks), std::end(mintBlocks));
+    BOOST_CHECK(pblocktree->WriteBatchSync(files, 0, blocks));
+
+    CZerocoinState state;
+    for (CBlockIndex *index: mintBlocks)
+        state.AddBlock(index, params);
+
+    ZerocoinPruneIndexData(chainActive[30]);
+    for (CBlockIndex *index: mintBlocks) {
+        BOOST_CHECK(index->mintedPubCoins.empty());
+        BOOST_CHECK(index->accumulatorChanges.empty());
+    }
+
+    // walking the group back reads the pruned entries from the database
+    CZerocoinState::CoinGroupInfo coinGroup;
+    BOOST_CHECK(state.GetCoinGroupInfoAtHeight(1, 1, 15, coinGroup));
+    BOOST_CHECK(coinGroup.lastBlock == mintBlocks[0]);
+    BOOST_CHECK_EQUAL(coinGroup.nCoins, 1);
+    for (CBlockIndex *index: mintBlocks) {
+        BOOST_CHECK_EQUAL(index->mintedPubCoins[denomAndId].size(), 1);
+        BOOST_CHECK(index->mintedPubCoins[denomAndId][0] == CBigNum(1000 + index->nHeight));
+        BOOST_CHECK(index->accumulatorChanges[denomAndId].first == CBigNum(index->nHeight));
+    }
+
+    // disconnecting a pruned block reads it back as well
+    ZerocoinPruneIndexData(chainActive[30]);
+    state.RemoveBlock(mintBlocks[1]);
+    BOOST_CHECK(!state.HasCoin(CBigNum(1020)));
+    BOOST_CHECK(state.HasCoin(CBigNum(1010)));
+    BOOST_CHECK(state.GetCoinGroupInfo(1, 1, coinGroup));
+    BOOST_CHECK(coinGroup.lastBlock == mintBlocks[0]);
+    BOOST_CHECK_EQUAL(coinGroup.nCoins, 1);
+
+    for (CBlockIndex *index: mintBlocks) {
+        ZerocoinLoadIndexData(index);
+        index->mintedPubCoins.clear();
+        index->accumulatorChanges.clear();
+    }
+    BOOST_CHECK(pblocktree->WriteBatchSync(files, 0, blocks));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
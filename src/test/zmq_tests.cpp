@@ -0,0 +1,69 @@
+// Copyright (c) 2020 The Zcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chain.h"
+#include "random.h"
+#include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqpublishnotifier.h"
+
+#include "test/test_bitcoin.h"
+
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(zmq_tests, BasicTestingSetup)
+
+static std::vector<const CBlockIndex*> Range(const std::vector<CBlockIndex>& vIndex, int nFrom, int nTo)
+{
+    std::vector<const CBlockIndex*> vRange;
+    for (int i = nFrom; i <= nTo; i++)
+        vRange.push_back(&vIndex[i]);
+    return vRange;
+}
+
+BOOST_AUTO_TEST_CASE(zmq_connected_blocks)
+{
+    // Main chain 0..9 and a fork 10..14 branching off at height 5
+    std::vector<CBlockIndex> vIndex(15);
+    for (int i = 0; i < 15; i++) {
+        vIndex[i].nHeight = i < 10 ? i : i - 4;
+        vIndex[i].pprev = i == 0 ? NULL : i == 10 ? &vIndex[5] : &vIndex[i - 1];
+        vIndex[i].BuildSkip();
+    }
+
+    BOOST_CHECK(GetConnectedBlocks(NULL, &vIndex[9]) == Range(vIndex, 9, 9));
+    BOOST_CHECK(GetConnectedBlocks(&vIndex[9], NULL).empty());
+    BOOST_CHECK(GetConnectedBlocks(&vIndex[9], &vIndex[9]).empty());
+
+    // Extending the chain
+    BOOST_CHECK(GetConnectedBlocks(&vIndex[6], &vIndex[7]) == Range(vIndex, 7, 7));
+    BOOST_CHECK(GetConnectedBlocks(&vIndex[3], &vIndex[9]) == Range(vIndex, 4, 9));
+
+    // Disconnecting doesn't connect anything
+    BOOST_CHECK(GetConnectedBlocks(&vIndex[9], &vIndex[8]).empty());
+    BOOST_CHECK(GetConnectedBlocks(&vIndex[9], &vIndex[5]).empty());
+
+    // A reorg connects the other branch above the fork
+    BOOST_CHECK(GetConnectedBlocks(&vIndex[9], &vIndex[14]) == Range(vIndex, 10, 14));
+    BOOST_CHECK(GetConnectedBlocks(&vIndex[12], &vIndex[7]) == Range(vIndex, 6, 7));
+}
+
+BOOST_AUTO_TEST_CASE(zmq_queue_stopped_publisher)
+{
+    // Messages queued while the publisher isn't running are dropped and counted
+    CZMQPublishHashBlockNotifier notifier;
+    CBlockIndex index;
+    uint256 hash = GetRandHash();
+    index.phashBlock = &hash;
+
+    CZMQPublisherStats before = GetZMQPublisherStats();
+    BOOST_CHECK(notifier.NotifyBlock(&index));
+    CZMQPublisherStats after = GetZMQPublisherStats();
+    BOOST_CHECK_EQUAL(after.nDropped, before.nDropped + 1);
+    BOOST_CHECK_EQUAL(after.nQueued, 0);
+    BOOST_CHECK_EQUAL(after.nPublished, before.nPublished);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
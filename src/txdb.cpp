@@ -12,9 +12,12 @@
 #include "main.h"
 #include "consensus/consensus.h"
 #include "base58.h"
+#include "zerocoin.h"
 
 #include <stdint.h>
 
+#include <algorithm>
+
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -29,10 +32,14 @@ static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
+static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
 static const char DB_TOTAL_SUPPLY = 'S';
+static const char DB_ZEROCOIN_SNAPSHOT = 'Z';
+static const char DB_ZEROCOIN_SNAPSHOT_LIST = 'z';
+static const char DB_ZEROCOIN_VERIFIED = 'v';
 
 
 CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true)
@@ -70,13 +77,55 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
         CCoinsMap::iterator itOld = it++;
         mapCoins.erase(itOld);
     }
-    if (!hashBlock.IsNull())
+    if (!hashBlock.IsNull()) {
+        batch.Erase(DB_HEAD_BLOCKS);
         batch.Write(DB_BEST_BLOCK, hashBlock);
+    }
 
     LogPrint("coindb", "Committing %u changed transactions (out of %u) to coin database...\n", (unsigned int)changed, (unsigned int)count);
     return db.WriteBatch(batch);
 }
 
+std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
+    std::vector<uint256> vhashHeadBlocks;
+    if (!db.Read(DB_HEAD_BLOCKS, vhashHeadBlocks))
+        return std::vector<uint256>();
+    return vhashHeadBlocks;
+}
+
+bool CCoinsViewDB::BatchWriteEntries(const std::vector<CCoinsMap::const_iterator> &entries, const uint256 &hashBlock, bool fFinal) {
+    CDBBatch batch(db);
+    std::vector<uint256> vhashHeadBlocks = GetHeadBlocks();
+    if (!fFinal) {
+        // The database holds coins from blocks after its best block until the final batch is written.
+        // Replace the best block by the range of blocks to replay on startup: {new tip, old tip}.
+        if (vhashHeadBlocks.empty()) {
+            vhashHeadBlocks.push_back(hashBlock);
+            vhashHeadBlocks.push_back(GetBestBlock());
+            batch.Erase(DB_BEST_BLOCK);
+            batch.Write(DB_HEAD_BLOCKS, vhashHeadBlocks);
+        } else if (vhashHeadBlocks.size() == 2 && vhashHeadBlocks[0] != hashBlock) {
+            vhashHeadBlocks[0] = hashBlock;
+            batch.Write(DB_HEAD_BLOCKS, vhashHeadBlocks);
+        }
+    }
+    size_t changed = 0;
+    for (const CCoinsMap::const_iterator &it : entries) {
+        if (it->second.coins.IsPruned())
+            batch.Erase(make_pair(DB_COINS, it->first));
+        else
+            batch.Write(make_pair(DB_COINS, it->first), it->second.coins);
+        changed++;
+    }
+    if (fFinal) {
+        batch.Erase(DB_HEAD_BLOCKS);
+        batch.Write(DB_BEST_BLOCK, hashBlock);
+    }
+
+    LogPrint("coindb", "Committing %u changed transactions to coin database%s...\n", (unsigned int)changed, fFinal ? "" : " (partial)");
+    return db.WriteBatch(batch);
+}
+
 CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
 }
 
@@ -156,6 +205,10 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadBlockIndex(const uint256 &hash, CDiskBlockIndex &index) {
+    return Read(make_pair(DB_BLOCK_INDEX, hash), index);
+}
+
 bool CBlockTreeDB::ReadTxIndex(const uint256 &txid, CDiskTxPos &pos) {
     return Read(make_pair(DB_TXINDEX, txid), pos);
 }
@@ -657,3 +710,48 @@ CDbIndexHelper::SpentIndex const & CDbIndexHelper::getSpentIndex() const
 {
     return *spentIndex;
 }
+
+bool CBlockTreeDB::ReadZerocoinStateSnapshotList(std::vector<uint256> &blockHashes)
+{
+    blockHashes.clear();
+    if (!Exists(DB_ZEROCOIN_SNAPSHOT_LIST))
+        return true;
+    return Read(DB_ZEROCOIN_SNAPSHOT_LIST, blockHashes);
+}
+
+bool CBlockTreeDB::ReadZerocoinStateSnapshot(const uint256 &blockHash, CZerocoinStateSnapshot &snapshot)
+{
+    return Read(make_pair(DB_ZEROCOIN_SNAPSHOT, blockHash), snapshot);
+}
+
+bool CBlockTreeDB::WriteZerocoinStateSnapshot(const CZerocoinStateSnapshot &snapshot, size_t nToKeep)
+{
+    std::vector<uint256> blockHashes;
+    if (!ReadZerocoinStateSnapshotList(blockHashes))
+        return false;
+
+    blockHashes.erase(std::remove(blockHashes.begin(), blockHashes.end(), snapshot.blockHash), blockHashes.end());
+    blockHashes.push_back(snapshot.blockHash);
+
+    CDBBatch batch(*this);
+    while (blockHashes.size() > std::max<size_t>(nToKeep, 1)) {
+        batch.Erase(make_pair(DB_ZEROCOIN_SNAPSHOT, blockHashes.front()));
+        blockHashes.erase(blockHashes.begin());
+    }
+    batch.Write(make_pair(DB_ZEROCOIN_SNAPSHOT, snapshot.blockHash), snapshot);
+    batch.Write(DB_ZEROCOIN_SNAPSHOT_LIST, blockHashes);
+    return WriteBatch(batch, true);
+}
+
+bool CBlockTreeDB::ReadZerocoinVerifiedHeight(int &nHeight)
+{
+    nHeight = 0;
+    if (!Exists(DB_ZEROCOIN_VERIFIED))
+        return true;
+    return Read(DB_ZEROCOIN_VERIFIED, nHeight);
+}
+
+bool CBlockTreeDB::WriteZerocoinVerifiedHeight(int nHeight)
+{
+    return Write(DB_ZEROCOIN_VERIFIED, nHeight);
+}
@@ -20,6 +20,7 @@
 
 class CBlockIndex;
 class CCoinsViewDBCursor;
+class CZerocoinStateSnapshot;
 class uint256;
 
 //! -dbcache default (MiB)
@@ -74,6 +75,8 @@ public:
     bool HaveCoins(const uint256 &txid) const;
     uint256 GetBestBlock() const;
     bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    bool BatchWriteEntries(const std::vector<CCoinsMap::const_iterator> &entries, const uint256 &hashBlock, bool fFinal);
+    std::vector<uint256> GetHeadBlocks() const;
     CCoinsViewCursor *Cursor() const;
 };
 
@@ -113,6 +116,7 @@ public:
     bool ReadLastBlockFile(int &nFile);
     bool WriteReindexing(bool fReindex);
     bool ReadReindexing(bool &fReindex);
+    bool ReadBlockIndex(const uint256 &hash, CDiskBlockIndex &index);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
@@ -135,6 +139,14 @@ public:
     int GetBlockIndexVersion(uint256 const & blockHash);
     bool AddTotalSupply(CAmount const & supply);
     bool ReadTotalSupply(CAmount & supply);
+    // Snapshots of zerocoin state, newest last
+    bool ReadZerocoinStateSnapshotList(std::vector<uint256> &blockHashes);
+    bool ReadZerocoinStateSnapshot(const uint256 &blockHash, CZerocoinStateSnapshot &snapshot);
+    // Write new snapshot erasing all but nToKeep latest ones
+    bool WriteZerocoinStateSnapshot(const CZerocoinStateSnapshot &snapshot, size_t nToKeep);
+    // Height up to which the zerocoin spend proofs skipped during the initial sync were verified
+    bool ReadZerocoinVerifiedHeight(int &nHeight);
+    bool WriteZerocoinVerifiedHeight(int nHeight);
 };
 
 
@@ -763,21 +763,22 @@ void CTxMemPool::removeConflicts(const CTransaction &tx, std::list <CTransaction
 /**
  * Called when a block is connected. Removes from mempool and updates the miner fee estimator.
  */
-void CTxMemPool::removeForBlock(const std::vector <CTransaction> &vtx, unsigned int nBlockHeight,
+void CTxMemPool::removeForBlock(const std::vector <CTransactionRef> &vtx, unsigned int nBlockHeight,
                                 std::list <CTransaction> &conflicts, bool fCurrentEstimate) {
     try {
         LOCK(cs);
         std::vector <CTxMemPoolEntry> entries;
-        BOOST_FOREACH(const CTransaction &tx, vtx)
+        BOOST_FOREACH(const CTransactionRef &ptx, vtx)
         {
-            uint256 hash = tx.GetHash();
+            uint256 hash = ptx->GetHash();
 
             indexed_transaction_set::iterator i = mapTx.find(hash);
             if (i != mapTx.end())
                 entries.push_back(*i);
         }
-        BOOST_FOREACH(const CTransaction &tx, vtx)
+        BOOST_FOREACH(const CTransactionRef &ptx, vtx)
         {
+            const CTransaction &tx = *ptx;
             txiter it = mapTx.find(tx.GetHash());
             if (it != mapTx.end()) {
                 setEntries stage;
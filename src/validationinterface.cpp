@@ -4,8 +4,17 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "validationinterface.h"
+#include "primitives/block.h"
+#include "sync.h"
 #include "util.h"
 
+#include <deque>
+#include <set>
+
+#include <boost/bind.hpp>
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+
 static CMainSignals g_signals;
 
 CMainSignals& GetMainSignals()
@@ -13,7 +22,252 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
-void RegisterValidationInterface(CValidationInterface* pwalletIn) {
+/**
+ * Single thread delivering notifications to asynchronous listeners in the
+ * order they were raised.
+ */
+class CValidationQueue
+{
+private:
+    CWaitableCriticalSection cs;
+    CConditionVariable condWork;
+    CConditionVariable condProcessed;
+    std::deque<boost::function<void()> > queue;
+    uint64_t nQueued;
+    uint64_t nProcessed;
+    bool fRunning;
+    bool fStopping;
+    boost::thread thread;
+    boost::thread::id idThread;
+
+    void Run()
+    {
+        RenameThread("bitcoin-valnotify");
+        boost::unique_lock<boost::mutex> lock(cs);
+        idThread = boost::this_thread::get_id();
+        while (true) {
+            while (queue.empty() && !fStopping)
+                condWork.wait(lock);
+            if (queue.empty())
+                break;
+            boost::function<void()> func = queue.front();
+            queue.pop_front();
+            lock.unlock();
+            try {
+                func();
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, "CValidationQueue");
+            } catch (...) {
+                PrintExceptionContinue(NULL, "CValidationQueue");
+            }
+            lock.lock();
+            nProcessed++;
+            condProcessed.notify_all();
+        }
+    }
+
+public:
+    CValidationQueue() : nQueued(0), nProcessed(0), fRunning(false), fStopping(false) {}
+
+    bool IsRunning()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return fRunning;
+    }
+
+    void Start()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (fRunning)
+            return;
+        fRunning = true;
+        fStopping = false;
+        thread = boost::thread(boost::bind(&CValidationQueue::Run, this));
+    }
+
+    void Stop()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            if (!fRunning)
+                return;
+            fStopping = true;
+            condWork.notify_all();
+        }
+        thread.join();
+        boost::unique_lock<boost::mutex> lock(cs);
+        fRunning = false;
+        idThread = boost::thread::id();
+        condProcessed.notify_all();
+    }
+
+    /** Queue a notification, or run it inline when the thread is not running */
+    void Enqueue(const boost::function<void()>& func)
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            if (fRunning && !fStopping) {
+                queue.push_back(func);
+                nQueued++;
+                condWork.notify_one();
+                return;
+            }
+        }
+        func();
+    }
+
+    void WaitUntilProcessed()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (!fRunning || boost::this_thread::get_id() == idThread)
+            return;
+        uint64_t nTarget = nQueued;
+        while (fRunning && nProcessed < nTarget)
+            condProcessed.wait(lock);
+    }
+
+    size_t Size()
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        return queue.size();
+    }
+};
+
+static CValidationQueue validationQueue;
+
+static CCriticalSection cs_asyncListeners;
+static std::set<CValidationInterface*> setAsyncListeners;
+
+/**
+ * Signal slots for asynchronous listeners. Arguments are copied before the
+ * call is queued since the caller's references do not outlive the signal.
+ * Block index entries are never freed while the node runs, so they are
+ * passed as is.
+ */
+struct CAsyncValidationDispatch
+{
+    static void UpdatedBlockTip(CValidationInterface* p, const CBlockIndex* pindex)
+    {
+        validationQueue.Enqueue(boost::bind(&CValidationInterface::UpdatedBlockTip, p, pindex));
+    }
+
+    static void SyncTransaction(CValidationInterface* p, const CTransaction& tx, const CBlockIndex* pindex, const CBlock* pblock)
+    {
+        boost::shared_ptr<const CBlock> block = CopyBlock(pblock);
+        CTransactionRef ptx = GetTransactionRef(block.get(), tx);
+        validationQueue.Enqueue([p, ptx, pindex, block]() {
+            p->SyncTransaction(*ptx, pindex, block.get());
+        });
+    }
+
+    static void UpdatedTransaction(CValidationInterface* p, const uint256& hash)
+    {
+        validationQueue.Enqueue(boost::bind(&CValidationInterface::UpdatedTransaction, p, hash));
+    }
+
+    static void SetBestChain(CValidationInterface* p, const CBlockLocator& locator)
+    {
+        validationQueue.Enqueue(boost::bind(&CValidationInterface::SetBestChain, p, locator));
+    }
+
+    static void Inventory(CValidationInterface* p, const uint256& hash)
+    {
+        validationQueue.Enqueue(boost::bind(&CValidationInterface::Inventory, p, hash));
+    }
+
+    static void ResendWalletTransactions(CValidationInterface* p, int64_t nBestBlockTime)
+    {
+        validationQueue.Enqueue(boost::bind(&CValidationInterface::ResendWalletTransactions, p, nBestBlockTime));
+    }
+
+    static void BlockChecked(CValidationInterface* p, const CBlock& block, const CValidationState& state)
+    {
+        p->BlockChecked(block, state);
+    }
+
+    static void GetScriptForMining(CValidationInterface* p, boost::shared_ptr<CReserveScript>& script)
+    {
+        p->GetScriptForMining(script);
+    }
+
+    static void ResetRequestCount(CValidationInterface* p, const uint256& hash)
+    {
+        p->ResetRequestCount(hash);
+    }
+
+    /**
+     * Transactions of a block are shared with its copy, so they are not copied
+     * again. Mempool transactions are copied once into a reference.
+     */
+    static CTransactionRef GetTransactionRef(const CBlock* pblock, const CTransaction& tx)
+    {
+        if (pblock) {
+            for (const CTransactionRef& ptx : pblock->vtx) {
+                if (ptx.get() == &tx)
+                    return ptx;
+            }
+        }
+        return MakeTransactionRef(tx);
+    }
+
+    /**
+     * SyncTransaction is raised once per transaction of a connected block, so
+     * the copy of the block is shared between those notifications.
+     */
+    static boost::shared_ptr<const CBlock> CopyBlock(const CBlock* pblock)
+    {
+        static CCriticalSection cs_lastBlock;
+        static const CBlock* pLastBlock = NULL;
+        static uint256 hashLastBlock;
+        static boost::shared_ptr<const CBlock> lastBlock;
+
+        if (!pblock)
+            return boost::shared_ptr<const CBlock>();
+        uint256 hash = pblock->GetHash();
+        LOCK(cs_lastBlock);
+        if (pblock != pLastBlock || hash != hashLastBlock || !lastBlock) {
+            lastBlock.reset(new CBlock(*pblock));
+            pLastBlock = pblock;
+            hashLastBlock = hash;
+        }
+        return lastBlock;
+    }
+};
+
+static void ConnectAsync(CValidationInterface* pwalletIn) {
+    g_signals.UpdatedBlockTip.connect(boost::bind(&CAsyncValidationDispatch::UpdatedBlockTip, pwalletIn, _1));
+    g_signals.SyncTransaction.connect(boost::bind(&CAsyncValidationDispatch::SyncTransaction, pwalletIn, _1, _2, _3));
+    g_signals.UpdatedTransaction.connect(boost::bind(&CAsyncValidationDispatch::UpdatedTransaction, pwalletIn, _1));
+    g_signals.SetBestChain.connect(boost::bind(&CAsyncValidationDispatch::SetBestChain, pwalletIn, _1));
+    g_signals.Inventory.connect(boost::bind(&CAsyncValidationDispatch::Inventory, pwalletIn, _1));
+    g_signals.Broadcast.connect(boost::bind(&CAsyncValidationDispatch::ResendWalletTransactions, pwalletIn, _1));
+    g_signals.BlockChecked.connect(boost::bind(&CAsyncValidationDispatch::BlockChecked, pwalletIn, _1, _2));
+    g_signals.ScriptForMining.connect(boost::bind(&CAsyncValidationDispatch::GetScriptForMining, pwalletIn, _1));
+    g_signals.BlockFound.connect(boost::bind(&CAsyncValidationDispatch::ResetRequestCount, pwalletIn, _1));
+}
+
+static void DisconnectAsync(CValidationInterface* pwalletIn) {
+    g_signals.BlockFound.disconnect(boost::bind(&CAsyncValidationDispatch::ResetRequestCount, pwalletIn, _1));
+    g_signals.ScriptForMining.disconnect(boost::bind(&CAsyncValidationDispatch::GetScriptForMining, pwalletIn, _1));
+    g_signals.BlockChecked.disconnect(boost::bind(&CAsyncValidationDispatch::BlockChecked, pwalletIn, _1, _2));
+    g_signals.Broadcast.disconnect(boost::bind(&CAsyncValidationDispatch::ResendWalletTransactions, pwalletIn, _1));
+    g_signals.Inventory.disconnect(boost::bind(&CAsyncValidationDispatch::Inventory, pwalletIn, _1));
+    g_signals.SetBestChain.disconnect(boost::bind(&CAsyncValidationDispatch::SetBestChain, pwalletIn, _1));
+    g_signals.UpdatedTransaction.disconnect(boost::bind(&CAsyncValidationDispatch::UpdatedTransaction, pwalletIn, _1));
+    g_signals.SyncTransaction.disconnect(boost::bind(&CAsyncValidationDispatch::SyncTransaction, pwalletIn, _1, _2, _3));
+    g_signals.UpdatedBlockTip.disconnect(boost::bind(&CAsyncValidationDispatch::UpdatedBlockTip, pwalletIn, _1));
+}
+
+void RegisterValidationInterface(CValidationInterface* pwalletIn, bool fAsync) {
+    if (fAsync && validationQueue.IsRunning()) {
+        {
+            LOCK(cs_asyncListeners);
+            if (!setAsyncListeners.insert(pwalletIn).second)
+                return;
+        }
+        ConnectAsync(pwalletIn);
+        return;
+    }
     g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
     g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
     g_signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
@@ -26,6 +280,17 @@ void RegisterValidationInterface(CValidationInterface* pwalletIn) {
 }
 
 void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
+    bool fAsync;
+    {
+        LOCK(cs_asyncListeners);
+        fAsync = setAsyncListeners.erase(pwalletIn) > 0;
+    }
+    if (fAsync) {
+        DisconnectAsync(pwalletIn);
+        // Notifications queued before the disconnect still refer to the listener
+        validationQueue.WaitUntilProcessed();
+        return;
+    }
     g_signals.BlockFound.disconnect(boost::bind(&CValidationInterface::ResetRequestCount, pwalletIn, _1));
     g_signals.ScriptForMining.disconnect(boost::bind(&CValidationInterface::GetScriptForMining, pwalletIn, _1));
     g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
@@ -47,6 +312,32 @@ void UnregisterAllValidationInterfaces() {
     g_signals.UpdatedTransaction.disconnect_all_slots();
     g_signals.SyncTransaction.disconnect_all_slots();
     g_signals.UpdatedBlockTip.disconnect_all_slots();
+    {
+        LOCK(cs_asyncListeners);
+        setAsyncListeners.clear();
+    }
+    validationQueue.WaitUntilProcessed();
+}
+
+void StartValidationInterfaceQueue() {
+    validationQueue.Start();
+}
+
+void StopValidationInterfaceQueue() {
+    validationQueue.Stop();
+}
+
+void SyncWithValidationInterfaceQueue() {
+    validationQueue.WaitUntilProcessed();
+}
+
+void LimitValidationInterfaceQueue() {
+    if (validationQueue.Size() > MAX_VALIDATION_QUEUE_SIZE)
+        validationQueue.WaitUntilProcessed();
+}
+
+size_t GetValidationInterfaceQueueSize() {
+    return validationQueue.Size();
 }
 
 void SyncWithWallets(const CTransaction &tx, const CBlockIndex *pindex, const CBlock *pblock) {
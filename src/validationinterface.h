@@ -9,6 +9,8 @@
 #include <boost/signals2/signal.hpp>
 #include <boost/shared_ptr.hpp>
 
+#include <stddef.h>
+
 class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
@@ -19,14 +21,42 @@ class CValidationInterface;
 class CValidationState;
 class uint256;
 
+struct CAsyncValidationDispatch;
+
+/** Default for -asyncnotifications */
+static const bool DEFAULT_ASYNC_NOTIFICATIONS = true;
+/** Number of queued notifications above which block relay waits for listeners to catch up */
+static const size_t MAX_VALIDATION_QUEUE_SIZE = 10000;
+
 // These functions dispatch to one or all registered wallets
 
-/** Register a wallet to receive updates from core */
-void RegisterValidationInterface(CValidationInterface* pwalletIn);
-/** Unregister a wallet from core */
+/**
+ * Register a wallet to receive updates from core. An asynchronous listener
+ * receives its notifications in order on the validation notification thread
+ * instead of inside the caller (usually with cs_main held). If the thread is
+ * not running the listener is registered synchronously.
+ * BlockChecked, GetScriptForMining and ResetRequestCount are always delivered
+ * synchronously.
+ */
+void RegisterValidationInterface(CValidationInterface* pwalletIn, bool fAsync = false);
+/** Unregister a wallet from core, waiting for its queued notifications to be delivered */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
+/** Start the thread delivering notifications to asynchronous listeners */
+void StartValidationInterfaceQueue();
+/** Deliver all pending notifications and stop the notification thread; later notifications run inline */
+void StopValidationInterfaceQueue();
+/**
+ * Wait until every notification queued before this call has been delivered.
+ * Must not be called with cs_main held. Returns immediately on the
+ * notification thread itself.
+ */
+void SyncWithValidationInterfaceQueue();
+/** Wait for the listeners to catch up if the queue has grown past MAX_VALIDATION_QUEUE_SIZE. Must not be called with cs_main held. */
+void LimitValidationInterfaceQueue();
+/** Number of notifications waiting for the notification thread */
+size_t GetValidationInterfaceQueueSize();
 /** Push an updated transaction to all registered wallets */
 void SyncWithWallets(const CTransaction& tx, const CBlockIndex *pindex, const CBlock* pblock = NULL);
 
@@ -41,9 +71,10 @@ protected:
     virtual void BlockChecked(const CBlock&, const CValidationState&) {}
     virtual void GetScriptForMining(boost::shared_ptr<CReserveScript>&) {};
     virtual void ResetRequestCount(const uint256 &hash) {};
-    friend void ::RegisterValidationInterface(CValidationInterface*);
+    friend void ::RegisterValidationInterface(CValidationInterface*, bool);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend struct ::CAsyncValidationDispatch;
 };
 
 struct CMainSignals {
@@ -70,6 +70,9 @@ bool EnsureWalletIsAvailable(bool avoidException)
         else
             return false;
     }
+    // Make the wallet reflect every block and transaction validated before this call
+    if (!avoidException)
+        SyncWithValidationInterfaceQueue();
     return true;
 }
 
@@ -2903,6 +2906,9 @@ UniValue mint(const UniValue& params, bool fHelp)
 
 UniValue mintzerocoin(const UniValue& params, bool fHelp)
 {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
     if (fHelp || params.size() != 1)
         throw runtime_error("mintzerocoin <amount>(1,10,25,50,100)\n" + HelpRequiringPassphrase());
 
@@ -2986,6 +2992,9 @@ UniValue mintzerocoin(const UniValue& params, bool fHelp)
 
 UniValue mintmanyzerocoin(const UniValue& params, bool fHelp)
 {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
     if (fHelp || params.size() == 0 || params.size() % 2 != 0 || params.size() > 10)
         throw runtime_error(
                 "mintmanyzerocoin <denomination>(1,10,25,50,100), numberOfMints, <denomination>(1,10,25,50,100), numberOfMints, ... }\n"
@@ -3103,6 +3112,8 @@ UniValue mintmanyzerocoin(const UniValue& params, bool fHelp)
 }
 
 UniValue spendzerocoin(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
 
     if (fHelp || params.size() < 1 || params.size() > 2)
         throw runtime_error(
@@ -3170,6 +3181,8 @@ UniValue spendzerocoin(const UniValue& params, bool fHelp) {
 }
 
 UniValue spendallzerocoin(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
 
     if (fHelp || params.size() >= 1)
         throw runtime_error(
@@ -3191,8 +3204,10 @@ UniValue spendallzerocoin(const UniValue& params, bool fHelp) {
 }
 
 UniValue spendmanyzerocoin(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
 
-        if (fHelp || params.size() != 1)
+    if (fHelp || params.size() != 1)
         throw runtime_error(
                 "spendmanyzerocoin \"{\"address\":\"<third party address or blank for internal>\", \"denominations\": [{\"value\":(1,10,25,50,100), \"amount\":<>}, {\"value\":(1,10,25,50,100), \"amount\":<>},...]}\"\n"
                 + HelpRequiringPassphrase()
@@ -3300,6 +3315,9 @@ UniValue spendmanyzerocoin(const UniValue& params, bool fHelp) {
 }
 
 UniValue spendmany(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
     if (fHelp || params.size() < 2 || params.size() > 5)
         throw std::runtime_error(
                 "spendmany \"fromaccount\" {\"address\":amount,...} ( minconf \"comment\" [\"address\",...] )\n"
@@ -3408,6 +3426,9 @@ UniValue spendmany(const UniValue& params, bool fHelp) {
 }
 
 UniValue resetmintzerocoin(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
     if (fHelp || params.size() != 0)
         throw runtime_error(
                 "resetmintzerocoin"
@@ -3435,6 +3456,8 @@ UniValue resetmintzerocoin(const UniValue& params, bool fHelp) {
 }
 
 UniValue resetsigmamint(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
 
     if (fHelp || params.size() != 0)
         throw runtime_error(
@@ -3461,6 +3484,9 @@ UniValue resetsigmamint(const UniValue& params, bool fHelp) {
 }
 
 UniValue listmintzerocoins(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
     if (fHelp || params.size() > 1)
         throw runtime_error(
                 "listmintzerocoins <all>(false/true)\n"
@@ -3497,6 +3523,8 @@ UniValue listmintzerocoins(const UniValue& params, bool fHelp) {
 }
 
 UniValue listsigmamints(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
 
     if (fHelp || params.size() > 1)
         throw runtime_error(
@@ -3540,6 +3568,9 @@ UniValue listsigmamints(const UniValue& params, bool fHelp) {
 
 
 UniValue listpubcoins(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
     if (fHelp || params.size() > 1)
         throw runtime_error(
                 "listpubcoins <all>(1/10/25/50/100)\n"
@@ -3577,6 +3608,8 @@ UniValue listpubcoins(const UniValue& params, bool fHelp) {
 }
 
 UniValue listsigmapubcoins(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
 
     std::string help_message =
         "listsigmapubcoins <all>(0.05/0.1/0.5/1/10/25/100)\n"
@@ -3631,6 +3664,9 @@ UniValue listsigmapubcoins(const UniValue& params, bool fHelp) {
 }
 
 UniValue setmintzerocoinstatus(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
     if (fHelp || params.size() != 2)
         throw runtime_error(
                 "setmintzerocoinstatus \"coinserial\" <isused>(true/false)\n"
@@ -3695,6 +3731,8 @@ UniValue setmintzerocoinstatus(const UniValue& params, bool fHelp) {
 }
 
 UniValue setsigmamintstatus(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
 
     if (fHelp || params.size() != 2)
         throw runtime_error(
@@ -4024,6 +4062,9 @@ UniValue removetxmempool(const UniValue &params, bool fHelp) {
 }
 
 UniValue removetxwallet(const UniValue& params, bool fHelp) {
+    if (!EnsureWalletIsAvailable(fHelp))
+        return NullUniValue;
+
     if (fHelp || params.size() != 1)
         throw runtime_error("removetxwallet <txid>\n" + HelpRequiringPassphrase());
 
@@ -23,6 +23,7 @@
 #include "../sigma/coin.h"
 #include "../sigma/remint.h"
 #include "../libzerocoin/SpendMetaData.h"
+#include "../libzerocoin/ParallelTasks.h"
 #include "net.h"
 #include "policy/policy.h"
 #include "primitives/block.h"
@@ -2051,8 +2052,8 @@ int CWallet::ScanForWalletTransactions(CBlockIndex *pindexStart, bool fUpdate, b
 
             CBlock block;
             ReadBlockFromDisk(block, pindex, Params().GetConsensus());
-            BOOST_FOREACH(CTransaction & tx, block.vtx)
-            {
+            for (const CTransactionRef &ptx: block.vtx) {
+                const CTransaction &tx = *ptx;
                 if (AddToWalletIfInvolvingMe(tx, &block, fUpdate))
                     ret++;
             }
@@ -6115,37 +6116,43 @@ bool CWallet::CreateMultipleSigmaSpendTransaction(
             uint256 txHashForMetadata = txTemp.GetHash();
             LogPrintf("txNew.GetHash: %s\n", txHashForMetadata.ToString());
 
-            std::vector<sigma::CoinSpend> spends;
+            // Create the CoinSpend objects and verify them. Proofs of the inputs are independent,
+            // so generate them in parallel
+            std::vector<std::unique_ptr<sigma::CoinSpend>> spends(tempStorages.size());
+            std::vector<char> passVerify(tempStorages.size(), false);
+            libzerocoin::ParallelTasks proofs(tempStorages.size());
+            for (size_t i = 0; i < tempStorages.size(); i++) {
+                proofs.Add([sigmaParams, &spends, &passVerify, &tempStorages, &txHashForMetadata, i] {
+                    const TempStorage &tempStorage = tempStorages[i];
+
+                    // We use incomplete transaction hash for now as a metadata
+                    sigma::SpendMetaData metaData(tempStorage.serializedId, tempStorage.blockHash, txHashForMetadata);
+                    bool fPadding = tempStorage.txVersion >= ZEROCOIN_TX_VERSION_3_1;
+
+                    spends[i].reset(new sigma::CoinSpend(sigmaParams,
+                                                         tempStorage.privateCoin,
+                                                         tempStorage.anonimity_set,
+                                                         metaData,
+                                                         fPadding));
+                    spends[i]->setVersion(tempStorage.txVersion);
+                    passVerify[i] = spends[i]->Verify(tempStorage.anonimity_set, metaData, fPadding);
+                });
+            }
+            proofs.Wait();
+
+            if (std::find(passVerify.begin(), passVerify.end(), false) != passVerify.end()) {
+                strFailReason = _("the spend coin transaction did not verify");
+                return false;
+            }
+
             // Iterator of std::vector<std::pair<int64_t, sigma::CoinDenomination>>::const_iterator
             for (auto it = denominations.begin(); it != denominations.end(); it++)
             {
                 unsigned index = it - denominations.begin();
 
-                // We use incomplete transaction hash for now as a metadata
-                sigma::SpendMetaData metaData(
-                    tempStorages[index].serializedId,
-                    tempStorages[index].blockHash,
-                    txHashForMetadata);
-
-
-                TempStorage tempStorage = tempStorages.at(index);
-                CSigmaEntry coinToUse = tempStorage.coinToUse;
-
-                bool fPadding = tempStorage.txVersion >= ZEROCOIN_TX_VERSION_3_1;
+                sigma::CoinSpend &spend = *spends[index];
+                CSigmaEntry coinToUse = tempStorages.at(index).coinToUse;
 
-                // Recreate CoinSpend object
-                sigma::CoinSpend spend(sigmaParams,
-                                       tempStorage.privateCoin,
-                                       tempStorage.anonimity_set,
-                                       metaData,
-                                       fPadding);
-                spend.setVersion(tempStorage.txVersion);
-                spends.push_back(spend);
-                // Verify the coinSpend
-                if (!spend.Verify(tempStorage.anonimity_set, metaData, fPadding)) {
-                    strFailReason = _("the spend coin transaction did not verify");
-                    return false;
-                }
                 // Serialize the CoinSpend object into a buffer.
                 CDataStream serializedCoinSpend(SER_NETWORK, PROTOCOL_VERSION);
                 serializedCoinSpend << spend;
@@ -6213,10 +6220,10 @@ bool CWallet::CreateMultipleSigmaSpendTransaction(
             for(int i = 0; i < txNew.vin.size(); i++){
                 // We use incomplete transaction hash as metadata.
                 sigma::SpendMetaData metaDataNew(tempStorages[i].serializedId, tempStorages[i].blockHash, txTempNew.GetHash());
-                spends[i].updateMetaData(tempStorages[i].privateCoin, metaDataNew);
+                spends[i]->updateMetaData(tempStorages[i].privateCoin, metaDataNew);
                 // Serialize the CoinSpend object into a buffer.
                 CDataStream serializedCoinSpendNew(SER_NETWORK, PROTOCOL_VERSION);
-                serializedCoinSpendNew << spends[i];
+                serializedCoinSpendNew << *spends[i];
                 CScript tmpNew = CScript() << OP_SIGMASPEND;
                 tmpNew.insert(tmpNew.end(), serializedCoinSpendNew.begin(), serializedCoinSpendNew.end());
                 txNew.vin[i].scriptSig.assign(tmpNew.begin(), tmpNew.end());
@@ -7981,7 +7988,7 @@ bool CWallet::InitLoadWallet() {
         zwalletMain = new CHDMintWallet(pwalletMain->strWalletFile);
     }
 
-    RegisterValidationInterface(walletInstance);
+    RegisterValidationInterface(walletInstance, true);
 
     CBlockIndex *pindexRescan = chainActive.Tip();
     if (GetBoolArg("-rescan", false))
@@ -8204,7 +8211,7 @@ int CMerkleTx::SetMerkleBranch(const CBlock &block) {
 
     // Locate the transaction
     for (nIndex = 0; nIndex < (int) block.vtx.size(); nIndex++)
-        if (block.vtx[nIndex] == *(CTransaction * )this)
+        if (*block.vtx[nIndex] == *(CTransaction * )this)
     break;
     if (nIndex == (int) block.vtx.size()) {
         nIndex = -1;
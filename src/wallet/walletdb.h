@@ -444,6 +444,40 @@ public:
         ListEntries<K, V, InsertF>(string("exodus_mint_v1"), insertF);
     }
 
+    // index of elysium transactions
+    bool ReadElysiumTxIndexVersion(int& version)
+    {
+        return Read(std::string("elysium_tx_version"), version);
+    }
+
+    bool WriteElysiumTxIndexVersion(int version)
+    {
+        return Write(std::string("elysium_tx_version"), version);
+    }
+
+    bool EraseElysiumTxIndexVersion()
+    {
+        return Erase(std::string("elysium_tx_version"));
+    }
+
+    template<class K, class V>
+    bool WriteElysiumTx(const K& k, const V& v)
+    {
+        return Write(std::make_pair(std::string("elysium_tx"), k), v);
+    }
+
+    template<class K>
+    bool EraseElysiumTx(const K& k)
+    {
+        return Erase(std::make_pair(std::string("elysium_tx"), k));
+    }
+
+    template<typename K, typename V, typename InsertF>
+    void ListElysiumTxs(InsertF insertF)
+    {
+        ListEntries<K, V, InsertF>(string("elysium_tx"), insertF);
+    }
+
 #endif
 
 private:
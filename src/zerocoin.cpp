@@ -9,6 +9,9 @@
 #include "wallet/wallet.h"
 #include "wallet/walletdb.h"
 #include "sigma/remint.h"
+#include "checkpoints.h"
+#include "txdb.h"
+#include "libzerocoin/ParallelTasks.h"
 
 #include <atomic>
 #include <sstream>
@@ -21,6 +24,8 @@ using namespace std;
 // Settings
 int64_t nTransactionFee = 0;
 int64_t nMinimumInputValue = DUST_HARD_LIMIT;
+bool fAssumeValidZerocoinProofs = DEFAULT_ASSUME_VALID_ZEROCOIN;
+int nZerocoinSnapshotInterval = DEFAULT_ZEROCOIN_SNAPSHOT_INTERVAL;
 
 // btzc: add zerocoin init
 // zerocoin init
@@ -213,6 +218,113 @@ bool CheckRemintLavaTransaction(const CTransaction &tx,
     return true;
 }
 
+// Accumulator values the spend could have been made against, the most recent first. Should be called with cs_main held
+static vector<CBigNum> GetZerocoinSpendAccumulatorValues(const libzerocoin::CoinSpend &spend,
+                                                         int spendVersion,
+                                                         const CZerocoinState::CoinGroupInfo &coinGroup,
+                                                         const pair<int,int> &denominationAndId,
+                                                         bool fAlternativeModulus) {
+    vector<CBigNum> accumulatorValues;
+    CBlockIndex *index = coinGroup.lastBlock;
+
+    bool spendHasBlockHash = false;
+
+    // Zerocoin v1.5/v2 transaction can cointain block hash of the last mint tx seen at the moment of spend. It speeds
+    // up verification
+    if (spendVersion > ZEROCOIN_TX_VERSION_1 && !spend.getAccumulatorBlockHash().IsNull()) {
+        spendHasBlockHash = true;
+        uint256 accumulatorBlockHash = spend.getAccumulatorBlockHash();
+
+        // find index for block with hash of accumulatorBlockHash or set index to the coinGroup.firstBlock if not found
+        while (index != coinGroup.firstBlock && index->GetBlockHash() != accumulatorBlockHash)
+            index = index->pprev;
+    }
+
+    decltype(&CBlockIndex::accumulatorChanges) accChanges = fAlternativeModulus ?
+                &CBlockIndex::alternativeAccumulatorChanges : &CBlockIndex::accumulatorChanges;
+
+    // Enumerate all the accumulator changes seen in the blockchain starting with the latest block
+    // In most cases the latest accumulator value will be used for verification
+    for (;;) {
+        ZerocoinLoadIndexData(index);
+        auto accChange = (index->*accChanges).find(denominationAndId);
+        if (accChange != (index->*accChanges).end())
+            accumulatorValues.push_back(accChange->second.first);
+
+        // if spend has block hash we don't need to look further
+        if (index == coinGroup.firstBlock || spendHasBlockHash)
+            break;
+
+        index = index->pprev;
+    }
+
+    return accumulatorValues;
+}
+
+// All the coins of the group sorted by the time of mint. Should be called with cs_main held
+static vector<CBigNum> GetZerocoinGroupPubCoins(const CZerocoinState::CoinGroupInfo &coinGroup, const pair<int,int> &denominationAndId) {
+    CBlockIndex *index = coinGroup.lastBlock;
+    ZerocoinLoadIndexData(index);
+    vector<CBigNum> pubCoins = index->mintedPubCoins[denominationAndId];
+    if (index != coinGroup.firstBlock) {
+        do {
+            index = index->pprev;
+            ZerocoinLoadIndexData(index);
+            if (index->mintedPubCoins.count(denominationAndId) > 0)
+                pubCoins.insert(pubCoins.begin(),
+                                index->mintedPubCoins[denominationAndId].cbegin(),
+                                index->mintedPubCoins[denominationAndId].cend());
+        } while (index != coinGroup.firstBlock);
+    }
+
+    return pubCoins;
+}
+
+// Verify spend proof against the accumulator values. Doesn't access the chain state except for getPubCoins
+// which is only called for v1 spends that didn't verify against any of the accumulator values
+static bool VerifyZerocoinSpendProof(const libzerocoin::CoinSpend &spend,
+                                     int spendVersion,
+                                     libzerocoin::Params *zcParams,
+                                     libzerocoin::CoinDenomination denomination,
+                                     const libzerocoin::SpendMetaData &metadata,
+                                     const vector<CBigNum> &accumulatorValues,
+                                     std::function<vector<CBigNum>()> getPubCoins) {
+    BOOST_FOREACH(const CBigNum &accumulatorValue, accumulatorValues) {
+        libzerocoin::Accumulator accumulator(zcParams, accumulatorValue, denomination);
+        LogPrintf("CheckSpendLavaTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
+        if (spend.Verify(accumulator, metadata))
+            return true;
+    }
+
+    // Rare case: accumulator value contains some but NOT ALL coins from one block. In this case we will
+    // have to enumerate over coins manually. No optimization is really needed here because it's a rarity
+    // This can't happen if spend is of version 1.5 or 2.0
+    if (spendVersion != ZEROCOIN_TX_VERSION_1)
+        return false;
+
+    vector<CBigNum> pubCoins = getPubCoins();
+
+    libzerocoin::Accumulator accumulator(zcParams, denomination);
+    BOOST_FOREACH(const CBigNum &pubCoin, pubCoins) {
+        accumulator += libzerocoin::PublicCoin(zcParams, pubCoin, denomination);
+        LogPrintf("CheckSpendLavaTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
+        if (spend.Verify(accumulator, metadata))
+            return true;
+    }
+
+    // One more time now in reverse direction. The only reason why it's required is compatibility with
+    // previous client versions
+    libzerocoin::Accumulator accumulatorRev(zcParams, denomination);
+    BOOST_REVERSE_FOREACH(const CBigNum &pubCoin, pubCoins) {
+        accumulatorRev += libzerocoin::PublicCoin(zcParams, pubCoin, denomination);
+        LogPrintf("CheckSpendLavaTransaction: accumulatorRev=%s\n", accumulatorRev.getValue().ToString().substr(0,15));
+        if (spend.Verify(accumulatorRev, metadata))
+            return true;
+    }
+
+    return false;
+}
+
 bool CheckSpendLavaTransaction(const CTransaction &tx,
                                 const Consensus::Params &params,
                                 const vector<libzerocoin::CoinDenomination>& targetDenominations,
@@ -288,7 +400,7 @@ bool CheckSpendLavaTransaction(const CTransaction &tx,
             }
         }
 
-        if (fModulusV2InIndex != fModulusV2 && fStatefulZerocoinCheck)
+        if (fModulusV2InIndex != fModulusV2 && fStatefulZerocoinCheck && !(zerocoinTxInfo && zerocoinTxInfo->fAssumeValidProofs))
             zerocoinState.CalculateAlternativeModulusAccumulatorValues(&chainActive, (int)targetDenominations[vinIndex], pubcoinId);
 
         uint256 txHashForMetadata;
@@ -365,82 +477,17 @@ bool CheckSpendLavaTransaction(const CTransaction &tx,
         if (!zerocoinState.GetCoinGroupInfo(targetDenominations[vinIndex], pubcoinId, coinGroup))
             return state.DoS(100, false, NO_MINT_ZEROCOIN, "CheckSpendLavaTransaction: Error: no coins were minted with such parameters");
 
-        bool passVerify = false;
-        CBlockIndex *index = coinGroup.lastBlock;
+        // Serials are tracked above, only the proof itself is assumed to be valid
+        if (zerocoinTxInfo && zerocoinTxInfo->fAssumeValidProofs)
+            continue;
 
         pair<int,int> denominationAndId = make_pair(targetDenominations[vinIndex], pubcoinId);
 
-        bool spendHasBlockHash = false;
-
-        // Zerocoin v1.5/v2 transaction can cointain block hash of the last mint tx seen at the moment of spend. It speeds
-        // up verification
-        if (spendVersion > ZEROCOIN_TX_VERSION_1 && !spend->getAccumulatorBlockHash().IsNull()) {
-			spendHasBlockHash = true;
-			uint256 accumulatorBlockHash = spend->getAccumulatorBlockHash();
-
-			// find index for block with hash of accumulatorBlockHash or set index to the coinGroup.firstBlock if not found
-			while (index != coinGroup.firstBlock && index->GetBlockHash() != accumulatorBlockHash)
-				index = index->pprev;
-		}
-
-        decltype(&CBlockIndex::accumulatorChanges) accChanges = fModulusV2 == fModulusV2InIndex ?
-                    &CBlockIndex::accumulatorChanges : &CBlockIndex::alternativeAccumulatorChanges;
-
-        // Enumerate all the accumulator changes seen in the blockchain starting with the latest block
-        // In most cases the latest accumulator value will be used for verification
-        do {
-            if ((index->*accChanges).count(denominationAndId) > 0) {
-                libzerocoin::Accumulator accumulator(zcParams,
-                                                     (index->*accChanges)[denominationAndId].first,
-                                                     targetDenominations[vinIndex]);
-                LogPrintf("CheckSpendLavaTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
-                passVerify = spend->Verify(accumulator, newMetadata);
-            }
+        vector<CBigNum> accumulatorValues = GetZerocoinSpendAccumulatorValues(*spend, spendVersion, coinGroup,
+                denominationAndId, fModulusV2 != fModulusV2InIndex);
 
-            // if spend has block hash we don't need to look further
-            if (index == coinGroup.firstBlock || spendHasBlockHash)
-                break;
-            else
-                index = index->pprev;
-        } while (!passVerify);
-
-        // Rare case: accumulator value contains some but NOT ALL coins from one block. In this case we will
-        // have to enumerate over coins manually. No optimization is really needed here because it's a rarity
-        // This can't happen if spend is of version 1.5 or 2.0
-        if (!passVerify && spendVersion == ZEROCOIN_TX_VERSION_1) {
-            // Build vector of coins sorted by the time of mint
-            index = coinGroup.lastBlock;
-            vector<CBigNum> pubCoins = index->mintedPubCoins[denominationAndId];
-            if (index != coinGroup.firstBlock) {
-                do {
-                    index = index->pprev;
-                    if (index->mintedPubCoins.count(denominationAndId) > 0)
-                        pubCoins.insert(pubCoins.begin(),
-                                        index->mintedPubCoins[denominationAndId].cbegin(),
-                                        index->mintedPubCoins[denominationAndId].cend());
-                } while (index != coinGroup.firstBlock);
-            }
-
-            libzerocoin::Accumulator accumulator(zcParams, targetDenominations[vinIndex]);
-            BOOST_FOREACH(const CBigNum &pubCoin, pubCoins) {
-                accumulator += libzerocoin::PublicCoin(zcParams, pubCoin, (libzerocoin::CoinDenomination)targetDenominations[vinIndex]);
-                LogPrintf("CheckSpendLavaTransaction: accumulator=%s\n", accumulator.getValue().ToString().substr(0,15));
-                if ((passVerify = spend->Verify(accumulator, newMetadata)) == true)
-                    break;
-            }
-
-            if (!passVerify) {
-                // One more time now in reverse direction. The only reason why it's required is compatibility with
-                // previous client versions
-                libzerocoin::Accumulator accumulator(zcParams, targetDenominations[vinIndex]);
-                BOOST_REVERSE_FOREACH(const CBigNum &pubCoin, pubCoins) {
-                    accumulator += libzerocoin::PublicCoin(zcParams, pubCoin, (libzerocoin::CoinDenomination)targetDenominations[vinIndex]);
-                    LogPrintf("CheckSpendLavaTransaction: accumulatorRev=%s\n", accumulator.getValue().ToString().substr(0,15));
-                    if ((passVerify = spend->Verify(accumulator, newMetadata)) == true)
-                        break;
-                }
-            }
-        }
+        bool passVerify = VerifyZerocoinSpendProof(*spend, spendVersion, zcParams, targetDenominations[vinIndex],
+                newMetadata, accumulatorValues, [&] { return GetZerocoinGroupPubCoins(coinGroup, denominationAndId); });
 
         if (!passVerify) {
             LogPrintf("CheckSpendZCoinTransaction: verification failed at block %d\n", nHeight);
@@ -716,6 +763,7 @@ bool ConnectBlockZC(CValidationState &state, const CChainParams &chainParams, CB
 
 	    if (!fJustCheck) {
             // clear the state
+            ZerocoinLoadIndexData(pindexNew);
 			pindexNew->spentSerials.clear();
             pindexNew->mintedPubCoins.clear();
             pindexNew->accumulatorChanges.clear();
@@ -783,6 +831,182 @@ bool ConnectBlockZC(CValidationState &state, const CChainParams &chainParams, CB
     return true;
 }
 
+bool IsZerocoinProofAssumedValid(const CBlockIndex *pindex, const CCheckpointData &checkpoints) {
+    if (!fAssumeValidZerocoinProofs)
+        return false;
+
+    // Same as with scripts: only ancestors of the last checkpoint are not verified
+    CBlockIndex *pindexLastCheckpoint = Checkpoints::GetLastCheckpoint(checkpoints);
+    return pindexLastCheckpoint && pindexLastCheckpoint->GetAncestor(pindex->nHeight) == pindex;
+}
+
+bool VerifyZerocoinSpendProofs(const CTransaction &tx, int nHeight, const Consensus::Params &params) {
+    uint256 txHashForMetadata;
+
+    BOOST_FOREACH(const CTxIn &txin, tx.vin) {
+        std::unique_ptr<libzerocoin::CoinSpend> spend;
+        uint32_t pubcoinId;
+
+        try {
+            std::tie(spend, pubcoinId) = ParseZerocoinSpend(txin);
+        } catch (CBadSequence&) {
+            return false;
+        } catch (CBadTxIn&) {
+            return false;
+        }
+
+        bool fModulusV2 = pubcoinId >= ZC_MODULUS_V2_BASE_ID;
+        if (fModulusV2)
+            pubcoinId -= ZC_MODULUS_V2_BASE_ID;
+        libzerocoin::Params *zcParams = fModulusV2 ? ZCParamsV2 : ZCParams;
+        libzerocoin::CoinDenomination denomination = spend->getDenomination();
+
+        int spendVersion = spend->getVersion();
+        bool fModulusV2InIndex = IsZerocoinTxV2(denomination, params, pubcoinId);
+        if (!fModulusV2InIndex && spendVersion == ZEROCOIN_TX_VERSION_2) {
+            // same as in CheckSpendLavaTransaction
+            spendVersion = ZEROCOIN_TX_VERSION_1;
+            spend->setVersion(ZEROCOIN_TX_VERSION_1);
+        }
+
+        if (spendVersion > ZEROCOIN_TX_VERSION_1 && txHashForMetadata.IsNull()) {
+            // Obtain the hash of the transaction sans the zerocoin part
+            CMutableTransaction txTemp = tx;
+            BOOST_FOREACH(CTxIn &txTempIn, txTemp.vin) {
+                if (txTempIn.scriptSig.IsZerocoinSpend()) {
+                    txTempIn.scriptSig.clear();
+                    txTempIn.prevout.SetNull();
+                }
+            }
+            txHashForMetadata = txTemp.GetHash();
+        }
+
+        pair<int,int> denominationAndId = make_pair((int)denomination, (int)pubcoinId);
+        CZerocoinState::CoinGroupInfo coinGroup;
+        vector<CBigNum> accumulatorValues;
+        {
+            LOCK(cs_main);
+
+            // the spend was checked against the coins minted before its block, later mints must not be used
+            if (!zerocoinState.GetCoinGroupInfoAtHeight(denomination, pubcoinId, nHeight, coinGroup))
+                return false;
+
+            if (fModulusV2InIndex != fModulusV2)
+                zerocoinState.CalculateAlternativeModulusAccumulatorValues(&chainActive, denomination, pubcoinId);
+
+            accumulatorValues = GetZerocoinSpendAccumulatorValues(*spend, spendVersion, coinGroup,
+                    denominationAndId, fModulusV2 != fModulusV2InIndex);
+        }
+
+        // the expensive part is done without holding cs_main
+        libzerocoin::SpendMetaData metadata(txin.nSequence, spendVersion > ZEROCOIN_TX_VERSION_1 ? txHashForMetadata : uint256());
+        if (!VerifyZerocoinSpendProof(*spend, spendVersion, zcParams, denomination, metadata, accumulatorValues,
+                [&] { LOCK(cs_main); return GetZerocoinGroupPubCoins(coinGroup, denominationAndId); }))
+            return false;
+    }
+
+    return true;
+}
+
+// The chain below the checkpoint can't be reorganized, so the best we can do is to stop at the invalid block
+static void InvalidateZerocoinSpendBlock(CBlockIndex *pindex) {
+    const CChainParams &chainparams = Params();
+
+    strMiscWarning = _("Warning: Invalid zerocoin spend found below the checkpoint, the block was invalidated! Restart with -assumevalidzerocoin=0 -reindex to verify the chain fully.");
+    AlertNotify(strMiscWarning);
+
+    CValidationState state;
+    {
+        LOCK(cs_main);
+        InvalidateBlock(state, chainparams, pindex);
+    }
+
+    if (state.IsValid())
+        ActivateBestChain(state, chainparams);
+
+    if (!state.IsValid())
+        LogPrintf("%s: failed to invalidate block %s: %s\n", __func__, pindex->GetBlockHash().ToString(), FormatStateMessage(state));
+}
+
+bool VerifyAssumedValidZerocoinProofs(int nLastHeight) {
+    const Consensus::Params &params = Params().GetConsensus();
+
+    int nVerifiedHeight;
+    if (!pblocktree->ReadZerocoinVerifiedHeight(nVerifiedHeight))
+        return false;
+
+    if (nVerifiedHeight >= nLastHeight)
+        return true;
+
+    LogPrintf("%s: verifying zerocoin spend proofs from block %d up to block %d\n", __func__, nVerifiedHeight + 1, nLastHeight);
+
+    int nVerified = 0;
+    for (int nHeight = nVerifiedHeight + 1; nHeight <= nLastHeight; nHeight++) {
+        boost::this_thread::interruption_point();
+
+        CBlockIndex *pindex;
+        {
+            LOCK(cs_main);
+            pindex = chainActive[nHeight];
+            if (!pindex)
+                return false;
+            if (pindex->spentSerials.empty())
+                continue;
+        }
+
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, params)) {
+            LogPrintf("%s: failed to read block %s from disk\n", __func__, pindex->GetBlockHash().ToString());
+            return false;
+        }
+
+        for (const CTransactionRef &ptx: block.vtx) {
+            const CTransaction &tx = *ptx;
+            if (!tx.IsZerocoinSpend())
+                continue;
+
+            if (!VerifyZerocoinSpendProofs(tx, nHeight, params)) {
+                LogPrintf("%s: zerocoin spend %s at block %d failed verification\n", __func__, tx.GetHash().ToString(), nHeight);
+                InvalidateZerocoinSpendBlock(pindex);
+                return false;
+            }
+
+            nVerified++;
+        }
+
+        // restart continues after the last block with spends instead of the very beginning
+        pblocktree->WriteZerocoinVerifiedHeight(nHeight);
+    }
+
+    pblocktree->WriteZerocoinVerifiedHeight(nLastHeight);
+
+    LogPrintf("%s: %d zerocoin spend transactions verified\n", __func__, nVerified);
+    return true;
+}
+
+void ThreadVerifyZerocoinProofs() {
+    RenameThread("lava-zcverify");
+
+    // Historical proofs are verified only when the thread pool has nothing better to do
+    libzerocoin::ParallelTasks::PriorityScope lowPriority(libzerocoin::PARALLEL_TASK_PRIORITY_LOW);
+
+    while (IsInitialBlockDownload())
+        MilliSleep(10000);
+
+    const CChainParams &chainparams = Params();
+
+    int nLastHeight;
+    {
+        LOCK(cs_main);
+        CBlockIndex *pindexCheckpoint = Checkpoints::GetLastCheckpoint(chainparams.Checkpoints());
+        if (!pindexCheckpoint || !chainActive.Contains(pindexCheckpoint))
+            return;
+        nLastHeight = std::min(pindexCheckpoint->nHeight, chainparams.GetConsensus().nDisableZerocoinStartBlock - 1);
+    }
+
+    VerifyAssumedValidZerocoinProofs(nLastHeight);
+}
+
 int ZerocoinGetNHeight(const CBlockHeader &block) {
     CBlockIndex *pindexPrev = NULL;
     int nHeight = 0;
@@ -795,14 +1019,99 @@ int ZerocoinGetNHeight(const CBlockHeader &block) {
 }
 
 
+// Height of the latest snapshot written or restored, -1 if none
+static int nLastZerocoinSnapshotHeight = -1;
+
+// Block index entries whose mint data was dropped from memory
+static set<CBlockIndex *> setZerocoinPrunedIndexes;
+
+void ZerocoinPruneIndexData(CBlockIndex *pindex) {
+    for (CBlockIndex *index = pindex; index; index = index->pprev) {
+        if (setZerocoinPrunedIndexes.count(index) > 0 ||
+                (index->mintedPubCoins.empty() && index->accumulatorChanges.empty()))
+            continue;
+
+        // swap with empty maps to release the memory
+        map<pair<int,int>, vector<CBigNum>>().swap(index->mintedPubCoins);
+        map<pair<int,int>, pair<CBigNum,int>>().swap(index->accumulatorChanges);
+        setZerocoinPrunedIndexes.insert(index);
+    }
+}
+
+void ZerocoinForgetPrunedIndexData() {
+    setZerocoinPrunedIndexes.clear();
+}
+
+void ZerocoinLoadIndexData(CBlockIndex *pindex) {
+    if (setZerocoinPrunedIndexes.count(pindex) == 0)
+        return;
+
+    CDiskBlockIndex diskindex;
+    if (!pblocktree || !pblocktree->ReadBlockIndex(pindex->GetBlockHash(), diskindex))
+        throw runtime_error(strprintf("%s: can't read block index entry %s", __func__, pindex->GetBlockHash().ToString()));
+
+    pindex->mintedPubCoins.swap(diskindex.mintedPubCoins);
+    pindex->accumulatorChanges.swap(diskindex.accumulatorChanges);
+    setZerocoinPrunedIndexes.erase(pindex);
+}
+
+// Restore zerocoin state from the latest snapshot belonging to the chain. Returns the block the snapshot
+// was taken at or NULL if there is no usable snapshot
+static CBlockIndex *ZerocoinRestoreStateSnapshot(CChain *chain) {
+    vector<uint256> snapshotHashes;
+    if (!pblocktree || !pblocktree->ReadZerocoinStateSnapshotList(snapshotHashes))
+        return NULL;
+
+    for (auto it = snapshotHashes.rbegin(); it != snapshotHashes.rend(); ++it) {
+        BlockMap::const_iterator mi = mapBlockIndex.find(*it);
+        if (mi == mapBlockIndex.end() || !chain->Contains(mi->second))
+            // snapshot was taken at the block that is no longer in the active chain
+            continue;
+
+        CZerocoinStateSnapshot snapshot;
+        try {
+            if (!pblocktree->ReadZerocoinStateSnapshot(*it, snapshot))
+                continue;
+        }
+        catch (const std::exception &e) {
+            LogPrintf("ZerocoinState: can't read snapshot at block %s: %s\n", it->ToString(), e.what());
+            continue;
+        }
+
+        if (zerocoinState.ApplySnapshot(chain, snapshot)) {
+            LogPrintf("ZerocoinState: restored from snapshot at height %d\n", snapshot.nHeight);
+            return mi->second;
+        }
+
+        LogPrintf("ZerocoinState: snapshot at block %s is inconsistent with the index, ignoring\n", it->ToString());
+    }
+
+    return NULL;
+}
+
 bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes) {
     auto params = Params().GetConsensus();
 
     zerocoinState.Reset();
-    for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
-        zerocoinState.AddBlock(blockIndex, params);
+    nLastZerocoinSnapshotHeight = -1;
+
+    CBlockIndex *snapshotBlock = ZerocoinRestoreStateSnapshot(chain);
+    if (snapshotBlock) {
+        // Snapshot is written only after accumulators were recalculated, replay only the blocks after it
+        nLastZerocoinSnapshotHeight = snapshotBlock->nHeight;
+        for (CBlockIndex *blockIndex = chain->Next(snapshotBlock); blockIndex; blockIndex=chain->Next(blockIndex))
+            zerocoinState.AddBlock(blockIndex, params);
+        changes.clear();
+
+        // Blocks covered by the snapshot are only needed for witnesses and reorgs below it
+        ZerocoinPruneIndexData(snapshotBlock);
+    }
+    else {
+        for (CBlockIndex *blockIndex = chain->Genesis(); blockIndex; blockIndex=chain->Next(blockIndex))
+            zerocoinState.AddBlock(blockIndex, params);
 
-    changes = zerocoinState.RecalculateAccumulators(chain);
+        changes = zerocoinState.RecalculateAccumulators(chain);
+    }
 
     // DEBUG
     LogPrintf("Latest IDs are %d, %d, %d, %d, %d\n",
@@ -814,6 +1123,29 @@ bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes) {
     return true;
 }
 
+bool ZerocoinWriteStateSnapshotIfNeeded(CBlockIndex *tip) {
+    AssertLockHeld(cs_main);
+
+    if (nZerocoinSnapshotInterval <= 0 || !tip || !pblocktree)
+        return true;
+
+    int nNextSnapshotHeight = std::max(nLastZerocoinSnapshotHeight, 0) + nZerocoinSnapshotInterval;
+    if (tip->nHeight < nNextSnapshotHeight)
+        return true;
+
+    CZerocoinStateSnapshot snapshot;
+    zerocoinState.GetSnapshot(tip, snapshot);
+    if (!pblocktree->WriteZerocoinStateSnapshot(snapshot, ZEROCOIN_SNAPSHOTS_TO_KEEP))
+        return error("%s: failed to write zerocoin state snapshot", __func__);
+
+    LogPrintf("ZerocoinState: snapshot written at height %d\n", tip->nHeight);
+    nLastZerocoinSnapshotHeight = tip->nHeight;
+
+    // The block index has just been flushed, so none of the entries is dirty
+    ZerocoinPruneIndexData(tip);
+    return true;
+}
+
 // CZerocoinTxInfo
 
 void CZerocoinTxInfo::Complete() {
@@ -868,6 +1200,7 @@ int CZerocoinState::AddMint(CBlockIndex *index, int denomination, const CBigNum
             coinGroup.firstBlock = coinGroup.lastBlock = index;
         }
         else {
+            ZerocoinLoadIndexData(coinGroup.lastBlock);
             previousAccValue = coinGroup.lastBlock->accumulatorChanges[make_pair(denomination,mintId)].first;
             coinGroup.lastBlock = index;
         }
@@ -893,6 +1226,7 @@ void CZerocoinState::AddSpend(const CBigNum &serial) {
 }
 
 void CZerocoinState::AddBlock(CBlockIndex *index, const Consensus::Params &params) {
+    ZerocoinLoadIndexData(index);
     BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), PAIRTYPE(CBigNum,int)) &accUpdate, index->accumulatorChanges)
     {
         CoinGroupInfo   &coinGroup = coinGroups[accUpdate.first];
@@ -922,6 +1256,7 @@ void CZerocoinState::AddBlock(CBlockIndex *index, const Consensus::Params &param
 }
 
 void CZerocoinState::RemoveBlock(CBlockIndex *index) {
+    ZerocoinLoadIndexData(index);
     // roll back accumulator updates
     BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), PAIRTYPE(CBigNum,int)) &accUpdate, index->accumulatorChanges)
     {
@@ -941,6 +1276,7 @@ void CZerocoinState::RemoveBlock(CBlockIndex *index) {
             do {
                 assert(coinGroup.lastBlock != coinGroup.firstBlock);
                 coinGroup.lastBlock = coinGroup.lastBlock->pprev;
+                ZerocoinLoadIndexData(coinGroup.lastBlock);
             } while (coinGroup.lastBlock->accumulatorChanges.count(accUpdate.first) == 0);
         }
     }
@@ -973,6 +1309,27 @@ bool CZerocoinState::GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &r
     return true;
 }
 
+bool CZerocoinState::GetCoinGroupInfoAtHeight(int denomination, int id, int nHeight, CoinGroupInfo &result) {
+    if (!GetCoinGroupInfo(denomination, id, result) || result.firstBlock->nHeight >= nHeight)
+        return false;
+
+    pair<int,int> key = make_pair(denomination, id);
+    while (result.lastBlock->nHeight >= nHeight) {
+        ZerocoinLoadIndexData(result.lastBlock);
+        auto mints = result.lastBlock->mintedPubCoins.find(key);
+        if (mints != result.lastBlock->mintedPubCoins.end())
+            result.nCoins -= mints->second.size();
+
+        // step back to the previous block of the group, first block is below nHeight so the loop stops there
+        do {
+            result.lastBlock = result.lastBlock->pprev;
+            ZerocoinLoadIndexData(result.lastBlock);
+        } while (result.lastBlock->mintedPubCoins.count(key) == 0);
+    }
+
+    return true;
+}
+
 bool CZerocoinState::IsUsedCoinSerial(const CBigNum &coinSerial) {
     return usedCoinSerials.count(coinSerial) != 0;
 }
@@ -992,6 +1349,8 @@ int CZerocoinState::GetAccumulatorValueForSpend(CChain *chain, int maxHeight, in
     CoinGroupInfo coinGroup = coinGroups[denomAndId];
     CBlockIndex *lastBlock = coinGroup.lastBlock;
 
+    ZerocoinLoadIndexData(lastBlock);
+    ZerocoinLoadIndexData(coinGroup.firstBlock);
     assert(lastBlock->accumulatorChanges.count(denomAndId) > 0);
     assert(coinGroup.firstBlock->accumulatorChanges.count(denomAndId) > 0);
 
@@ -1009,6 +1368,7 @@ int CZerocoinState::GetAccumulatorValueForSpend(CChain *chain, int maxHeight, in
 
     int numberOfCoins = 0;
     for (;;) {
+        ZerocoinLoadIndexData(lastBlock);
         map<pair<int,int>, pair<CBigNum,int>> &accumulatorChanges = lastBlock->*accChangeField;
         if (accumulatorChanges.count(denomAndId) > 0) {
             if (lastBlock->nHeight <= maxHeight) {
@@ -1064,6 +1424,7 @@ libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain
     if (block != coinGroup.firstBlock) {
         do {
             block = block->pprev;
+            ZerocoinLoadIndexData(block);
         } while ((block->*accChangeField).count(denomAndId) == 0);
         accumulator = libzerocoin::Accumulator(zcParams, (block->*accChangeField)[denomAndId].first, d);
     }
@@ -1071,6 +1432,7 @@ libzerocoin::AccumulatorWitness CZerocoinState::GetWitnessForSpend(CChain *chain
     // Now add to the accumulator every coin minted since that moment except pubCoin
     block = coinGroup.lastBlock;
     for (;;) {
+        ZerocoinLoadIndexData(block);
         if (block->nHeight <= maxHeight && block->mintedPubCoins.count(denomAndId) > 0) {
             vector<CBigNum> &pubCoins = block->mintedPubCoins[denomAndId];
             for (const CBigNum &coin: pubCoins) {
@@ -1115,6 +1477,7 @@ void CZerocoinState::CalculateAlternativeModulusAccumulatorValues(CChain *chain,
 
     CBlockIndex *block = coinGroup.firstBlock;
     for (;;) {
+        ZerocoinLoadIndexData(block);
         if (block->accumulatorChanges.count(denomAndId) > 0) {
             if (block->alternativeAccumulatorChanges.count(denomAndId) > 0)
                 // already calculated, update accumulator with cached value
@@ -1148,6 +1511,7 @@ bool CZerocoinState::TestValidity(CChain *chain) {
 
         CBlockIndex *block = coinGroup.second.firstBlock;
         for (;;) {
+            ZerocoinLoadIndexData(block);
             if (block->accumulatorChanges.count(coinGroup.first) > 0) {
                 if (block->mintedPubCoins.count(coinGroup.first) == 0) {
                     fprintf(stderr, "  no minted coins\n");
@@ -1194,6 +1558,7 @@ set<CBlockIndex *> CZerocoinState::RecalculateAccumulators(CChain *chain) {
         // Try to calculate accumulator for the first batch of mints. If it doesn't match we need to recalculate the rest of it
         CBlockIndex *block = coinGroup.second.firstBlock;
         for (;;) {
+            ZerocoinLoadIndexData(block);
             if (block->accumulatorChanges.count(coinGroup.first) > 0) {
                 BOOST_FOREACH(const CBigNum &pubCoin, block->mintedPubCoins[coinGroup.first]) {
                     acc += libzerocoin::PublicCoin(ZCParamsV2, pubCoin, (libzerocoin::CoinDenomination)coinGroup.first.first);
@@ -1289,6 +1654,90 @@ void CZerocoinState::Reset() {
     mempoolCoinSerials.clear();
 }
 
+void CZerocoinState::GetSnapshot(const CBlockIndex *index, CZerocoinStateSnapshot &snapshot) const {
+    snapshot = CZerocoinStateSnapshot();
+    snapshot.blockHash = index->GetBlockHash();
+    snapshot.nHeight = index->nHeight;
+
+    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CoinGroupInfo) &coinGroup, coinGroups) {
+        CZerocoinStateSnapshot::CoinGroup &group = snapshot.coinGroups[coinGroup.first];
+        group.firstBlockHash = coinGroup.second.firstBlock->GetBlockHash();
+        group.lastBlockHash = coinGroup.second.lastBlock->GetBlockHash();
+        group.nCoins = coinGroup.second.nCoins;
+    }
+
+    snapshot.mintedPubCoins.reserve(mintedPubCoins.size());
+    for (const auto &mint: mintedPubCoins) {
+        CZerocoinStateSnapshot::MintedCoin coin;
+        coin.pubCoin = mint.first;
+        coin.denomination = mint.second.denomination;
+        coin.id = mint.second.id;
+        coin.nHeight = mint.second.nHeight;
+        snapshot.mintedPubCoins.push_back(coin);
+    }
+
+    snapshot.latestCoinIds = latestCoinIds;
+    snapshot.usedCoinSerials.assign(usedCoinSerials.begin(), usedCoinSerials.end());
+}
+
+bool CZerocoinState::ApplySnapshot(CChain *chain, const CZerocoinStateSnapshot &snapshot) {
+    Reset();
+
+    if (snapshot.nSnapshotVersion != CZerocoinStateSnapshot::CURRENT_VERSION)
+        return false;
+
+    CBlockIndex *snapshotBlock = (*chain)[snapshot.nHeight];
+    if (!snapshotBlock || snapshotBlock->GetBlockHash() != snapshot.blockHash)
+        return false;
+
+    // Group boundaries are resolved against the active chain, both must be at or below the snapshot block
+    auto resolveBlock = [&](const uint256 &hash) -> CBlockIndex * {
+        BlockMap::const_iterator mi = mapBlockIndex.find(hash);
+        if (mi == mapBlockIndex.end() || mi->second->nHeight > snapshot.nHeight || !chain->Contains(mi->second))
+            return NULL;
+        return mi->second;
+    };
+
+    BOOST_FOREACH(const PAIRTYPE(PAIRTYPE(int,int), CZerocoinStateSnapshot::CoinGroup) &group, snapshot.coinGroups) {
+        CoinGroupInfo coinGroup;
+        coinGroup.firstBlock = resolveBlock(group.second.firstBlockHash);
+        coinGroup.lastBlock = resolveBlock(group.second.lastBlockHash);
+        coinGroup.nCoins = group.second.nCoins;
+
+        if (coinGroup.firstBlock && coinGroup.lastBlock) {
+            ZerocoinLoadIndexData(coinGroup.firstBlock);
+            ZerocoinLoadIndexData(coinGroup.lastBlock);
+        }
+
+        if (!coinGroup.firstBlock || !coinGroup.lastBlock
+                || coinGroup.firstBlock->accumulatorChanges.count(group.first) == 0
+                || coinGroup.lastBlock->accumulatorChanges.count(group.first) == 0) {
+            Reset();
+            return false;
+        }
+
+        coinGroups[group.first] = coinGroup;
+    }
+
+    mintedPubCoins.reserve(snapshot.mintedPubCoins.size());
+    BOOST_FOREACH(const CZerocoinStateSnapshot::MintedCoin &coin, snapshot.mintedPubCoins) {
+        CMintedCoinInfo coinInfo;
+        coinInfo.denomination = coin.denomination;
+        coinInfo.id = coin.id;
+        coinInfo.nHeight = coin.nHeight;
+        mintedPubCoins.insert(pair<CBigNum,CMintedCoinInfo>(coin.pubCoin, coinInfo));
+    }
+
+    latestCoinIds = snapshot.latestCoinIds;
+
+    usedCoinSerials.reserve(snapshot.usedCoinSerials.size());
+    BOOST_FOREACH(const CBigNum &serial, snapshot.usedCoinSerials) {
+        usedCoinSerials.insert(serial);
+    }
+
+    return true;
+}
+
 CZerocoinState *CZerocoinState::GetZerocoinState() {
     return &zerocoinState;
 }
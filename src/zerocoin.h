@@ -11,9 +11,24 @@
 #include <unordered_map>
 #include <functional>
 
+struct CCheckpointData;
+
 // zerocoin parameters
 extern libzerocoin::Params *ZCParams, *ZCParamsV2;
 
+// Skip spend proof verification in blocks below the last checkpoint
+static const bool DEFAULT_ASSUME_VALID_ZEROCOIN = true;
+// Re-check skipped spend proofs in the background after the initial sync
+static const bool DEFAULT_BACKGROUND_ZEROCOIN_VERIFY = false;
+
+// Write zerocoin state snapshot every that many blocks, 0 disables snapshots
+static const int DEFAULT_ZEROCOIN_SNAPSHOT_INTERVAL = 10000;
+// Number of snapshots kept in the block index database
+static const int ZEROCOIN_SNAPSHOTS_TO_KEEP = 2;
+
+extern bool fAssumeValidZerocoinProofs;
+extern int nZerocoinSnapshotInterval;
+
 // Test for zerocoin transaction version 2
 inline bool IsZerocoinTxV2(libzerocoin::CoinDenomination denomination, const Consensus::Params &params, int coinId) {
 	return ((denomination == libzerocoin::ZQ_LOVELACE) && (coinId >= params.nSpendV2ID_1))
@@ -40,7 +55,10 @@ public:
     // information about transactions in the block is complete
     bool fInfoIsComplete;
 
-    CZerocoinTxInfo(): fHasSpendV1(false), fInfoIsComplete(false) {}
+    // block is below the checkpoint, spend proofs are assumed to be valid and aren't verified
+    bool fAssumeValidProofs;
+
+    CZerocoinTxInfo(): fHasSpendV1(false), fInfoIsComplete(false), fAssumeValidProofs(false) {}
     // finalize everything
     void Complete();
 };
@@ -66,8 +84,105 @@ int ZerocoinGetNHeight(const CBlockHeader &block);
 
 bool ZerocoinBuildStateFromIndex(CChain *chain, set<CBlockIndex *> &changes);
 
+// Save zerocoin state into the block index database if enough blocks were connected since the last snapshot.
+// tip is the block the state corresponds to (best block of the coins database). Should be called after the
+// block index is flushed. Mint data of the blocks covered by the snapshot is dropped from memory
+bool ZerocoinWriteStateSnapshotIfNeeded(CBlockIndex *tip);
+
+// Drop mintedPubCoins/accumulatorChanges of pindex and its ancestors from memory, they are read back from the
+// block index database on access. The entries must not be dirty. Should be called with cs_main held
+void ZerocoinPruneIndexData(CBlockIndex *pindex);
+// Read back the mint data of the block index entry if it was pruned. Should be called with cs_main held before
+// accessing mintedPubCoins/accumulatorChanges or writing the entry to the database
+void ZerocoinLoadIndexData(CBlockIndex *pindex);
+// Forget about the pruned entries, should be called when the block index is unloaded
+void ZerocoinForgetPrunedIndexData();
+
 CBigNum ZerocoinGetSpendSerialNumber(const CTransaction &tx, const CTxIn &txin);
 
+// Check if spend proofs of the block are assumed to be valid, i.e. the block is an ancestor of the last checkpoint
+bool IsZerocoinProofAssumedValid(const CBlockIndex *pindex, const CCheckpointData &checkpoints);
+
+// Verify proofs of all the zerocoin spends in the transaction included into the active chain at given height
+bool VerifyZerocoinSpendProofs(const CTransaction &tx, int nHeight, const Consensus::Params &params);
+
+// Verify the spend proofs skipped during the initial sync up to nLastHeight, continuing from the height saved
+// in the block index database. The first block with an invalid spend is invalidated. Returns false if the
+// verification didn't complete
+bool VerifyAssumedValidZerocoinProofs(int nLastHeight);
+
+// Re-verify spend proofs skipped during the initial sync, meant to be run in a separate thread
+void ThreadVerifyZerocoinProofs();
+
+/*
+ * Serialized copy of CZerocoinState taken at some block of the active chain. Block pointers are
+ * replaced by block hashes
+ */
+class CZerocoinStateSnapshot {
+public:
+    struct CoinGroup {
+        uint256 firstBlockHash;
+        uint256 lastBlockHash;
+        int nCoins;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+            READWRITE(firstBlockHash);
+            READWRITE(lastBlockHash);
+            READWRITE(nCoins);
+        }
+    };
+
+    struct MintedCoin {
+        CBigNum pubCoin;
+        int denomination;
+        int id;
+        int nHeight;
+
+        ADD_SERIALIZE_METHODS;
+
+        template <typename Stream, typename Operation>
+        inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+            READWRITE(pubCoin);
+            READWRITE(denomination);
+            READWRITE(id);
+            READWRITE(nHeight);
+        }
+    };
+
+    static const int CURRENT_VERSION = 1;
+
+    int nSnapshotVersion;
+    // block the snapshot was taken at
+    uint256 blockHash;
+    int nHeight;
+
+    map<pair<int,int>, CoinGroup> coinGroups;
+    vector<MintedCoin> mintedPubCoins;
+    map<int, int> latestCoinIds;
+    vector<CBigNum> usedCoinSerials;
+
+    CZerocoinStateSnapshot() : nSnapshotVersion(CURRENT_VERSION), nHeight(-1) {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(nSnapshotVersion);
+        if (nSnapshotVersion != CURRENT_VERSION)
+            // unknown format, caller will rebuild the state from the index
+            return;
+        READWRITE(blockHash);
+        READWRITE(nHeight);
+        READWRITE(coinGroups);
+        READWRITE(mintedPubCoins);
+        READWRITE(latestCoinIds);
+        READWRITE(usedCoinSerials);
+    }
+};
+
 /*
  * State of minted/spent coins as extracted from the index
  */
@@ -128,12 +243,16 @@ public:
 
     // Query coin group with given denomination and id
     bool GetCoinGroupInfo(int denomination, int id, CoinGroupInfo &result);
+    // Query coin group as it was seen by the block at given height, i.e. with the coins minted below it only
+    bool GetCoinGroupInfoAtHeight(int denomination, int id, int nHeight, CoinGroupInfo &result);
 
     // Query if the coin serial was previously used
     bool IsUsedCoinSerial(const CBigNum &coinSerial);
     // Query if there is a coin with given pubCoin value
     bool HasCoin(const CBigNum &pubCoin);
 
+    std::size_t GetTotalCoins() const { return mintedPubCoins.size(); }
+
     // Given denomination and id returns latest accumulator value and corresponding block hash
     // Do not take into account coins with height more than maxHeight
     // Returns number of coins satisfying conditions
@@ -151,6 +270,12 @@ public:
     // Reset to initial values
     void Reset();
 
+    // Copy the state into the snapshot. index should be the tip of the chain the state corresponds to
+    void GetSnapshot(const CBlockIndex *index, CZerocoinStateSnapshot &snapshot) const;
+    // Restore the state from the snapshot taken at the block belonging to chain. Returns false (and leaves
+    // the state reset) if the snapshot doesn't match the chain
+    bool ApplySnapshot(CChain *chain, const CZerocoinStateSnapshot &snapshot);
+
     // Test function
     bool TestValidity(CChain *chain);
 
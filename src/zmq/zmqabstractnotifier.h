@@ -32,7 +32,10 @@ public:
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
+    //! The tip changed to pindex, called when blocks are connected and disconnected
     virtual bool NotifyBlock(const CBlockIndex *pindex);
+    //! pindex was connected to the active chain, called once per block in chain order
+    virtual bool NotifyBlockConnected(const CBlockIndex *pindex);
     virtual bool NotifyTransaction(const CTransaction &transaction);
 
 protected:
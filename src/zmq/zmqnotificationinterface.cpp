@@ -10,12 +10,14 @@
 #include "streams.h"
 #include "util.h"
 
+#include <algorithm>
+
 void zmqError(const char *str)
 {
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL), pindexLastTip(NULL)
 {
 }
 
@@ -39,6 +41,9 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubhashtx"] = CZMQAbstractNotifier::Create<CZMQPublishHashTransactionNotifier>;
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
+    factories["pubsigmamint"] = CZMQAbstractNotifier::Create<CZMQPublishSigmaMintNotifier>;
+    factories["pubsigmaspend"] = CZMQAbstractNotifier::Create<CZMQPublishSigmaSpendNotifier>;
+    factories["pubelysiumtx"] = CZMQAbstractNotifier::Create<CZMQPublishElysiumTransactionNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -107,6 +112,7 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    StartZMQPublisher(std::max((int64_t)GetArg("-zmqpubqueue", DEFAULT_ZMQ_PUBLISH_QUEUE), (int64_t)1));
     return true;
 }
 
@@ -116,6 +122,9 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
     if (pcontext)
     {
+        // Send what is queued while the sockets are still open
+        StopZMQPublisher();
+
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -128,12 +137,40 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
+std::vector<const CBlockIndex*> GetConnectedBlocks(const CBlockIndex* pindexOld, const CBlockIndex* pindexNew)
+{
+    std::vector<const CBlockIndex*> vConnected;
+    if (!pindexNew)
+        return vConnected;
+    const CBlockIndex* pindexFork = pindexNew->pprev;
+    if (pindexOld) {
+        pindexFork = pindexOld->nHeight > pindexNew->nHeight ? pindexOld->GetAncestor(pindexNew->nHeight) : pindexOld;
+        while (pindexFork && pindexNew->GetAncestor(pindexFork->nHeight) != pindexFork)
+            pindexFork = pindexFork->pprev;
+    }
+    for (const CBlockIndex* pindex = pindexNew; pindex && pindex != pindexFork; pindex = pindex->pprev)
+        vConnected.push_back(pindex);
+    std::reverse(vConnected.begin(), vConnected.end());
+    return vConnected;
+}
+
 void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
 {
+    // The tip also moves back when blocks are disconnected, the connected topics only get new blocks
+    std::vector<const CBlockIndex*> vConnected;
+    {
+        boost::unique_lock<boost::mutex> lock(csLastTip);
+        vConnected = GetConnectedBlocks(pindexLastTip, pindex);
+        pindexLastTip = pindex;
+    }
+
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex))
+        bool fOk = notifier->NotifyBlock(pindex);
+        for (size_t n = 0; fOk && n < vConnected.size(); n++)
+            fOk = notifier->NotifyBlockConnected(vConnected[n]);
+        if (fOk)
         {
             i++;
         }
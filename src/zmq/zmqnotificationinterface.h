@@ -6,12 +6,49 @@
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
 #include "validationinterface.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <list>
 #include <string>
 #include <map>
+#include <vector>
+
+#include <boost/thread/mutex.hpp>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+/** Default for -zmqpubqueue, messages waiting to be published before new ones are dropped */
+static const unsigned int DEFAULT_ZMQ_PUBLISH_QUEUE = 10000;
+
+/** Counters of the publisher thread */
+struct CZMQPublisherStats
+{
+    size_t nQueued;         //!< messages waiting to be sent
+    size_t nMaxQueued;      //!< queue limit, see -zmqpubqueue
+    size_t nHighWater;      //!< largest number of messages that were waiting at once
+    uint64_t nPublished;    //!< messages sent
+    uint64_t nDropped;      //!< messages dropped because the queue was full
+    uint64_t nFailed;       //!< messages that couldn't be produced or sent
+    uint64_t nBatches;      //!< number of times the thread emptied the queue
+};
+
+/**
+ * Messages are queued by the validation callbacks and sent by a dedicated thread, so slow
+ * subscribers and expensive payloads don't delay block connection. Start before the first
+ * message is queued and stop before the notifiers are shut down.
+ */
+void StartZMQPublisher(size_t nMaxQueued);
+void StopZMQPublisher();
+CZMQPublisherStats GetZMQPublisherStats();
+
+/**
+ * Blocks connected when the tip moves from pindexOld to pindexNew, in chain order: the blocks of
+ * pindexNew's chain above its fork with pindexOld. Empty if the tip only moved back. Without an old
+ * tip, pindexNew is the only connected block.
+ */
+std::vector<const CBlockIndex*> GetConnectedBlocks(const CBlockIndex* pindexOld, const CBlockIndex* pindexNew);
+
 class CZMQNotificationInterface : public CValidationInterface
 {
 public:
@@ -32,6 +69,10 @@ private:
 
     void *pcontext;
     std::list<CZMQAbstractNotifier*> notifiers;
+
+    //! Tip of the last UpdatedBlockTip, to tell connected from disconnected blocks
+    boost::mutex csLastTip;
+    const CBlockIndex* pindexLastTip;
 };
 
 #endif // BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
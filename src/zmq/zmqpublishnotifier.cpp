@@ -3,17 +3,181 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "chainparams.h"
+#include "chaintip.h"
 #include "zmqpublishnotifier.h"
 #include "main.h"
+#include "sync.h"
 #include "util.h"
 #include "rpc/server.h"
 
+#ifdef ENABLE_ELYSIUM
+#include "elysium/elysium.h"
+#include "elysium/packetencoder.h"
+#endif
+
+#include <deque>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread.hpp>
+
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
-static const char *MSG_HASHBLOCK = "hashblock";
-static const char *MSG_HASHTX    = "hashtx";
-static const char *MSG_RAWBLOCK  = "rawblock";
-static const char *MSG_RAWTX     = "rawtx";
+static const char *MSG_HASHBLOCK  = "hashblock";
+static const char *MSG_HASHTX     = "hashtx";
+static const char *MSG_RAWBLOCK   = "rawblock";
+static const char *MSG_RAWTX      = "rawtx";
+static const char *MSG_SIGMAMINT  = "sigmamint";
+static const char *MSG_SIGMASPEND = "sigmaspend";
+static const char *MSG_ELYSIUMTX  = "elysiumtx";
+
+/** Message waiting for the publisher thread */
+struct CZMQQueuedMessage
+{
+    CZMQAbstractPublishNotifier *notifier;
+    const char *command;
+    uint32_t nSequence;
+    std::string data;
+    //! Produces data on the publisher thread if set
+    boost::function<bool(std::string&)> produce;
+};
+
+/** Bounded message queue and the thread sending its messages */
+class CZMQPublisher
+{
+private:
+    CWaitableCriticalSection cs;
+    CConditionVariable cond;
+    std::deque<CZMQQueuedMessage> queue;
+    bool fRunning;
+    boost::thread thread;
+    CZMQPublisherStats stats;
+
+    void Run();
+
+public:
+    CZMQPublisher() : fRunning(false)
+    {
+        memset(&stats, 0, sizeof(stats));
+        stats.nMaxQueued = DEFAULT_ZMQ_PUBLISH_QUEUE;
+    }
+
+    void Start(size_t nMaxQueued);
+    void Stop();
+    void Queue(CZMQQueuedMessage& message);
+    CZMQPublisherStats GetStats();
+};
+
+static CZMQPublisher publisher;
+
+void CZMQPublisher::Start(size_t nMaxQueued)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    assert(!fRunning);
+    stats.nMaxQueued = nMaxQueued;
+    fRunning = true;
+    thread = boost::thread(boost::bind(&CZMQPublisher::Run, this));
+}
+
+void CZMQPublisher::Stop()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (!fRunning)
+            return;
+        fRunning = false;
+        cond.notify_all();
+    }
+    // The thread sends what was queued before it exits
+    thread.join();
+}
+
+void CZMQPublisher::Queue(CZMQQueuedMessage& message)
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    // Dropped messages use up a sequence number too, so subscribers can detect the loss
+    message.nSequence = message.notifier->nSequence++;
+    if (!fRunning) {
+        stats.nDropped++;
+        LogPrint("zmq", "zmq: publisher is stopped, dropping %s notification\n", message.command);
+        return;
+    }
+    if (queue.size() >= stats.nMaxQueued) {
+        if (stats.nDropped++ == 0)
+            LogPrintf("zmq: publish queue is full, dropping %s notifications\n", message.command);
+        return;
+    }
+    queue.push_back(CZMQQueuedMessage());
+    queue.back().notifier = message.notifier;
+    queue.back().command = message.command;
+    queue.back().nSequence = message.nSequence;
+    queue.back().data.swap(message.data);
+    queue.back().produce = message.produce;
+    stats.nHighWater = std::max(stats.nHighWater, queue.size());
+    cond.notify_one();
+}
+
+void CZMQPublisher::Run()
+{
+    RenameThread("bitcoin-zmqpub");
+    std::deque<CZMQQueuedMessage> batch;
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            while (fRunning && queue.empty())
+                cond.wait(lock);
+            if (queue.empty())
+                break;
+            // Take everything queued so far, the queue is available to the callbacks again right away
+            batch.swap(queue);
+            stats.nBatches++;
+        }
+
+        uint64_t nPublished = 0, nFailed = 0;
+        BOOST_FOREACH(CZMQQueuedMessage& message, batch) {
+            CZMQAbstractPublishNotifier *notifier = message.notifier;
+            if (notifier->fFailed || (message.produce && !message.produce(message.data))) {
+                nFailed++;
+                continue;
+            }
+            if (notifier->SendMessage(message.command, message.data.data(), message.data.size(), message.nSequence)) {
+                nPublished++;
+            } else {
+                LogPrintf("zmq: Failed to publish %s on %s, notifier disabled\n", message.command, notifier->GetAddress());
+                notifier->fFailed = true;
+                nFailed++;
+            }
+        }
+        batch.clear();
+
+        boost::unique_lock<boost::mutex> lock(cs);
+        stats.nPublished += nPublished;
+        stats.nFailed += nFailed;
+    }
+}
+
+CZMQPublisherStats CZMQPublisher::GetStats()
+{
+    boost::unique_lock<boost::mutex> lock(cs);
+    CZMQPublisherStats result = stats;
+    result.nQueued = queue.size();
+    return result;
+}
+
+void StartZMQPublisher(size_t nMaxQueued)
+{
+    publisher.Start(nMaxQueued);
+}
+
+void StopZMQPublisher()
+{
+    publisher.Stop();
+}
+
+CZMQPublisherStats GetZMQPublisherStats()
+{
+    return publisher.GetStats();
+}
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -124,20 +288,37 @@ void CZMQAbstractPublishNotifier::Shutdown()
     psocket = 0;
 }
 
-bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size, uint32_t nMessageSequence)
 {
     assert(psocket);
 
     /* send three parts, command & data & a LE 4byte sequence number */
     unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
+    WriteLE32(&msgseq[0], nMessageSequence);
     int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
     if (rc == -1)
         return false;
 
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    return true;
+}
 
+bool CZMQAbstractPublishNotifier::QueueMessage(const char *command, const std::string& data)
+{
+    CZMQQueuedMessage message;
+    message.notifier = this;
+    message.command = command;
+    message.data = data;
+    publisher.Queue(message);
+    return true;
+}
+
+bool CZMQAbstractPublishNotifier::QueueMessage(const char *command, const boost::function<bool(std::string&)>& produce)
+{
+    CZMQQueuedMessage message;
+    message.notifier = this;
+    message.command = command;
+    message.produce = produce;
+    publisher.Queue(message);
     return true;
 }
 
@@ -148,7 +329,7 @@ bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHBLOCK, data, 32);
+    return QueueMessage(MSG_HASHBLOCK, std::string(data, 32));
 }
 
 bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
@@ -158,35 +339,79 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     char data[32];
     for (unsigned int i = 0; i < 32; i++)
         data[31 - i] = hash.begin()[i];
-    return SendMessage(MSG_HASHTX, data, 32);
+    return QueueMessage(MSG_HASHTX, std::string(data, 32));
+}
+
+/** Read and serialize the block on the publisher thread, block index entries live as long as the node */
+static bool ProduceRawBlock(const CBlockIndex *pindex, std::string& data)
+{
+    CBlock block;
+    if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus()))
+    {
+        zmqError("Can't read block from disk");
+        return false;
+    }
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+    ss << block;
+    data = ss.str();
+    return true;
 }
 
 bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
+    return QueueMessage(MSG_RAWBLOCK, boost::bind(&ProduceRawBlock, pindex, _1));
+}
 
-    const Consensus::Params& consensusParams = Params().GetConsensus();
+bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+{
+    uint256 hash = transaction.GetHash();
+    LogPrint("zmq", "zmq: Publish rawtx %s\n", hash.GetHex());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
+    ss << transaction;
+    return QueueMessage(MSG_RAWTX, ss.str());
+}
+
+bool CZMQPublishSigmaMintNotifier::NotifyBlockConnected(const CBlockIndex *pindex)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
     {
+        // The mints of the block index are updated while blocks are connected and disconnected
         LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex, consensusParams))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
+        if (pindex->sigmaMintedPubCoins.empty())
+            return true;
+        ss << pindex->GetBlockHash() << pindex->nHeight << pindex->sigmaMintedPubCoins;
     }
+    LogPrint("zmq", "zmq: Publish sigmamint %s\n", pindex->GetBlockHash().GetHex());
+    return QueueMessage(MSG_SIGMAMINT, ss.str());
+}
 
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+bool CZMQPublishSigmaSpendNotifier::NotifyBlockConnected(const CBlockIndex *pindex)
+{
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    {
+        LOCK(cs_main);
+        if (pindex->sigmaSpentSerials.empty())
+            return true;
+        ss << pindex->GetBlockHash() << pindex->nHeight << pindex->sigmaSpentSerials;
+    }
+    LogPrint("zmq", "zmq: Publish sigmaspend %s\n", pindex->GetBlockHash().GetHex());
+    return QueueMessage(MSG_SIGMASPEND, ss.str());
 }
 
-bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool CZMQPublishElysiumTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
 {
+#ifdef ENABLE_ELYSIUM
+    if (!isElysiumEnabled() || !elysium::DeterminePacketClass(transaction, GetChainTipSnapshot()->nHeight + 1))
+        return true;
+
     uint256 hash = transaction.GetHash();
-    LogPrint("zmq", "zmq: Publish rawtx %s\n", hash.GetHex());
+    LogPrint("zmq", "zmq: Publish elysiumtx %s\n", hash.GetHex());
     CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | RPCSerializationFlags());
     ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    return QueueMessage(MSG_ELYSIUMTX, ss.str());
+#else
+    return true;
+#endif
 }
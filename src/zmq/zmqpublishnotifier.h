@@ -6,15 +6,22 @@
 #define BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 
 #include "zmqabstractnotifier.h"
+#include "zmqnotificationinterface.h"
+
+#include <boost/function.hpp>
 
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; //!< upcounting per message sequence number
+    uint32_t nSequence; //!< upcounting per message sequence number, also counts dropped messages
+    bool fFailed;       //!< a message couldn't be sent, the notifier doesn't publish anymore
+
+    friend class CZMQPublisher;
 
 public:
+    CZMQAbstractPublishNotifier() : nSequence(0), fFailed(false) {}
 
     /* send zmq multipart message
        parts:
@@ -22,7 +29,13 @@ public:
           * data
           * message sequence number
     */
-    bool SendMessage(const char *command, const void* data, size_t size);
+    bool SendMessage(const char *command, const void* data, size_t size, uint32_t nMessageSequence);
+
+    /** Queue a message for the publisher thread */
+    bool QueueMessage(const char *command, const std::string& data);
+
+    /** Queue a message whose data is produced by the publisher thread. produce returns false if it failed */
+    bool QueueMessage(const char *command, const boost::function<bool(std::string&)>& produce);
 
     bool Initialize(void *pcontext);
     void Shutdown();
@@ -52,4 +65,25 @@ public:
     bool NotifyTransaction(const CTransaction &transaction);
 };
 
+/** Sigma coins minted by a connected block */
+class CZMQPublishSigmaMintNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnected(const CBlockIndex *pindex);
+};
+
+/** Sigma serials spent by a connected block */
+class CZMQPublishSigmaSpendNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockConnected(const CBlockIndex *pindex);
+};
+
+/** Raw transactions that carry an Elysium packet */
+class CZMQPublishElysiumTransactionNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyTransaction(const CTransaction &transaction);
+};
+
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H